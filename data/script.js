@@ -1,7 +1,23 @@
 let websocket;
 let chart;
 const statusDiv = document.getElementById('status');
-const MAX_DATA_POINTS = 100;
+// Limite de pontos no gráfico; a janela de tempo (seletor "Histórico") é
+// quem normalmente corta os pontos antigos
+const MAX_DATA_POINTS = 3000;
+
+// Quadro binario da assinatura de telemetria (ver src/subscriptions.h),
+// little-endian; so os canais assinados vem em cada registro
+const TELEMETRY_MAGIC = 0x4D54;
+const TELEMETRY_VERSION = 2;
+const TELEMETRY_HEADER_SIZE = 20;
+const TELEMETRY_FLAG_ACTIVE = 1;
+const TELEMETRY_FLAG_PROFILE = 8;
+const TELEMETRY_CHANNELS = [[1, 'sp_v'], [2, 'y_v'], [4, 'u'], [8, 'iTerm']];
+// O gráfico só usa setpoint e saída
+const TELEMETRY_SUBSCRIPTION = { assinar: { canais: ["sp", "y"], decimacao: 1 } };
+let expectedNext = null;
+let lostRecords = 0;
+let droppedRecords = 0;
 
 // Função para inicializar o gráfico
 function initChart() {
@@ -42,26 +58,181 @@ function initChart() {
     });
 }
 
-// Função para adicionar dados ao gráfico
+// Janela do gráfico e duração de cada ponto, vindas da última resposta do
+// histórico; as amostras ao vivo são agrupadas na mesma resolução
+let chartWindowS = 600;
+let chartPeriodMs = 200;
+let liveBin = null;
+
+// Função para adicionar dados ao gráfico (chart.update() fica com quem chama)
 function addDataToChart(time, sp, y) {
     if (!chart) return;
 
-    // Remove o ponto mais antigo se o limite for atingido
-    if (chart.data.labels.length > MAX_DATA_POINTS) {
-        chart.data.labels.shift();
+    // Remove os pontos fora da janela (ou acima do limite)
+    const labels = chart.data.labels;
+    while (labels.length > 0 && (labels.length >= MAX_DATA_POINTS || labels[0] < time / 1000 - chartWindowS)) {
+        labels.shift();
         chart.data.datasets.forEach((dataset) => {
             dataset.data.shift();
         });
     }
 
     // Adiciona os novos pontos
-    chart.data.labels.push(time / 1000); // Converte ms para s
+    labels.push(time / 1000); // Converte ms para s
     chart.data.datasets[0].data.push(sp);
     chart.data.datasets[1].data.push(y);
+}
+
+// Amostra ao vivo: com pontos de mais de um ciclo, entra a média do grupo
+function addLiveSample(time, sp, y) {
+    if (chartPeriodMs <= 200) {
+        addDataToChart(time, sp, y);
+        return;
+    }
+    if (!liveBin) liveBin = { time: time, sp: 0, y: 0, n: 0 };
+    liveBin.sp += sp;
+    liveBin.y += y;
+    liveBin.n++;
+    if (time - liveBin.time + 200 >= chartPeriodMs) {
+        addDataToChart(liveBin.time, liveBin.sp / liveBin.n, liveBin.y / liveBin.n);
+        liveBin = null;
+    }
+}
+
+// Histórico em várias resoluções (ver src/history.h): uma resposta traz a
+// janela inteira e substitui o gráfico
+const HISTORY_MAGIC = 0x4948;
+const HISTORY_VERSION = 1;
+const HISTORY_HEADER_SIZE = 20;
+const HISTORY_RAW_POINT_SIZE = 8;
+let historyId = 0;
+
+function requestHistory() {
+    if (!websocket || websocket.readyState !== WebSocket.OPEN) return;
+    historyId = historyId % 65535 + 1;
+    websocket.send(JSON.stringify({
+        historico: { janela_s: parseInt(document.getElementById('janela_historico').value, 10), id: historyId }
+    }));
+}
 
+function handleHistoryFrame(buffer) {
+    const view = new DataView(buffer);
+    if (buffer.byteLength < HISTORY_HEADER_SIZE || view.getUint8(2) !== HISTORY_VERSION) {
+        console.error("Quadro de histórico inválido");
+        return;
+    }
+    const id = view.getUint16(4, true);
+    const count = view.getUint16(6, true);
+    const pointSize = view.getUint8(8);
+    const periodMs = view.getUint32(12, true);
+    const firstMs = view.getUint32(16, true);
+    if (buffer.byteLength < HISTORY_HEADER_SIZE + count * pointSize) {
+        console.error("Quadro de histórico truncado");
+        return;
+    }
+    // O histórico de quem acabou de conectar (id 0) não vale se a página já
+    // pediu outra janela
+    if (id === 0 && historyId !== 0) return;
+    if (id !== 0 && id !== historyId) return;
+
+    chartWindowS = parseInt(document.getElementById('janela_historico').value, 10);
+    chartPeriodMs = periodMs;
+    liveBin = null;
+    chart.data.labels = [];
+    chart.data.datasets.forEach((dataset) => { dataset.data = []; });
+
+    // Valores em mV; pontos resumidos trazem mínimo, máximo e média
+    for (let i = 0; i < count; i++) {
+        const offset = HISTORY_HEADER_SIZE + i * pointSize;
+        let sp, y;
+        if (pointSize === HISTORY_RAW_POINT_SIZE) {
+            if (view.getUint8(offset + 6) === 0) continue;
+            sp = view.getInt16(offset, true);
+            y = view.getInt16(offset + 2, true);
+        } else {
+            if (view.getUint16(offset, true) === 0) continue;
+            sp = view.getInt16(offset + 8, true);
+            y = view.getInt16(offset + 14, true);
+        }
+        addDataToChart(firstMs + i * periodMs, sp / 1000, y / 1000);
+    }
     chart.update();
 }
 
+// Decodifica um quadro com todas as amostras desde o envio anterior
+function decodeTelemetryFrame(buffer) {
+    const view = new DataView(buffer);
+    if (buffer.byteLength < TELEMETRY_HEADER_SIZE ||
+        view.getUint16(0, true) !== TELEMETRY_MAGIC || view.getUint8(2) !== TELEMETRY_VERSION) {
+        console.error("Quadro de telemetria inválido");
+        return null;
+    }
+
+    const recordSize = view.getUint8(3);
+    const frame = {
+        first: view.getUint32(4, true),
+        next: view.getUint32(8, true),
+        count: view.getUint16(12, true),
+        dropped: view.getUint16(14, true),
+        channels: view.getUint8(16),
+        decimation: view.getUint8(17),
+        skipped: view.getUint16(18, true),
+        records: []
+    };
+    if (buffer.byteLength < TELEMETRY_HEADER_SIZE + frame.count * recordSize) {
+        console.error("Quadro de telemetria truncado");
+        return null;
+    }
+
+    for (let i = 0; i < frame.count; i++) {
+        let offset = TELEMETRY_HEADER_SIZE + i * recordSize;
+        const record = {
+            cycle: view.getUint32(offset, true),
+            time: view.getUint32(offset + 4, true)
+        };
+        offset += 8;
+        for (const [bit, name] of TELEMETRY_CHANNELS) {
+            if (!(frame.channels & bit)) continue;
+            record[name] = view.getFloat32(offset, true);
+            offset += 4;
+        }
+        record.planta = view.getUint8(offset);
+        record.combinacao = view.getUint8(offset + 1);
+        record.flags = view.getUint8(offset + 2);
+        frame.records.push(record);
+    }
+    return frame;
+}
+
+function handleTelemetryFrame(buffer) {
+    const frame = decodeTelemetryFrame(buffer);
+    if (!frame) return;
+
+    // Cada quadro começa onde o anterior parou, mais o que o ESP32 descartou
+    // (cliente atrasado) e o que a decimação pulou; outro buraco = amostras
+    // perdidas no caminho
+    const expectedFirst = (expectedNext + frame.dropped + frame.skipped) >>> 0;
+    if (expectedNext !== null && frame.first !== expectedFirst) {
+        lostRecords += (frame.first - expectedFirst) >>> 0;
+        console.warn(`Telemetria: ${lostRecords} amostra(s) perdida(s) até agora`);
+    }
+    expectedNext = frame.next;
+    if (frame.dropped > 0) {
+        droppedRecords += frame.dropped;
+        console.warn(`Telemetria: ${droppedRecords} amostra(s) descartada(s) no ESP32 até agora`);
+    }
+
+    // O gráfico mostra a malha da planta ativa
+    for (const r of frame.records) {
+        if (!(r.flags & TELEMETRY_FLAG_ACTIVE)) continue;
+        addLiveSample(r.time, r.sp_v, r.y_v);
+        // O perfil pode terminar ou ser parado no ESP32 (setpoint manual,
+        // ensaio do relé); a telemetria diz se ele ainda comanda o setpoint
+        profileRunning = (r.flags & TELEMETRY_FLAG_PROFILE) !== 0;
+    }
+    if (chart) chart.update();
+}
+
 
 function connectWebSocket() {
     const ip = document.getElementById('esp32_ip').value;
@@ -77,10 +248,17 @@ function connectWebSocket() {
     }
 
     websocket = new WebSocket(wsUri);
+    websocket.binaryType = 'arraybuffer';
+    expectedNext = null;
+    historyId = 0;
 
     websocket.onopen = (event) => {
         statusDiv.textContent = "Conectado";
         statusDiv.className = "connected";
+        websocket.send(JSON.stringify(TELEMETRY_SUBSCRIPTION));
+        // O ESP32 já manda os últimos 10 min a quem conecta; outra janela
+        // precisa ser pedida
+        if (document.getElementById('janela_historico').value !== "600") requestHistory();
     };
 
     websocket.onclose = (event) => {
@@ -90,11 +268,40 @@ function connectWebSocket() {
 
     // Manipulador para receber mensagens do ESP32
     websocket.onmessage = (event) => {
+        if (event.data instanceof ArrayBuffer) {
+            if (event.data.byteLength >= 2 && new DataView(event.data).getUint16(0, true) === HISTORY_MAGIC) {
+                handleHistoryFrame(event.data);
+            } else {
+                handleTelemetryFrame(event.data);
+            }
+            return;
+        }
         try {
             const data = JSON.parse(event.data);
+            if (data.autotune !== undefined) {
+                handleAutotuneResult(data.autotune);
+                return;
+            }
+            if (data.perfil !== undefined) {
+                handleProfileResult(data.perfil);
+                return;
+            }
+            if (data.degrau !== undefined) {
+                handleStepResult(data.degrau);
+                return;
+            }
+            if (data.ack !== undefined) {
+                handleCommandAck(data.ack);
+                return;
+            }
+            if (data.ganhos !== undefined) {
+                gainTable = data.ganhos;
+                return;
+            }
             // Adiciona os dados recebidos ao gráfico
             if (data.time !== undefined && data.sp_v !== undefined && data.y_v !== undefined) {
                 addDataToChart(data.time, data.sp_v, data.y_v);
+                chart.update();
             }
         } catch (e) {
             console.error("Erro ao interpretar JSON recebido:", e);
@@ -137,15 +344,139 @@ function sendData() {
         kp: parseFloat(document.getElementById('kp').value),
         ki: parseFloat(document.getElementById('ki').value),
         kd: parseFloat(document.getElementById('kd').value),
-        setpoint_v: parseFloat(document.getElementById('setpoint').value),
         planta: parseInt(document.querySelector('input[name="planta"]:checked').value, 10),
-        combinacao: parseInt(document.getElementById('combinacao').value, 10)
+        combinacao: parseInt(document.getElementById('combinacao').value, 10),
+        duas_malhas: document.getElementById('duas_malhas').checked,
+        varredura: document.getElementById('varredura').checked,
+        varredura_s: parseFloat(document.getElementById('varredura_s').value),
+        gravar: document.getElementById('gravar').checked,
+        id: nextCommandId()
     };
 
+    // Com um perfil rodando, o setpoint é dele: mandar o setpoint manual
+    // pararia o perfil
+    if (!profileRunning) {
+        data.setpoint_v = parseFloat(document.getElementById('setpoint').value);
+    }
+
     const jsonString = JSON.stringify(data);
     console.log("Enviando JSON: ", jsonString);
     websocket.send(jsonString);
 }
 
+// Os comandos com "id" são confirmados pelo ESP32 quando a tarefa de
+// controle os aplica (ou recusados na hora, se inválidos ou com a fila cheia)
+let commandId = 0;
+
+function nextCommandId() {
+    commandId = commandId % 65535 + 1;
+    return commandId;
+}
+
+function handleCommandAck(ack) {
+    if (ack.estado === "aplicado") {
+        console.log(`Comando ${ack.id} aplicado no ciclo ${ack.ciclo}`);
+    } else {
+        alert(`Comando ${ack.id} não aplicado: ${ack.estado}`);
+    }
+}
+
+// Tabela de ganhos por rede enviada pelo ESP32. Ao trocar de planta ou de
+// combinação os campos passam a mostrar os ganhos da rede escolhida, para que
+// "Enviar Parâmetros" não grave os ganhos de uma rede na entrada de outra.
+let gainTable = [];
+
+function showNetworkGains() {
+    const plant = parseInt(document.querySelector('input[name="planta"]:checked').value, 10);
+    const combination = parseInt(document.getElementById('combinacao').value, 10);
+    const entry = gainTable.find(g => g.planta === plant && g.combinacao === combination);
+    if (!entry) return;
+    document.getElementById('kp').value = entry.kp.toFixed(4);
+    document.getElementById('ki').value = entry.ki.toFixed(4);
+    document.getElementById('kd').value = entry.kd.toFixed(4);
+}
+
+// Ensaio do relé: o controlador sai do laço até o ensaio terminar e, se
+// concluir, já passa a usar os ganhos calculados
+function startAutotune() {
+    if (!websocket || websocket.readyState !== WebSocket.OPEN) {
+        alert("WebSocket não está conectado. Por favor, conecte-se primeiro.");
+        return;
+    }
+    websocket.send(JSON.stringify({
+        autotune: document.getElementById('regra_sintonia').value,
+        autotune_amplitude: parseFloat(document.getElementById('amplitude_rele').value)
+    }));
+}
+
+function cancelAutotune() {
+    if (!websocket || websocket.readyState !== WebSocket.OPEN) return;
+    websocket.send(JSON.stringify({ autotune: "cancelar" }));
+}
+
+function handleAutotuneResult(result) {
+    const statusDiv = document.getElementById('autotune_status');
+    if (result.estado === "concluido") {
+        statusDiv.textContent = `${result.regra}: Ku=${result.ku.toFixed(3)}, Pu=${result.pu.toFixed(2)} s`;
+        // Os campos passam a mostrar os ganhos aplicados pelo ESP32
+        document.getElementById('kp').value = result.kp.toFixed(4);
+        document.getElementById('ki').value = result.ki.toFixed(4);
+        document.getElementById('kd').value = result.kd.toFixed(4);
+    } else {
+        statusDiv.textContent = `Ensaio ${result.estado} (planta ${result.planta}, combinação ${result.combinacao})`;
+    }
+}
+
+// Perfil de setpoint: o ESP32 compila o texto e responde com o número de
+// segmentos e a duração, ou com o segmento que tem erro
+let profileRunning = false;
+
+function startProfile() {
+    if (!websocket || websocket.readyState !== WebSocket.OPEN) {
+        alert("WebSocket não está conectado. Por favor, conecte-se primeiro.");
+        return;
+    }
+    websocket.send(JSON.stringify({ perfil: document.getElementById('perfil').value }));
+}
+
+function stopProfile() {
+    if (!websocket || websocket.readyState !== WebSocket.OPEN) return;
+    websocket.send(JSON.stringify({ perfil: "parar" }));
+}
+
+function handleProfileResult(result) {
+    const statusDiv = document.getElementById('perfil_status');
+    profileRunning = result.estado === "rodando";
+    if (result.estado === "rodando") {
+        statusDiv.textContent = `Perfil com ${result.segmentos} segmentos, ${result.duracao_s.toFixed(1)} s` +
+                                (result.repetir ? " (repetindo)" : "");
+    } else if (result.estado === "erro") {
+        statusDiv.textContent = `Perfil rejeitado: ${result.erro}`;
+    } else {
+        statusDiv.textContent = "Perfil parado";
+    }
+}
+
+// Medidas de cada degrau do setpoint, calculadas pelo ESP32 no próprio
+// laço; tempos negativos quando não houve (não subiu até 90 %, não acomodou)
+function handleStepResult(step) {
+    const time = (s) => s >= 0 ? `${s.toFixed(1)} s` : "—";
+    document.getElementById('degrau_status').textContent =
+        `Planta ${step.planta}, combinação ${step.combinacao}: ${step.de_v.toFixed(2)} → ${step.para_v.toFixed(2)} V, ` +
+        `subida ${time(step.subida_s)}, sobressinal ${step.sobressinal_pct.toFixed(1)} %, ` +
+        `acomodação ${time(step.acomodacao_s)}, erro ${(step.erro_regime_v * 1000).toFixed(0)} mV, ` +
+        `IAE ${step.iae.toFixed(2)} V·s (${step.estado})`;
+}
+
+// Lista das execuções gravadas (cada uma pode ser baixada em /run?nome=...)
+function openRuns() {
+    const ip = document.getElementById('esp32_ip').value;
+    if (!ip) {
+        alert("Por favor, insira o endereço IP do ESP32.");
+        return;
+    }
+    window.open(`http://${ip}/runs`, '_blank');
+}
+
 // Inicializa o gráfico quando a página carrega
 window.onload = initChart;
\ No newline at end of file
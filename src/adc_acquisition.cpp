@@ -0,0 +1,169 @@
+// src/adc_acquisition.cpp
+
+#include "adc_acquisition.h"
+#include "adc_calibration.h"
+#include "config.h"
+#include "hal.h"
+#include "loop_metrics.h"
+#include "mux.h"
+
+#include <algorithm>
+#include <atomic>
+
+static_assert((ADC_RING_SIZE & (ADC_RING_SIZE - 1)) == 0, "ADC_RING_SIZE deve ser potencia de 2");
+static_assert(ADC_DECIMATION_WINDOW <= ADC_RING_SIZE / 2, "janela grande demais para o buffer");
+
+// Buffer circular de um produtor (tarefa de aquisicao) e um consumidor
+// (tarefa de controle). head conta todas as amostras ja escritas.
+typedef struct {
+    uint16_t samples[ADC_RING_SIZE];
+    uint8_t generations[ADC_RING_SIZE];     // mux_generation() de cada amostra
+    std::atomic<uint32_t> head;
+    uint32_t read_cursor;           // ate onde a media do periodo ja consumiu
+    // Leitura direta da ultima troca do MUX, usada enquanto nao houver
+    // amostra da geracao atual. Do consumidor.
+    bool fresh_valid;
+    uint8_t fresh_generation;
+    float fresh_raw;
+} AdcRing_t;
+
+static AdcRing_t adc_rings[2];
+static std::atomic<int> decimation_mode(ADC_DECIMATE_MEAN);
+
+static AdcRing_t *adc_ring_for(int plant_id) {
+    return (plant_id == 1 || plant_id == 2) ? &adc_rings[plant_id - 1] : NULL;
+}
+
+void adc_acquisition_init() {
+    for (int p = 0; p < 2; p++) {
+        adc_rings[p].head.store(0, std::memory_order_relaxed);
+        adc_rings[p].read_cursor = 0;
+        adc_rings[p].fresh_valid = false;
+    }
+}
+
+void adc_acquisition_push(int plant_id, uint16_t raw, uint32_t generation) {
+    AdcRing_t *ring = adc_ring_for(plant_id);
+    if (ring == NULL) return;
+
+    uint32_t head = ring->head.load(std::memory_order_relaxed);
+    ring->samples[head & (ADC_RING_SIZE - 1)] = raw;
+    ring->generations[head & (ADC_RING_SIZE - 1)] = (uint8_t)generation;
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+void adc_acquisition_sample_now() {
+    // Lida antes de converter: se o MUX trocar no meio da rajada, as
+    // amostras saem com a geracao anterior e a decimacao as descarta
+    uint32_t generation = mux_generation();
+    for (int i = 0; i < ADC_ACQ_BURST; i++) {
+        adc_acquisition_push(1, (uint16_t)hal_adc_read(ADC_PIN_PLANT_1), generation);
+        adc_acquisition_push(2, (uint16_t)hal_adc_read(ADC_PIN_PLANT_2), generation);
+    }
+}
+
+// Copia as ultimas amostras da geracao pedida (ate ADC_DECIMATION_WINDOW),
+// procurando no maximo metade do buffer para tras
+static int adc_ring_latest(const AdcRing_t *ring, uint32_t head, uint8_t generation, uint16_t *out) {
+    uint32_t span = head < ADC_RING_SIZE / 2 ? head : ADC_RING_SIZE / 2;
+    int n = 0;
+    for (uint32_t i = head; i != head - span && n < ADC_DECIMATION_WINDOW; i--) {
+        uint32_t slot = (i - 1) & (ADC_RING_SIZE - 1);
+        if (ring->generations[slot] == generation) out[n++] = ring->samples[slot];
+    }
+    return n;
+}
+
+float adc_acquisition_read(int plant_id) {
+    AdcRing_t *ring = adc_ring_for(plant_id);
+    if (ring == NULL) return 0;
+
+    uint8_t generation = (uint8_t)mux_generation();
+    uint32_t head = ring->head.load(std::memory_order_acquire);
+    uint32_t cursor = ring->read_cursor;
+    ring->read_cursor = head;
+    if (head == 0) return 0;
+
+    // So entram as amostras da geracao atual do MUX
+    uint16_t window[ADC_DECIMATION_WINDOW];
+    uint32_t sum = 0;
+    int n = 0;
+    float raw = 0;
+
+    switch ((AdcDecimation_t)decimation_mode.load(std::memory_order_relaxed)) {
+    case ADC_DECIMATE_MEDIAN:
+        n = adc_ring_latest(ring, head, generation, window);
+        if (n == 0) break;
+        std::nth_element(window, window + n / 2, window + n);
+        raw = window[n / 2];
+        break;
+    case ADC_DECIMATE_BOXCAR:
+        n = adc_ring_latest(ring, head, generation, window);
+        for (int i = 0; i < n; i++) sum += window[i];
+        if (n > 0) raw = (float)sum / n;
+        break;
+    case ADC_DECIMATE_MEAN:
+    default: {
+        // Tudo o que chegou desde o ultimo tick (limitado ao que o buffer
+        // ainda guarda); sem amostras novas, repete a ultima
+        uint32_t span = head - cursor;
+        if (span == 0) span = 1;
+        if (span > ADC_RING_SIZE / 2) span = ADC_RING_SIZE / 2;
+        for (uint32_t i = head - span; i != head; i++) {
+            uint32_t slot = i & (ADC_RING_SIZE - 1);
+            if (ring->generations[slot] != generation) continue;
+            sum += ring->samples[slot];
+            n++;
+        }
+        if (n > 0) raw = (float)sum / n;
+        break;
+    }
+    }
+
+    // Nenhuma amostra da rede ligada ainda: leitura direta da troca, ou a
+    // ultima amostra se o MUX trocou sem adc_acquisition_mux_switched()
+    if (n == 0) {
+        bool fresh = ring->fresh_valid && ring->fresh_generation == generation;
+        raw = fresh ? ring->fresh_raw : ring->samples[(head - 1) & (ADC_RING_SIZE - 1)];
+    }
+    return adc_calibration_apply(plant_id, raw);
+}
+
+void adc_acquisition_mux_switched() {
+    const int pins[2] = {ADC_PIN_PLANT_1, ADC_PIN_PLANT_2};
+    uint8_t generation = (uint8_t)mux_generation();
+    for (int p = 0; p < 2; p++) {
+        AdcRing_t *ring = &adc_rings[p];
+        uint32_t sum = 0;
+        for (int i = 0; i < ADC_ACQ_BURST; i++) sum += (uint32_t)hal_adc_read(pins[p]);
+        ring->fresh_raw = (float)sum / ADC_ACQ_BURST;
+        ring->fresh_generation = generation;
+        ring->fresh_valid = true;
+    }
+}
+
+void adc_acquisition_set_mode(AdcDecimation_t mode) {
+    decimation_mode.store(mode, std::memory_order_relaxed);
+}
+
+AdcDecimation_t adc_acquisition_get_mode() {
+    return (AdcDecimation_t)decimation_mode.load(std::memory_order_relaxed);
+}
+
+uint32_t adc_acquisition_sample_count(int plant_id) {
+    AdcRing_t *ring = adc_ring_for(plant_id);
+    return ring ? ring->head.load(std::memory_order_relaxed) : 0;
+}
+
+void adc_acquisition_task(void *parameters) {
+    (void)parameters;
+    TickType_t xLastWakeTime = xTaskGetTickCount();
+    const TickType_t xFrequency = pdMS_TO_TICKS(ADC_ACQ_PERIOD_MS);
+
+    for (;;) {
+        vTaskDelayUntil(&xLastWakeTime, xFrequency);
+        loop_metrics_task_begin(LOOP_TASK_ACQUISITION);
+        adc_acquisition_sample_now();
+        loop_metrics_task_end(LOOP_TASK_ACQUISITION);
+    }
+}
@@ -0,0 +1,55 @@
+// src/adc_acquisition.h
+//
+// Aquisicao continua do ADC. Uma tarefa de alta prioridade le os dois pinos
+// das plantas a cada ADC_ACQ_PERIOD_MS (ADC_ACQ_BURST leituras seguidas por
+// pino) e guarda as amostras em um buffer circular por planta. No tick de
+// controle, adc_acquisition_read() reduz as amostras recentes a um unico
+// valor (media do periodo, mediana ou boxcar) e aplica a tabela de
+// calibracao. No build nativo, o simulador alimenta o mesmo caminho.
+
+#ifndef ADC_ACQUISITION_H
+#define ADC_ACQUISITION_H
+
+#include <stdint.h>
+
+typedef enum {
+    ADC_DECIMATE_MEAN = 0,   // media das amostras desde a ultima leitura
+    ADC_DECIMATE_MEDIAN,     // mediana das ultimas ADC_DECIMATION_WINDOW amostras
+    ADC_DECIMATE_BOXCAR,     // media movel das ultimas ADC_DECIMATION_WINDOW amostras
+} AdcDecimation_t;
+
+const int ADC_RING_SIZE = 512;   // amostras por planta (potencia de 2)
+
+void adc_acquisition_init();
+
+// Le os dois pinos (ADC_ACQ_BURST vezes cada) e guarda no buffer. Chamado pela
+// tarefa de aquisicao ou, no simulador, a cada ADC_ACQ_PERIOD_MS virtuais.
+void adc_acquisition_sample_now();
+
+// Produtor alternativo (fontes sinteticas, DMA): uma amostra bruta da planta,
+// com a mux_generation() lida antes da conversao
+void adc_acquisition_push(int plant_id, uint16_t raw, uint32_t generation);
+
+// Valor decimado e calibrado da planta, em contagens do ADC
+float adc_acquisition_read(int plant_id);
+
+// Chamado pela tarefa de controle depois de trocar o MUX e esperar
+// acomodar. Cada amostra leva a geracao do MUX (mux.h) lida antes da
+// conversao, e a decimacao so usa as da geracao atual: uma amostra da rede
+// anterior que chegue depois da troca (produtor preemptado no meio da rajada)
+// fica de fora. A tarefa de aquisicao, de prioridade menor no mesmo nucleo,
+// nao roda entre o incremento e o fim da espera, entao nenhuma amostra da
+// geracao nova e convertida antes de a rede acomodar. Ate chegar alguma, as
+// leituras devolvem uma leitura direta dos dois pinos (ADC_ACQ_BURST de cada,
+// em media) feita aqui.
+void adc_acquisition_mux_switched();
+
+void adc_acquisition_set_mode(AdcDecimation_t mode);
+AdcDecimation_t adc_acquisition_get_mode();
+
+// Total de amostras recebidas pela planta desde o init
+uint32_t adc_acquisition_sample_count(int plant_id);
+
+void adc_acquisition_task(void *parameters);
+
+#endif // ADC_ACQUISITION_H
@@ -0,0 +1,128 @@
+// src/adc_calibration.cpp
+
+#include "adc_calibration.h"
+#include "blob_storage.h"
+#include "byte_order.h"
+#include "config.h"
+#include "crc32.h"
+#include "seqlock.h"
+
+#include <atomic>
+#include <math.h>
+
+static const char ADC_CAL_FILE[] = "adccal.bin";
+
+// Publicada por quem troca as tabelas; a tarefa de controle copia para
+// active quando o numero de publicacoes muda
+static Seqlock<AdcCalibration_t> calibration_seqlock;
+static std::atomic<uint32_t> publish_count(0);
+static uint32_t saved_revision = 0;
+
+// Identidade ate o boot carregar o blob
+static uint32_t active_count = 0;
+static float active[ADC_CAL_CHANNELS][ADC_CAL_POINTS] = {
+    {0, 256, 512, 768, 1024, 1280, 1536, 1792, 2048, 2304, 2560, 2816, 3072, 3328, 3584, 3840, 4096},
+    {0, 256, 512, 768, 1024, 1280, 1536, 1792, 2048, 2304, 2560, 2816, 3072, 3328, 3584, 3840, 4096},
+};
+
+void adc_calibration_identity(AdcCalibration_t *calibration) {
+    memset(calibration, 0, sizeof(*calibration));
+    for (int c = 0; c < ADC_CAL_CHANNELS; c++) {
+        for (int i = 0; i < ADC_CAL_POINTS; i++) calibration->corrected[c][i] = (float)(i * ADC_CAL_STEP);
+    }
+}
+
+bool adc_calibration_table_valid(const float *corrected) {
+    for (int i = 0; i < ADC_CAL_POINTS; i++) {
+        float v = corrected[i];
+        if (!isfinite(v) || v < 0 || v > ADC_CAL_STEP * ADC_CAL_POINTS) return false;
+        if (i > 0 && !(v > corrected[i - 1])) return false;
+    }
+    return true;
+}
+
+size_t adc_calibration_encode(const AdcCalibration_t *calibration, uint8_t out[ADC_CAL_BLOB_SIZE]) {
+    uint8_t *p = out;
+    p = put_u32(p, ADC_CAL_MAGIC);
+    p = put_u16(p, ADC_CAL_VERSION);
+    *p++ = (uint8_t)ADC_CAL_CHANNELS;
+    *p++ = (uint8_t)ADC_CAL_POINTS;
+    for (int c = 0; c < ADC_CAL_CHANNELS; c++) {
+        for (int i = 0; i < ADC_CAL_POINTS; i++) p = put_f32(p, calibration->corrected[c][i]);
+    }
+    p = put_u32(p, crc32_ieee(out, p - out));
+    return p - out;
+}
+
+bool adc_calibration_decode(const uint8_t *data, size_t length, AdcCalibration_t *calibration) {
+    if (length != ADC_CAL_BLOB_SIZE) return false;
+    if (get_u32(data) != ADC_CAL_MAGIC || get_u16(data + 4) != ADC_CAL_VERSION) return false;
+    if (data[6] != ADC_CAL_CHANNELS || data[7] != ADC_CAL_POINTS) return false;
+    if (get_u32(data + length - 4) != crc32_ieee(data, length - 4)) return false;
+
+    memset(calibration, 0, sizeof(*calibration));
+    const uint8_t *p = data + 8;
+    for (int c = 0; c < ADC_CAL_CHANNELS; c++) {
+        for (int i = 0; i < ADC_CAL_POINTS; i++, p += 4) calibration->corrected[c][i] = get_f32(p);
+        if (!adc_calibration_table_valid(calibration->corrected[c])) return false;
+    }
+    return true;
+}
+
+bool adc_calibration_load(AdcCalibration_t *calibration) {
+    uint8_t data[ADC_CAL_BLOB_SIZE];
+    size_t length;
+    if (blob_storage_read(ADC_CAL_FILE, data, sizeof(data), &length) &&
+        adc_calibration_decode(data, length, calibration)) {
+        return true;
+    }
+    return blob_storage_read_pending(ADC_CAL_FILE, data, sizeof(data), &length) &&
+           adc_calibration_decode(data, length, calibration);
+}
+
+bool adc_calibration_save(const AdcCalibration_t *calibration) {
+    uint8_t data[ADC_CAL_BLOB_SIZE];
+    size_t length = adc_calibration_encode(calibration, data);
+    return blob_storage_write(ADC_CAL_FILE, data, length);
+}
+
+void adc_calibration_set(const AdcCalibration_t *calibration) {
+    calibration_seqlock.publish(*calibration);
+    publish_count.fetch_add(1, std::memory_order_release);
+}
+
+void adc_calibration_get(AdcCalibration_t *out) {
+    if (publish_count.load(std::memory_order_acquire) == 0) {
+        adc_calibration_identity(out);
+        return;
+    }
+    calibration_seqlock.read(out);
+}
+
+void adc_calibration_persist() {
+    if (publish_count.load(std::memory_order_acquire) == 0) return;
+    // Fora da pilha de 3 KB da tarefa, que ainda grava no SPIFFS
+    static AdcCalibration_t calibration;
+    calibration_seqlock.read(&calibration);
+    if (calibration.revision == saved_revision) return;
+    if (adc_calibration_save(&calibration)) saved_revision = calibration.revision;
+}
+
+float adc_calibration_apply(int plant_id, float raw) {
+    uint32_t count = publish_count.load(std::memory_order_acquire);
+    if (count != active_count) {
+        AdcCalibration_t calibration;
+        calibration_seqlock.read(&calibration);
+        memcpy(active, calibration.corrected, sizeof(active));
+        active_count = count;
+    }
+    const float *table = active[(plant_id == 2) ? 1 : 0];
+    if (raw <= 0) return table[0];
+
+    int i = (int)raw / ADC_CAL_STEP;
+    if (i >= ADC_CAL_POINTS - 1) i = ADC_CAL_POINTS - 2;
+
+    float frac = (raw - i * ADC_CAL_STEP) * (1.0f / ADC_CAL_STEP);
+    float v = table[i] + frac * (table[i + 1] - table[i]);
+    return (v > ADC_RESOLUTION) ? ADC_RESOLUTION : (v < 0 ? 0 : v);
+}
@@ -0,0 +1,63 @@
+// src/adc_calibration.h
+//
+// Correcao da nao linearidade do ADC por tabela: ADC_CAL_POINTS pontos
+// igualmente espacados na escala bruta (0, 256, ..., 4096), cada um com o
+// valor corrigido correspondente, interpolados linearmente. Cada canal
+// (pino da Planta 1 e da Planta 2) tem a sua tabela.
+//
+// As tabelas ficam em um blob pequeno no sistema de arquivos
+// (ADC_CAL_BLOB_SIZE bytes, com CRC), carregado no boot; o comando
+// "calibracao_adc" do WebSocket troca a tabela de um canal. A tabela nova e
+// publicada por seqlock e a tarefa de controle a adota na proxima leitura;
+// quem grava o blob e a combination_selector_task (adc_calibration_persist).
+
+#ifndef ADC_CALIBRATION_H
+#define ADC_CALIBRATION_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+const int ADC_CAL_POINTS = 17;
+const int ADC_CAL_STEP = 256;   // contagens brutas entre pontos
+const int ADC_CAL_CHANNELS = 2;
+
+const uint32_t ADC_CAL_MAGIC = 0x31434341;      // "ACC1"
+const uint16_t ADC_CAL_VERSION = 1;
+const size_t ADC_CAL_BLOB_SIZE = 8 + ADC_CAL_CHANNELS * ADC_CAL_POINTS * 4 + 4;
+
+typedef struct {
+    uint32_t revision;          // quem troca uma tabela incrementa (nao vai para o blob)
+    float corrected[ADC_CAL_CHANNELS][ADC_CAL_POINTS];
+} AdcCalibration_t;
+
+// Identidade nos dois canais: sem correcao
+void adc_calibration_identity(AdcCalibration_t *calibration);
+
+// Tabela de um canal valida: valores finitos, crescentes, de 0 ate um passo
+// alem do fim da grade (a saida de adc_calibration_apply e limitada)
+bool adc_calibration_table_valid(const float *corrected);
+
+// Blob: magic, versao, dimensoes, tabelas (f32 LE) e CRC-32 do resto. A
+// decodificacao recusa o blob com alguma tabela invalida.
+size_t adc_calibration_encode(const AdcCalibration_t *calibration, uint8_t out[ADC_CAL_BLOB_SIZE]);
+bool adc_calibration_decode(const uint8_t *data, size_t length, AdcCalibration_t *calibration);
+
+// Le/grava o blob (ver blob_storage.h); a leitura cai na copia temporaria
+// de uma gravacao interrompida se ela for valida
+bool adc_calibration_load(AdcCalibration_t *calibration);
+bool adc_calibration_save(const AdcCalibration_t *calibration);
+
+// Publica as tabelas (uma tarefa por vez: o boot, depois o servidor web) e
+// le a copia publicada
+void adc_calibration_set(const AdcCalibration_t *calibration);
+void adc_calibration_get(AdcCalibration_t *out);
+
+// Grava as tabelas publicadas se a revisao mudou desde a ultima gravacao
+// (as carregadas no boot tem revisao 0 e nao voltam ao arquivo)
+void adc_calibration_persist();
+
+// Valor corrigido do canal da planta, em contagens (0 a ADC_RESOLUTION).
+// So a tarefa de controle (ou o simulador no lugar dela) chama.
+float adc_calibration_apply(int plant_id, float raw);
+
+#endif // ADC_CALIBRATION_H
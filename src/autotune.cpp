@@ -0,0 +1,190 @@
+// src/autotune.cpp
+
+#include "autotune.h"
+#include "config.h"
+
+#include <math.h>
+#include <string.h>
+
+bool autotune_start(Autotune_t *at, float sp, float bias, float amplitude, float hysteresis) {
+    memset(at, 0, sizeof(*at));
+
+    // O rele nunca passa dos limites do DAC
+    const float u_max = (float)DAC_RESOLUTION;
+    if (bias < 0) bias = 0;
+    if (bias > u_max) bias = u_max;
+    if (amplitude > bias) amplitude = bias;
+    if (amplitude > u_max - bias) amplitude = u_max - bias;
+    if (amplitude < AUTOTUNE_MIN_AMPLITUDE) {
+        at->status = AUTOTUNE_FAILED;
+        return false;
+    }
+
+    at->sp = sp;
+    at->bias = bias;
+    at->amplitude = amplitude;
+    at->hysteresis = hysteresis;
+    at->status = AUTOTUNE_RUNNING;
+    return true;
+}
+
+void autotune_cancel(Autotune_t *at) {
+    if (at->status == AUTOTUNE_RUNNING) at->status = AUTOTUNE_IDLE;
+}
+
+static void autotune_finish(Autotune_t *at) {
+    if (at->averaged == 0) {
+        at->status = AUTOTUNE_FAILED;
+        return;
+    }
+
+    float a = at->amp_sum / at->averaged;
+    float eps = at->hysteresis;
+    // Com a amplitude perto da histerese a correcao explode; limita a 10%
+    float a_eff = sqrtf(fmaxf(a * a - eps * eps, 0.01f * a * a));
+    if (a_eff <= 0) {
+        at->status = AUTOTUNE_FAILED;
+        return;
+    }
+
+    at->pu = at->period_sum / at->averaged;
+    at->ku = 4.0f * at->amplitude / ((float)M_PI * a_eff);
+
+    float u_mean = at->u_mean_sum / at->averaged;
+    float y_mean = at->y_mean_sum / at->averaged;
+    at->plant_gain = (u_mean > 0) ? y_mean / u_mean : 0;
+    at->status = AUTOTUNE_DONE;
+}
+
+// Fecha um periodo (de subida a subida). So entram na media periodos
+// seguidos que concordam entre si dentro de AUTOTUNE_TOLERANCE.
+static void autotune_period(Autotune_t *at, float period) {
+    float amp = 0.5f * (at->y_max - at->y_min);
+    at->periods++;
+
+    if (at->periods > AUTOTUNE_SKIP_PERIODS && at->samples > 0) {
+        bool agrees = at->last_period > 0 &&
+                      fabsf(period - at->last_period) <= AUTOTUNE_TOLERANCE * period &&
+                      fabsf(amp - at->last_amp) <= AUTOTUNE_TOLERANCE * amp;
+        if (!agrees) {
+            at->period_sum = at->amp_sum = at->u_mean_sum = at->y_mean_sum = 0;
+            at->averaged = 0;
+        }
+        at->period_sum += period;
+        at->amp_sum += amp;
+        at->u_mean_sum += at->u_sum / at->samples;
+        at->y_mean_sum += at->y_sum / at->samples;
+        at->averaged++;
+    }
+    at->last_period = period;
+    at->last_amp = amp;
+
+    if (at->averaged >= AUTOTUNE_MIN_PERIODS) {
+        autotune_finish(at);
+    } else if (at->periods >= AUTOTUNE_MAX_PERIODS) {
+        // Nunca estabilizou: usa o que tiver da ultima sequencia
+        if (at->averaged >= 2) autotune_finish(at);
+        else at->status = AUTOTUNE_FAILED;
+    }
+}
+
+AutotuneStatus_t autotune_step(Autotune_t *at, float y, float dt_s, float *u) {
+    if (at->status != AUTOTUNE_RUNNING) {
+        *u = at->bias;
+        return at->status;
+    }
+
+    if (at->t == 0) {
+        at->relay_high = y < at->sp;
+        at->last_y = y;
+        at->y_max = at->y_min = y;
+    }
+    at->t += dt_s;
+
+    const float high = at->sp + at->hysteresis;
+    const float low = at->sp - at->hysteresis;
+
+    if (at->relay_high && y > high) {
+        at->relay_high = false;
+
+        // Instante em que a medicao cruzou sp + eps, interpolado entre as
+        // duas ultimas amostras
+        float frac = (y != at->last_y) ? (high - at->last_y) / (y - at->last_y) : 1.0f;
+        if (frac < 0) frac = 0;
+        if (frac > 1) frac = 1;
+        float rise_t = at->t - dt_s + frac * dt_s;
+
+        if (at->have_rise) autotune_period(at, rise_t - at->last_rise_t);
+        at->last_rise_t = rise_t;
+        at->have_rise = true;
+        at->y_max = at->y_min = y;
+        at->u_sum = at->y_sum = 0;
+        at->samples = 0;
+        if (at->status != AUTOTUNE_RUNNING) {
+            *u = at->bias;
+            return at->status;
+        }
+    } else if (!at->relay_high && y < low) {
+        at->relay_high = true;
+    }
+
+    if (y > at->y_max) at->y_max = y;
+    if (y < at->y_min) at->y_min = y;
+    at->last_y = y;
+
+    *u = at->relay_high ? at->bias + at->amplitude : at->bias - at->amplitude;
+    at->u_sum += *u;
+    at->y_sum += y;
+    at->samples++;
+
+    if (at->t > AUTOTUNE_TIMEOUT_S) at->status = AUTOTUNE_FAILED;
+    return at->status;
+}
+
+bool autotune_compute_gains(float ku, float pu, float plant_gain, AutotuneRule_t rule, AutotuneGains_t *gains) {
+    if (ku <= 0 || pu <= 0) return false;
+
+    float kp, ti, td;
+    switch (rule) {
+    case AUTOTUNE_RULE_ZN:
+        kp = 0.6f * ku;
+        ti = 0.5f * pu;
+        td = 0.125f * pu;
+        break;
+    case AUTOTUNE_RULE_TL:
+        kp = ku / 2.2f;
+        ti = 2.2f * pu;
+        td = pu / 6.3f;
+        break;
+    case AUTOTUNE_RULE_SIMC: {
+        // Primeira ordem com atraso que passa pelo ponto critico medido
+        float k = plant_gain;
+        float wu = 2.0f * (float)M_PI / pu;
+        float x = k * ku;
+        if (k <= 0 || x <= 1.0f) return false;
+        float tau = sqrtf(x * x - 1.0f) / wu;
+        float theta = ((float)M_PI - atanf(tau * wu)) / wu;
+        float tc = theta;
+        kp = tau / (k * (tc + theta));
+        ti = fminf(tau, 4.0f * (tc + theta));
+        td = 0;
+        break;
+    }
+    default:
+        return false;
+    }
+
+    gains->kp = kp;
+    gains->ki = kp / ti;
+    gains->kd = kp * td;
+    return true;
+}
+
+const char *autotune_rule_name(AutotuneRule_t rule) {
+    switch (rule) {
+    case AUTOTUNE_RULE_ZN: return "ZN";
+    case AUTOTUNE_RULE_TL: return "TL";
+    case AUTOTUNE_RULE_SIMC: return "SIMC";
+    }
+    return "?";
+}
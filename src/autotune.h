@@ -0,0 +1,93 @@
+// src/autotune.h
+//
+// Sintonia automatica por realimentacao a rele (Astrom-Hagglund). Durante o
+// ensaio o PID fica desligado e a saida alterna entre bias + d e bias - d
+// conforme a medicao cruza o setpoint (com histerese). A planta entra em
+// oscilacao sustentada; de cada periodo completo saem o periodo Pu (cruzamentos
+// interpolados entre amostras) e a amplitude a (pico a pico / 2), medidos de
+// forma incremental, sem guardar amostras. O ganho critico e
+//
+//     Ku = 4 d / (pi * sqrt(a^2 - eps^2))
+//
+// e os ganhos do PID saem de Ku/Pu pela regra escolhida. A SIMC precisa de um
+// modelo de primeira ordem com atraso: o ganho estatico vem das medias de y
+// e u no ensaio (as redes RC vao a zero com u = 0) e tau/theta do ponto
+// critico (|G(j wu)| = 1/Ku, fase = -pi).
+//
+// Tudo em contagens (y do ADC, u do DAC), como o PID. Nenhuma alocacao:
+// o estado inteiro cabe em Autotune_t e cada passo e O(1).
+
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+
+#include <stdint.h>
+
+typedef enum {
+    AUTOTUNE_RULE_ZN = 0,    // Ziegler-Nichols (PID)
+    AUTOTUNE_RULE_TL,        // Tyreus-Luyben (PID, mais conservadora)
+    AUTOTUNE_RULE_SIMC,      // Skogestad IMC (PI, tau_c = theta)
+} AutotuneRule_t;
+
+typedef enum {
+    AUTOTUNE_IDLE = 0,
+    AUTOTUNE_RUNNING,
+    AUTOTUNE_DONE,
+    AUTOTUNE_FAILED,
+} AutotuneStatus_t;
+
+const float AUTOTUNE_DEFAULT_AMPLITUDE = 40.0f;   // d, contagens do DAC
+const float AUTOTUNE_MIN_AMPLITUDE = 5.0f;
+const float AUTOTUNE_HYSTERESIS = 8.0f;           // eps, contagens do ADC
+const int AUTOTUNE_SKIP_PERIODS = 2;              // transitorio descartado
+const int AUTOTUNE_MIN_PERIODS = 3;               // periodos na media
+const int AUTOTUNE_MAX_PERIODS = 12;
+const float AUTOTUNE_TOLERANCE = 0.05f;           // variacao entre periodos
+const float AUTOTUNE_TIMEOUT_S = 600.0f;
+
+typedef struct {
+    // Configuracao (fixa durante o ensaio)
+    float sp, bias, amplitude, hysteresis;
+
+    // Estado do rele e do periodo em andamento
+    AutotuneStatus_t status;
+    bool relay_high;
+    float t;                    // tempo desde o inicio (s)
+    float last_y;
+    float last_rise_t;          // ultimo cruzamento de subida (interpolado)
+    bool have_rise;
+    float y_max, y_min;
+    float u_sum, y_sum;         // medias do periodo em andamento
+    uint32_t samples;
+
+    // Periodos completos
+    int periods;
+    float last_period, last_amp;
+    float period_sum, amp_sum, u_mean_sum, y_mean_sum;
+    int averaged;
+
+    // Resultado
+    float ku, pu;
+    float plant_gain;           // contagens do ADC por contagem do DAC
+} Autotune_t;
+
+typedef struct {
+    float kp, ki, kd;           // ki e kd por segundo (antes da escala de Ts)
+} AutotuneGains_t;
+
+// Comeca o ensaio em torno de bias (normalmente o u atual). A amplitude e
+// reduzida para caber em [0, DAC_RESOLUTION]; retorna false se sobrar menos
+// que AUTOTUNE_MIN_AMPLITUDE.
+bool autotune_start(Autotune_t *at, float sp, float bias, float amplitude, float hysteresis);
+void autotune_cancel(Autotune_t *at);
+
+// Um ciclo de controle: recebe a medicao e o periodo de amostragem (s),
+// devolve em *u a saida do rele. Retorna o estado depois do passo.
+AutotuneStatus_t autotune_step(Autotune_t *at, float y, float dt_s, float *u);
+
+// Ganhos do PID a partir do ponto critico (ku, pu) e do ganho estatico da
+// planta medidos em um ensaio concluido
+bool autotune_compute_gains(float ku, float pu, float plant_gain, AutotuneRule_t rule, AutotuneGains_t *gains);
+
+const char *autotune_rule_name(AutotuneRule_t rule);
+
+#endif // AUTOTUNE_H
@@ -0,0 +1,31 @@
+// src/blob_storage.h
+//
+// Arquivos pequenos de configuracao, lidos e gravados inteiros de uma vez
+// (ex.: a tabela de ganhos). No ESP32 ficam na raiz do SPIFFS
+// (spiffs_defs.cpp). A gravacao escreve uma copia temporaria (nome.tmp),
+// apaga o arquivo antigo e renomeia a copia; o SPIFFS nao renomeia por cima
+// de um arquivo existente, entao a troca nao e atomica:
+//
+//   reset durante a escrita       fica o arquivo antigo (e um .tmp pela metade)
+//   reset entre apagar e renomear fica so o .tmp, inteiro
+//
+// Quem le tenta o arquivo e, se ele faltar ou nao passar na sua validacao
+// (CRC), a copia temporaria com blob_storage_read_pending, validada do mesmo
+// jeito. No build nativo os blobs ficam na memoria do processo
+// (sim/blob_storage_sim.cpp), que simula os dois cortes.
+
+#ifndef BLOB_STORAGE_H
+#define BLOB_STORAGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Le ate capacity bytes; *length recebe o tamanho lido. false se nao existir.
+bool blob_storage_read(const char *name, uint8_t *data, size_t capacity, size_t *length);
+bool blob_storage_write(const char *name, const uint8_t *data, size_t length);
+
+// Copia temporaria de uma gravacao que nao terminou; false se nao houver.
+// Pode estar pela metade: so vale depois de validada.
+bool blob_storage_read_pending(const char *name, uint8_t *data, size_t capacity, size_t *length);
+
+#endif // BLOB_STORAGE_H
@@ -0,0 +1,137 @@
+// src/boot.cpp
+
+#include "boot.h"
+#include "text_buffer.h"
+#include "config.h"
+#include "hal.h"
+#include "mux.h"
+#include "plant.h"
+
+#include <atomic>
+#include <stdio.h>
+
+static const char *PHASE_NAMES[BOOT_PHASE_COUNT] = {
+    "hardware", "storage", "discharge", "tasks", "first_cycle", "wifi", "web",
+};
+
+static std::atomic<uint32_t> reached_mask(0);
+static std::atomic<uint32_t> phase_us[BOOT_PHASE_COUNT];
+static std::atomic<uint32_t> wifi_reconnects(0);
+
+// Escrita uma vez pelo setup(), antes de as tarefas existirem
+static BootDischarge_t discharge = {0, 0, {-1, -1}, false};
+
+void boot_reset() {
+    reached_mask.store(0);
+    for (int i = 0; i < BOOT_PHASE_COUNT; i++) phase_us[i].store(0);
+    wifi_reconnects.store(0);
+    discharge = {0, 0, {-1, -1}, false};
+}
+
+void boot_mark(BootPhase_t phase) {
+    uint32_t bit = 1u << phase;
+    if (reached_mask.load(std::memory_order_relaxed) & bit) return;
+    // Cada fase e marcada por uma unica tarefa: o tempo vai antes do bit
+    phase_us[phase].store(hal_micros(), std::memory_order_relaxed);
+    reached_mask.fetch_or(bit, std::memory_order_release);
+}
+
+bool boot_reached(BootPhase_t phase) {
+    return (reached_mask.load(std::memory_order_acquire) & (1u << phase)) != 0;
+}
+
+void boot_wifi_reconnected() {
+    wifi_reconnects.fetch_add(1, std::memory_order_relaxed);
+}
+
+static int boot_read_counts(int plant_id) {
+    int sum = 0;
+    for (int i = 0; i < BOOT_DISCHARGE_READS; i++) sum += plant_read_raw(plant_id);
+    return (sum + BOOT_DISCHARGE_READS / 2) / BOOT_DISCHARGE_READS;
+}
+
+bool boot_discharge_plants(int plant_id, int combination, int threshold_counts, uint32_t timeout_ms,
+                           BootDischarge_t *result) {
+    // DACs em 0 com a rede de partida ligada; as tarefas ainda nao existem,
+    // entao a leitura e direta no ADC (sem a aquisicao continua)
+    mux_select_plant(plant_id, combination);
+    plant_write_control(1, 0);
+    plant_write_control(2, 0);
+    hal_delay_us(MUX_SETTLE_US);
+    bool both = plant_id == 2 || (combination & 0b10) == 0;
+
+    BootDischarge_t r = {0, threshold_counts, {-1, -1}, false};
+    uint32_t start = hal_micros();
+    int below = 0;
+    for (;;) {
+        int worst = 0;
+        for (int p = 1; p <= 2; p++) {
+            if (p != plant_id && !both) continue;
+            r.final_counts[p - 1] = boot_read_counts(p);
+            if (r.final_counts[p - 1] > worst) worst = r.final_counts[p - 1];
+        }
+        below = worst <= threshold_counts ? below + 1 : 0;
+        r.duration_ms = (hal_micros() - start) / 1000;
+        if (below >= BOOT_DISCHARGE_CONFIRM) break;
+        if (r.duration_ms >= timeout_ms) {
+            r.timed_out = true;
+            break;
+        }
+        vTaskDelay(pdMS_TO_TICKS(BOOT_DISCHARGE_POLL_MS));
+    }
+
+    discharge = r;
+    if (result) *result = r;
+    return !r.timed_out;
+}
+
+void boot_read(BootReport_t *out) {
+    out->reached = reached_mask.load(std::memory_order_acquire);
+    for (int i = 0; i < BOOT_PHASE_COUNT; i++) out->phase_us[i] = phase_us[i].load(std::memory_order_relaxed);
+    out->discharge = discharge;
+    out->wifi_reconnects = wifi_reconnects.load(std::memory_order_relaxed);
+}
+
+const char *boot_phase_name(BootPhase_t phase) {
+    return PHASE_NAMES[phase];
+}
+
+void boot_print_report() {
+    BootReport_t report;
+    boot_read(&report);
+    Serial.println("--- Partida (ms desde o reset) ---");
+    for (int i = 0; i < BOOT_PHASE_COUNT; i++) {
+        if (report.reached & (1u << i)) {
+            Serial.printf("  %-12s %9.1f\n", PHASE_NAMES[i], report.phase_us[i] / 1000.0);
+        } else {
+            Serial.printf("  %-12s  pendente\n", PHASE_NAMES[i]);
+        }
+    }
+    const BootDischarge_t *d = &report.discharge;
+    Serial.printf("  descarga: %lu ms%s, leituras %d/%d (limiar %d)\n", (unsigned long)d->duration_ms,
+                  d->timed_out ? " (TIMEOUT)" : "", d->final_counts[0], d->final_counts[1], d->threshold_counts);
+}
+
+size_t boot_format_text(char *out, size_t capacity) {
+    if (capacity == 0) return 0;
+    TextBuffer_t t = {out, capacity, 0};
+    out[0] = '\0';
+
+    BootReport_t report;
+    boot_read(&report);
+    text_append(&t, "# TYPE boot_phase_ms gauge\n");
+    for (int i = 0; i < BOOT_PHASE_COUNT; i++) {
+        if (!(report.reached & (1u << i))) continue;
+        text_append(&t, "boot_phase_ms{phase=\"%s\"} %.1f\n", PHASE_NAMES[i], report.phase_us[i] / 1000.0);
+    }
+    const BootDischarge_t *d = &report.discharge;
+    text_append(&t, "# TYPE boot_discharge_ms gauge\nboot_discharge_ms %lu\n", (unsigned long)d->duration_ms);
+    text_append(&t, "boot_discharge_timed_out %d\n", d->timed_out ? 1 : 0);
+    for (int p = 0; p < 2; p++) {
+        if (d->final_counts[p] < 0) continue;
+        text_append(&t, "boot_discharge_counts{plant=\"%d\"} %d\n", p + 1, d->final_counts[p]);
+    }
+    text_append(&t, "# TYPE boot_wifi_reconnects_total counter\nboot_wifi_reconnects_total %lu\n",
+                (unsigned long)report.wifi_reconnects);
+    return t.length;
+}
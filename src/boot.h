@@ -0,0 +1,75 @@
+// src/boot.h
+//
+// Tempos da partida e descarga medida dos capacitores. Cada fase marca o
+// hal_micros() em que terminou (a primeira marca vale, as outras sao
+// ignoradas); setup(), a tarefa de controle e a tarefa de rede marcam, e o
+// relatorio sai na Serial e no /metrics. Marcar custa um load e, na primeira
+// vez, um store atomico: pode ficar no caminho do ciclo de controle.
+//
+// A descarga deixa os DACs em 0 na selecao de partida e le os ADCs das duas
+// plantas ate as duas ficarem abaixo do limiar (BOOT_DISCHARGE_CONFIRM
+// leituras seguidas), ou ate o timeout. No lugar da espera fixa de
+// TIME_TO_DISCHARGE_MS, que agora e o limite: depois de um reset com os
+// capacitores ja vazios, o controle comeca em dezenas de ms.
+//
+// O Wi-Fi nao faz parte do caminho ate o primeiro ciclo: sobe em paralelo
+// (tarefa de rede em main.cpp) e so marca as fases WIFI e WEB quando chega.
+
+#ifndef BOOT_H
+#define BOOT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+const uint32_t BOOT_DISCHARGE_POLL_MS = 10;    // intervalo entre leituras
+const int BOOT_DISCHARGE_CONFIRM = 3;          // leituras seguidas abaixo do limiar
+const int BOOT_DISCHARGE_READS = 4;            // leituras mediadas em cada uma
+
+typedef enum {
+    BOOT_PHASE_HARDWARE = 0,    // MUX, DACs, ADC
+    BOOT_PHASE_STORAGE,         // SPIFFS, gravador, tabela de ganhos
+    BOOT_PHASE_DISCHARGE,       // capacitores abaixo do limiar (ou timeout)
+    BOOT_PHASE_TASKS,           // tarefas criadas e timer ligado
+    BOOT_PHASE_FIRST_CYCLE,     // primeiro ciclo de controle
+    BOOT_PHASE_WIFI,            // Wi-Fi conectado pela primeira vez
+    BOOT_PHASE_WEB,             // servidor web atendendo
+    BOOT_PHASE_COUNT
+} BootPhase_t;
+
+typedef struct {
+    uint32_t duration_ms;
+    int threshold_counts;
+    int final_counts[2];        // ultima leitura de cada planta (-1: nao lida)
+    bool timed_out;
+} BootDischarge_t;
+
+typedef struct {
+    uint32_t reached;                      // bit i: fase i ja marcada
+    uint32_t phase_us[BOOT_PHASE_COUNT];   // hal_micros() da marca
+    BootDischarge_t discharge;
+    uint32_t wifi_reconnects;
+} BootReport_t;
+
+// Zera as marcas (so o simulador precisa: no ESP32 tudo comeca zerado)
+void boot_reset();
+
+void boot_mark(BootPhase_t phase);
+bool boot_reached(BootPhase_t phase);
+void boot_wifi_reconnected();
+
+// Descarga medida na selecao (plant_id, combination). A outra planta so e
+// lida se a selecao tambem ligar uma rede dela (a Planta 2 so tem redes com
+// IN_A em LOW). Retorna true se ficaram abaixo do limiar antes do timeout.
+bool boot_discharge_plants(int plant_id, int combination, int threshold_counts, uint32_t timeout_ms,
+                           BootDischarge_t *result);
+
+void boot_read(BootReport_t *out);
+const char *boot_phase_name(BootPhase_t phase);
+
+// Relatorio na Serial (ms desde a partida de cada fase)
+void boot_print_report();
+
+// Linhas do /metrics (formato do Prometheus); retorna o tamanho escrito
+size_t boot_format_text(char *out, size_t capacity);
+
+#endif // BOOT_H
@@ -0,0 +1,83 @@
+// src/buffer_pool.h
+//
+// Pool de N blocos de SIZE bytes reservados na partida, sem lock. Um mapa de
+// bits diz quais blocos estao em uso: acquire marca o primeiro livre com um
+// CAS e nunca espera (pool esgotado devolve NULL e conta a falta), release
+// desmarca. Serve para os buffers de JSON que antes vinham do heap (String)
+// e para que o uso de cada pool apareca no relatorio de memoria
+// (memory_budget.h): em uso, pico e faltas.
+// Memoria: N * SIZE + 20 bytes, fixa.
+
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    uint32_t block_size;
+    uint32_t blocks;
+    uint32_t in_use;
+    uint32_t peak;              // maior numero de blocos em uso ao mesmo tempo
+    uint32_t acquired;          // blocos entregues desde a partida
+    uint32_t exhausted;         // pedidos recusados com o pool esgotado
+} BufferPoolStats_t;
+
+template <size_t SIZE, int N>
+class BufferPool {
+public:
+    BufferPool() : used_(0), peak_(0), acquired_(0), exhausted_(0) {}
+
+    // Qualquer tarefa (nao em interrupcao). NULL se todos estao em uso.
+    char *acquire() {
+        uint32_t used = used_.load(std::memory_order_relaxed);
+        for (;;) {
+            uint32_t free_bits = ~used & ALL;
+            if (free_bits == 0) {
+                exhausted_.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            uint32_t bit = free_bits & (0u - free_bits);
+            if (used_.compare_exchange_weak(used, used | bit, std::memory_order_acquire,
+                                            std::memory_order_relaxed)) {
+                acquired_.fetch_add(1, std::memory_order_relaxed);
+                uint32_t in_use = (uint32_t)__builtin_popcount(used | bit);
+                uint32_t peak = peak_.load(std::memory_order_relaxed);
+                while (in_use > peak && !peak_.compare_exchange_weak(peak, in_use, std::memory_order_relaxed)) {}
+                return blocks_[__builtin_ctz(bit)];
+            }
+        }
+    }
+
+    // Devolve um bloco entregue por acquire (NULL e ignorado)
+    void release(char *block) {
+        if (block == nullptr) return;
+        size_t index = (size_t)(block - blocks_[0]) / SIZE;
+        used_.fetch_and(~(1u << index), std::memory_order_release);
+    }
+
+    void stats(BufferPoolStats_t *out) const {
+        out->block_size = (uint32_t)SIZE;
+        out->blocks = (uint32_t)N;
+        out->in_use = (uint32_t)__builtin_popcount(used_.load(std::memory_order_relaxed));
+        out->peak = peak_.load(std::memory_order_relaxed);
+        out->acquired = acquired_.load(std::memory_order_relaxed);
+        out->exhausted = exhausted_.load(std::memory_order_relaxed);
+    }
+
+    static constexpr size_t block_size() { return SIZE; }
+
+private:
+    static_assert(N >= 1 && N <= 32, "o mapa de bits do pool tem 32 blocos");
+    static_assert(SIZE % 4 == 0, "blocos do pool alinhados em 32 bits");
+    static const uint32_t ALL = (N == 32) ? 0xFFFFFFFFu : ((1u << N) - 1);
+
+    alignas(4) char blocks_[N][SIZE];
+    std::atomic<uint32_t> used_;
+    std::atomic<uint32_t> peak_;
+    std::atomic<uint32_t> acquired_;
+    std::atomic<uint32_t> exhausted_;
+};
+
+#endif // BUFFER_POOL_H
@@ -0,0 +1,87 @@
+// src/command_queue.h
+//
+// Fila de capacidade fixa com varias produtoras e uma consumidora, sem lock
+// (fila limitada de Vyukov). Cada slot guarda um numero de sequencia que diz
+// de quem ele e: igual a posicao, livre para a produtora; posicao + 1, pronto
+// para a consumidora. As produtoras reservam posicoes com um CAS no indice de
+// escrita e nunca esperam: com a fila cheia o push falha na hora e a recusa
+// e contada. A consumidora (tarefa de controle) nunca espera: um slot
+// reservado mas ainda nao escrito conta como fila vazia.
+//
+// push reserva varias posicoes seguidas em um unico CAS, entao os itens de
+// um lote ficam contiguos na fila, sem itens de outra produtora no meio, e o
+// lote entra inteiro ou nao entra.
+// Memoria: N * (sizeof(T) + 4) + 12 bytes, fixa.
+
+#ifndef COMMAND_QUEUE_H
+#define COMMAND_QUEUE_H
+
+#include <atomic>
+#include <stdint.h>
+
+template <typename T, int N>
+class CommandQueue {
+public:
+    CommandQueue() : tail_(0), head_(0), rejected_(0) {
+        for (int i = 0; i < N; i++) slots_[i].seq.store((uint32_t)i, std::memory_order_relaxed);
+    }
+
+    // Qualquer tarefa. Retorna false (e conta uma recusa) se nao houver
+    // count posicoes livres.
+    bool push(const T *items, int count) {
+        if (count < 1 || count > N) return false;
+
+        uint32_t pos = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            // A consumidora libera os slots em ordem: se o ultimo do lote ja
+            // esta livre, todos os anteriores tambem estao
+            uint32_t last = pos + (uint32_t)count - 1;
+            uint32_t seq = slots_[last & MASK].seq.load(std::memory_order_acquire);
+            int32_t diff = (int32_t)(seq - last);
+            if (diff < 0) {
+                rejected_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            if (diff == 0 && tail_.compare_exchange_weak(pos, pos + (uint32_t)count, std::memory_order_relaxed)) break;
+            if (diff > 0) pos = tail_.load(std::memory_order_relaxed);
+        }
+
+        for (int i = 0; i < count; i++) {
+            Slot &slot = slots_[(pos + i) & MASK];
+            slot.value = items[i];
+            slot.seq.store(pos + i + 1, std::memory_order_release);
+        }
+        return true;
+    }
+
+    // Somente a consumidora. Retorna false se nao houver item pronto.
+    bool pop(T *out) {
+        Slot &slot = slots_[head_ & MASK];
+        if (slot.seq.load(std::memory_order_acquire) != head_ + 1) return false;
+        *out = slot.value;
+        slot.seq.store(head_ + N, std::memory_order_release);
+        head_++;
+        return true;
+    }
+
+    // Lotes recusados por falta de espaco desde o boot
+    uint32_t rejected() const {
+        return rejected_.load(std::memory_order_relaxed);
+    }
+
+private:
+    static const uint32_t MASK = N - 1;
+    static_assert((N & (N - 1)) == 0, "capacidade da fila deve ser potencia de 2");
+
+    struct Slot {
+        std::atomic<uint32_t> seq;
+        T value;
+    };
+
+    std::atomic<uint32_t> tail_;
+    uint32_t head_;
+    std::atomic<uint32_t> rejected_;
+    Slot slots_[N];
+};
+
+#endif // COMMAND_QUEUE_H
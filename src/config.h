@@ -3,10 +3,14 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
+#ifdef NATIVE_SIM
+#include "sim/sim_platform.h" // Substitutos do Arduino/FreeRTOS para o build nativo
+#else
 #include <Arduino.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/semphr.h>
+#include <freertos/queue.h>
 #include <freertos/timers.h>
 #include <driver/dac.h>
 #include <WiFi.h>
@@ -14,15 +18,16 @@
 #include <ESPAsyncWebServer.h>
 #include <ArduinoJson.h>
 #include "spiffs_defs.h" // Para usar initSPIFFS
+#endif
 
 
 extern const char* WIFI_SSID;
 extern const char* WIFI_PASSWORD;
 
 // --- Definições de Hardware e Pinos ---
-const double VCC = 3.3; // Tensão de operação do ESP32
-const uint16_t ADC_RESOLUTION = 4095; // Resolução do ADC (0-4095 para 12 bits)
-const uint8_t DAC_RESOLUTION = 255;  // Resolução do DAC (0-255 para 8 bits)
+constexpr double VCC = 3.3; // Tensão de operação do ESP32
+constexpr uint16_t ADC_RESOLUTION = 4095; // Resolução do ADC (0-4095 para 12 bits)
+constexpr uint8_t DAC_RESOLUTION = 255;  // Resolução do DAC (0-255 para 8 bits)
 
 // Pinos para a Planta 1
 const int ADC_PIN_PLANT_1 = 34;
@@ -37,19 +42,44 @@ const int MUX_IN_A_PIN = 32;
 const int MUX_IN_B_PIN = 33;
 
 // --- Configurações do Sistema de Controle ---
-const unsigned long SAMPLE_TIME_MS = 200; // Tempo de amostragem
-const unsigned long TIME_TO_DISCHARGE_MS = 8000; //
+// Periodo do timer de hardware que dispara o ciclo (resolucao de 1 us, nao
+// depende do tick do FreeRTOS). E a constante primaria: o Ts usado nos
+// ganhos e modelos e o periodo em ms do historico derivam dela
+constexpr uint32_t CONTROL_PERIOD_US = 200000;
+constexpr double SAMPLE_TIME_S = CONTROL_PERIOD_US / 1e6; // Tempo de amostragem (Ts)
+constexpr unsigned long SAMPLE_TIME_MS = CONTROL_PERIOD_US / 1000UL;
+static_assert(CONTROL_PERIOD_US % 1000UL == 0, "historico e perfis contam o periodo em ms inteiros");
+const unsigned long TIME_TO_DISCHARGE_MS = 8000; // Limite da descarga medida na partida (boot.h)
+const int DISCHARGE_THRESHOLD_COUNTS = 186; // ~0,15 V: capacitor considerado descarregado
+const unsigned long MUX_SETTLE_US = 200; // Acomodacao do MUX apos trocar a selecao
+
+// --- Nucleos das tarefas (TASK_LAYOUT em main.cpp) ---
+// O Wi-Fi e o lwIP rodam no nucleo 0; o controle, a aquisicao e a
+// interrupcao do timer ficam sozinhos no 1
+const int CONTROL_CORE = 1;
+const int COMMS_CORE = 0;   // rede, WebSocket, Serial, gravador, tabela de ganhos
+
+// --- Wi-Fi (tarefa de rede em main.cpp) ---
+const unsigned long WIFI_POLL_MS = 250;          // verificacao do estado da conexao
+const unsigned long WIFI_RETRY_MIN_MS = 2000;    // nova tentativa sem conexao, dobrando...
+const unsigned long WIFI_RETRY_MAX_MS = 30000;   // ...ate este limite
+
+// --- Aquisicao continua do ADC (ver adc_acquisition.h) ---
+const unsigned long ADC_ACQ_PERIOD_MS = 1; // Periodo da tarefa de aquisicao
+const int ADC_ACQ_BURST = 4;               // Leituras seguidas por pino a cada periodo
+const int ADC_DECIMATION_WINDOW = 32;      // Amostras usadas pela mediana/boxcar
 
 // --- Definições do FreeRTOS ---
 
 // Estrutura para armazenar o estado compartilhado do sistema
 typedef struct {
-    double u;          // Sinal de controle
-    double y;          // Saída da planta 
-    double sp;         // Referenciah
-    double iTerm;      // Termo integral acumulado
-    double lastY;      // Ultima leitura da saida
-    double kp, ki, kd; // Ganhos do PID
+    // float: o FPU do ESP32 so tem precisao simples (double seria emulado)
+    float u;          // Sinal de controle
+    float y;          // Saída da planta 
+    float sp;         // Referenciah
+    float iTerm;      // Termo integral acumulado
+    float lastY;      // Ultima leitura da saida
+    float kp, ki, kd; // Ganhos do PID
 
     // Campos para gerenciar o estado completo do sistema
     int active_plant;      // Guarda o ID da planta ativa (1 ou 2)
@@ -57,14 +87,8 @@ typedef struct {
 
 } SystemState_t;
 
-// Mutex para proteger o acesso a estrutura de estado compartilhado
-extern SemaphoreHandle_t xStateMutex;
-
-// Semaphore para sincronizar o loop de controle
-extern SemaphoreHandle_t xControlSemaphore;
-
-// Timer para disparar o controle periodicamente
-extern TimerHandle_t xControlTimer;
+// O estado pertence a tarefa de controle: pedidos de alteracao vao pela
+// fila de comandos (control_loop.h) e leitores usam state_snapshot.h
 
 // Declaracaoo da variavel de estado global
 extern SystemState_t g_systemState;
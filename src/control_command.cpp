@@ -0,0 +1,229 @@
+// src/control_command.cpp
+
+#include "control_command.h"
+#include "config.h"
+#include "autotune.h"
+#include "gain_schedule.h"
+#include "identification.h"
+#include "controller_engine.h"
+#include "byte_order.h"
+
+#include <math.h>
+#include <string.h>
+
+double control_command_setpoint_counts(double volts) {
+    if (!(volts > 0.0)) volts = 0.0;    // NaN tambem vai para 0
+    if (volts > VCC) volts = VCC;
+    return (volts / VCC) * ADC_RESOLUTION;
+}
+
+static bool gain_valid(double k) {
+    return isfinite(k) && k >= 0.0;
+}
+
+static bool sp_valid(double sp) {
+    return isfinite(sp) && sp >= 0.0 && sp <= ADC_RESOLUTION;
+}
+
+bool control_command_valid(const ControlCommand_t *c) {
+    switch (c->type) {
+    case CONTROL_CMD_TUNINGS:
+        return gain_valid(c->tunings.kp) && gain_valid(c->tunings.ki) && gain_valid(c->tunings.kd);
+    case CONTROL_CMD_PLANT:
+        return gain_schedule_index(c->plant.plant_id, c->plant.combination) >= 0;
+    case CONTROL_CMD_SETPOINT:
+        return sp_valid(c->sp);
+    case CONTROL_CMD_LOOP_SETPOINT:
+        return (c->loop_sp.plant_id == 1 || c->loop_sp.plant_id == 2) && sp_valid(c->loop_sp.sp);
+    case CONTROL_CMD_AUTOTUNE:
+        if (c->autotune.rule < 0) return true;
+        return c->autotune.rule <= AUTOTUNE_RULE_SIMC && isfinite(c->autotune.amplitude) &&
+               c->autotune.amplitude > 0.0 && c->autotune.amplitude <= DAC_RESOLUTION;
+    case CONTROL_CMD_IDENT:
+        return c->ident.action >= IDENT_ACTION_NONE && c->ident.action <= IDENT_ACTION_RESET &&
+               isfinite(c->ident.excitation) && c->ident.excitation <= IDENT_MAX_EXCITATION;
+    case CONTROL_CMD_CONTROLLER:
+        return c->controller.kind >= 0 && c->controller.kind < CONTROLLER_KIND_COUNT &&
+               isfinite(c->controller.weight) && c->controller.weight <= CONTROL_MPC_MAX_WEIGHT;
+    case CONTROL_CMD_DUAL:
+    case CONTROL_CMD_PROFILE:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Bytes de dados de cada tipo no quadro, -1 se o tipo nao existe
+static int control_command_payload_size(uint8_t type) {
+    switch (type) {
+    case CONTROL_CMD_TUNINGS: return 12;
+    case CONTROL_CMD_PLANT: return 2;
+    case CONTROL_CMD_SETPOINT: return 4;
+    case CONTROL_CMD_DUAL: return 1;
+    case CONTROL_CMD_LOOP_SETPOINT: return 5;
+    case CONTROL_CMD_AUTOTUNE: return 5;
+    case CONTROL_CMD_PROFILE: return 1;
+    case CONTROL_CMD_IDENT: return 5;
+    case CONTROL_CMD_CONTROLLER: return 5;
+    default: return -1;
+    }
+}
+
+int control_command_decode(const uint8_t *frame, size_t length, uint16_t *id, ControlCommand_t *commands, int max) {
+    if (length < CONTROL_FRAME_HEADER_SIZE) return -1;
+    if (get_u16(frame) != CONTROL_COMMAND_MAGIC || frame[2] != CONTROL_COMMAND_VERSION) return -1;
+    int count = frame[3];
+    if (count < 1 || count > max || count > CONTROL_COMMAND_MAX_BATCH) return -1;
+    *id = get_u16(frame + 4);
+
+    const uint8_t *p = frame + CONTROL_FRAME_HEADER_SIZE;
+    const uint8_t *end = frame + length;
+    for (int i = 0; i < count; i++) {
+        if (p >= end) return -1;
+        ControlCommand_t *c = &commands[i];
+        memset(c, 0, sizeof(*c));
+        c->type = *p++;
+        int size = control_command_payload_size(c->type);
+        if (size < 0 || end - p < size) return -1;
+
+        switch (c->type) {
+        case CONTROL_CMD_TUNINGS:
+            c->tunings.kp = get_f32(p);
+            c->tunings.ki = get_f32(p + 4);
+            c->tunings.kd = get_f32(p + 8);
+            break;
+        case CONTROL_CMD_PLANT:
+            c->plant.plant_id = p[0];
+            c->plant.combination = p[1];
+            break;
+        case CONTROL_CMD_SETPOINT: {
+            float volts = get_f32(p);
+            if (!isfinite(volts)) return -1;
+            c->sp = control_command_setpoint_counts(volts);
+            break;
+        }
+        case CONTROL_CMD_DUAL:
+            c->dual = p[0] != 0;
+            break;
+        case CONTROL_CMD_LOOP_SETPOINT: {
+            float volts = get_f32(p + 1);
+            if (!isfinite(volts)) return -1;
+            c->loop_sp.plant_id = p[0];
+            c->loop_sp.sp = control_command_setpoint_counts(volts);
+            break;
+        }
+        case CONTROL_CMD_AUTOTUNE:
+            c->autotune.rule = (p[0] == CONTROL_AUTOTUNE_CANCEL) ? -1 : p[0];
+            c->autotune.amplitude = get_f32(p + 1);
+            break;
+        case CONTROL_CMD_PROFILE:
+            // Pelo quadro binario so da para parar o perfil
+            if (p[0] != 0) return -1;
+            c->profile_start = false;
+            break;
+        case CONTROL_CMD_IDENT:
+            c->ident.action = p[0];
+            c->ident.excitation = get_f32(p + 1);
+            break;
+        case CONTROL_CMD_CONTROLLER:
+            c->controller.kind = p[0];
+            c->controller.weight = get_f32(p + 1);
+            break;
+        }
+        p += size;
+        if (!control_command_valid(c)) return -1;
+    }
+    // Bytes sobrando indicam um quadro de outra versao ou corrompido
+    return p == end ? count : -1;
+}
+
+size_t control_command_encode(uint8_t *out, size_t capacity, uint16_t id, const ControlCommand_t *commands, int count) {
+    if (count < 1 || count > CONTROL_COMMAND_MAX_BATCH) return 0;
+    size_t length = CONTROL_FRAME_HEADER_SIZE;
+    for (int i = 0; i < count; i++) {
+        int size = control_command_payload_size(commands[i].type);
+        if (size < 0) return 0;
+        length += 1 + (size_t)size;
+    }
+    if (length > capacity) return 0;
+
+    uint8_t *p = put_u16(out, CONTROL_COMMAND_MAGIC);
+    *p++ = CONTROL_COMMAND_VERSION;
+    *p++ = (uint8_t)count;
+    p = put_u16(p, id);
+    for (int i = 0; i < count; i++) {
+        const ControlCommand_t *c = &commands[i];
+        *p++ = c->type;
+        switch (c->type) {
+        case CONTROL_CMD_TUNINGS:
+            p = put_f32(p, (float)c->tunings.kp);
+            p = put_f32(p, (float)c->tunings.ki);
+            p = put_f32(p, (float)c->tunings.kd);
+            break;
+        case CONTROL_CMD_PLANT:
+            *p++ = (uint8_t)c->plant.plant_id;
+            *p++ = (uint8_t)c->plant.combination;
+            break;
+        case CONTROL_CMD_SETPOINT:
+            p = put_f32(p, (float)(c->sp / ADC_RESOLUTION * VCC));
+            break;
+        case CONTROL_CMD_DUAL:
+            *p++ = c->dual ? 1 : 0;
+            break;
+        case CONTROL_CMD_LOOP_SETPOINT:
+            *p++ = (uint8_t)c->loop_sp.plant_id;
+            p = put_f32(p, (float)(c->loop_sp.sp / ADC_RESOLUTION * VCC));
+            break;
+        case CONTROL_CMD_AUTOTUNE:
+            *p++ = c->autotune.rule < 0 ? CONTROL_AUTOTUNE_CANCEL : (uint8_t)c->autotune.rule;
+            p = put_f32(p, (float)c->autotune.amplitude);
+            break;
+        case CONTROL_CMD_PROFILE:
+            *p++ = c->profile_start ? 1 : 0;
+            break;
+        case CONTROL_CMD_IDENT:
+            *p++ = (uint8_t)c->ident.action;
+            p = put_f32(p, (float)c->ident.excitation);
+            break;
+        case CONTROL_CMD_CONTROLLER:
+            *p++ = (uint8_t)c->controller.kind;
+            p = put_f32(p, (float)c->controller.weight);
+            break;
+        }
+    }
+    return length;
+}
+
+size_t control_ack_encode(uint8_t *out, size_t capacity, const ControlAck_t *ack) {
+    if (capacity < CONTROL_ACK_SIZE) return 0;
+    uint8_t *p = put_u16(out, CONTROL_ACK_MAGIC);
+    *p++ = CONTROL_COMMAND_VERSION;
+    *p++ = ack->status;
+    p = put_u16(p, ack->id);
+    *p++ = ack->type;
+    *p++ = 0;
+    put_u32(p, ack->cycle);
+    return CONTROL_ACK_SIZE;
+}
+
+bool control_ack_decode(const uint8_t *frame, size_t length, ControlAck_t *ack) {
+    if (length != CONTROL_ACK_SIZE) return false;
+    if (get_u16(frame) != CONTROL_ACK_MAGIC || frame[2] != CONTROL_COMMAND_VERSION) return false;
+    memset(ack, 0, sizeof(*ack));
+    ack->status = frame[3];
+    ack->id = get_u16(frame + 4);
+    ack->type = frame[6];
+    ack->cycle = get_u32(frame + 8);
+    ack->binary = 1;
+    return true;
+}
+
+const char *control_ack_status_name(uint8_t status) {
+    switch (status) {
+    case CONTROL_ACK_APPLIED: return "aplicado";
+    case CONTROL_ACK_REJECTED: return "recusado";
+    case CONTROL_ACK_INVALID: return "invalido";
+    case CONTROL_ACK_QUEUE_FULL: return "fila_cheia";
+    default: return "desconhecido";
+    }
+}
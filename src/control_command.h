@@ -0,0 +1,128 @@
+// src/control_command.h
+//
+// Comandos para a tarefa de controle. Quem recebe um pedido (WebSocket,
+// tarefa do seletor, simulador) interpreta e valida tudo fora da tarefa de
+// controle e entrega um lote de comandos prontos na fila sem lock de
+// control_loop_submit(); a tarefa de controle aplica os lotes inteiros no
+// inicio do ciclo seguinte, na ordem em que chegaram, e devolve uma
+// confirmacao por lote (ControlAck_t) para quem pediu.
+//
+// Alem do JSON, o WebSocket aceita os mesmos comandos em um quadro binario
+// (little-endian, sem preenchimento implicito); cada quadro e um lote:
+//
+//   cabecalho (CONTROL_FRAME_HEADER_SIZE bytes)
+//     u16 magic        CONTROL_COMMAND_MAGIC
+//     u8  version      CONTROL_COMMAND_VERSION
+//     u8  count        comandos no quadro (1 a CONTROL_COMMAND_MAX_BATCH)
+//     u16 id           numero do lote, devolvido na confirmacao (0: sem confirmacao)
+//
+//   count comandos: u8 type (ControlCommandType_t) e os dados do tipo
+//     TUNINGS          f32 kp, f32 ki, f32 kd
+//     PLANT            u8 planta, u8 combinacao
+//     SETPOINT         f32 referencia (V)
+//     DUAL             u8 ligado
+//     LOOP_SETPOINT    u8 planta, f32 referencia (V)
+//     AUTOTUNE         u8 regra (CONTROL_AUTOTUNE_CANCEL cancela), f32 amplitude (contagens do DAC)
+//     PROFILE          u8 0 (parar; um perfil novo so vem em texto, pelo JSON)
+//     IDENT            u8 acao (IdentAction_t), f32 excitacao (contagens do DAC; negativa mantem)
+//     CONTROLLER       u8 algoritmo (ControllerKind_t), f32 peso do MPC (negativo mantem)
+//
+// Confirmacao (ESP32 -> cliente que enviou o quadro):
+//     u16 magic        CONTROL_ACK_MAGIC
+//     u8  version      CONTROL_COMMAND_VERSION
+//     u8  status       ControlAckStatus_t
+//     u16 id           o do lote
+//     u8  type         comando recusado (ou o ultimo do lote, se aplicado)
+//     u8  reserved
+//     u32 cycle        ciclo de controle em que o lote foi aplicado
+
+#ifndef CONTROL_COMMAND_H
+#define CONTROL_COMMAND_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+const uint16_t CONTROL_COMMAND_MAGIC = 0x4343;      // "CC"
+const uint16_t CONTROL_ACK_MAGIC = 0x4143;          // "CA"
+const uint8_t CONTROL_COMMAND_VERSION = 1;
+const size_t CONTROL_FRAME_HEADER_SIZE = 6;
+const size_t CONTROL_ACK_SIZE = 12;
+const int CONTROL_COMMAND_MAX_BATCH = 8;            // comandos por lote/quadro
+const uint8_t CONTROL_AUTOTUNE_CANCEL = 0xFF;
+const double CONTROL_MPC_MAX_WEIGHT = 100.0;
+
+typedef enum {
+    CONTROL_CMD_TUNINGS = 1,
+    CONTROL_CMD_PLANT,
+    CONTROL_CMD_SETPOINT,
+    CONTROL_CMD_DUAL,
+    CONTROL_CMD_LOOP_SETPOINT,
+    CONTROL_CMD_AUTOTUNE,
+    CONTROL_CMD_PROFILE,
+    CONTROL_CMD_IDENT,
+    CONTROL_CMD_CONTROLLER,
+} ControlCommandType_t;
+
+enum {
+    CONTROL_CMD_FLAG_MORE   = 1 << 0,   // o lote continua no proximo comando
+    CONTROL_CMD_FLAG_BINARY = 1 << 1,   // confirmar com o quadro binario
+};
+
+typedef enum {
+    CONTROL_ACK_APPLIED = 0,    // lote aplicado inteiro
+    CONTROL_ACK_REJECTED,       // recusado pela tarefa de controle (ex.: ensaio no modo duplo); nada aplicado
+    CONTROL_ACK_INVALID,        // quadro ou valores invalidos, nada foi enfileirado
+    CONTROL_ACK_QUEUE_FULL,     // fila cheia, nada foi enfileirado
+} ControlAckStatus_t;
+
+// Valores ja validados e nas unidades do laco (setpoints em contagens do ADC)
+typedef struct {
+    uint8_t type;               // ControlCommandType_t
+    uint8_t flags;              // CONTROL_CMD_FLAG_*
+    uint16_t id;                // lote (0: sem confirmacao)
+    uint32_t client;            // cliente do WebSocket que recebe a confirmacao (0: nenhum)
+    union {
+        struct { double kp, ki, kd; } tunings;
+        struct { int32_t plant_id, combination; } plant;
+        double sp;
+        bool dual;
+        struct { int32_t plant_id; double sp; } loop_sp;
+        struct { int32_t rule; double amplitude; } autotune;   // rule < 0 cancela
+        bool profile_start;
+        struct { int32_t action; double excitation; } ident;  // excitation < 0 mantem
+        struct { int32_t kind; double weight; } controller;   // weight < 0 mantem
+    };
+} ControlCommand_t;
+
+typedef struct {
+    uint32_t client;
+    uint32_t cycle;
+    uint16_t id;
+    uint8_t status;             // ControlAckStatus_t
+    uint8_t type;
+    uint8_t binary;             // responder com o quadro binario
+    uint8_t reserved[3];
+} ControlAck_t;
+
+// Setpoint em volts, limitado a 0-VCC, em contagens do ADC
+double control_command_setpoint_counts(double volts);
+
+// Confere os valores de um comando (finitos, dentro das faixas). Quem monta
+// comandos a partir do JSON chama antes de enfileirar.
+bool control_command_valid(const ControlCommand_t *command);
+
+// Quadro binario -> comandos validados (ate max). Retorna quantos, ou -1 se
+// o quadro ou algum valor for invalido (nesse caso nada vale).
+int control_command_decode(const uint8_t *frame, size_t length, uint16_t *id, ControlCommand_t *commands, int max);
+
+// Comandos -> quadro binario (para clientes e testes). Retorna o tamanho,
+// ou 0 se nao couber.
+size_t control_command_encode(uint8_t *out, size_t capacity, uint16_t id, const ControlCommand_t *commands, int count);
+
+// Confirmacao no formato binario (CONTROL_ACK_SIZE bytes) e de volta
+size_t control_ack_encode(uint8_t *out, size_t capacity, const ControlAck_t *ack);
+bool control_ack_decode(const uint8_t *frame, size_t length, ControlAck_t *ack);
+
+const char *control_ack_status_name(uint8_t status);
+
+#endif // CONTROL_COMMAND_H
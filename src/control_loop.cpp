@@ -0,0 +1,807 @@
+// src/control_loop.cpp
+
+#include "control_loop.h"
+#include "config.h"
+#include "mux.h"
+#include "plant.h"
+#include "adc_acquisition.h"
+#include "hal.h"
+#include "controller.h"
+#include "controller_bank.h"
+#include "state_snapshot.h"
+#include "telemetry.h"
+#include "autotune.h"
+#include "gain_schedule.h"
+#include "setpoint.h"
+#include "loop_metrics.h"
+#include "control_command.h"
+#include "identification.h"
+#include "step_response.h"
+#include "command_queue.h"
+
+#include <atomic>
+#include <math.h>
+#include <string.h>
+
+// Estado do laco de controle: so a tarefa de controle escreve nele depois
+// do setup. Os leitores usam state_snapshot_read().
+SystemState_t g_systemState;
+
+// Fila de comandos (control_command.h): qualquer tarefa enfileira lotes, so
+// a tarefa de controle consome. As confirmacoes voltam por outra fila, da
+// tarefa de controle para a tarefa que responde pelo WebSocket.
+static const int COMMAND_QUEUE_SIZE = 32;
+static const int ACK_QUEUE_SIZE = 32;
+static const int COMMANDS_PER_CYCLE = 16;   // limita o custo do ciclo sob enxurrada
+static CommandQueue<ControlCommand_t, COMMAND_QUEUE_SIZE> command_queue;
+static CommandQueue<ControlAck_t, ACK_QUEUE_SIZE> ack_queue;
+
+// Lote que comecou a sair da fila e ainda nao terminou (a produtora ainda
+// esta escrevendo o resto, ou o limite do ciclo cortou no meio). So e
+// aplicado inteiro, no ciclo em que o ultimo comando chegar.
+static ControlCommand_t batch[CONTROL_COMMAND_MAX_BATCH];
+static int batch_count = 0;
+static uint32_t commands_applied = 0;
+
+static uint32_t control_cycle = 0;
+
+// Modo de duas malhas: malha 0 = Planta 1, malha 1 = Planta 2. O MUX e
+// compartilhado, entao as duas usam a mesma combinacao (a Planta 2 so esta
+// ligada nas combinacoes 0 e 1). g_systemState espelha a malha da planta
+// ativa, que e a que recebe os pedidos de ganho/setpoint.
+static const int BANK_LOOPS = 2;
+static ControllerBank<BANK_LOOPS> control_bank;
+static bool dual_mode = false;
+
+// Ensaio de sintonia a rele (so no modo simples); enquanto roda, o rele
+// substitui o PID na planta ativa
+static Autotune_t autotune;
+static AutotuneRule_t autotune_rule = AUTOTUNE_RULE_ZN;
+static AutotuneReport_t autotune_report;
+
+// Tabela de ganhos por rede (NULL em control_loop_set_gain_schedule
+// desliga: ganhos e integrador passam de uma rede para a outra). Cada rede
+// guarda o integrador de quando saiu do laco, se saiu acomodada.
+typedef struct {
+    float iTerm;
+    float sp;
+    bool saved;
+} NetworkMemory_t;
+
+// Erro maximo (contagens do ADC) para considerar a rede acomodada e o mesmo
+// ponto de operacao na volta
+static const float NETWORK_SETTLED_BAND = 0.01f * ADC_RESOLUTION;
+
+static GainTable_t gain_table;
+static bool gain_schedule_on = false;
+static NetworkMemory_t network_memory[GAIN_SCHEDULE_ENTRIES];
+static bool restart_derivative = false;
+
+// Controlador da malha simples (controller.h): o MPC usa o modelo
+// identificado da rede ativa com este peso. Depois de trocar de rede, o
+// controlador recomeca na primeira medicao da rede nova.
+static float mpc_weight = MPC_DEFAULT_WEIGHT;
+static bool restart_controller = false;
+
+// Perfil de setpoint: tres buffers que so trocam de dono. profile_playing e
+// da tarefa de controle, profile_writer da tarefa que envia perfis e
+// profile_delivered o entregue que ainda nao foi adotado, trocado por
+// exchange atomico. O bit PROFILE_FRESH marca que o entregue e novo: sem
+// ele, um segundo pedido de inicio recomeca o perfil que ja esta tocando.
+static const uintptr_t PROFILE_FRESH = 1;
+static SetpointProfile_t profile_slots[3];
+static SetpointProfile_t *profile_playing = &profile_slots[0];
+static std::atomic<uintptr_t> profile_delivered((uintptr_t)&profile_slots[1]);
+static SetpointProfile_t *profile_writer = &profile_slots[2];
+static SetpointPlayer_t profile_player;
+
+bool control_loop_init() {
+    ident_init();
+    step_response_init();
+    return true;
+}
+
+bool control_loop_submit(const ControlCommand_t *commands, int count) {
+    if (count < 1 || count > CONTROL_COMMAND_MAX_BATCH) return false;
+    ControlCommand_t marked[CONTROL_COMMAND_MAX_BATCH];
+    for (int i = 0; i < count; i++) {
+        if (!control_command_valid(&commands[i])) return false;
+        marked[i] = commands[i];
+        marked[i].flags = (uint8_t)((commands[i].flags & ~CONTROL_CMD_FLAG_MORE) |
+                                    (i + 1 < count ? CONTROL_CMD_FLAG_MORE : 0));
+    }
+    return command_queue.push(marked, count);
+}
+
+int control_loop_drain_acks(ControlAck_t *out, int max) {
+    int count = 0;
+    while (count < max && ack_queue.pop(&out[count])) count++;
+    return count;
+}
+
+uint32_t control_loop_acks_dropped() {
+    return ack_queue.rejected();
+}
+
+// Pedidos de um comando so, sem confirmacao
+static bool control_loop_submit_one(ControlCommand_t *command) {
+    command->flags = 0;
+    command->id = 0;
+    command->client = 0;
+    return control_loop_submit(command, 1);
+}
+
+bool control_loop_request_tunings(double kP, double kI, double kD) {
+    ControlCommand_t command;
+    command.type = CONTROL_CMD_TUNINGS;
+    command.tunings.kp = kP;
+    command.tunings.ki = kI;
+    command.tunings.kd = kD;
+    return control_loop_submit_one(&command);
+}
+
+bool control_loop_request_plant(int plant_id, int combination) {
+    ControlCommand_t command;
+    command.type = CONTROL_CMD_PLANT;
+    command.plant.plant_id = plant_id;
+    command.plant.combination = combination;
+    return control_loop_submit_one(&command);
+}
+
+bool control_loop_request_dual_mode(bool enabled) {
+    ControlCommand_t command;
+    command.type = CONTROL_CMD_DUAL;
+    command.dual = enabled;
+    return control_loop_submit_one(&command);
+}
+
+bool control_loop_request_loop_setpoint(int plant_id, double sp) {
+    ControlCommand_t command;
+    command.type = CONTROL_CMD_LOOP_SETPOINT;
+    command.loop_sp.plant_id = plant_id;
+    command.loop_sp.sp = sp;
+    return control_loop_submit_one(&command);
+}
+
+bool control_loop_request_autotune(bool start, int rule, double amplitude) {
+    ControlCommand_t command;
+    command.type = CONTROL_CMD_AUTOTUNE;
+    command.autotune.rule = start ? rule : -1;
+    command.autotune.amplitude = amplitude;
+    return control_loop_submit_one(&command);
+}
+
+bool control_loop_request_identification(double excitation, int action) {
+    ControlCommand_t command;
+    command.type = CONTROL_CMD_IDENT;
+    command.ident.action = action;
+    command.ident.excitation = excitation;
+    return control_loop_submit_one(&command);
+}
+
+bool control_loop_request_controller(int kind, double weight) {
+    ControlCommand_t command;
+    command.type = CONTROL_CMD_CONTROLLER;
+    command.controller.kind = kind;
+    command.controller.weight = weight;
+    return control_loop_submit_one(&command);
+}
+
+bool control_loop_request_setpoint(double sp) {
+    ControlCommand_t command;
+    command.type = CONTROL_CMD_SETPOINT;
+    command.sp = sp;
+    return control_loop_submit_one(&command);
+}
+
+SetpointProfile_t *control_loop_profile_buffer() {
+    return profile_writer;
+}
+
+void control_loop_deliver_profile() {
+    uintptr_t previous = profile_delivered.exchange((uintptr_t)profile_writer | PROFILE_FRESH, std::memory_order_acq_rel);
+    profile_writer = (SetpointProfile_t *)(previous & ~PROFILE_FRESH);
+}
+
+bool control_loop_request_profile(bool start) {
+    if (start) control_loop_deliver_profile();
+    ControlCommand_t command;
+    command.type = CONTROL_CMD_PROFILE;
+    command.profile_start = start;
+    return control_loop_submit_one(&command);
+}
+
+void control_loop_set_gain_schedule(const GainTable_t *table) {
+    gain_schedule_on = table != NULL;
+    for (int i = 0; i < GAIN_SCHEDULE_ENTRIES; i++) network_memory[i].saved = false;
+    if (!gain_schedule_on) return;
+
+    gain_table = *table;
+    gain_schedule_publish(&gain_table);
+
+    int index = gain_schedule_index(g_systemState.active_plant, g_systemState.mux_combination);
+    if (index >= 0) {
+        const GainScheduleEntry_t *entry = &gain_table.entries[index];
+        controller_set_tunings(entry->kp, entry->ki, entry->kd);
+    }
+}
+
+static void control_loop_set_dual_mode(bool enabled);
+static void control_loop_publish_bank();
+static void control_loop_start_autotune(AutotuneRule_t rule, float amplitude);
+static void control_loop_stop_autotune(AutotuneStatus_t status);
+static void control_loop_switch_network(int plant_id, int combination);
+static void control_loop_store_gains(float kp, float ki, float kd, uint32_t source);
+static bool control_loop_read_model(int plant_id, int combination, ControllerModel_t *model);
+static bool control_loop_load_model(int plant_id, int combination);
+
+// Aplica um comando. Retorna false se o estado atual nao permite (os
+// valores ja chegam validados).
+static bool control_loop_apply_command(const ControlCommand_t *command) {
+    int loop = g_systemState.active_plant - 1;
+    bool bank_loop = dual_mode && loop >= 0 && loop < BANK_LOOPS;
+
+    switch (command->type) {
+    case CONTROL_CMD_DUAL:
+    case CONTROL_CMD_PLANT: {
+        // No modo duplo a malha 2 segue a combinacao da Planta 1; numa
+        // combinacao que a Planta 2 nao tem, ela escreveria no DAC 2 sem rede
+        bool dual = (command->type == CONTROL_CMD_DUAL) ? command->dual : dual_mode;
+        int combination = (command->type == CONTROL_CMD_PLANT) ? command->plant.combination
+                                                                : g_systemState.mux_combination;
+        if (dual && gain_schedule_index(2, combination) < 0) return false;
+
+        // Trocar de modo ou de planta invalida o ensaio em andamento
+        if (autotune.status == AUTOTUNE_RUNNING) control_loop_stop_autotune(AUTOTUNE_IDLE);
+        if (command->type == CONTROL_CMD_DUAL) control_loop_set_dual_mode(command->dual);
+        else control_loop_switch_network(command->plant.plant_id, command->plant.combination);
+        return true;
+    }
+
+    case CONTROL_CMD_TUNINGS: {
+        double kp = command->tunings.kp, ki = command->tunings.ki, kd = command->tunings.kd;
+        controller_set_tunings(kp, ki, kd);
+        if (bank_loop) {
+            controller_scale_tunings(control_bank.kp[loop], control_bank.ki[loop], control_bank.kd[loop], kp, ki, kd);
+        }
+        control_loop_store_gains(kp, ki, kd, GAIN_ENTRY_USER);
+        return true;
+    }
+
+    // Setpoint manual na malha ativa tira o perfil do comando
+    case CONTROL_CMD_SETPOINT:
+        g_systemState.sp = command->sp;
+        if (bank_loop) control_bank.sp[loop] = command->sp;
+        profile_player.active = false;
+        return true;
+
+    case CONTROL_CMD_LOOP_SETPOINT: {
+        int i = command->loop_sp.plant_id - 1;
+        control_bank.sp[i] = command->loop_sp.sp;
+        if (i == loop) {
+            g_systemState.sp = command->loop_sp.sp;
+            profile_player.active = false;
+        }
+        return true;
+    }
+
+    case CONTROL_CMD_PROFILE:
+        if (!command->profile_start) {
+            profile_player.active = false;
+            return true;
+        }
+        // Adota o perfil entregue, se houver um novo; comecar um perfil
+        // invalida o ensaio
+        if (profile_delivered.load(std::memory_order_acquire) & PROFILE_FRESH) {
+            uintptr_t delivered = profile_delivered.exchange((uintptr_t)profile_playing, std::memory_order_acq_rel);
+            profile_playing = (SetpointProfile_t *)(delivered & ~PROFILE_FRESH);
+        }
+        if (autotune.status == AUTOTUNE_RUNNING) control_loop_stop_autotune(AUTOTUNE_IDLE);
+        setpoint_player_start(&profile_player, profile_playing);
+        return true;
+
+    case CONTROL_CMD_AUTOTUNE:
+        if (command->autotune.rule < 0) {
+            if (autotune.status == AUTOTUNE_RUNNING) control_loop_stop_autotune(AUTOTUNE_IDLE);
+            return true;
+        }
+        if (dual_mode || autotune.status == AUTOTUNE_RUNNING) return false;
+        profile_player.active = false;
+        control_loop_start_autotune((AutotuneRule_t)command->autotune.rule, (float)command->autotune.amplitude);
+        return true;
+
+    case CONTROL_CMD_CONTROLLER: {
+        int kind = command->controller.kind;
+        if (command->controller.weight >= 0.0) mpc_weight = (float)command->controller.weight;
+        if (kind == CONTROLLER_MPC || controller_kind() == CONTROLLER_MPC) {
+            if (dual_mode && kind == CONTROLLER_MPC) return false;
+            bool loaded = control_loop_load_model(g_systemState.active_plant, g_systemState.mux_combination);
+            if (kind == CONTROLLER_MPC && !loaded) return false;
+        }
+        return controller_select(kind);
+    }
+
+    case CONTROL_CMD_IDENT:
+        if (command->ident.excitation >= 0.0) ident_set_excitation((float)command->ident.excitation);
+        ident_apply(gain_schedule_index(g_systemState.active_plant, g_systemState.mux_combination),
+                    (IdentAction_t)command->ident.action);
+        return true;
+    }
+    return false;
+}
+
+// Confere o lote contra o estado que cada comando encontraria depois dos
+// anteriores, sem aplicar nada. Devolve o indice do primeiro comando que
+// control_loop_apply_command recusaria, ou -1.
+static int control_loop_check_batch() {
+    bool dual = dual_mode;
+    int plant_id = g_systemState.active_plant;
+    int combination = g_systemState.mux_combination;
+    bool autotune_running = autotune.status == AUTOTUNE_RUNNING;
+    bool profile_ready = (profile_delivered.load(std::memory_order_acquire) & PROFILE_FRESH) ||
+                         profile_playing->count > 0;
+    float weight = mpc_weight;
+
+    for (int i = 0; i < batch_count; i++) {
+        const ControlCommand_t *command = &batch[i];
+        switch (command->type) {
+        case CONTROL_CMD_DUAL:
+        case CONTROL_CMD_PLANT:
+            if (command->type == CONTROL_CMD_DUAL) {
+                dual = command->dual;
+            } else {
+                plant_id = command->plant.plant_id;
+                combination = command->plant.combination;
+            }
+            if (dual && gain_schedule_index(2, combination) < 0) return i;
+            autotune_running = false;
+            break;
+
+        case CONTROL_CMD_PROFILE:
+            if (!command->profile_start) break;
+            if (!profile_ready) return i;
+            autotune_running = false;
+            break;
+
+        case CONTROL_CMD_AUTOTUNE:
+            if (command->autotune.rule < 0) {
+                autotune_running = false;
+                break;
+            }
+            if (dual || autotune_running) return i;
+            autotune_running = true;
+            break;
+
+        case CONTROL_CMD_CONTROLLER:
+            if (command->controller.weight >= 0.0) weight = (float)command->controller.weight;
+            if (command->controller.kind == CONTROLLER_MPC) {
+                ControllerModel_t model;
+                float gain[MPC_HORIZON];
+                if (dual || !control_loop_read_model(plant_id, combination, &model) ||
+                    !LoopMpc_t::solve_gain(&model, weight, gain)) {
+                    return i;
+                }
+            }
+            break;
+
+        default:
+            break;
+        }
+    }
+    return -1;
+}
+
+// Aplica o lote inteiro, ou nada se algum comando for recusado, e confirma
+// para quem pediu
+static void control_loop_apply_batch() {
+    ControlAck_t ack;
+    memset(&ack, 0, sizeof(ack));
+    ack.status = CONTROL_ACK_APPLIED;
+    int rejected = control_loop_check_batch();
+    if (rejected >= 0) {
+        ack.status = CONTROL_ACK_REJECTED;
+        ack.type = batch[rejected].type;
+    } else {
+        // A conferencia acima cobre todas as recusas de
+        // control_loop_apply_command; o retorno so denuncia se as duas
+        // deixarem de concordar
+        for (int i = 0; i < batch_count; i++) {
+            if (!control_loop_apply_command(&batch[i]) && ack.status == CONTROL_ACK_APPLIED) {
+                ack.status = CONTROL_ACK_REJECTED;
+                ack.type = batch[i].type;
+            }
+        }
+        commands_applied += batch_count;
+    }
+
+    const ControlCommand_t *last = &batch[batch_count - 1];
+    batch_count = 0;
+    if (last->id == 0 || last->client == 0) return;
+    if (ack.status == CONTROL_ACK_APPLIED) ack.type = last->type;
+    ack.client = last->client;
+    ack.id = last->id;
+    ack.cycle = control_cycle;
+    ack.binary = (last->flags & CONTROL_CMD_FLAG_BINARY) ? 1 : 0;
+    ack_queue.push(&ack, 1);    // fila cheia: a confirmacao se perde e e contada
+}
+
+// Esvazia a fila de comandos no inicio do ciclo, sem esperar: aplica os
+// lotes completos, em ordem, ate COMMANDS_PER_CYCLE comandos
+static void control_loop_apply_commands() {
+    ControlCommand_t command;
+    for (int n = 0; n < COMMANDS_PER_CYCLE && command_queue.pop(&command); n++) {
+        batch[batch_count++] = command;
+        if (!(command.flags & CONTROL_CMD_FLAG_MORE) || batch_count == CONTROL_COMMAND_MAX_BATCH) {
+            control_loop_apply_batch();
+        }
+    }
+    loop_metrics_commands(commands_applied, command_queue.rejected());
+}
+
+static void control_loop_publish_autotune() {
+    autotune_report.seq++;
+    autotune_report.status = autotune.status;
+    autotune_report.rule = autotune_rule;
+    autotune_report.plant = g_systemState.active_plant;
+    autotune_report.combination = g_systemState.mux_combination;
+    autotune_report.ku = autotune.ku;
+    autotune_report.pu = autotune.pu;
+    autotune_report.plant_gain = autotune.plant_gain;
+    autotune_report_publish(&autotune_report);
+}
+
+// O rele gira em torno do u atual, entao o ensaio comeca sem salto
+static void control_loop_start_autotune(AutotuneRule_t rule, float amplitude) {
+    autotune_rule = rule;
+    autotune_start(&autotune, g_systemState.sp, g_systemState.u, amplitude, AUTOTUNE_HYSTERESIS);
+    autotune_report.kp = autotune_report.ki = autotune_report.kd = 0;
+    control_loop_publish_autotune();
+}
+
+// Fim do ensaio (concluido, falho ou cancelado). Se concluiu, aplica os
+// ganhos; em todos os casos o PID volta com o integrador no centro do rele,
+// para retomar sem salto.
+static void control_loop_stop_autotune(AutotuneStatus_t status) {
+    autotune.status = status;
+
+    AutotuneGains_t gains;
+    if (status == AUTOTUNE_DONE && autotune_compute_gains(autotune.ku, autotune.pu, autotune.plant_gain, autotune_rule, &gains)) {
+        controller_set_tunings(gains.kp, gains.ki, gains.kd);
+        control_loop_store_gains(gains.kp, gains.ki, gains.kd, GAIN_ENTRY_AUTOTUNE);
+        autotune_report.kp = gains.kp;
+        autotune_report.ki = gains.ki;
+        autotune_report.kd = gains.kd;
+    } else if (status == AUTOTUNE_DONE) {
+        autotune.status = AUTOTUNE_FAILED;
+    }
+
+    g_systemState.iTerm = autotune.bias;
+    g_systemState.lastY = g_systemState.y;
+    controller_reset();
+    control_loop_publish_autotune();
+}
+
+// Ganhos novos da rede ativa passam a ser os da sua entrada na tabela
+static void control_loop_store_gains(float kp, float ki, float kd, uint32_t source) {
+    int index = gain_schedule_index(g_systemState.active_plant, g_systemState.mux_combination);
+    if (!gain_schedule_on || index < 0) return;
+
+    // A pagina reenvia os ganhos junto com cada pedido; se nada mudou, nao
+    // ha o que gravar
+    GainScheduleEntry_t *entry = &gain_table.entries[index];
+    if (entry->kp == kp && entry->ki == ki && entry->kd == kd) return;
+    entry->kp = kp;
+    entry->ki = ki;
+    entry->kd = kd;
+    entry->flags = source;
+    gain_table.revision++;
+    gain_schedule_publish(&gain_table);
+}
+
+// Modelo identificado da rede (identification.h) para o MPC, em contagens
+static bool control_loop_read_model(int plant_id, int combination, ControllerModel_t *model) {
+    IdentModel_t identified;
+    if (!ident_model_read(gain_schedule_index(plant_id, combination), &identified)) return false;
+
+    const float scale = (float)ADC_RESOLUTION / (float)DAC_RESOLUTION;
+    for (int i = 0; i < 2; i++) {
+        model->a[i] = identified.a[i];
+        model->b[i] = identified.b[i] * scale;
+    }
+    return true;
+}
+
+static bool control_loop_load_model(int plant_id, int combination) {
+    ControllerModel_t model;
+    return control_loop_read_model(plant_id, combination, &model) && controller_set_model(&model, mpc_weight);
+}
+
+// Troca de uma malha de rede: guarda o integrador da rede que sai e devolve
+// a entrada da tabela da rede que entra. O integrador guardado so volta se
+// a rede saiu acomodada e volta ao mesmo setpoint: e o u que a segura ali.
+// Fora disso (primeira visita, saiu no meio de um transitorio, setpoint
+// mudou) o integrador fica como esta, ou seja, a rede nova parte do u atual.
+static const GainScheduleEntry_t *control_loop_swap_network(int from, int to, float sp, float y, float *iTerm) {
+    if (from >= 0) {
+        network_memory[from].iTerm = *iTerm;
+        network_memory[from].sp = sp;
+        network_memory[from].saved = fabsf(sp - y) <= NETWORK_SETTLED_BAND;
+    }
+    if (to < 0) return NULL;
+
+    const NetworkMemory_t *memory = &network_memory[to];
+    if (memory->saved && fabsf(memory->sp - sp) <= NETWORK_SETTLED_BAND) *iTerm = memory->iTerm;
+    return &gain_table.entries[to];
+}
+
+static void control_loop_switch_network(int plant_id, int combination) {
+    int old_plant = g_systemState.active_plant;
+    int old_combination = g_systemState.mux_combination;
+    g_systemState.active_plant = plant_id;
+    g_systemState.mux_combination = combination;
+    // No modo simples a planta que sai do laco para de gerar amostras, e o
+    // controlador passa a ver outra rede: o MPC troca de modelo (ou volta ao
+    // PID, se a rede nova nao tem um)
+    if (!dual_mode && plant_id != old_plant) ident_restart(old_plant);
+    if (!dual_mode && (plant_id != old_plant || combination != old_combination)) {
+        if (controller_kind() == CONTROLLER_MPC && !control_loop_load_model(plant_id, combination)) {
+            controller_select(CONTROLLER_PID);
+        }
+        restart_controller = true;
+    }
+    if (!gain_schedule_on || (plant_id == old_plant && combination == old_combination)) return;
+
+    // A medicao anterior e de outra rede: a derivada recomeca no proximo ciclo
+    restart_derivative = true;
+
+    if (!dual_mode) {
+        const GainScheduleEntry_t *entry = control_loop_swap_network(
+            gain_schedule_index(old_plant, old_combination), gain_schedule_index(plant_id, combination),
+            g_systemState.sp, g_systemState.y, &g_systemState.iTerm);
+        if (entry != NULL) controller_set_tunings(entry->kp, entry->ki, entry->kd);
+        return;
+    }
+
+    // No modo duplo a combinacao vale para as duas malhas
+    if (combination == old_combination) return;
+    for (int i = 0; i < BANK_LOOPS; i++) {
+        const GainScheduleEntry_t *entry = control_loop_swap_network(
+            gain_schedule_index(i + 1, old_combination), gain_schedule_index(i + 1, combination),
+            control_bank.sp[i], control_bank.y[i], &control_bank.iTerm[i]);
+        if (entry == NULL) continue;
+        controller_scale_tunings(control_bank.kp[i], control_bank.ki[i], control_bank.kd[i], entry->kp, entry->ki,
+                                 entry->kd);
+        if (i == plant_id - 1) controller_set_tunings(entry->kp, entry->ki, entry->kd);
+    }
+}
+
+// Entrar no modo duplo copia ganhos e setpoint atuais para as duas malhas e
+// preserva o integrador da planta ativa, para nao dar salto na saida dela.
+static void control_loop_set_dual_mode(bool enabled) {
+    if (enabled == dual_mode) return;
+    // O banco e so de PIDs
+    if (enabled) controller_select(CONTROLLER_PID);
+    dual_mode = enabled;
+    if (!enabled) {
+        for (int i = 0; i < BANK_LOOPS; i++) {
+            if (i + 1 != g_systemState.active_plant) ident_restart(i + 1);
+        }
+        restart_controller = true;
+        control_loop_publish_bank();
+        return;
+    }
+
+    controller_bank_init(&control_bank, BANK_LOOPS);
+    for (int i = 0; i < BANK_LOOPS; i++) {
+        control_bank.sp[i] = g_systemState.sp;
+        control_bank.kp[i] = g_systemState.kp;
+        control_bank.ki[i] = g_systemState.ki;
+        control_bank.kd[i] = g_systemState.kd;
+    }
+
+    // Com a tabela ligada, a outra malha usa os ganhos da sua rede
+    for (int i = 0; i < BANK_LOOPS; i++) {
+        int index = gain_schedule_index(i + 1, g_systemState.mux_combination);
+        if (!gain_schedule_on || index < 0) continue;
+        const GainScheduleEntry_t *entry = &gain_table.entries[index];
+        controller_scale_tunings(control_bank.kp[i], control_bank.ki[i], control_bank.kd[i], entry->kp, entry->ki,
+                                 entry->kd);
+    }
+
+    int loop = g_systemState.active_plant - 1;
+    if (loop >= 0 && loop < BANK_LOOPS) {
+        control_bank.iTerm[loop] = g_systemState.iTerm;
+        control_bank.lastY[loop] = g_systemState.lastY;
+    }
+}
+
+static void control_loop_publish() {
+    StateSnapshot_t snapshot;
+    snapshot.cycle = control_cycle;
+    snapshot.time_ms = millis();
+    snapshot.sp = g_systemState.sp;
+    snapshot.y = g_systemState.y;
+    snapshot.u = g_systemState.u;
+    snapshot.iTerm = g_systemState.iTerm;
+    snapshot.kp = g_systemState.kp;
+    snapshot.ki = g_systemState.ki;
+    snapshot.kd = g_systemState.kd;
+    snapshot.active_plant = g_systemState.active_plant;
+    snapshot.mux_combination = g_systemState.mux_combination;
+    snapshot.controller = controller_kind();
+    state_snapshot_publish(&snapshot);
+}
+
+static void control_loop_publish_bank() {
+    BankSnapshot_t snapshot;
+    snapshot.cycle = control_cycle;
+    snapshot.loops = dual_mode ? BANK_LOOPS : 0;
+    for (int i = 0; i < BANK_LOOPS; i++) {
+        snapshot.sp[i] = control_bank.sp[i];
+        snapshot.y[i] = control_bank.y[i];
+        snapshot.u[i] = control_bank.u[i];
+        snapshot.iTerm[i] = control_bank.iTerm[i];
+        snapshot.saturated[i] = control_bank.saturated[i];
+        snapshot.iae[i] = control_bank.iae[i];
+    }
+    bank_snapshot_publish(&snapshot);
+}
+
+// Um registro de telemetria por malha e por ciclo (sp/y em volts)
+static void control_loop_push_telemetry(int plant_id, float sp, float y, float u, float iTerm, uint8_t flags) {
+    TelemetryRecord_t record;
+    record.cycle = control_cycle;
+    record.time_ms = millis();
+    record.sp_v = (sp / (float)ADC_RESOLUTION) * (float)VCC;
+    record.y_v = (y / (float)ADC_RESOLUTION) * (float)VCC;
+    record.u = u;
+    record.iTerm = iTerm;
+    record.plant = (uint8_t)plant_id;
+    record.combination = (uint8_t)g_systemState.mux_combination;
+    record.flags = flags;
+    record.reserved = 0;
+    telemetry_push(&record);
+}
+
+// Avanca o perfil uma amostra e poe o valor no setpoint da malha ativa.
+// Retorna true se o setpoint deste ciclo veio do perfil.
+static bool control_loop_advance_profile() {
+    float sp;
+    if (!setpoint_player_next(&profile_player, &sp)) return false;
+
+    g_systemState.sp = sp;
+    int loop = g_systemState.active_plant - 1;
+    if (dual_mode && loop >= 0 && loop < BANK_LOOPS) control_bank.sp[loop] = sp;
+    return true;
+}
+
+// PRBS da identificacao somado ao u do PID, dentro da faixa do DAC
+static float control_loop_excite(float u, float excitation) {
+    u += excitation;
+    if (u > DAC_RESOLUTION) u = DAC_RESOLUTION;
+    if (u < 0) u = 0;
+    return u;
+}
+
+// Ciclo do modo duplo: le as duas plantas, atualiza o banco inteiro e
+// escreve os dois DACs
+static void control_loop_step_dual(uint8_t profile_flag) {
+    if (mux_select_plant(1, g_systemState.mux_combination)) {
+        hal_delay_us(MUX_SETTLE_US);
+        adc_acquisition_mux_switched();
+    }
+
+    control_bank.y[0] = adc_acquisition_read(1);
+    control_bank.y[1] = adc_acquisition_read(2);
+    if (restart_derivative) {
+        for (int i = 0; i < BANK_LOOPS; i++) control_bank.lastY[i] = control_bank.y[i];
+        restart_derivative = false;
+    }
+    loop_metrics_mark(LOOP_STAGE_ACQUIRE);
+    controller_bank_compute(&control_bank);
+    float excitation = ident_excitation_next();
+    for (int i = 0; i < BANK_LOOPS; i++) {
+        if (excitation != 0.0f) control_bank.u[i] = control_loop_excite(control_bank.u[i], excitation);
+    }
+    loop_metrics_mark(LOOP_STAGE_COMPUTE);
+
+    plant_write_control(1, control_bank.u[0]);
+    plant_write_control(2, control_bank.u[1]);
+    loop_metrics_mark(LOOP_STAGE_OUTPUT);
+
+    // Espelha a malha da planta ativa no estado principal
+    int loop = g_systemState.active_plant - 1;
+    if (loop >= 0 && loop < BANK_LOOPS) {
+        g_systemState.sp = control_bank.sp[loop];
+        g_systemState.y = control_bank.y[loop];
+        g_systemState.u = control_bank.u[loop];
+        g_systemState.iTerm = control_bank.iTerm[loop];
+        g_systemState.lastY = control_bank.lastY[loop];
+    }
+
+    for (int i = 0; i < BANK_LOOPS; i++) {
+        ident_update(i + 1, g_systemState.mux_combination, control_bank.y[i], control_bank.u[i]);
+        step_response_update(i + 1, g_systemState.mux_combination, control_bank.sp[i], control_bank.y[i],
+                             control_cycle);
+    }
+    control_cycle++;
+    ident_publish(control_cycle);
+    control_loop_publish();
+    control_loop_publish_bank();
+
+    for (int i = 0; i < BANK_LOOPS; i++) {
+        uint8_t flags = TELEMETRY_FLAG_DUAL | (i == loop ? TELEMETRY_FLAG_ACTIVE | profile_flag : 0);
+        control_loop_push_telemetry(i + 1, control_bank.sp[i], control_bank.y[i], control_bank.u[i],
+                                    control_bank.iTerm[i], flags);
+    }
+    loop_metrics_mark(LOOP_STAGE_PUBLISH);
+}
+
+void control_loop_step() {
+    loop_metrics_cycle_begin();
+    control_loop_apply_commands();
+    uint8_t profile_flag = control_loop_advance_profile() ? TELEMETRY_FLAG_PROFILE : 0;
+    loop_metrics_mark(LOOP_STAGE_REQUESTS);
+
+    if (dual_mode) {
+        control_loop_step_dual(profile_flag);
+        loop_metrics_cycle_end();
+        return;
+    }
+
+    int current_plant = g_systemState.active_plant;
+
+    // ativa a planta e combinaçao atual; so espera acomodar se o MUX mudou.
+    // O buffer de aquisicao so tem amostras da rede anterior: o y deste
+    // ciclo sai de uma leitura direta depois da espera
+    if (mux_select_plant(current_plant, g_systemState.mux_combination)) {
+        hal_delay_us(MUX_SETTLE_US);
+        adc_acquisition_mux_switched();
+    }
+
+    // Amostra decimada e calibrada do buffer de aquisicao, em contagens do
+    // ADC (a unidade do PID)
+    g_systemState.y = adc_acquisition_read(current_plant);
+    if (restart_derivative) {
+        g_systemState.lastY = g_systemState.y;
+        restart_derivative = false;
+    }
+    if (restart_controller) {
+        controller_reset();
+        restart_controller = false;
+    }
+    loop_metrics_mark(LOOP_STAGE_ACQUIRE);
+
+    uint8_t telemetry_flags = TELEMETRY_FLAG_ACTIVE | profile_flag;
+    if (autotune.status == AUTOTUNE_RUNNING) {
+        float u;
+        AutotuneStatus_t status = autotune_step(&autotune, g_systemState.y, (float)SAMPLE_TIME_S, &u);
+        g_systemState.u = u;
+        telemetry_flags |= TELEMETRY_FLAG_AUTOTUNE;
+        if (status != AUTOTUNE_RUNNING) control_loop_stop_autotune(status);
+    } else {
+        controller_compute();
+        float excitation = ident_excitation_next();
+        if (excitation != 0.0f) g_systemState.u = control_loop_excite(g_systemState.u, excitation);
+    }
+    loop_metrics_mark(LOOP_STAGE_COMPUTE);
+
+    // Aplica o sinal de controle
+    plant_write_control(current_plant, g_systemState.u);
+    loop_metrics_mark(LOOP_STAGE_OUTPUT);
+
+    // O ensaio do rele tambem serve de amostra para o modelo
+    ident_update(current_plant, g_systemState.mux_combination, g_systemState.y, g_systemState.u);
+    // O rele nao e resposta do controlador: o ciclo sem amostra descarta o degrau
+    if (!(telemetry_flags & TELEMETRY_FLAG_AUTOTUNE)) {
+        step_response_update(current_plant, g_systemState.mux_combination, g_systemState.sp, g_systemState.y,
+                             control_cycle);
+    }
+    control_cycle++;
+    ident_publish(control_cycle);
+    control_loop_publish();
+    control_loop_push_telemetry(current_plant, g_systemState.sp, g_systemState.y, g_systemState.u,
+                                g_systemState.iTerm, telemetry_flags);
+    loop_metrics_mark(LOOP_STAGE_PUBLISH);
+    loop_metrics_cycle_end();
+}
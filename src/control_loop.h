@@ -0,0 +1,92 @@
+// src/control_loop.h
+
+#ifndef CONTROL_LOOP_H
+#define CONTROL_LOOP_H
+
+#include "gain_schedule.h"
+#include "setpoint.h"
+#include "control_command.h"
+
+#include <stdint.h>
+
+// Prepara o ciclo. Chamar no setup. (A fila de comandos e estatica e nao
+// precisa de objetos do FreeRTOS.)
+bool control_loop_init();
+
+// Executa um ciclo completo de controle: aplica os comandos enfileirados,
+// seleciona a planta no MUX, le a saida, calcula o PID, aplica o sinal no
+// DAC e publica o snapshot do estado. Chamado pela pid_controller_task no
+// ESP32 e pelo simulador no build nativo.
+void control_loop_step();
+
+// Entrega um lote de comandos validados (control_command_valid) a tarefa
+// de controle, de qualquer tarefa e sem bloquear: o lote vai para uma fila
+// sem lock e e aplicado inteiro, no mesmo ciclo, no inicio do proximo ciclo
+// e na ordem de chegada. Retorna false se algum comando for invalido ou se a
+// fila estiver cheia (nada e enfileirado). Se o ultimo comando tiver id e
+// client, a confirmacao do lote sai em control_loop_drain_acks().
+bool control_loop_submit(const ControlCommand_t *commands, int count);
+
+// Confirmacoes dos lotes aplicados, em ordem. Somente uma tarefa consome
+// (a que responde pelo WebSocket). As que nao couberem na fila se perdem e
+// sao contadas em control_loop_acks_dropped().
+int control_loop_drain_acks(ControlAck_t *out, int max);
+uint32_t control_loop_acks_dropped();
+
+// Pedidos de um comando so, sem confirmacao (selecionador de plantas,
+// simulador). Retornam false se a fila estiver cheia.
+bool control_loop_request_tunings(double kP, double kI, double kD);
+bool control_loop_request_plant(int plant_id, int combination);
+bool control_loop_request_setpoint(double sp);
+
+// Perfil de setpoint (setpoint.h). Quem envia compila o perfil direto no
+// buffer devolvido por control_loop_profile_buffer() e o entrega com
+// control_loop_request_profile(true) (ou control_loop_deliver_profile() e um
+// comando CONTROL_CMD_PROFILE no lote); a tarefa de controle passa a
+// reproduzi-lo do inicio no proximo ciclo, uma amostra por ciclo, no lugar
+// do setpoint manual. A entrega so troca ponteiros entre tres buffers, com
+// um exchange atomico, entao o perfil nunca e copiado nem lido pela metade.
+// So uma tarefa pode enviar perfis. Com false o perfil para e o setpoint
+// fica onde estava; um setpoint manual ou o ensaio do rele tambem param o
+// perfil.
+SetpointProfile_t *control_loop_profile_buffer();
+void control_loop_deliver_profile();
+bool control_loop_request_profile(bool start);
+
+// Liga/desliga o modo de duas malhas (Planta 1 e Planta 2 controladas ao
+// mesmo tempo pelo banco de controladores, ver controller_bank.h). A
+// combinacao do MUX vale para as duas malhas, e a Planta 2 so existe nas
+// combinacoes 0 e 1: ligar o modo com a combinacao 2 ou 3, ou trocar para
+// uma delas no modo duplo, e recusado.
+bool control_loop_request_dual_mode(bool enabled);
+
+// Setpoint de uma malha especifica do modo duplo (plant_id 1 ou 2)
+bool control_loop_request_loop_setpoint(int plant_id, double sp);
+
+// Inicia (start = true) ou cancela o ensaio de sintonia a rele na planta
+// ativa (ver autotune.h). Ao terminar, os ganhos calculados pela regra
+// (AutotuneRule_t) sao aplicados e o resultado e publicado em
+// autotune_report_read(). Recusado no modo de duas malhas.
+bool control_loop_request_autotune(bool start, int rule, double amplitude);
+
+// Identificacao em linha (identification.h): amplitude do PRBS somado ao u
+// (contagens do DAC, 0 desliga, negativa mantem) e uma acao (IdentAction_t)
+// sobre o modelo da rede da planta ativa. Os modelos saem em
+// ident_report_read().
+bool control_loop_request_identification(double excitation, int action);
+
+// Algoritmo da malha simples (ControllerKind_t, controller_engine.h) e peso
+// dos incrementos de u do MPC (negativo mantem). O MPC usa o modelo
+// identificado da rede ativa: e recusado sem modelo valido ou no modo de
+// duas malhas, e a troca para uma rede sem modelo volta ao PID.
+bool control_loop_request_controller(int kind, double weight);
+
+// Tabela de ganhos por rede (gain_schedule.h). Chamar no setup, antes de
+// criar as tarefas: copia a tabela e aplica a entrada da rede atual. Dai em
+// diante cada troca de planta/combinacao aplica os ganhos da rede nova e
+// restaura o integrador dela; ganhos enviados pela pagina ou calculados
+// pelo ensaio do rele vao para a entrada da rede ativa. Com NULL a tabela
+// fica desligada e ganhos/integrador passam de uma rede para a outra.
+void control_loop_set_gain_schedule(const GainTable_t *table);
+
+#endif // CONTROL_LOOP_H
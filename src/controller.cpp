@@ -3,44 +3,58 @@
 #include "controller.h"
 #include "config.h"
 
+static ControllerEngine_t engine;
 
 void controller_init(double kP, double kI, double kD) {
     g_systemState.u = 0;
     g_systemState.y = 0;
     g_systemState.iTerm = 0;
     g_systemState.lastY = 0;
-    g_systemState.sp = 0.5 * ADC_RESOLUTION; // Ponto inicial (50%)
+    g_systemState.sp = 0.5f * ADC_RESOLUTION; // Ponto inicial (50%)
 
+    engine.kind = CONTROLLER_PID;
+    engine.pid.reset(&g_systemState);
+    engine.mpc.ready = false;
     controller_set_tunings(kP, kI, kD);
 }
 
 void controller_set_tunings(double kP, double kI, double kD) {
-    double sampleTimeInSec = (double)SAMPLE_TIME_MS / 1000.0;
-    g_systemState.kp = kP;
-    g_systemState.ki = kI * sampleTimeInSec;
-    g_systemState.kd = kD / sampleTimeInSec;
+    controller_scale_tunings(g_systemState.kp, g_systemState.ki, g_systemState.kd, kP, kI, kD);
 }
 
 
 void controller_compute() {
-    // Erro 
-    double e = g_systemState.sp - g_systemState.y;
+    g_systemState.u = controller_engine_compute(&engine, &g_systemState);
+}
+
+// O integrador do PID parte do u atual; o MPC ja trabalha em torno dele
+bool controller_select(int kind) {
+    if (kind < 0 || kind >= CONTROLLER_KIND_COUNT) return false;
+    if (kind == CONTROLLER_MPC && !engine.mpc.ready) return false;
+    if (kind == engine.kind) return true;
 
-    // Termo Integral com antiwindup
-    g_systemState.iTerm += (g_systemState.ki * e);
-    if (g_systemState.iTerm > DAC_RESOLUTION) g_systemState.iTerm = DAC_RESOLUTION;
-    else if (g_systemState.iTerm < 0) g_systemState.iTerm = 0;
+    engine.kind = kind;
+    g_systemState.iTerm = pid_clamp(g_systemState.u);
+    g_systemState.lastY = g_systemState.y;
+    controller_engine_reset(&engine, &g_systemState);
+    return true;
+}
 
-    // Termo Derivativo
-    double dY = g_systemState.y - g_systemState.lastY;
+int controller_kind() {
+    return engine.kind;
+}
 
-    // Calcula o sinal de controle PID
-    g_systemState.u = (g_systemState.kp * e) + g_systemState.iTerm - (g_systemState.kd * dY);
+bool controller_set_model(const ControllerModel_t *model, float weight) {
+    if (!engine.mpc.set_model(model, weight)) return false;
+    if (engine.kind == CONTROLLER_MPC) engine.mpc.reset(&g_systemState);
+    return true;
+}
 
-    // Controle de sautracao
-    if (g_systemState.u > DAC_RESOLUTION) g_systemState.u = DAC_RESOLUTION;
-    else if (g_systemState.u < 0) g_systemState.u = 0;
+float controller_model_weight() {
+    return engine.mpc.weight;
+}
 
-    // Atualiza a ultma leitura
+void controller_reset() {
     g_systemState.lastY = g_systemState.y;
-}
\ No newline at end of file
+    controller_engine_reset(&engine, &g_systemState);
+}
@@ -1,10 +1,30 @@
 // src/controller.h
+//
+// Controlador da malha simples sobre g_systemState. O algoritmo vem do
+// conjunto fixo de controller_engine.h (PID por padrao) e so a tarefa de
+// controle chama estas funcoes depois do setup.
 
 #ifndef CONTROLLER_H
 #define CONTROLLER_H
 
+#include "controller_engine.h"
+
 void controller_init(double kP, double kI, double kD);
 void controller_set_tunings(double kP, double kI, double kD);
 void controller_compute();
 
-#endif // CONTROLLER_H
\ No newline at end of file
+// Troca o algoritmo, sem salto no u. O MPC so e aceito depois de receber um
+// modelo (controller_set_model). Retorna false se nao puder trocar.
+bool controller_select(int kind);
+int controller_kind();
+
+// Modelo e peso dos incrementos de u do MPC. Retorna false se o modelo nao
+// servir (o anterior continua).
+bool controller_set_model(const ControllerModel_t *model, float weight);
+float controller_model_weight();
+
+// A medicao deixou de seguir as anteriores (troca de rede, fim do ensaio do
+// rele): o controlador recomeca do estado atual
+void controller_reset();
+
+#endif // CONTROLLER_H
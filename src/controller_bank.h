@@ -0,0 +1,68 @@
+// src/controller_bank.h
+//
+// Banco de N malhas PID independentes em layout struct-of-arrays: cada campo
+// (sp, y, u, iTerm, lastY, ganhos) e um vetor contiguo, e um unico
+// controller_bank_compute() atualiza todas as malhas no mesmo tick, cada uma
+// com o mesmo kernel do PID da malha simples (pid_kernel_compute). No ESP32
+// o banco tem 2 malhas (uma por planta); no build nativo pode ter milhares
+// de malhas virtuais para medir quantas cabem em um tick.
+
+#ifndef CONTROLLER_BANK_H
+#define CONTROLLER_BANK_H
+
+#include "config.h"
+#include "pid_kernel.h"
+
+template <int N>
+struct ControllerBank {
+    int count;                  // malhas em uso (<= N)
+
+    float sp[N];
+    float y[N];
+    float u[N];
+    float iTerm[N];
+    float lastY[N];
+    float dTerm[N];             // derivada filtrada (contagens do DAC)
+    float kp[N], ki[N], kd[N];  // ki e kd ja escalados pelo periodo (controller_scale_tunings)
+
+    // Telemetria por malha
+    uint32_t cycles[N];
+    uint32_t saturated[N];      // ciclos com u no limite do DAC
+    float iae[N];               // integral do erro absoluto (contagens.s)
+};
+
+template <int N>
+void controller_bank_init(ControllerBank<N> *bank, int count) {
+    bank->count = (count > N) ? N : count;
+    for (int i = 0; i < N; i++) {
+        bank->sp[i] = 0.5f * ADC_RESOLUTION;
+        bank->y[i] = 0;
+        bank->u[i] = 0;
+        bank->iTerm[i] = 0;
+        bank->lastY[i] = 0;
+        bank->dTerm[i] = 0;
+        bank->kp[i] = bank->ki[i] = bank->kd[i] = 0;
+        bank->cycles[i] = 0;
+        bank->saturated[i] = 0;
+        bank->iae[i] = 0;
+    }
+}
+
+// Atualiza todas as malhas com as medicoes ja gravadas em bank->y
+template <int N>
+void controller_bank_compute(ControllerBank<N> *bank) {
+    constexpr float ts = (float)SAMPLE_TIME_S;
+    const int count = bank->count;
+
+    for (int i = 0; i < count; i++) {
+        float e = bank->sp[i] - bank->y[i];
+        float u = pid_kernel_compute<float>(bank->sp[i], bank->y[i], bank->iTerm[i], bank->lastY[i],
+                                            bank->dTerm[i], bank->kp[i], bank->ki[i], bank->kd[i]);
+        bank->u[i] = u;
+        bank->cycles[i]++;
+        bank->saturated[i] += (u <= PidLimits<float>::u_min() || u >= PidLimits<float>::u_max());
+        bank->iae[i] += (e < 0 ? -e : e) * ts;
+    }
+}
+
+#endif // CONTROLLER_BANK_H
@@ -0,0 +1,239 @@
+// src/controller_engine.h
+//
+// Controladores da malha simples. Cada um deriva de Controller<Derived>
+// (CRTP): a interface chama a implementacao por static_cast, sem tabela
+// virtual, e o compilador pode expandir o controlador inteiro dentro do
+// ciclo. ControllerEngine guarda um de cada do conjunto fixo e escolhe em
+// tempo de execucao por um switch no tipo (controller_engine_compute).
+//
+// Todos trabalham sobre o SystemState_t: leem sp, y e o u aplicado no
+// ciclo anterior (com o que foi somado depois do controlador, como o PRBS
+// da identificacao) e deixam em iTerm o u que segura o ponto de operacao,
+// que e o que a troca de rede guarda e a troca de controlador usa para nao
+// dar salto.
+//
+//   CONTROLLER_PID  PID com derivada sobre a medicao filtrada (Td/N) e
+//                   anti-windup por recalculo (back-calculation)
+//   CONTROLLER_MPC  controle preditivo sobre o modelo ARX incremental da
+//                   rede (identification.h): horizonte de MPC_HORIZON
+//                   amostras, MPC_MOVES movimentos de u, custo quadratico
+//                   no erro e nos incrementos de u. Sem restricoes ativas a
+//                   solucao e linear na resposta livre, entao o ganho e
+//                   calculado uma vez por modelo (set_model)
+//                   e o ciclo so simula a resposta livre e faz um produto
+//                   escalar; a saturacao do DAC corta o primeiro movimento.
+//                   A forma incremental do modelo da a acao integral sem
+//                   estimador de perturbacao.
+
+#ifndef CONTROLLER_ENGINE_H
+#define CONTROLLER_ENGINE_H
+
+#include "config.h"
+#include "pid_kernel.h"
+
+#include <math.h>
+
+typedef enum {
+    CONTROLLER_PID = 0,
+    CONTROLLER_MPC,
+    CONTROLLER_KIND_COUNT,
+} ControllerKind_t;
+
+const int MPC_HORIZON = 25;                     // amostras previstas (5 s)
+const int MPC_MOVES = 3;                        // movimentos de u otimizados
+const float MPC_DEFAULT_WEIGHT = 0.05f;         // peso dos incrementos de u
+
+inline const char *controller_kind_name(int kind) {
+    return kind == CONTROLLER_MPC ? "mpc" : "pid";
+}
+
+// Modelo y[k] = a1 y[k-1] + a2 y[k-2] + b1 u[k-1] + b2 u[k-2] + c, com y em
+// contagens do ADC e u em contagens do DAC (a2 = 0 na primeira ordem). O
+// controlador usa a forma incremental, entao c nao entra.
+typedef struct {
+    float a[2];
+    float b[2];
+} ControllerModel_t;
+
+template <typename Derived>
+class Controller {
+public:
+    // u do ciclo (contagens do DAC) a partir de s->sp e s->y
+    float compute(SystemState_t *s) { return self()->compute_impl(s); }
+
+    // Assume a malha no estado atual (u aplicado, y medido), sem salto
+    void reset(const SystemState_t *s) { self()->reset_impl(s); }
+
+private:
+    Derived *self() { return static_cast<Derived *>(this); }
+};
+
+// Ganhos do PID por segundo (ki em 1/s, kd em s) escalados para o periodo
+// ts_s, como pid_kernel_compute os usa. Serve a malha simples
+// (SystemState_t) e a cada malha do banco (controller_bank.h).
+inline void controller_scale_tunings(float &kp_out, float &ki_out, float &kd_out, double kp, double ki, double kd,
+                                     double ts_s = SAMPLE_TIME_S) {
+    kp_out = kp;
+    ki_out = ki * ts_s;
+    kd_out = kd / ts_s;
+}
+
+// PID do kernel (pid_kernel.h), o mesmo de cada malha do banco
+class PidController : public Controller<PidController> {
+public:
+    float dTerm = 0.0f;         // derivada filtrada (contagens do DAC)
+
+    // ki e kd ja escalados pelo periodo (controller_set_tunings)
+    float compute_impl(SystemState_t *s) {
+        return pid_kernel_compute<float>(s->sp, s->y, s->iTerm, s->lastY, dTerm, s->kp, s->ki, s->kd);
+    }
+
+    void reset_impl(const SystemState_t *s) {
+        (void)s;
+        dTerm = 0.0f;
+    }
+};
+
+template <int NP, int NC>
+class MpcController : public Controller<MpcController<NP, NC>> {
+public:
+    ControllerModel_t model;
+    float weight = MPC_DEFAULT_WEIGHT;
+    float gain[NP];             // primeira linha de (G'G + w I)^-1 G'
+    bool ready = false;
+    float y1 = 0.0f, y2 = 0.0f; // y[k-1], y[k-2]
+    float u2 = 0.0f;            // u[k-2]
+
+    float compute_impl(SystemState_t *s) {
+        const float a1 = model.a[0], a2 = model.a[1], b2 = model.b[1];
+        float y = s->y;
+        float u1 = pid_clamp(s->u);     // u[k-1], o que chegou ao DAC
+
+        // Resposta livre: u parado em u[k-1] daqui em diante
+        float d0 = y - y1, d1 = y1 - y2;
+        float f = y;
+        float du = b2 * (u1 - u2);
+        float move = 0.0f;
+        for (int j = 0; j < NP; j++) {
+            float dn = a1 * d0 + a2 * d1 + du;
+            du = 0.0f;
+            f += dn;
+            d1 = d0;
+            d0 = dn;
+            move += gain[j] * (s->sp - f);
+        }
+
+        float u = pid_clamp(u1 + move);
+        y2 = y1;
+        y1 = y;
+        u2 = u1;
+        s->lastY = y;
+        s->iTerm = u;
+        return u;
+    }
+
+    void reset_impl(const SystemState_t *s) {
+        y1 = y2 = s->y;
+        u2 = pid_clamp(s->u);
+    }
+
+    // Calcula o ganho para o modelo. Retorna false (e fica como estava) se
+    // o modelo nao responde ao degrau ou o sistema for singular.
+    bool set_model(const ControllerModel_t *m, float w) {
+        float g[NP];
+        if (!solve_gain(m, w, g)) return false;
+        model = *m;
+        weight = w;
+        for (int j = 0; j < NP; j++) gain[j] = g[j];
+        ready = true;
+        return true;
+    }
+
+    // Primeira linha de (G'G + w dc^2 I)^-1 G', sem mexer no controlador:
+    // serve tambem para saber antes se set_model vai aceitar o modelo
+    static bool solve_gain(const ControllerModel_t *m, float w, float out[NP]) {
+        // Resposta ao degrau unitario de u: g[j] = y[j+1]
+        float g[NP];
+        float ya = 0.0f, yb = 0.0f;
+        for (int j = 0; j < NP; j++) {
+            float next = m->a[0] * ya + m->a[1] * yb + m->b[0] + (j > 0 ? m->b[1] : 0.0f);
+            yb = ya;
+            ya = next;
+            g[j] = next;
+        }
+        float dc = g[NP - 1];
+        if (!(fabsf(dc) > 1e-6f) || !(w >= 0.0f)) return false;
+
+        // M = G'G + w dc^2 I, com G[j][m] = g[j - m] (0 antes do movimento)
+        float M[NC][NC];
+        float Gt[NC][NP];
+        for (int m1 = 0; m1 < NC; m1++) {
+            for (int j = 0; j < NP; j++) Gt[m1][j] = (j >= m1) ? g[j - m1] : 0.0f;
+        }
+        for (int m1 = 0; m1 < NC; m1++) {
+            for (int m2 = 0; m2 < NC; m2++) {
+                float sum = 0.0f;
+                for (int j = 0; j < NP; j++) sum += Gt[m1][j] * Gt[m2][j];
+                M[m1][m2] = sum + (m1 == m2 ? w * dc * dc : 0.0f);
+            }
+        }
+
+        // Gauss-Jordan em [M | G'] ate M virar a identidade; a primeira
+        // linha do lado direito e o ganho
+        for (int c = 0; c < NC; c++) {
+            int pivot = c;
+            for (int r = c + 1; r < NC; r++) {
+                if (fabsf(M[r][c]) > fabsf(M[pivot][c])) pivot = r;
+            }
+            if (!(fabsf(M[pivot][c]) > 1e-12f)) return false;
+            if (pivot != c) {
+                for (int k = 0; k < NC; k++) { float t = M[c][k]; M[c][k] = M[pivot][k]; M[pivot][k] = t; }
+                for (int k = 0; k < NP; k++) { float t = Gt[c][k]; Gt[c][k] = Gt[pivot][k]; Gt[pivot][k] = t; }
+            }
+            float inv = 1.0f / M[c][c];
+            for (int k = 0; k < NC; k++) M[c][k] *= inv;
+            for (int k = 0; k < NP; k++) Gt[c][k] *= inv;
+            for (int r = 0; r < NC; r++) {
+                if (r == c || M[r][c] == 0.0f) continue;
+                float f = M[r][c];
+                for (int k = 0; k < NC; k++) M[r][k] -= f * M[c][k];
+                for (int k = 0; k < NP; k++) Gt[r][k] -= f * Gt[c][k];
+            }
+        }
+
+        for (int j = 0; j < NP; j++) out[j] = Gt[0][j];
+        return true;
+    }
+};
+
+typedef MpcController<MPC_HORIZON, MPC_MOVES> LoopMpc_t;
+
+typedef struct {
+    int kind;                   // ControllerKind_t
+    PidController pid;
+    LoopMpc_t mpc;
+} ControllerEngine_t;
+
+inline float controller_engine_compute(ControllerEngine_t *engine, SystemState_t *s) {
+    switch (engine->kind) {
+    case CONTROLLER_MPC:
+        return engine->mpc.compute(s);
+    case CONTROLLER_PID:
+    default:
+        return engine->pid.compute(s);
+    }
+}
+
+inline void controller_engine_reset(ControllerEngine_t *engine, const SystemState_t *s) {
+    switch (engine->kind) {
+    case CONTROLLER_MPC:
+        engine->mpc.reset(s);
+        break;
+    case CONTROLLER_PID:
+    default:
+        engine->pid.reset(s);
+        break;
+    }
+}
+
+#endif // CONTROLLER_ENGINE_H
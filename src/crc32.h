@@ -0,0 +1,22 @@
+// src/crc32.h
+//
+// CRC-32 (IEEE) dos blobs de configuracao (blob_storage.h). Bit a bit: os
+// blobs tem algumas centenas de bytes e so sao verificados no boot e ao
+// gravar.
+
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+static inline uint32_t crc32_ieee(const uint8_t *data, size_t length) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int b = 0; b < 8; b++) crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+    }
+    return ~crc;
+}
+
+#endif // CRC32_H
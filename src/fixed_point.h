@@ -0,0 +1,52 @@
+// src/fixed_point.h
+//
+// Ponto fixo Q16.16 (16 bits inteiros com sinal, 16 fracionarios) para o
+// kernel do PID. Faixa de +-32768 com resolucao de 1/65536, suficiente para
+// contagens do ADC (0-4095) e do DAC (0-255).
+
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <stdint.h>
+
+struct Q16_16 {
+    int32_t raw;
+
+    constexpr Q16_16() : raw(0) {}
+    constexpr Q16_16(double v) : raw((int32_t)(v * 65536.0 + (v >= 0 ? 0.5 : -0.5))) {}
+    constexpr Q16_16(int v) : raw((int32_t)((uint32_t)v << 16)) {}
+
+    static constexpr Q16_16 from_raw(int32_t r) { return Q16_16(r, 0); }
+
+    constexpr double to_double() const { return raw / 65536.0; }
+    constexpr float to_float() const { return raw / 65536.0f; }
+    explicit constexpr operator double() const { return to_double(); }
+
+    constexpr Q16_16 operator+(Q16_16 o) const { return from_raw(raw + o.raw); }
+    constexpr Q16_16 operator-(Q16_16 o) const { return from_raw(raw - o.raw); }
+    constexpr Q16_16 operator-() const { return from_raw(-raw); }
+    constexpr Q16_16 operator*(Q16_16 o) const {
+        return from_raw((int32_t)(((int64_t)raw * o.raw) >> 16));
+    }
+
+    // Satura no limite da faixa quando o quociente nao cabe; divisor zero
+    // da o limite com o sinal do dividendo (0/0 da 0)
+    constexpr Q16_16 operator/(Q16_16 o) const {
+        if (o.raw == 0) return from_raw(raw > 0 ? INT32_MAX : raw < 0 ? INT32_MIN : 0);
+        int64_t q = ((int64_t)raw * 65536) / o.raw;
+        return from_raw(q > INT32_MAX ? INT32_MAX : q < INT32_MIN ? INT32_MIN : (int32_t)q);
+    }
+
+    Q16_16 &operator+=(Q16_16 o) { raw += o.raw; return *this; }
+    Q16_16 &operator-=(Q16_16 o) { raw -= o.raw; return *this; }
+
+    constexpr bool operator<(Q16_16 o) const { return raw < o.raw; }
+    constexpr bool operator>(Q16_16 o) const { return raw > o.raw; }
+    constexpr bool operator<=(Q16_16 o) const { return raw <= o.raw; }
+    constexpr bool operator>=(Q16_16 o) const { return raw >= o.raw; }
+
+private:
+    constexpr Q16_16(int32_t r, int) : raw(r) {}
+};
+
+#endif // FIXED_POINT_H
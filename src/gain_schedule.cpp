@@ -0,0 +1,141 @@
+// src/gain_schedule.cpp
+
+#include "gain_schedule.h"
+#include "blob_storage.h"
+#include "byte_order.h"
+#include "crc32.h"
+#include "seqlock.h"
+
+#include <atomic>
+#include <math.h>
+
+static const char GAIN_SCHEDULE_FILE[] = "gains.bin";
+
+static Seqlock<GainTable_t> table_seqlock;
+static uint32_t saved_revision = 0;
+
+// Pedidos de varredura (qualquer tarefa) e estado (so a tarefa da varredura)
+static std::atomic<bool> sweep_enabled(false);
+static std::atomic<bool> sweep_restart(false);
+static std::atomic<uint32_t> sweep_dwell_ms(GAIN_SCHEDULE_DEFAULT_DWELL_MS);
+static unsigned long sweep_last_ms = 0;
+
+void gain_schedule_defaults(GainTable_t *table, float kp, float ki, float kd) {
+    memset(table, 0, sizeof(*table));
+    for (int i = 0; i < GAIN_SCHEDULE_ENTRIES; i++) {
+        table->entries[i].kp = kp;
+        table->entries[i].ki = ki;
+        table->entries[i].kd = kd;
+    }
+}
+
+size_t gain_schedule_encode(const GainTable_t *table, uint8_t out[GAIN_SCHEDULE_BLOB_SIZE]) {
+    uint8_t *p = out;
+    p = put_u32(p, GAIN_SCHEDULE_MAGIC);
+    p = put_u16(p, GAIN_SCHEDULE_VERSION);
+    *p++ = (uint8_t)GAIN_SCHEDULE_PLANTS;
+    *p++ = (uint8_t)GAIN_SCHEDULE_COMBINATIONS;
+    for (int i = 0; i < GAIN_SCHEDULE_ENTRIES; i++) {
+        const GainScheduleEntry_t *e = &table->entries[i];
+        p = put_f32(p, e->kp);
+        p = put_f32(p, e->ki);
+        p = put_f32(p, e->kd);
+        p = put_u32(p, e->flags);
+    }
+    p = put_u32(p, crc32_ieee(out, p - out));
+    return p - out;
+}
+
+bool gain_schedule_decode(const uint8_t *data, size_t length, GainTable_t *table) {
+    if (length != GAIN_SCHEDULE_BLOB_SIZE) return false;
+    if (get_u32(data) != GAIN_SCHEDULE_MAGIC || get_u16(data + 4) != GAIN_SCHEDULE_VERSION) return false;
+    if (data[6] != GAIN_SCHEDULE_PLANTS || data[7] != GAIN_SCHEDULE_COMBINATIONS) return false;
+    if (get_u32(data + length - 4) != crc32_ieee(data, length - 4)) return false;
+
+    memset(table, 0, sizeof(*table));
+    const uint8_t *p = data + 8;
+    for (int i = 0; i < GAIN_SCHEDULE_ENTRIES; i++, p += GAIN_SCHEDULE_ENTRY_SIZE) {
+        GainScheduleEntry_t *e = &table->entries[i];
+        e->kp = get_f32(p);
+        e->ki = get_f32(p + 4);
+        e->kd = get_f32(p + 8);
+        e->flags = get_u32(p + 12);
+        // Ganho que nao e um numero finito e nao negativo nunca chega ao
+        // controlador: a tabela inteira e recusada
+        if (!isfinite(e->kp) || !isfinite(e->ki) || !isfinite(e->kd) || e->kp < 0 || e->ki < 0 || e->kd < 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool gain_schedule_load(GainTable_t *table) {
+    uint8_t data[GAIN_SCHEDULE_BLOB_SIZE];
+    size_t length;
+    if (blob_storage_read(GAIN_SCHEDULE_FILE, data, sizeof(data), &length) &&
+        gain_schedule_decode(data, length, table)) {
+        return true;
+    }
+    // Reset entre apagar o arquivo antigo e renomear o novo: vale a copia
+    // temporaria, se estiver inteira
+    return blob_storage_read_pending(GAIN_SCHEDULE_FILE, data, sizeof(data), &length) &&
+           gain_schedule_decode(data, length, table);
+}
+
+bool gain_schedule_save(const GainTable_t *table) {
+    uint8_t data[GAIN_SCHEDULE_BLOB_SIZE];
+    size_t length = gain_schedule_encode(table, data);
+    return blob_storage_write(GAIN_SCHEDULE_FILE, data, length);
+}
+
+void gain_schedule_publish(const GainTable_t *table) {
+    table_seqlock.publish(*table);
+}
+
+void gain_schedule_read(GainTable_t *out) {
+    table_seqlock.read(out);
+}
+
+void gain_schedule_persist() {
+    GainTable_t table;
+    gain_schedule_read(&table);
+    if (table.revision == saved_revision) return;
+    // Se falhar, tenta de novo na proxima chamada
+    if (gain_schedule_save(&table)) saved_revision = table.revision;
+}
+
+void gain_schedule_request_sweep(bool enabled, uint32_t dwell_ms) {
+    if (dwell_ms > 0) sweep_dwell_ms.store(dwell_ms);
+    // Religar conta a permanencia de novo; repetir o pedido nao
+    if (enabled && !sweep_enabled.load()) sweep_restart.store(true);
+    sweep_enabled.store(enabled);
+}
+
+bool gain_schedule_sweep_enabled() {
+    return sweep_enabled.load();
+}
+
+bool gain_schedule_sweep_next(unsigned long now_ms, int plant_id, int combination, bool dual,
+                              int *next_plant, int *next_combination) {
+    if (!sweep_enabled.load()) return false;
+    if (sweep_restart.exchange(false)) {
+        sweep_last_ms = now_ms;
+        return false;
+    }
+    if (now_ms - sweep_last_ms < sweep_dwell_ms.load()) return false;
+    sweep_last_ms = now_ms;
+
+    // Proxima entrada que existe, dando a volta na tabela
+    int index = gain_schedule_index(plant_id, combination);
+    for (int step = 1; step <= GAIN_SCHEDULE_ENTRIES; step++) {
+        int i = (index + step + GAIN_SCHEDULE_ENTRIES) % GAIN_SCHEDULE_ENTRIES;
+        int plant = i / GAIN_SCHEDULE_COMBINATIONS + 1;
+        int comb = i % GAIN_SCHEDULE_COMBINATIONS;
+        if (gain_schedule_index(plant, comb) != i) continue;
+        if (dual && gain_schedule_index(2, comb) < 0) continue;
+        *next_plant = plant;
+        *next_combination = comb;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,89 @@
+// src/gain_schedule.h
+//
+// Tabela de ganhos por rede RC (planta, combinacao do MUX). Cada entrada
+// guarda os ganhos sintonizados para aquela rede; a troca de combinacao
+// busca a entrada pelo indice (O(1)) e a tarefa de controle salva/restaura
+// o estado do integrador de cada rede, para que a rede que volta ao laco
+// retome de onde parou, sem salto na saida (ver control_loop.cpp).
+//
+// A tabela e salva no sistema de arquivos em um blob binario pequeno
+// (GAIN_SCHEDULE_BLOB_SIZE bytes, com CRC) e carregada uma vez no boot.
+// Quem grava e a combination_selector_task, nunca a tarefa de controle:
+// a tarefa de controle so publica a tabela (seqlock) quando ela muda.
+//
+// A mesma tarefa faz a varredura programada: percorre as entradas da
+// tabela em ordem, ficando dwell_ms em cada rede.
+
+#ifndef GAIN_SCHEDULE_H
+#define GAIN_SCHEDULE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+const int GAIN_SCHEDULE_PLANTS = 2;
+const int GAIN_SCHEDULE_COMBINATIONS = 4;
+const int GAIN_SCHEDULE_ENTRIES = GAIN_SCHEDULE_PLANTS * GAIN_SCHEDULE_COMBINATIONS;
+
+const uint32_t GAIN_SCHEDULE_MAGIC = 0x31435347;    // "GSC1"
+const uint16_t GAIN_SCHEDULE_VERSION = 1;
+const size_t GAIN_SCHEDULE_ENTRY_SIZE = 16;
+const size_t GAIN_SCHEDULE_BLOB_SIZE = 8 + GAIN_SCHEDULE_ENTRIES * GAIN_SCHEDULE_ENTRY_SIZE + 4;
+
+const unsigned long GAIN_SCHEDULE_TASK_PERIOD_MS = 1000;
+const uint32_t GAIN_SCHEDULE_DEFAULT_DWELL_MS = 60000;
+
+// Origem dos ganhos de uma entrada
+enum {
+    GAIN_ENTRY_USER = 1 << 0,       // enviados pela pagina
+    GAIN_ENTRY_AUTOTUNE = 1 << 1,   // calculados pelo ensaio do rele
+};
+
+typedef struct {
+    float kp, ki, kd;               // ki e kd por segundo (antes da escala de Ts)
+    uint32_t flags;
+} GainScheduleEntry_t;
+
+typedef struct {
+    uint32_t revision;              // muda a cada alteracao (nao vai para o blob)
+    GainScheduleEntry_t entries[GAIN_SCHEDULE_ENTRIES];
+} GainTable_t;
+
+// Indice da entrada de (planta, combinacao), ou -1 se nao existir. A Planta 2
+// so esta ligada nas combinacoes 0 e 1.
+inline int gain_schedule_index(int plant_id, int combination) {
+    if (plant_id < 1 || plant_id > GAIN_SCHEDULE_PLANTS) return -1;
+    if (combination < 0 || combination >= (plant_id == 1 ? 4 : 2)) return -1;
+    return (plant_id - 1) * GAIN_SCHEDULE_COMBINATIONS + combination;
+}
+
+// Todas as entradas com os mesmos ganhos
+void gain_schedule_defaults(GainTable_t *table, float kp, float ki, float kd);
+
+// Blob: magic, versao, dimensoes, entradas (f32 LE) e CRC-32 do resto. A
+// decodificacao recusa o blob com ganho nao finito ou negativo.
+size_t gain_schedule_encode(const GainTable_t *table, uint8_t out[GAIN_SCHEDULE_BLOB_SIZE]);
+bool gain_schedule_decode(const uint8_t *data, size_t length, GainTable_t *table);
+
+// Le/grava o blob no sistema de arquivos (ver blob_storage.h); a leitura
+// cai na copia temporaria de uma gravacao interrompida se ela for valida
+bool gain_schedule_load(GainTable_t *table);
+bool gain_schedule_save(const GainTable_t *table);
+
+// Copia publicada pela tarefa de controle; qualquer tarefa pode ler
+void gain_schedule_publish(const GainTable_t *table);
+void gain_schedule_read(GainTable_t *out);
+
+// Grava a tabela publicada se ela mudou desde a ultima gravacao
+void gain_schedule_persist();
+
+// Varredura programada pelas entradas da tabela
+void gain_schedule_request_sweep(bool enabled, uint32_t dwell_ms);
+bool gain_schedule_sweep_enabled();
+
+// Chamado periodicamente: quando der o tempo de trocar, devolve a proxima
+// (planta, combinacao) depois da atual e retorna true. No modo duplo (dual)
+// a combinacao vale para as duas malhas, entao so as que a Planta 2 tem.
+bool gain_schedule_sweep_next(unsigned long now_ms, int plant_id, int combination, bool dual,
+                              int *next_plant, int *next_combination);
+
+#endif // GAIN_SCHEDULE_H
@@ -0,0 +1,61 @@
+// src/hal.h
+//
+// Camada de abstracao de hardware (HAL). Os modulos plant e mux falam com o
+// hardware apenas por aqui, o que permite trocar o ESP32 (hal_esp32.cpp) pelo
+// simulador das plantas RC no build nativo (sim/hal_sim.cpp).
+
+#ifndef HAL_H
+#define HAL_H
+
+#include <stdint.h>
+
+// Funcoes chamadas de dentro de uma interrupcao ficam na IRAM do ESP32 (a
+// interrupcao continua atendida com a cache da flash desligada, durante uma
+// gravacao no SPIFFS)
+#ifdef NATIVE_SIM
+#define HAL_ISR_ATTR
+#else
+#include <esp_attr.h>
+#define HAL_ISR_ATTR IRAM_ATTR
+#endif
+
+// GPIO
+void hal_gpio_set_output(int pin);
+void hal_gpio_set_input(int pin);
+void hal_gpio_write(int pin, bool high);
+
+// ADC: leitura bruta (0 a ADC_RESOLUTION) do pino informado
+int hal_adc_read(int pin);
+
+// DAC: pino 25 (canal 1) ou 26 (canal 2), valor de 0 a DAC_RESOLUTION
+void hal_dac_enable(int pin);
+void hal_dac_write(int pin, uint8_t value);
+
+// Tempo
+uint32_t hal_micros();
+void hal_delay_us(uint32_t us);
+
+// Contador de ciclos da CPU (da a volta em 32 bits) e quantos ciclos cabem
+// em 1 us, para medir trechos curtos de codigo (loop_metrics.h)
+uint32_t hal_cycle_count();
+uint32_t hal_cycles_per_us();
+
+// Timer de hardware periodico (resolucao de 1 us): callback(arg) roda dentro
+// da interrupcao a cada period_us, no nucleo que chamou hal_timer_start.
+// O callback precisa ser HAL_ISR_ATTR e curto. Um timer por programa;
+// retorna false se nao houver timer (no build nativo o simulador dispara os
+// ciclos pelo relogio virtual).
+typedef void (*HalTimerCallback_t)(void *arg);
+bool hal_timer_start(uint32_t period_us, HalTimerCallback_t callback, void *arg);
+
+// Heap de uso geral (memory_budget.h). Tudo em bytes; no build nativo nao ha
+// heap do ESP32 para medir e tudo fica em 0.
+typedef struct {
+    uint32_t total;
+    uint32_t free;
+    uint32_t min_free;          // menor livre desde a partida
+    uint32_t largest_block;     // maior bloco que ainda da para alocar
+} HalHeapStats_t;
+void hal_heap_stats(HalHeapStats_t *out);
+
+#endif // HAL_H
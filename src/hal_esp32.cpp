@@ -0,0 +1,83 @@
+// src/hal_esp32.cpp
+//
+// Implementacao da HAL sobre o Arduino core do ESP32.
+
+#include "hal.h"
+#include "config.h"
+
+#include <esp_heap_caps.h>
+
+static dac_channel_t dac_channel_from_pin(int pin) {
+    return (pin == DAC_PIN_PLANT_2) ? DAC_CHANNEL_2 : DAC_CHANNEL_1;
+}
+
+void hal_gpio_set_output(int pin) {
+    pinMode(pin, OUTPUT);
+}
+
+void hal_gpio_set_input(int pin) {
+    pinMode(pin, INPUT);
+}
+
+void hal_gpio_write(int pin, bool high) {
+    digitalWrite(pin, high ? HIGH : LOW);
+}
+
+int hal_adc_read(int pin) {
+    return analogRead(pin);
+}
+
+void hal_dac_enable(int pin) {
+    dac_output_enable(dac_channel_from_pin(pin));
+}
+
+void hal_dac_write(int pin, uint8_t value) {
+    dac_output_voltage(dac_channel_from_pin(pin), value);
+}
+
+uint32_t hal_micros() {
+    return micros();
+}
+
+void hal_delay_us(uint32_t us) {
+    delayMicroseconds(us);
+}
+
+uint32_t HAL_ISR_ATTR hal_cycle_count() {
+    return ESP.getCycleCount();
+}
+
+uint32_t hal_cycles_per_us() {
+    static const uint32_t cycles_per_us = getCpuFrequencyMhz();
+    return cycles_per_us;
+}
+
+// Timer 0 do grupo 0 com prescaler 80 (APB de 80 MHz): conta em us
+static hw_timer_t *hal_timer = NULL;
+static HalTimerCallback_t hal_timer_callback = NULL;
+static void *hal_timer_arg = NULL;
+
+static void HAL_ISR_ATTR hal_timer_isr() {
+    hal_timer_callback(hal_timer_arg);
+}
+
+bool hal_timer_start(uint32_t period_us, HalTimerCallback_t callback, void *arg) {
+    if (hal_timer != NULL || callback == NULL || period_us == 0) return false;
+    hal_timer = timerBegin(0, 80, true);
+    if (hal_timer == NULL) return false;
+    hal_timer_callback = callback;
+    hal_timer_arg = arg;
+    // A interrupcao e alocada no nucleo de quem chama; o timer do ESP32 so
+    // gera interrupcao por nivel (edge = false)
+    timerAttachInterrupt(hal_timer, &hal_timer_isr, false);
+    timerAlarmWrite(hal_timer, period_us, true);
+    timerAlarmEnable(hal_timer);
+    return true;
+}
+
+void hal_heap_stats(HalHeapStats_t *out) {
+    out->total = heap_caps_get_total_size(MALLOC_CAP_8BIT);
+    out->free = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    out->min_free = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+    out->largest_block = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+}
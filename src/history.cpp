@@ -0,0 +1,359 @@
+// src/history.cpp
+
+#include "history.h"
+#include "config.h"
+#include "byte_order.h"
+
+#include <math.h>
+#include <string.h>
+
+static_assert(HISTORY_PERIOD_MS[HISTORY_RAW] == SAMPLE_TIME_MS, "nivel bruto deve ter o periodo de controle");
+static_assert(HISTORY_PERIOD_MS[HISTORY_1S] % SAMPLE_TIME_MS == 0 && HISTORY_PERIOD_MS[HISTORY_10S] % SAMPLE_TIME_MS == 0 &&
+              HISTORY_PERIOD_MS[HISTORY_60S] % SAMPLE_TIME_MS == 0, "periodos do historico em ciclos inteiros");
+
+static uint32_t history_period_cycles(int level) {
+    return HISTORY_PERIOD_MS[level] / SAMPLE_TIME_MS;
+}
+
+static int16_t history_clamp_i16(float v) {
+    if (!(v == v)) return 0;    // NaN
+    if (v > 32767.0f) return 32767;
+    if (v < -32768.0f) return -32768;
+    return (int16_t)lrintf(v);
+}
+
+int16_t history_quantize(const TelemetryRecord_t *record, int signal) {
+    switch (signal) {
+    case HISTORY_SP: return history_clamp_i16(record->sp_v * 1000.0f);
+    case HISTORY_Y: return history_clamp_i16(record->y_v * 1000.0f);
+    default: return history_clamp_i16(record->u * 100.0f);
+    }
+}
+
+void history_init(History_t *history) {
+    memset(history, 0, sizeof(*history));
+}
+
+static void history_store(History_t *history, int level, uint32_t n, const HistoryBucket_t *b) {
+    int slot = (int)(n % (uint32_t)HISTORY_CAPACITY[level]);
+    switch (level) {
+    case HISTORY_RAW: {
+        HistorySample_t *s = &history->raw[slot];
+        for (int i = 0; i < HISTORY_SIGNALS; i++) s->value[i] = b->mean[i];
+        s->plant = b->samples ? b->plant : 0;
+        s->flags = b->flags;
+        break;
+    }
+    case HISTORY_1S: history->tier_1s[slot] = *b; break;
+    case HISTORY_10S: history->tier_10s[slot] = *b; break;
+    default: history->tier_60s[slot] = *b; break;
+    }
+}
+
+static void history_load(const History_t *history, int level, uint32_t n, HistoryBucket_t *b) {
+    int slot = (int)(n % (uint32_t)HISTORY_CAPACITY[level]);
+    switch (level) {
+    case HISTORY_RAW: {
+        const HistorySample_t *s = &history->raw[slot];
+        b->samples = s->plant ? 1 : 0;
+        b->plant = s->plant;
+        b->flags = s->flags;
+        for (int i = 0; i < HISTORY_SIGNALS; i++) b->min[i] = b->max[i] = b->mean[i] = s->value[i];
+        break;
+    }
+    case HISTORY_1S: *b = history->tier_1s[slot]; break;
+    case HISTORY_10S: *b = history->tier_10s[slot]; break;
+    default: *b = history->tier_60s[slot]; break;
+    }
+}
+
+// Guarda o bucket n no anel do nivel, com buckets vazios no lugar dos que
+// faltaram desde o ultimo. Um buraco maior que o anel recomeca o anel.
+static void history_append(History_t *history, int level, uint32_t n, const HistoryBucket_t *b) {
+    HistoryTier_t *tier = &history->tiers[level];
+    const uint32_t capacity = (uint32_t)HISTORY_CAPACITY[level];
+
+    if (tier->count == 0 || n - tier->next >= capacity) {
+        tier->count = 0;
+        tier->next = n;
+    }
+    HistoryBucket_t empty;
+    memset(&empty, 0, sizeof(empty));
+    while (tier->next != n) {
+        history_store(history, level, tier->next++, &empty);
+        if (tier->count < capacity) tier->count++;
+    }
+    history_store(history, level, n, b);
+    tier->next = n + 1;
+    if (tier->count < capacity) tier->count++;
+}
+
+static void history_close_bucket(const HistoryAccumulator_t *open, HistoryBucket_t *b) {
+    b->samples = open->samples;
+    b->plant = open->plant;
+    b->flags = open->flags;
+    for (int i = 0; i < HISTORY_SIGNALS; i++) {
+        b->min[i] = open->min[i];
+        b->max[i] = open->max[i];
+        // Media arredondada, tambem para valores negativos
+        int32_t sum = open->sum[i], half = open->samples / 2;
+        b->mean[i] = (int16_t)((sum >= 0 ? sum + half : sum - half) / (int32_t)open->samples);
+    }
+}
+
+void history_add(History_t *history, const TelemetryRecord_t *record) {
+    if (!(record->flags & TELEMETRY_FLAG_ACTIVE)) return;
+    const uint32_t cycle = record->cycle;
+    if (history->started && (int32_t)(cycle - history->newest_cycle) <= 0) return;
+    if (!history->started) {
+        history->started = true;
+        history->first_cycle = cycle;
+    }
+    history->newest_cycle = cycle;
+    history->time_offset_ms = record->time_ms - cycle * (uint32_t)SAMPLE_TIME_MS;
+
+    int16_t value[HISTORY_SIGNALS];
+    for (int i = 0; i < HISTORY_SIGNALS; i++) value[i] = history_quantize(record, i);
+
+    HistoryBucket_t sample;
+    sample.samples = 1;
+    sample.plant = record->plant;
+    sample.flags = record->flags;
+    for (int i = 0; i < HISTORY_SIGNALS; i++) sample.min[i] = sample.max[i] = sample.mean[i] = value[i];
+    history_append(history, HISTORY_RAW, cycle, &sample);
+
+    for (int level = HISTORY_1S; level < HISTORY_LEVELS; level++) {
+        HistoryAccumulator_t *open = &history->tiers[level].open;
+        uint32_t n = cycle / history_period_cycles(level);
+
+        if (open->samples > 0 && open->bucket != n) {
+            HistoryBucket_t closed;
+            history_close_bucket(open, &closed);
+            history_append(history, level, open->bucket, &closed);
+            open->samples = 0;
+        }
+        if (open->samples == 0) {
+            open->bucket = n;
+            open->flags = 0;
+            for (int i = 0; i < HISTORY_SIGNALS; i++) {
+                open->min[i] = open->max[i] = value[i];
+                open->sum[i] = 0;
+            }
+        }
+        open->samples++;
+        open->plant = record->plant;
+        open->flags |= record->flags;
+        for (int i = 0; i < HISTORY_SIGNALS; i++) {
+            if (value[i] < open->min[i]) open->min[i] = value[i];
+            if (value[i] > open->max[i]) open->max[i] = value[i];
+            open->sum[i] += value[i];
+        }
+    }
+}
+
+// Buckets disponiveis no nivel, contando o aberto: [oldest, newest]
+static bool history_range(const History_t *history, int level, uint32_t *oldest, uint32_t *newest) {
+    const HistoryTier_t *tier = &history->tiers[level];
+    bool open = level != HISTORY_RAW && tier->open.samples > 0;
+    if (tier->count == 0 && !open) return false;
+    *oldest = tier->count > 0 ? tier->next - tier->count : tier->open.bucket;
+    *newest = open ? tier->open.bucket : tier->next - 1;
+    return true;
+}
+
+// Bucket n do nivel; fora do que esta guardado, vazio
+static void history_get(const History_t *history, int level, uint32_t n, HistoryBucket_t *b) {
+    const HistoryTier_t *tier = &history->tiers[level];
+    if (level != HISTORY_RAW && tier->open.samples > 0 && n == tier->open.bucket) {
+        history_close_bucket(&tier->open, b);
+    } else if (tier->count > 0 && n - (tier->next - tier->count) < tier->count) {
+        history_load(history, level, n, b);
+    } else {
+        memset(b, 0, sizeof(*b));
+    }
+}
+
+void history_select(const History_t *history, const HistoryQuery_t *query, int *level,
+                    uint32_t *merge, int *points) {
+    // Janela em ciclos, limitada ao que ja foi amostrado
+    uint32_t available = history->started ? history->newest_cycle - history->first_cycle + 1 : 1;
+    uint64_t window = (uint64_t)query->window_s * 1000 / SAMPLE_TIME_MS;
+    if (window == 0 || window > available) window = available;
+
+    if (query->resolution_ms > 0) {
+        // O nivel mais grosso que nao passa da resolucao pedida, juntando
+        // buckets dele ate chegar nela
+        uint32_t resolution = query->resolution_ms / SAMPLE_TIME_MS;
+        if (resolution == 0) resolution = 1;
+        *level = HISTORY_RAW;
+        for (int l = HISTORY_LEVELS - 1; l > HISTORY_RAW; l--) {
+            if (history_period_cycles(l) <= resolution) {
+                *level = l;
+                break;
+            }
+        }
+        *merge = resolution / history_period_cycles(*level);
+        if (*merge > 0xFFFF) *merge = 0xFFFF;
+    } else {
+        // O nivel mais fino que guarda a janela inteira em ate
+        // HISTORY_MAX_POINTS pontos; se nenhum guarda, o mais grosso,
+        // juntando buckets para caber
+        *level = -1;
+        for (int l = HISTORY_RAW; l < HISTORY_LEVELS; l++) {
+            uint64_t period = history_period_cycles(l);
+            if (window <= period * (uint64_t)HISTORY_CAPACITY[l] && (window + period - 1) / period <= (uint64_t)HISTORY_MAX_POINTS) {
+                *level = l;
+                break;
+            }
+        }
+        *merge = 1;
+        if (*level < 0) {
+            *level = HISTORY_60S;
+            uint64_t period = history_period_cycles(HISTORY_60S);
+            uint64_t retained = period * HISTORY_CAPACITY[HISTORY_60S];
+            if (window > retained) window = retained;
+            *merge = (uint32_t)((window + period * HISTORY_MAX_POINTS - 1) / (period * HISTORY_MAX_POINTS));
+        }
+    }
+
+    uint64_t step = (uint64_t)history_period_cycles(*level) * *merge;
+    uint64_t count = (window + step - 1) / step;
+    *points = count > (uint64_t)HISTORY_MAX_POINTS ? HISTORY_MAX_POINTS : (int)count;
+}
+
+static uint8_t *history_encode_header(uint8_t *p, const HistoryFrameHeader_t *header) {
+    p = put_u16(p, HISTORY_MAGIC);
+    *p++ = HISTORY_VERSION;
+    *p++ = header->level;
+    p = put_u16(p, header->id);
+    p = put_u16(p, header->count);
+    *p++ = header->point_size;
+    *p++ = 0;
+    p = put_u16(p, header->merge);
+    p = put_u32(p, header->period_ms);
+    return put_u32(p, header->first_ms);
+}
+
+static uint8_t *history_encode_point(uint8_t *p, const HistoryBucket_t *b, bool raw) {
+    if (raw) {
+        for (int i = 0; i < HISTORY_SIGNALS; i++) p = put_u16(p, (uint16_t)b->mean[i]);
+        *p++ = b->samples ? b->plant : 0;
+        *p++ = b->flags;
+        return p;
+    }
+    p = put_u16(p, b->samples);
+    *p++ = b->plant;
+    *p++ = b->flags;
+    for (int i = 0; i < HISTORY_SIGNALS; i++) {
+        p = put_u16(p, (uint16_t)b->min[i]);
+        p = put_u16(p, (uint16_t)b->max[i]);
+        p = put_u16(p, (uint16_t)b->mean[i]);
+    }
+    return p;
+}
+
+size_t history_build_frame(const History_t *history, const HistoryQuery_t *query, uint8_t *out, size_t capacity) {
+    int level, points;
+    uint32_t merge;
+    history_select(history, query, &level, &merge, &points);
+
+    const bool raw = level == HISTORY_RAW && merge == 1;
+    const uint32_t period = history_period_cycles(level);
+
+    HistoryFrameHeader_t header;
+    header.level = (uint8_t)level;
+    header.point_size = (uint8_t)(raw ? HISTORY_RAW_POINT_SIZE : HISTORY_POINT_SIZE);
+    header.id = query->id;
+    header.count = 0;
+    header.merge = (uint16_t)merge;
+    header.period_ms = period * merge * (uint32_t)SAMPLE_TIME_MS;
+    header.first_ms = history->time_offset_ms;
+
+    // Pontos alinhados em multiplos de merge buckets, o ultimo com o bucket
+    // mais novo; comeca no mais velho que ainda existe
+    uint32_t oldest = 0, newest = 0;
+    uint32_t first_group = 0, last_group = 0;
+    if (history_range(history, level, &oldest, &newest)) {
+        last_group = newest / merge;
+        first_group = last_group - (uint32_t)points + 1;
+        if (points > (int)last_group + 1) first_group = 0;
+        if (first_group < oldest / merge) first_group = oldest / merge;
+        header.count = (uint16_t)(last_group - first_group + 1);
+        header.first_ms = history->time_offset_ms + first_group * merge * period * (uint32_t)SAMPLE_TIME_MS;
+    }
+
+    size_t length = HISTORY_HEADER_SIZE + (size_t)header.count * header.point_size;
+    if (length > capacity) return 0;
+
+    uint8_t *p = history_encode_header(out, &header);
+    for (uint32_t g = first_group; header.count > 0 && g <= last_group; g++) {
+        HistoryBucket_t point;
+        memset(&point, 0, sizeof(point));
+        int32_t sum[HISTORY_SIGNALS] = {0, 0, 0};
+
+        // Juntar so o que existe: buckets fora de [oldest, newest] sao vazios
+        uint32_t from = g * merge, to = from + merge - 1;
+        if (from < oldest) from = oldest;
+        if (to > newest) to = newest;
+        for (uint32_t n = from; n <= to; n++) {
+            HistoryBucket_t b;
+            history_get(history, level, n, &b);
+            if (b.samples == 0) continue;
+            for (int i = 0; i < HISTORY_SIGNALS; i++) {
+                if (point.samples == 0 || b.min[i] < point.min[i]) point.min[i] = b.min[i];
+                if (point.samples == 0 || b.max[i] > point.max[i]) point.max[i] = b.max[i];
+                sum[i] += (int32_t)b.mean[i] * b.samples;
+            }
+            point.samples = (uint16_t)(point.samples + b.samples > 0xFFFF ? 0xFFFF : point.samples + b.samples);
+            point.plant = b.plant;
+            point.flags |= b.flags;
+        }
+        for (int i = 0; i < HISTORY_SIGNALS && point.samples > 0; i++) {
+            int32_t half = point.samples / 2;
+            point.mean[i] = (int16_t)((sum[i] >= 0 ? sum[i] + half : sum[i] - half) / (int32_t)point.samples);
+        }
+        p = history_encode_point(p, &point, raw);
+    }
+    return length;
+}
+
+int history_decode_frame(const uint8_t *frame, size_t length, HistoryFrameHeader_t *header,
+                         HistoryBucket_t *points, int max_points) {
+    if (length < HISTORY_HEADER_SIZE) return -1;
+    if (get_u16(frame) != HISTORY_MAGIC || frame[2] != HISTORY_VERSION) return -1;
+
+    header->level = frame[3];
+    header->id = get_u16(frame + 4);
+    header->count = get_u16(frame + 6);
+    header->point_size = frame[8];
+    header->merge = get_u16(frame + 10);
+    header->period_ms = get_u32(frame + 12);
+    header->first_ms = get_u32(frame + 16);
+    bool raw = header->point_size == HISTORY_RAW_POINT_SIZE;
+    if (!raw && header->point_size != HISTORY_POINT_SIZE) return -1;
+    if (length != HISTORY_HEADER_SIZE + (size_t)header->count * header->point_size) return -1;
+
+    int count = header->count < max_points ? header->count : max_points;
+    for (int i = 0; i < count; i++) {
+        const uint8_t *p = frame + HISTORY_HEADER_SIZE + (size_t)i * header->point_size;
+        HistoryBucket_t *b = &points[i];
+        if (raw) {
+            b->plant = p[6];
+            b->flags = p[7];
+            b->samples = b->plant ? 1 : 0;
+            for (int s = 0; s < HISTORY_SIGNALS; s++) {
+                b->min[s] = b->max[s] = b->mean[s] = (int16_t)get_u16(p + 2 * s);
+            }
+        } else {
+            b->samples = get_u16(p);
+            b->plant = p[2];
+            b->flags = p[3];
+            for (int s = 0; s < HISTORY_SIGNALS; s++) {
+                b->min[s] = (int16_t)get_u16(p + 4 + 6 * s);
+                b->max[s] = (int16_t)get_u16(p + 6 + 6 * s);
+                b->mean[s] = (int16_t)get_u16(p + 8 + 6 * s);
+            }
+        }
+    }
+    return count;
+}
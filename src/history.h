@@ -0,0 +1,166 @@
+// src/history.h
+//
+// Historico do laco em varias resolucoes, em memoria fixa, para que uma
+// pagina que acabou de conectar mostre o passado na hora. Cada amostra da
+// malha ativa (TELEMETRY_FLAG_ACTIVE) entra no anel bruto (uma por ciclo) e
+// no bucket aberto de cada nivel (1 s, 10 s, 60 s), que acumula minimo,
+// maximo e soma; quando o ciclo passa para o bucket seguinte, o aberto e
+// fechado no anel do nivel. Custo por amostra: O(1), sem alocacao.
+//
+// Os buckets sao numerados pelo ciclo de controle (ciclo / ciclos por
+// bucket), nao pelo millis(), entao o jitter do timer nunca junta nem pula
+// buckets. Ciclos sem amostra (cursor que perdeu registros) viram buckets
+// vazios (samples 0), e o tempo de cada ponto continua implicito.
+//
+// Quem mantem o historico e quem responde as consultas e a mesma tarefa (a
+// do WebSocket), entao nao ha nada para sincronizar: a tarefa de controle so
+// escreve no anel de telemetria, como sempre.
+//
+// Resposta a uma consulta: um quadro binario (little-endian, sem
+// preenchimento implicito) com todos os pontos da janela:
+//
+//   cabecalho (HISTORY_HEADER_SIZE bytes)
+//     u16 magic        HISTORY_MAGIC
+//     u8  version      HISTORY_VERSION
+//     u8  level        HistoryLevel_t de onde vieram os pontos
+//     u16 id           o da consulta
+//     u16 count        pontos no quadro
+//     u8  point_size   HISTORY_RAW_POINT_SIZE ou HISTORY_POINT_SIZE
+//     u8  reserved
+//     u16 merge        buckets do nivel juntados em cada ponto
+//     u32 period_ms    duracao de cada ponto
+//     u32 first_ms     millis() do inicio do primeiro ponto
+//
+//   ponto bruto (HISTORY_RAW_POINT_SIZE, so no nivel bruto sem juntar)
+//     i16 sp, i16 y, i16 u   valores da amostra
+//     u8  plant        planta (0: sem amostra)
+//     u8  flags        TELEMETRY_FLAG_*
+//
+//   ponto resumido (HISTORY_POINT_SIZE)
+//     u16 samples      amostras no ponto (0: sem amostra)
+//     u8  plant        planta da ultima amostra
+//     u8  flags        OU dos TELEMETRY_FLAG_* das amostras
+//     i16 min, max, mean  de sp, depois de y, depois de u
+//
+// Unidades: sp e y em mV, u em centesimos de contagem do DAC.
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "telemetry.h"
+
+const uint16_t HISTORY_MAGIC = 0x4948;              // "HI"
+const uint8_t HISTORY_VERSION = 1;
+const size_t HISTORY_HEADER_SIZE = 20;
+const size_t HISTORY_RAW_POINT_SIZE = 8;
+const size_t HISTORY_POINT_SIZE = 22;
+const int HISTORY_MAX_POINTS = 600;                 // pontos por resposta
+const size_t HISTORY_MAX_FRAME_SIZE = HISTORY_HEADER_SIZE + HISTORY_MAX_POINTS * HISTORY_POINT_SIZE;
+const uint32_t HISTORY_DEFAULT_WINDOW_S = 600;      // enviado a quem conecta
+
+typedef enum {
+    HISTORY_RAW = 0,        // uma amostra por ciclo
+    HISTORY_1S,
+    HISTORY_10S,
+    HISTORY_60S,
+    HISTORY_LEVELS
+} HistoryLevel_t;
+
+// Buckets guardados por nivel: 3,4 min brutos, 10 min a 1 s, 1 h a 10 s,
+// 8 h a 60 s (cerca de 40 KB no total)
+constexpr int HISTORY_CAPACITY[HISTORY_LEVELS] = {1024, 600, 360, 480};
+constexpr uint32_t HISTORY_PERIOD_MS[HISTORY_LEVELS] = {200, 1000, 10000, 60000};
+
+typedef enum {
+    HISTORY_SP = 0,
+    HISTORY_Y,
+    HISTORY_U,
+    HISTORY_SIGNALS
+} HistorySignal_t;
+
+typedef struct {
+    uint16_t samples;
+    uint8_t plant;
+    uint8_t flags;
+    int16_t min[HISTORY_SIGNALS];
+    int16_t max[HISTORY_SIGNALS];
+    int16_t mean[HISTORY_SIGNALS];
+} HistoryBucket_t;
+
+// Amostra do anel bruto (plant 0: ciclo sem amostra)
+typedef struct {
+    int16_t value[HISTORY_SIGNALS];
+    uint8_t plant;
+    uint8_t flags;
+} HistorySample_t;
+
+// Bucket ainda aberto de um nivel
+typedef struct {
+    uint32_t bucket;
+    uint16_t samples;
+    uint8_t plant;
+    uint8_t flags;
+    int16_t min[HISTORY_SIGNALS];
+    int16_t max[HISTORY_SIGNALS];
+    int32_t sum[HISTORY_SIGNALS];
+} HistoryAccumulator_t;
+
+typedef struct {
+    uint32_t next;          // bucket seguinte ao mais novo guardado
+    uint16_t count;         // buckets guardados (ate a capacidade)
+    HistoryAccumulator_t open;
+} HistoryTier_t;
+
+typedef struct {
+    HistorySample_t raw[HISTORY_CAPACITY[HISTORY_RAW]];
+    HistoryBucket_t tier_1s[HISTORY_CAPACITY[HISTORY_1S]];
+    HistoryBucket_t tier_10s[HISTORY_CAPACITY[HISTORY_10S]];
+    HistoryBucket_t tier_60s[HISTORY_CAPACITY[HISTORY_60S]];
+    HistoryTier_t tiers[HISTORY_LEVELS];
+    bool started;
+    uint32_t first_cycle;
+    uint32_t newest_cycle;
+    uint32_t time_offset_ms;    // millis() - ciclo * SAMPLE_TIME_MS da amostra mais nova
+} History_t;
+
+typedef struct {
+    uint16_t id;
+    uint32_t window_s;          // janela terminando na amostra mais nova (0: tudo)
+    uint32_t resolution_ms;     // 0: a mais fina com a janela em HISTORY_MAX_POINTS
+} HistoryQuery_t;
+
+typedef struct {
+    uint8_t level;
+    uint8_t point_size;
+    uint16_t id;
+    uint16_t count;
+    uint16_t merge;
+    uint32_t period_ms;
+    uint32_t first_ms;
+} HistoryFrameHeader_t;
+
+void history_init(History_t *history);
+
+// Uma amostra da telemetria; registros de outra malha ou repetidos sao
+// ignorados
+void history_add(History_t *history, const TelemetryRecord_t *record);
+
+// Nivel e buckets por ponto para a consulta, e quantos pontos a janela pede
+void history_select(const History_t *history, const HistoryQuery_t *query, int *level,
+                    uint32_t *merge, int *points);
+
+// Quadro de resposta; retorna o tamanho, ou 0 se nao couber. Sem amostras
+// ainda, o quadro vai sem pontos.
+size_t history_build_frame(const History_t *history, const HistoryQuery_t *query, uint8_t *out, size_t capacity);
+
+// Retorna o numero de pontos (ate max_points) ou -1 se o quadro for
+// invalido. Pontos brutos voltam como buckets de uma amostra.
+int history_decode_frame(const uint8_t *frame, size_t length, HistoryFrameHeader_t *header,
+                         HistoryBucket_t *points, int max_points);
+
+// Valores da telemetria nas unidades do historico
+int16_t history_quantize(const TelemetryRecord_t *record, int signal);
+
+#endif // HISTORY_H
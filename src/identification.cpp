@@ -0,0 +1,305 @@
+// src/identification.cpp
+
+#include "identification.h"
+#include "text_buffer.h"
+#include "config.h"
+#include "rls.h"
+#include "seqlock.h"
+#include "setpoint.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+// Modelo de uma rede: o estimador e o que se sabe dele
+typedef struct {
+    Rls<IDENT_MAX_PARAMS> rls;
+    float error_sq;             // media movel do erro a priori ao quadrado
+    uint32_t derived_updates;   // updates do ultimo ident_derive
+    uint32_t drift_count;       // publicacoes acima do limite (com histerese)
+    IdentModel_t model;
+} IdentEntry_t;
+
+// Regressores de uma malha: as amostras anteriores da rede ligada nela
+typedef struct {
+    int index;                  // rede das amostras guardadas (-1: nenhuma)
+    int filled;                 // amostras validas em y/u
+    float y[IDENT_MAX_ORDER];   // y[k-1], y[k-2] (fracao do fundo de escala)
+    float u[IDENT_INPUT_TERMS];
+} IdentHistory_t;
+
+static IdentEntry_t entries[GAIN_SCHEDULE_ENTRIES];
+static IdentHistory_t history[GAIN_SCHEDULE_PLANTS];
+static IdentReport_t report;
+static Seqlock<IdentReport_t> report_seqlock;
+static uint32_t publish_countdown = 0;
+
+static float excitation_amplitude = 0.0f;
+static uint16_t prbs_lfsr = 1;
+static int prbs_samples = 0;
+
+static void ident_reset_entry(int index) {
+    IdentEntry_t *entry = &entries[index];
+    int order = ident_model_order(index / GAIN_SCHEDULE_COMBINATIONS + 1);
+    rls_init(&entry->rls, order + IDENT_INPUT_TERMS + 1, IDENT_FORGETTING, IDENT_P0, IDENT_MAX_TRACE);
+    entry->error_sq = 0.0f;
+    entry->derived_updates = 0;
+    entry->drift_count = 0;
+    memset(&entry->model, 0, sizeof(entry->model));
+    entry->model.order = (uint32_t)order;
+}
+
+void ident_restart(int plant_id) {
+    if (plant_id < 1 || plant_id > GAIN_SCHEDULE_PLANTS) return;
+    history[plant_id - 1].index = -1;
+    history[plant_id - 1].filled = 0;
+}
+
+void ident_init() {
+    for (int i = 0; i < GAIN_SCHEDULE_ENTRIES; i++) ident_reset_entry(i);
+    for (int p = 1; p <= GAIN_SCHEDULE_PLANTS; p++) ident_restart(p);
+    excitation_amplitude = 0.0f;
+    prbs_lfsr = 1;
+    prbs_samples = 0;
+    publish_countdown = 0;
+    memset(&report, 0, sizeof(report));
+}
+
+void ident_set_excitation(float amplitude) {
+    if (amplitude < 0.0f) amplitude = 0.0f;
+    if (amplitude > IDENT_MAX_EXCITATION) amplitude = IDENT_MAX_EXCITATION;
+    excitation_amplitude = amplitude;
+}
+
+float ident_excitation() {
+    return excitation_amplitude;
+}
+
+float ident_excitation_next() {
+    if (excitation_amplitude <= 0.0f) return 0.0f;
+    if (++prbs_samples >= IDENT_PRBS_BIT_SAMPLES) {
+        prbs_samples = 0;
+        uint16_t lsb = prbs_lfsr & 1;
+        prbs_lfsr >>= 1;
+        if (lsb) prbs_lfsr ^= setpoint_prbs_taps(IDENT_PRBS_ORDER);
+    }
+    return (prbs_lfsr & 1) ? excitation_amplitude : -excitation_amplitude;
+}
+
+void ident_update(int plant_id, int combination, float y, float u) {
+    if (plant_id < 1 || plant_id > GAIN_SCHEDULE_PLANTS) return;
+    IdentHistory_t *h = &history[plant_id - 1];
+    int index = gain_schedule_index(plant_id, combination);
+    if (index != h->index) {
+        h->index = index;
+        h->filled = 0;
+    }
+    if (index < 0) return;
+
+    // O u que chegou na planta: o DAC satura e trunca
+    if (u > DAC_RESOLUTION) u = DAC_RESOLUTION;
+    if (u < 0) u = 0;
+    float yn = y / (float)ADC_RESOLUTION;
+    float un = floorf(u) / (float)DAC_RESOLUTION;
+
+    IdentEntry_t *entry = &entries[index];
+    int order = (int)entry->model.order;
+    if (h->filled >= IDENT_INPUT_TERMS) {
+        float phi[IDENT_MAX_PARAMS];
+        for (int i = 0; i < order; i++) phi[i] = h->y[i];
+        for (int i = 0; i < IDENT_INPUT_TERMS; i++) phi[order + i] = h->u[i];
+        phi[order + IDENT_INPUT_TERMS] = 1.0f;
+        float e = rls_update(&entry->rls, phi, yn);
+        entry->error_sq += (1.0f - IDENT_FORGETTING) * (e * e - entry->error_sq);
+    } else {
+        h->filled++;
+    }
+
+    for (int i = IDENT_MAX_ORDER - 1; i > 0; i--) h->y[i] = h->y[i - 1];
+    for (int i = IDENT_INPUT_TERMS - 1; i > 0; i--) h->u[i] = h->u[i - 1];
+    h->y[0] = yn;
+    h->u[0] = un;
+}
+
+bool ident_derive(const float *a, const float *b, float c, int order, float ts_s, IdentModel_t *model) {
+    model->gain = model->tau1_s = model->tau2_s = model->tau_s = model->theta_s = model->offset_v = 0.0f;
+
+    float p1, p2 = 0.0f;
+    if (order == 1) {
+        p1 = a[0];
+    } else {
+        // Polos de z^2 - a1 z - a2
+        float disc = a[0] * a[0] + 4.0f * a[1];
+        if (disc < 0.0f) return false;
+        float root = sqrtf(disc);
+        p1 = 0.5f * (a[0] + root);
+        p2 = 0.5f * (a[0] - root);
+        if (!(p2 > 0.0f && p2 < 1.0f)) return false;
+    }
+    if (!(p1 > 0.0f && p1 < 1.0f)) return false;
+
+    float den = 1.0f - a[0] - (order == 2 ? a[1] : 0.0f);
+    model->gain = (b[0] + b[1]) / den;
+    model->offset_v = c / den * (float)VCC;
+    model->tau1_s = -ts_s / logf(p1);
+    if (!(model->gain > 0.0f)) return false;
+    if (order == 2) {
+        model->tau2_s = -ts_s / logf(p2);
+        model->tau_s = model->tau1_s + 0.5f * model->tau2_s;
+        model->theta_s = 0.5f * model->tau2_s;
+        return true;
+    }
+
+    // Primeira ordem com atraso f*Ts discretizada com ZOH:
+    //   b1 = K (1 - a^(1-f)), b2 = K (a^(1-f) - a)
+    float rest = 1.0f - b[0] / model->gain;    // a^(1-f)
+    float f = (rest > p1 && rest < 1.0f) ? 1.0f - logf(rest) / logf(p1) : (rest >= 1.0f ? 1.0f : 0.0f);
+    model->tau_s = model->tau1_s;
+    model->theta_s = f * ts_s;
+    return true;
+}
+
+static float relative_deviation(float value, float reference) {
+    return reference > 0.0f ? fabsf(value - reference) / reference : 0.0f;
+}
+
+// Coeficientes e derivados do estimador em model (flags de referencia e
+// deriva ficam como estao)
+static void ident_refresh_model(const IdentEntry_t *entry, IdentModel_t *model) {
+    int order = (int)model->order;
+    const float *theta = entry->rls.theta;
+    model->updates = entry->rls.updates;
+    for (int i = 0; i < IDENT_MAX_ORDER; i++) model->a[i] = i < order ? theta[i] : 0.0f;
+    for (int i = 0; i < IDENT_INPUT_TERMS; i++) model->b[i] = theta[order + i];
+    model->c = theta[order + IDENT_INPUT_TERMS];
+    model->rms_error_v = sqrtf(entry->error_sq) * (float)VCC;
+
+    bool valid = model->updates >= IDENT_MIN_UPDATES &&
+                 ident_derive(model->a, model->b, model->c, order, (float)SAMPLE_TIME_S, model);
+    model->flags = valid ? (model->flags | IDENT_MODEL_VALID) : (model->flags & ~IDENT_MODEL_VALID);
+}
+
+static void ident_refresh(IdentEntry_t *entry) {
+    ident_refresh_model(entry, &entry->model);
+    entry->derived_updates = entry->rls.updates;
+}
+
+static void ident_set_reference(IdentEntry_t *entry) {
+    IdentModel_t *model = &entry->model;
+    model->gain_ref = model->gain;
+    model->tau_ref_s = model->tau_s;
+    model->drift = 0.0f;
+    model->flags = (model->flags | IDENT_MODEL_REFERENCE) & ~IDENT_MODEL_DRIFT;
+    entry->drift_count = 0;
+}
+
+// Deriva com histerese: o contador sobe acima do limite e desce abaixo
+// dele; a marca liga ao chegar em IDENT_DRIFT_CONFIRM e desliga em 0
+static void ident_check_drift(IdentEntry_t *entry) {
+    IdentModel_t *model = &entry->model;
+    if (!(model->flags & IDENT_MODEL_VALID)) return;
+    if (!(model->flags & IDENT_MODEL_REFERENCE)) {
+        if (model->updates >= IDENT_REFERENCE_UPDATES) ident_set_reference(entry);
+        return;
+    }
+
+    float dg = relative_deviation(model->gain, model->gain_ref);
+    float dt = relative_deviation(model->tau_s, model->tau_ref_s);
+    model->drift = dg > dt ? dg : dt;
+    if (model->drift > IDENT_DRIFT_LIMIT) {
+        if (entry->drift_count < IDENT_DRIFT_CONFIRM) entry->drift_count++;
+        if (entry->drift_count == IDENT_DRIFT_CONFIRM) model->flags |= IDENT_MODEL_DRIFT;
+    } else if (entry->drift_count > 0) {
+        entry->drift_count--;
+        if (entry->drift_count == 0) model->flags &= ~IDENT_MODEL_DRIFT;
+    }
+}
+
+void ident_apply(int index, IdentAction_t action) {
+    if (index < 0 || index >= GAIN_SCHEDULE_ENTRIES) return;
+    IdentEntry_t *entry = &entries[index];
+    if (action == IDENT_ACTION_RESET) {
+        ident_reset_entry(index);
+        for (int p = 0; p < GAIN_SCHEDULE_PLANTS; p++) {
+            if (history[p].index == index) history[p].filled = 0;
+        }
+    } else if (action == IDENT_ACTION_REFERENCE) {
+        ident_refresh(entry);
+        if (entry->model.flags & IDENT_MODEL_VALID) ident_set_reference(entry);
+    }
+    publish_countdown = 0;
+}
+
+bool ident_model_read(int index, IdentModel_t *out) {
+    if (index < 0 || index >= GAIN_SCHEDULE_ENTRIES) return false;
+    const IdentEntry_t *entry = &entries[index];
+    *out = entry->model;
+    if (entry->rls.updates != entry->derived_updates) ident_refresh_model(entry, out);
+    return (out->flags & IDENT_MODEL_VALID) != 0;
+}
+
+void ident_publish(uint32_t cycle) {
+    if (publish_countdown > 0) {
+        publish_countdown--;
+        return;
+    }
+    publish_countdown = IDENT_PUBLISH_CYCLES - 1;
+
+    for (int i = 0; i < GAIN_SCHEDULE_ENTRIES; i++) {
+        IdentEntry_t *entry = &entries[i];
+        if (entry->rls.updates != entry->derived_updates) {
+            ident_refresh(entry);
+            ident_check_drift(entry);
+        }
+        report.models[i] = entry->model;
+    }
+    report.seq++;
+    report.cycle = cycle;
+    report.excitation = excitation_amplitude;
+    report_seqlock.publish(report);
+}
+
+void ident_report_read(IdentReport_t *out) {
+    report_seqlock.read(out);
+}
+
+size_t ident_format_text(char *out, size_t capacity) {
+    if (capacity == 0) return 0;
+    TextBuffer_t t = {out, capacity, 0};
+    out[0] = '\0';
+
+    IdentReport_t r;
+    ident_report_read(&r);
+    static const struct {
+        const char *name;
+        size_t offset;
+    } GAUGES[] = {
+        {"plant_model_gain", offsetof(IdentModel_t, gain)},
+        {"plant_model_tau_seconds", offsetof(IdentModel_t, tau_s)},
+        {"plant_model_dead_time_seconds", offsetof(IdentModel_t, theta_s)},
+        {"plant_model_error_volts", offsetof(IdentModel_t, rms_error_v)},
+        {"plant_model_drift", offsetof(IdentModel_t, drift)},
+    };
+    for (size_t g = 0; g < sizeof(GAUGES) / sizeof(GAUGES[0]); g++) {
+        text_append(&t, "# TYPE %s gauge\n", GAUGES[g].name);
+        for (int i = 0; i < GAIN_SCHEDULE_ENTRIES; i++) {
+            const IdentModel_t *m = &r.models[i];
+            if (!(m->flags & IDENT_MODEL_VALID)) continue;
+            float value;
+            memcpy(&value, (const char *)m + GAUGES[g].offset, sizeof(value));
+            text_append(&t, "%s{plant=\"%d\",combination=\"%d\"} %.4f\n", GAUGES[g].name,
+                        i / GAIN_SCHEDULE_COMBINATIONS + 1, i % GAIN_SCHEDULE_COMBINATIONS, value);
+        }
+    }
+    text_append(&t, "# TYPE plant_model_drifting gauge\n");
+    for (int i = 0; i < GAIN_SCHEDULE_ENTRIES; i++) {
+        const IdentModel_t *m = &r.models[i];
+        if (!(m->flags & IDENT_MODEL_VALID)) continue;
+        text_append(&t, "plant_model_drifting{plant=\"%d\",combination=\"%d\"} %d\n",
+                    i / GAIN_SCHEDULE_COMBINATIONS + 1, i % GAIN_SCHEDULE_COMBINATIONS,
+                    (m->flags & IDENT_MODEL_DRIFT) ? 1 : 0);
+    }
+    text_append(&t, "# TYPE plant_model_excitation gauge\nplant_model_excitation %.1f\n", r.excitation);
+    return t.length;
+}
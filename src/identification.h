@@ -0,0 +1,133 @@
+// src/identification.h
+//
+// Identificacao em linha das redes RC. A cada ciclo de controle, a amostra
+// (y lido, u aplicado no DAC) alimenta um modelo ARX da rede ligada
+// (planta, combinacao), ajustado por minimos quadrados recursivos com
+// esquecimento (rls.h):
+//
+//     y[k] = a1 y[k-1] (+ a2 y[k-2]) + b1 u[k-1] + b2 u[k-2] + c
+//
+// y e u em fracao do fundo de escala (o ganho sai em V/V); c absorve o
+// offset do ADC. A ordem (numero de polos) vem do circuito: 1 na Planta 1
+// (RC simples), 2 na Planta 2 (RC em cascata). O segundo termo de u esta
+// sempre la: o y do ciclo e a media das leituras do ADC no periodo
+// (adc_acquisition.h), o que atrasa a resposta em uma fracao de amostra.
+// Do ARX saem o ganho estatico, as constantes de tempo dos polos e o modelo
+// de primeira ordem com atraso (FOPDT): na ordem 1 o atraso e o fracionario
+// que b2 representa; na ordem 2, a regra da metade de Skogestad
+// (tau = tau1 + tau2/2, theta = tau2/2).
+//
+// Cada rede tem o seu modelo; trocar de combinacao recomeca so os
+// regressores, e a rede que volta retoma o modelo de onde parou. Um PRBS
+// opcional (IDENT_PRBS_*) somado ao u do PID da a excitacao que o laco
+// fechado sozinho nao da. A primeira estimativa que fica valida por
+// IDENT_REFERENCE_UPDATES amostras vira a referencia da rede (ou a pagina
+// pede uma nova); o modelo que se afasta dela mais que IDENT_DRIFT_LIMIT
+// (ganho ou tau) por IDENT_DRIFT_CONFIRM publicacoes seguidas e marcado com
+// deriva: componente mudou de valor, envelheceu ou foi trocado.
+//
+// Tudo em memoria fixa; o custo por ciclo e uma atualizacao O(n^2) por
+// malha (n = 4 ou 5 parametros). A tarefa de controle e a unica escritora;
+// as outras leem o relatorio publicado (seqlock).
+
+#ifndef IDENTIFICATION_H
+#define IDENTIFICATION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "gain_schedule.h"
+
+const int IDENT_MAX_ORDER = 2;
+const int IDENT_INPUT_TERMS = 2;
+const int IDENT_MAX_PARAMS = IDENT_MAX_ORDER + IDENT_INPUT_TERMS + 1;
+const float IDENT_FORGETTING = 0.995f;          // memoria de ~200 amostras (40 s)
+const float IDENT_P0 = 1000.0f;                 // covariancia inicial
+const float IDENT_MAX_TRACE = 1.0e4f;
+const uint32_t IDENT_MIN_UPDATES = 50;          // antes disso o modelo nao vale
+const uint32_t IDENT_REFERENCE_UPDATES = 300;   // referencia automatica (60 s)
+const float IDENT_DRIFT_LIMIT = 0.15f;          // desvio relativo de ganho ou tau
+const uint32_t IDENT_DRIFT_CONFIRM = 10;        // publicacoes seguidas (10 s)
+const uint32_t IDENT_PUBLISH_CYCLES = 5;        // relatorio a cada 1 s
+const float IDENT_MAX_EXCITATION = 64.0f;       // contagens do DAC
+const int IDENT_PRBS_ORDER = 7;
+const int IDENT_PRBS_BIT_SAMPLES = 2;
+
+// Ordem do modelo de cada planta
+inline int ident_model_order(int plant_id) {
+    return plant_id == 2 ? 2 : 1;
+}
+
+typedef enum {
+    IDENT_ACTION_NONE = 0,
+    IDENT_ACTION_REFERENCE,     // estimativa atual vira a referencia da rede ativa
+    IDENT_ACTION_RESET,         // recomeca o modelo da rede ativa (e a referencia)
+} IdentAction_t;
+
+enum {
+    IDENT_MODEL_VALID     = 1 << 0,     // amostras suficientes e polos de uma rede RC
+    IDENT_MODEL_REFERENCE = 1 << 1,     // tem referencia
+    IDENT_MODEL_DRIFT     = 1 << 2,     // afastou-se da referencia
+};
+
+// Modelo estimado de uma rede. Ganho em V/V, tempos em segundos.
+typedef struct {
+    uint32_t updates;
+    uint32_t order;
+    uint32_t flags;             // IDENT_MODEL_*
+    float a[IDENT_MAX_ORDER];   // ARX (fracao do fundo de escala)
+    float b[IDENT_INPUT_TERMS];
+    float c;
+    float gain;
+    float tau1_s, tau2_s;       // constantes de tempo dos polos (tau1 >= tau2)
+    float tau_s, theta_s;       // FOPDT
+    float offset_v;             // saida com u = 0
+    float rms_error_v;          // erro de predicao a um passo
+    float gain_ref, tau_ref_s;  // referencia para a deriva
+    float drift;                // maior desvio relativo da referencia
+} IdentModel_t;
+
+typedef struct {
+    uint32_t seq;
+    uint32_t cycle;
+    float excitation;           // amplitude do PRBS (contagens do DAC)
+    IdentModel_t models[GAIN_SCHEDULE_ENTRIES];     // por gain_schedule_index()
+} IdentReport_t;
+
+// Somente a tarefa de controle chama as funcoes abaixo, ate ident_publish
+void ident_init();
+
+// Amplitude do PRBS somado ao u (0 desliga)
+void ident_set_excitation(float amplitude);
+float ident_excitation();
+
+// Proximo valor do PRBS (+-amplitude, ou 0 desligado); um por ciclo, o
+// mesmo para as duas malhas
+float ident_excitation_next();
+
+// Amostra do ciclo da malha de plant_id: y lido (contagens do ADC) e u
+// escrito no DAC neste ciclo (contagens, antes do truncamento do DAC)
+void ident_update(int plant_id, int combination, float y, float u);
+
+// Esquece os regressores da malha (a proxima amostra nao segue a anterior)
+void ident_restart(int plant_id);
+
+void ident_apply(int index, IdentAction_t action);
+
+// Modelo atual da rede (sem esperar a publicacao). Retorna true se valido.
+bool ident_model_read(int index, IdentModel_t *out);
+
+// Publica o relatorio a cada IDENT_PUBLISH_CYCLES chamadas (uma por ciclo)
+void ident_publish(uint32_t cycle);
+
+// Qualquer tarefa
+void ident_report_read(IdentReport_t *out);
+
+// Ganho, polos e FOPDT a partir dos coeficientes do ARX (order valores em
+// a, IDENT_INPUT_TERMS em b). Retorna false se os polos nao forem de uma
+// rede RC (reais, estaveis e positivos).
+bool ident_derive(const float *a, const float *b, float c, int order, float ts_s, IdentModel_t *model);
+
+// Texto do /metrics (plant_model_*) das redes com modelo valido
+size_t ident_format_text(char *out, size_t capacity);
+
+#endif // IDENTIFICATION_H
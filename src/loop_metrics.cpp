@@ -0,0 +1,255 @@
+// src/loop_metrics.cpp
+
+#include "loop_metrics.h"
+#include "text_buffer.h"
+#include "config.h"
+#include "hal.h"
+#include "seqlock.h"
+
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+
+static const char *STAGE_NAMES[LOOP_STAGE_COUNT] = {
+    "wake", "jitter", "requests", "acquire", "compute", "output", "publish", "total",
+};
+
+static const char *TASK_NAMES[LOOP_TASK_COUNT] = {
+    "control", "acquisition", "plotter", "websocket", "selector", "recorder", "network",
+};
+
+// Estado da tarefa de controle (unica escritora)
+static LoopMetrics_t metrics;
+static Seqlock<LoopMetrics_t> metrics_seqlock;
+static bool enabled = true;
+static uint32_t last_mark;
+static uint32_t last_wake_us;
+static bool have_wake = false;
+
+// Escrito pela interrupcao do timer
+static std::atomic<uint32_t> timer_fired_at(0);
+static std::atomic<uint32_t> timer_overruns(0);
+
+// Cada entrada so e escrita pela propria tarefa
+typedef struct {
+    std::atomic<uint32_t> busy_us;
+    std::atomic<uint32_t> runs;
+    uint32_t begin;
+    void *handle;
+    std::atomic<bool> registered;
+} TaskSlot_t;
+
+static TaskSlot_t tasks[LOOP_TASK_COUNT];
+
+static inline uint32_t cycles_to_us(uint32_t cycles) {
+    return cycles / hal_cycles_per_us();
+}
+
+// Ate 4,29 s (o contador de ciclos da a volta antes disso no ESP32)
+static inline uint32_t cycles_to_ns(uint32_t cycles) {
+    return (uint32_t)((uint64_t)cycles * 1000 / hal_cycles_per_us());
+}
+
+// Balde = metade da posicao do bit mais alto do tempo em ns
+static void histogram_add(LoopHistogram_t *h, uint32_t ns) {
+    int bucket = (ns < 4) ? 0 : (31 - __builtin_clz(ns)) / 2;
+    h->buckets[bucket]++;
+    h->count++;
+    if (ns > h->max_ns) h->max_ns = ns;
+    uint32_t lo = h->sum_ns_lo + ns;
+    if (lo < h->sum_ns_lo) h->sum_ns_hi++;
+    h->sum_ns_lo = lo;
+}
+
+// Limite superior inclusivo do balde i (o ultimo vai ate o fim do uint32)
+static inline uint32_t histogram_bound(int i) {
+    return (i >= LOOP_METRICS_BUCKETS - 1) ? 0xFFFFFFFFu : (4u << (2 * i)) - 1;
+}
+
+void loop_metrics_set_enabled(bool on) {
+    enabled = on;
+}
+
+void loop_metrics_reset() {
+    memset(&metrics, 0, sizeof(metrics));
+    have_wake = false;
+    timer_overruns.store(0, std::memory_order_relaxed);
+    metrics_seqlock.publish(metrics);
+}
+
+// Chamada de dentro da interrupcao do timer: so um load do contador e
+// atomicos de 32 bits, tudo na IRAM
+void HAL_ISR_ATTR loop_metrics_timer_fired(bool overrun) {
+    timer_fired_at.store(hal_cycle_count(), std::memory_order_relaxed);
+    if (overrun) timer_overruns.fetch_add(1, std::memory_order_relaxed);
+}
+
+void loop_metrics_cycle_begin() {
+    if (!enabled) return;
+    uint32_t now = hal_cycle_count();
+    histogram_add(&metrics.stages[LOOP_STAGE_WAKE],
+                  cycles_to_ns(now - timer_fired_at.load(std::memory_order_relaxed)));
+
+    // O periodo vem de hal_micros: no build nativo e o relogio virtual, que
+    // e o que o timer segue (o contador de ciclos la e o tempo real do PC)
+    uint32_t wake_us = hal_micros();
+    if (have_wake) {
+        int32_t deviation = (int32_t)(wake_us - last_wake_us) - (int32_t)CONTROL_PERIOD_US;
+        uint32_t jitter_us = (uint32_t)(deviation < 0 ? -deviation : deviation);
+        histogram_add(&metrics.stages[LOOP_STAGE_JITTER], jitter_us < 4000000 ? jitter_us * 1000 : 0xFFFFFFFFu);
+    }
+    last_wake_us = wake_us;
+    have_wake = true;
+    last_mark = now;
+    loop_metrics_task_begin(LOOP_TASK_CONTROL);
+}
+
+void loop_metrics_mark(LoopStage_t stage) {
+    if (!enabled) return;
+    uint32_t now = hal_cycle_count();
+    histogram_add(&metrics.stages[stage], cycles_to_ns(now - last_mark));
+    last_mark = now;
+}
+
+void loop_metrics_commands(uint32_t applied, uint32_t dropped) {
+    metrics.commands = applied;
+    metrics.commands_dropped = dropped;
+}
+
+void loop_metrics_cycle_end() {
+    if (!enabled) return;
+    uint32_t now = hal_cycle_count();
+    uint32_t total_ns = cycles_to_ns(now - timer_fired_at.load(std::memory_order_relaxed));
+    histogram_add(&metrics.stages[LOOP_STAGE_TOTAL], total_ns);
+    if (total_ns >= CONTROL_PERIOD_US * 1000UL) metrics.missed_deadlines++;
+    metrics.cycles++;
+    metrics.timer_overruns = timer_overruns.load(std::memory_order_relaxed);
+    loop_metrics_task_end(LOOP_TASK_CONTROL);
+    metrics_seqlock.publish(metrics);
+}
+
+void loop_metrics_read(LoopMetrics_t *out) {
+    metrics_seqlock.read(out);
+}
+
+// --- Tarefas ---
+
+void loop_metrics_register_task(LoopTask_t task, void *handle) {
+    tasks[task].handle = handle;
+    tasks[task].registered.store(true, std::memory_order_release);
+}
+
+void loop_metrics_task_begin(LoopTask_t task) {
+    tasks[task].begin = hal_cycle_count();
+}
+
+void loop_metrics_task_end(LoopTask_t task) {
+    TaskSlot_t *slot = &tasks[task];
+    uint32_t us = cycles_to_us(hal_cycle_count() - slot->begin);
+    slot->busy_us.store(slot->busy_us.load(std::memory_order_relaxed) + us, std::memory_order_relaxed);
+    slot->runs.store(slot->runs.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+void loop_metrics_read_task(LoopTask_t task, LoopTaskMetrics_t *out) {
+    const TaskSlot_t *slot = &tasks[task];
+    out->registered = slot->registered.load(std::memory_order_acquire);
+    out->busy_us = slot->busy_us.load(std::memory_order_relaxed);
+    out->runs = slot->runs.load(std::memory_order_relaxed);
+    out->stack_free_bytes = 0;
+    if (out->registered && slot->handle != NULL) {
+        out->stack_free_bytes = uxTaskGetStackHighWaterMark((TaskHandle_t)slot->handle);
+    }
+}
+
+const char *loop_metrics_task_name(LoopTask_t task) {
+    return TASK_NAMES[task];
+}
+
+const char *loop_metrics_stage_name(LoopStage_t stage) {
+    return STAGE_NAMES[stage];
+}
+
+// --- Leitura ---
+
+uint32_t loop_histogram_quantile(const LoopHistogram_t *h, double q) {
+    if (h->count == 0) return 0;
+    uint32_t target = (uint32_t)(q * h->count + 0.5);
+    if (target < 1) target = 1;
+    uint32_t cumulative = 0;
+    for (int i = 0; i < LOOP_METRICS_BUCKETS; i++) {
+        cumulative += h->buckets[i];
+        if (cumulative >= target) {
+            // O limite do balde nunca passa do maior valor visto
+            uint32_t bound = histogram_bound(i);
+            return bound < h->max_ns ? bound : h->max_ns;
+        }
+    }
+    return h->max_ns;
+}
+
+double loop_histogram_mean(const LoopHistogram_t *h) {
+    if (h->count == 0) return 0;
+    double sum = h->sum_ns_hi * 4294967296.0 + h->sum_ns_lo;
+    return sum / h->count;
+}
+
+// Acrescenta ao texto; para de escrever quando o buffer enche
+size_t loop_metrics_format_text(char *out, size_t capacity) {
+    if (capacity == 0) return 0;
+    TextBuffer_t t = {out, capacity, 0};
+    out[0] = '\0';
+
+    LoopMetrics_t m;
+    loop_metrics_read(&m);
+
+    text_append(&t, "# TYPE loop_cycles_total counter\nloop_cycles_total %lu\n", (unsigned long)m.cycles);
+    text_append(&t, "# TYPE loop_missed_deadlines_total counter\nloop_missed_deadlines_total %lu\n",
+                (unsigned long)m.missed_deadlines);
+    text_append(&t, "# TYPE loop_timer_overruns_total counter\nloop_timer_overruns_total %lu\n",
+                (unsigned long)m.timer_overruns);
+    text_append(&t, "# TYPE loop_commands_total counter\nloop_commands_total %lu\n", (unsigned long)m.commands);
+    text_append(&t, "# TYPE loop_commands_dropped_total counter\nloop_commands_dropped_total %lu\n",
+                (unsigned long)m.commands_dropped);
+
+    // Histogramas no formato do Prometheus: baldes acumulados, em ns
+    text_append(&t, "# TYPE loop_stage_ns histogram\n");
+    for (int s = 0; s < LOOP_STAGE_COUNT; s++) {
+        const LoopHistogram_t *h = &m.stages[s];
+        uint32_t cumulative = 0;
+        for (int i = 0; i < LOOP_METRICS_BUCKETS - 1; i++) {
+            cumulative += h->buckets[i];
+            text_append(&t, "loop_stage_ns_bucket{stage=\"%s\",le=\"%lu\"} %lu\n", STAGE_NAMES[s],
+                        (unsigned long)histogram_bound(i), (unsigned long)cumulative);
+        }
+        text_append(&t, "loop_stage_ns_bucket{stage=\"%s\",le=\"+Inf\"} %lu\n", STAGE_NAMES[s], (unsigned long)h->count);
+        text_append(&t, "loop_stage_ns_sum{stage=\"%s\"} %.0f\n", STAGE_NAMES[s], h->sum_ns_hi * 4294967296.0 + h->sum_ns_lo);
+        text_append(&t, "loop_stage_ns_count{stage=\"%s\"} %lu\n", STAGE_NAMES[s], (unsigned long)h->count);
+        text_append(&t, "loop_stage_ns_max{stage=\"%s\"} %lu\n", STAGE_NAMES[s], (unsigned long)h->max_ns);
+    }
+
+    // Uso de CPU desde a leitura anterior (so o servidor web formata)
+    static uint32_t previous_busy[LOOP_TASK_COUNT];
+    static uint32_t previous_us = 0;
+    uint32_t now_us = hal_micros();
+    uint32_t elapsed_us = now_us - previous_us;
+    previous_us = now_us;
+
+    text_append(&t, "# TYPE task_busy_us_total counter\n");
+    for (int i = 0; i < LOOP_TASK_COUNT; i++) {
+        LoopTaskMetrics_t task;
+        loop_metrics_read_task((LoopTask_t)i, &task);
+        if (!task.registered) continue;
+        uint32_t busy = task.busy_us - previous_busy[i];
+        previous_busy[i] = task.busy_us;
+        text_append(&t, "task_busy_us_total{task=\"%s\"} %lu\n", TASK_NAMES[i], (unsigned long)task.busy_us);
+        text_append(&t, "task_runs_total{task=\"%s\"} %lu\n", TASK_NAMES[i], (unsigned long)task.runs);
+        if (elapsed_us > 0) {
+            text_append(&t, "task_cpu_percent{task=\"%s\"} %.3f\n", TASK_NAMES[i], 100.0 * busy / elapsed_us);
+        }
+        if (task.stack_free_bytes > 0) {
+            text_append(&t, "task_stack_free_bytes{task=\"%s\"} %lu\n", TASK_NAMES[i],
+                        (unsigned long)task.stack_free_bytes);
+        }
+    }
+    return t.length;
+}
@@ -0,0 +1,114 @@
+// src/loop_metrics.h
+//
+// Instrumentacao do tempo do laco de controle. A interrupcao do timer marca
+// o disparo; a tarefa de controle marca o despertar e o fim de cada etapa do
+// ciclo com o contador de ciclos da CPU (hal_cycle_count) e acumula cada
+// duracao em um histograma de baldes fixos (potencias de 4 em
+// nanossegundos, de 1 ns a 4 s), com soma e maximo exatos. Cada marca custa
+// uma leitura do contador e um incremento; nada e alocado, nada bloqueia, e
+// os histogramas sao publicados por seqlock
+// para o servidor web ler (/metrics em texto, ou o quadro "metricas" do
+// WebSocket). Fica ligado em producao.
+//
+// As outras tarefas registram o tempo ocupado de cada volta do seu laco
+// (loop_metrics_task_begin/end); o uso de CPU sai da diferenca entre duas
+// leituras, e a folga de pilha do FreeRTOS (uxTaskGetStackHighWaterMark).
+//
+// No build nativo a mesma instrumentacao roda com o contador de ciclos
+// trocado pelo relogio real do PC: o relogio virtual do simulador nao anda
+// durante o codigo, entao so o tempo real mede o custo de cada etapa.
+
+#ifndef LOOP_METRICS_H
+#define LOOP_METRICS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+const int LOOP_METRICS_BUCKETS = 16;        // balde i: [4^i, 4^(i+1)) ns
+const size_t LOOP_METRICS_TEXT_SIZE = 20480; // texto completo do /metrics (~15 KB)
+
+typedef enum {
+    LOOP_STAGE_WAKE = 0,    // disparo do timer -> tarefa de controle acordada
+    LOOP_STAGE_JITTER,      // |intervalo entre despertares - CONTROL_PERIOD_US|
+    LOOP_STAGE_REQUESTS,    // fila de comandos (sem espera) e perfil
+    LOOP_STAGE_ACQUIRE,     // MUX + leitura da aquisicao do ADC
+    LOOP_STAGE_COMPUTE,     // PID (ou rele do ensaio, ou banco)
+    LOOP_STAGE_OUTPUT,      // escrita no DAC
+    LOOP_STAGE_PUBLISH,     // snapshot + anel de telemetria
+    LOOP_STAGE_TOTAL,       // disparo do timer -> fim do ciclo
+    LOOP_STAGE_COUNT
+} LoopStage_t;
+
+typedef enum {
+    LOOP_TASK_CONTROL = 0,
+    LOOP_TASK_ACQUISITION,
+    LOOP_TASK_PLOTTER,
+    LOOP_TASK_WEBSOCKET,
+    LOOP_TASK_SELECTOR,
+    LOOP_TASK_RECORDER,
+    LOOP_TASK_NETWORK,
+    LOOP_TASK_COUNT
+} LoopTask_t;
+
+typedef struct {
+    uint32_t buckets[LOOP_METRICS_BUCKETS];
+    uint32_t count;
+    uint32_t max_ns;
+    uint32_t sum_ns_lo, sum_ns_hi;          // soma em 64 bits (seqlock so copia palavras de 32)
+} LoopHistogram_t;
+
+typedef struct {
+    uint32_t cycles;
+    uint32_t missed_deadlines;      // ciclo terminou depois do proximo disparo
+    uint32_t timer_overruns;        // timer disparou com o ciclo anterior pendente
+    uint32_t commands;              // comandos aplicados
+    uint32_t commands_dropped;      // lotes recusados com a fila de comandos cheia
+    LoopHistogram_t stages[LOOP_STAGE_COUNT];
+} LoopMetrics_t;
+
+typedef struct {
+    uint32_t busy_us;               // tempo ocupado acumulado (da a volta)
+    uint32_t runs;
+    uint32_t stack_free_bytes;      // 0 se desconhecido
+    bool registered;
+} LoopTaskMetrics_t;
+
+// Interrupcao do timer de controle (ou o callback do timer de software).
+// overrun: a tarefa de controle nao consumiu o disparo anterior.
+void loop_metrics_timer_fired(bool overrun);
+
+// Tarefa de controle: inicio do ciclo, fim de cada etapa (na ordem de
+// LoopStage_t, REQUESTS a PUBLISH) e fim do ciclo
+void loop_metrics_cycle_begin();
+void loop_metrics_mark(LoopStage_t stage);
+void loop_metrics_cycle_end();
+void loop_metrics_commands(uint32_t applied, uint32_t dropped);
+
+// Desliga/liga a coleta (para medir o proprio custo) e zera os contadores
+// do laco (com a tarefa de controle parada)
+void loop_metrics_set_enabled(bool enabled);
+void loop_metrics_reset();
+
+// Tempo ocupado das tarefas: begin/end em volta do trabalho de cada volta
+// do laco da tarefa (so a propria tarefa chama). O handle e opcional (folga
+// de pilha).
+void loop_metrics_register_task(LoopTask_t task, void *handle);
+void loop_metrics_task_begin(LoopTask_t task);
+void loop_metrics_task_end(LoopTask_t task);
+const char *loop_metrics_task_name(LoopTask_t task);
+
+// Qualquer tarefa
+void loop_metrics_read(LoopMetrics_t *out);
+void loop_metrics_read_task(LoopTask_t task, LoopTaskMetrics_t *out);
+const char *loop_metrics_stage_name(LoopStage_t stage);
+
+// Limite superior (ns, inclusivo) do balde em que cai o quantil q (0-1);
+// 0 se vazio. Media em ns.
+uint32_t loop_histogram_quantile(const LoopHistogram_t *h, double q);
+double loop_histogram_mean(const LoopHistogram_t *h);
+
+// Texto do /metrics (formato de exposicao do Prometheus). Retorna o tamanho
+// escrito; o texto e truncado se nao couber.
+size_t loop_metrics_format_text(char *out, size_t capacity);
+
+#endif // LOOP_METRICS_H
@@ -3,15 +3,26 @@
 #include "mux.h"
 #include "plant.h"
 #include "controller.h"
-#include "setpoint.h"
+#include "control_loop.h"
+#include "adc_acquisition.h"
+#include "adc_calibration.h"
+#include "telemetry.h"
+#include "run_recorder.h"
+#include "state_snapshot.h"
+#include "autotune.h"
+#include "gain_schedule.h"
+#include "step_response.h"
+#include "loop_metrics.h"
+#include "memory_budget.h"
+#include "boot.h"
 #include "web_server.h"
 #include "spiffs_defs.h"
+#include "hal.h"
+
+#include <atomic>
 
 // -- variaveis globais e handles do FreeRTOS ---
-SystemState_t g_systemState;
-SemaphoreHandle_t xStateMutex;
-SemaphoreHandle_t xControlSemaphore;
-TimerHandle_t xControlTimer;
+// (g_systemState e a fila de comandos ficam em control_loop.cpp)
 
 // Variaveis do Wi-Fi
 const char* WIFI_SSID = "S23 de Luis";
@@ -19,114 +30,306 @@ const char* WIFI_PASSWORD = "luis1234";
 
 // --- Prototipos das Tarefas ---
 void pid_controller_task(void *parameters);
-// void setpoint_generator_task(void *parameters);
 void serial_plotter_task(void *parameters);
-// void combination_selector_task(void *parameters);
+void combination_selector_task(void *parameters);
 void websocket_plotter_task(void *parameters); 
+void network_task(void *parameters);
+
+// --- Distribuicao das tarefas ---
+// O controle e a aquisicao ficam sozinhos em CONTROL_CORE, com a
+// interrupcao do timer; o controle tem a maior prioridade do nucleo, para
+// rodar assim que a interrupcao o acorda. O que espera rede, Serial ou
+// flash vai para COMMS_CORE, junto do Wi-Fi e do AsyncTCP. A tarefa de rede
+// sobe no inicio do setup(); as outras, depois da descarga.
+typedef struct {
+    LoopTask_t id;
+    TaskFunction_t function;
+    const char *name;
+    uint32_t stack;
+    UBaseType_t priority;
+    BaseType_t core;
+} TaskLayout_t;
+
+static constexpr TaskLayout_t TASK_LAYOUT[] = {
+    {LOOP_TASK_NETWORK, network_task, "Network_Task", 4096, 1, COMMS_CORE},
+    {LOOP_TASK_ACQUISITION, adc_acquisition_task, "ADC_Acquisition_Task", 2048, 4, CONTROL_CORE},
+    {LOOP_TASK_CONTROL, pid_controller_task, "PID_Controller_Task", 4096, 5, CONTROL_CORE},
+    {LOOP_TASK_PLOTTER, serial_plotter_task, "Serial_Plotter_Task", 2048, 1, COMMS_CORE},
+    {LOOP_TASK_SELECTOR, combination_selector_task, "Combination_Selector_Task", 3072, 1, COMMS_CORE},
+    {LOOP_TASK_WEBSOCKET, websocket_plotter_task, "WebSocket_Plotter_Task", 4096, 2, COMMS_CORE},
+    {LOOP_TASK_RECORDER, run_recorder_task, "Run_Recorder_Task", 4096, 1, COMMS_CORE},
+};
+
+static TaskHandle_t task_handles[LOOP_TASK_COUNT];
+
+// Com -DSTATIC_ALLOCATION (memory_budget.h), as pilhas saem de uma area
+// estatica do tamanho da soma das pilhas de TASK_LAYOUT e os blocos de
+// controle das tarefas tambem sao estaticos: criar as tarefas nao usa o heap
+#ifdef STATIC_ALLOCATION
+static constexpr uint32_t task_stack_total() {
+    uint32_t total = 0;
+    for (const TaskLayout_t &t : TASK_LAYOUT) total += t.stack;
+    return total;
+}
+
+static StackType_t task_stacks[task_stack_total() / sizeof(StackType_t)];
+static StaticTask_t task_buffers[LOOP_TASK_COUNT];
+static uint32_t task_stack_used = 0;
+static const bool STATIC_TASKS = true;
+#else
+static const bool STATIC_TASKS = false;
+#endif
+
+static void create_task(LoopTask_t id) {
+    for (const TaskLayout_t &t : TASK_LAYOUT) {
+        if (t.id != id) continue;
+#ifdef STATIC_ALLOCATION
+        StackType_t *stack = &task_stacks[task_stack_used / sizeof(StackType_t)];
+        task_stack_used += t.stack;
+        task_handles[id] = xTaskCreateStaticPinnedToCore(t.function, t.name, t.stack, NULL, t.priority, stack,
+                                                         &task_buffers[id], t.core);
+#else
+        xTaskCreatePinnedToCore(t.function, t.name, t.stack, NULL, t.priority, &task_handles[id], t.core);
+#endif
+        loop_metrics_register_task(id, task_handles[id]);
+        memory_budget_register_task(id, task_handles[id], t.stack, STATIC_TASKS);
+    }
+}
+
+// --- Disparo do ciclo de controle ---
+// Padrao: timer de hardware cuja interrupcao acorda a tarefa de controle
+// direto (notificacao da tarefa), sem passar pela tarefa de servico dos
+// timers do FreeRTOS nem por um semaforo, e com periodo em us. Compilar com
+// -DCONTROL_TICK_SOFTWARE_TIMER volta ao timer de software + semaforo, para
+// comparar o jitter (loop_stage_ns wake/jitter no /metrics).
+#ifdef CONTROL_TICK_SOFTWARE_TIMER
+static SemaphoreHandle_t xControlSemaphore;
+static TimerHandle_t xControlTimer;
 
 void control_timer_callback(TimerHandle_t xTimer) {
-    // Libera o semáforo para desbloquear a tarefa de controle (pid_controller_task)
-    xSemaphoreGive(xControlSemaphore);
+    // Libera o semáforo para desbloquear a tarefa de controle (pid_controller_task).
+    // Semaforo ja dado = a tarefa ainda nao consumiu o disparo anterior.
+    bool overrun = xSemaphoreGive(xControlSemaphore) != pdTRUE;
+    loop_metrics_timer_fired(overrun);
+}
+
+static bool control_tick_init() {
+#ifdef STATIC_ALLOCATION
+    static StaticSemaphore_t semaphore_buffer;
+    static StaticTimer_t timer_buffer;
+    xControlSemaphore = xSemaphoreCreateBinaryStatic(&semaphore_buffer);
+    xControlTimer = xTimerCreateStatic("ControlTimer", pdMS_TO_TICKS(SAMPLE_TIME_MS), pdTRUE, (void *)0,
+                                       control_timer_callback, &timer_buffer);
+#else
+    xControlSemaphore = xSemaphoreCreateBinary();
+    xControlTimer = xTimerCreate("ControlTimer", pdMS_TO_TICKS(SAMPLE_TIME_MS), pdTRUE, (void *)0, control_timer_callback);
+#endif
+    return xControlSemaphore != NULL && xControlTimer != NULL;
+}
+
+static bool control_tick_start() {
+    return xTimerStart(xControlTimer, 0) == pdPASS;
 }
 
+static void control_tick_wait() {
+    while (xSemaphoreTake(xControlSemaphore, portMAX_DELAY) != pdTRUE) {}
+}
+#else
+static TaskHandle_t control_task = NULL;
+static std::atomic<bool> control_tick_pending(false);
+
+static void HAL_ISR_ATTR control_timer_isr(void *arg) {
+    // Disparo anterior ainda pendente = a tarefa nao o consumiu a tempo
+    bool overrun = control_tick_pending.exchange(true, std::memory_order_relaxed);
+    loop_metrics_timer_fired(overrun);
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(control_task, &woken);
+    if (woken == pdTRUE) portYIELD_FROM_ISR();
+}
+
+static bool control_tick_init() {
+    return true;
+}
+
+// Chamada pela propria tarefa de controle: a interrupcao fica no nucleo dela
+static bool control_tick_start() {
+    control_task = xTaskGetCurrentTaskHandle();
+    return hal_timer_start(CONTROL_PERIOD_US, control_timer_isr, NULL);
+}
+
+static void control_tick_wait() {
+    // Disparos acumulados viram um ciclo so, como o semaforo binario fazia
+    while (ulTaskNotifyTake(pdTRUE, portMAX_DELAY) == 0) {}
+    control_tick_pending.store(false, std::memory_order_relaxed);
+}
+#endif
+
 void setup() {
     Serial.begin(115200);
-    vTaskDelay(pdMS_TO_TICKS(1000)); // Aguarda para a Serial se estabilizar
     Serial.println("--- Inicializando Sistema de Controle PID com FreeRTOS ---");
 
-    // ---CONEXAO WI-FI ---
-    Serial.printf("Conectando à rede Wi-Fi: %s\n", WIFI_SSID);
-    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
-    while (WiFi.status() != WL_CONNECTED) {
-        vTaskDelay(pdMS_TO_TICKS(500));
-        Serial.print(".");
-    }
-    Serial.println("\nWi-Fi conectado!");
-    Serial.print("Endereço IP: ");
-    Serial.println(WiFi.localIP());
+    // O Wi-Fi sobe em paralelo com o resto da partida (tarefa de rede); o
+    // controle nao espera por ele
+    create_task(LOOP_TASK_NETWORK);
 
     // Inicializacao dos modulos de hardware
     mux_init();
     plant_init();
+    adc_acquisition_init();
+    boot_mark(BOOT_PHASE_HARDWARE);
     
     // Inicializacao dos objetos do FreeRTOS
-    xStateMutex = xSemaphoreCreateMutex();
-    xControlSemaphore = xSemaphoreCreateBinary();
-    xControlTimer = xTimerCreate("ControlTimer", pdMS_TO_TICKS(SAMPLE_TIME_MS), pdTRUE, (void *)0, control_timer_callback);
+    control_loop_init();
+    bool tick_ok = control_tick_init();
 
     // INICIALIZAÇAO DO SPIFFS
     initSPIFFS();
-
-    // INICIALIZAÇAO DO SERVIDOR WEB
-    setup_web_server();
+    run_recorder_init();
 
     // Verificacao de erros na criação dos objetos RTOS
-    if (xStateMutex == NULL || xControlSemaphore == NULL || xControlTimer == NULL) {
+    if (!tick_ok) {
         Serial.println("ERRO CRITICO: Falha ao criar objetos do FreeRTOS!");
         while(1); // Trava a execucao
     }
 
-    // Inicializacao do estado do controlador e do sistema de forma segura
-    if (xSemaphoreTake(xStateMutex, portMAX_DELAY) == pdTRUE) {
-        controller_init(0.05, 0.1, 0.0);
-        g_systemState.active_plant = 1;      // Inicia com a Planta 1
-        g_systemState.mux_combination = 0;   // Inicia com a combinação 0
-        xSemaphoreGive(xStateMutex);
+    // Inicializacao do estado do controlador e do sistema (as tarefas ainda
+    // nao existem, entao ninguem mais acessa g_systemState aqui)
+    controller_init(0.05, 0.1, 0.0);
+    g_systemState.active_plant = 1;      // Inicia com a Planta 1
+    g_systemState.mux_combination = 0;   // Inicia com a combinação 0
+
+    // Tabela de ganhos por rede salva no SPIFFS; sem ela, todas as redes
+    // comecam com os ganhos padrao
+    GainTable_t gain_table;
+    if (gain_schedule_load(&gain_table)) {
+        Serial.println("Tabela de ganhos carregada do SPIFFS");
+    } else {
+        gain_schedule_defaults(&gain_table, 0.05f, 0.1f, 0.0f);
+    }
+    control_loop_set_gain_schedule(&gain_table);
+
+    // Tabelas de calibracao do ADC por canal; sem elas, sem correcao
+    AdcCalibration_t adc_calibration;
+    if (adc_calibration_load(&adc_calibration)) {
+        adc_calibration_set(&adc_calibration);
+        Serial.println("Calibracao do ADC carregada do SPIFFS");
     }
+    boot_mark(BOOT_PHASE_STORAGE);
 
     // Reporta o estado inicial no terminal
     mux_report_selection(g_systemState.active_plant, g_systemState.mux_combination);
 
-    // Espera para descarga do capacitor
+    // Descarga dos capacitores medida no ADC: DACs em 0 ate as duas plantas
+    // lerem abaixo do limiar, com TIME_TO_DISCHARGE_MS de limite
     Serial.println("Aguardando descarga dos capacitores...");
-    mux_select_plant(1, 0); // Garante que os DACs estejam em 0
-    plant_write_control(1, 0);
-    mux_select_plant(2, 0);
-    plant_write_control(2, 0);
-    vTaskDelay(pdMS_TO_TICKS(TIME_TO_DISCHARGE_MS));
-
-    // Criacao das tarefas
-    xTaskCreate(pid_controller_task, "PID_Controller_Task", 4096, NULL, 3, NULL);
-    // xTaskCreate(setpoint_generator_task, "Setpoint_Generator_Task", 2048, NULL, 2, NULL);
-    xTaskCreate(serial_plotter_task, "Serial_Plotter_Task", 2048, NULL, 1, NULL);
-    // xTaskCreate(combination_selector_task, "Combination_Selector_Task", 2048, NULL, 1, NULL);
-    xTaskCreate(websocket_plotter_task, "WebSocket_Plotter_Task", 3072, NULL, 2, NULL);
-
-    // Inicia o timer
-    xTimerStart(xControlTimer, 0);
+    BootDischarge_t discharge;
+    if (!boot_discharge_plants(g_systemState.active_plant, g_systemState.mux_combination,
+                               DISCHARGE_THRESHOLD_COUNTS, TIME_TO_DISCHARGE_MS, &discharge)) {
+        Serial.printf("AVISO: descarga nao terminou em %lu ms (leituras %d/%d)\n",
+                      TIME_TO_DISCHARGE_MS, discharge.final_counts[0], discharge.final_counts[1]);
+    }
+    boot_mark(BOOT_PHASE_DISCHARGE);
+
+    // Criacao das tarefas (TASK_LAYOUT); os handles vao para as metricas
+    // (folga de pilha). A tarefa de controle liga o timer ao comecar.
+    for (const TaskLayout_t &t : TASK_LAYOUT) {
+        if (t.id != LOOP_TASK_NETWORK) create_task(t.id);
+    }
+    boot_mark(BOOT_PHASE_TASKS);
     
     Serial.println("Sistema iniciado. Tarefas em execução.");
     Serial.println("Setpoint(V),Output(V)"); // Cabeçalho para o Serial Plotter
 }
 
 void pid_controller_task(void *parameters) {
+    if (!control_tick_start()) {
+        Serial.println("ERRO CRITICO: Falha ao iniciar o timer de controle!");
+        vTaskDelete(NULL);
+    }
+    bool first_cycle = true;
     for (;;) {
         // Aguarda o sinal do timer
-        if (xSemaphoreTake(xControlSemaphore, portMAX_DELAY) == pdTRUE) {
-            int current_plant, current_combination;
-            
-            // obter estado atual
-            if (xSemaphoreTake(xStateMutex, portMAX_DELAY) == pdTRUE) {
-                current_plant = g_systemState.active_plant;
-                current_combination = g_systemState.mux_combination;
-                xSemaphoreGive(xStateMutex);
-            }
+        control_tick_wait();
+        control_loop_step();
+        if (first_cycle) {
+            // Fim da partida para o orcamento de memoria (memory_budget.h),
+            // selado aqui e antes da marca, para que o relatorio que a
+            // tarefa de rede imprime ao ver a marca ja o encontre selado
+            first_cycle = false;
+            memory_budget_seal();
+            boot_mark(BOOT_PHASE_FIRST_CYCLE);
+        }
+    }
+}
+
+// Tarefa de rede: conecta o Wi-Fi sem travar a partida, sobe o servidor web
+// na primeira conexao e, sem conexao, tenta de novo com espera crescente
+// (o reconectar automatico do ESP32 nao cobre todos os casos, como o AP
+// ausente na partida). Imprime o relatorio da partida e o da memoria
+// quando o primeiro ciclo de controle roda (a tarefa de controle ja selou o
+// orcamento de memoria, memory_budget.h) e de novo quando a rede chega;
+// alocacoes proibidas depois disso sao avisadas aqui.
+void network_task(void *parameters) {
+    TickType_t xLastWakeTime = xTaskGetTickCount();
+    const TickType_t xFrequency = pdMS_TO_TICKS(WIFI_POLL_MS);
 
-            // ativa a planta e combinaçao atual
-            mux_select_plant(current_plant, current_combination);
-            vTaskDelay(pdMS_TO_TICKS(1));
+    Serial.printf("Conectando à rede Wi-Fi: %s\n", WIFI_SSID);
+    WiFi.mode(WIFI_STA);
+    WiFi.setAutoReconnect(true);
+    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
 
-            double voltage_y = plant_read_voltage(current_plant);
+    bool connected = false;
+    bool server_started = false;
+    bool control_reported = false;
+    uint32_t heap_violations = 0;
+    unsigned long retry_ms = WIFI_RETRY_MIN_MS;
+    unsigned long last_attempt_ms = millis();
 
-            if (xSemaphoreTake(xStateMutex, portMAX_DELAY) == pdTRUE) {
-                g_systemState.y = (voltage_y / VCC) * ADC_RESOLUTION;
-                controller_compute();
-                xSemaphoreGive(xStateMutex);
+    for (;;) {
+        vTaskDelayUntil(&xLastWakeTime, xFrequency);
+        loop_metrics_task_begin(LOOP_TASK_NETWORK);
+
+        if (WiFi.status() == WL_CONNECTED) {
+            if (!connected) {
+                connected = true;
+                retry_ms = WIFI_RETRY_MIN_MS;
+                Serial.print("Wi-Fi conectado! Endereço IP: ");
+                Serial.println(WiFi.localIP());
+                boot_mark(BOOT_PHASE_WIFI);
+            }
+            // O servidor le o SPIFFS e a tabela de ganhos: so sobe depois
+            // que o setup() passou dessa fase
+            if (!server_started && boot_reached(BOOT_PHASE_STORAGE)) {
+                setup_web_server();
+                server_started = true;
+                boot_mark(BOOT_PHASE_WEB);
+                boot_print_report();
+            }
+        } else {
+            if (connected) {
+                connected = false;
+                last_attempt_ms = millis();
+                Serial.println("Wi-Fi desconectado; reconectando...");
+            } else if (millis() - last_attempt_ms >= retry_ms) {
+                WiFi.reconnect();
+                boot_wifi_reconnected();
+                last_attempt_ms = millis();
+                retry_ms = retry_ms * 2 > WIFI_RETRY_MAX_MS ? WIFI_RETRY_MAX_MS : retry_ms * 2;
             }
-            
-            // Aplica o sinal de controle
-            plant_write_control(current_plant, g_systemState.u);
         }
+
+        if (!control_reported && boot_reached(BOOT_PHASE_FIRST_CYCLE)) {
+            control_reported = true;
+            boot_print_report();
+            memory_budget_print();
+        }
+        if (memory_budget_violations() != heap_violations) {
+            heap_violations = memory_budget_violations();
+            Serial.printf("AVISO: %lu alocacoes no heap de tarefas que nao podem alocar\n",
+                          (unsigned long)heap_violations);
+            memory_budget_print();
+        }
+        loop_metrics_task_end(LOOP_TASK_NETWORK);
     }
 }
 
@@ -134,98 +337,310 @@ void serial_plotter_task(void *parameters) {
     TickType_t xLastWakeTime = xTaskGetTickCount();
     const TickType_t xFrequency = pdMS_TO_TICKS(150);
 
+    // Le o anel de telemetria com cursor proprio: imprime exatamente uma
+    // linha por ciclo de controle, sem repetir nem pular amostras
+    TelemetryCursor_t cursor;
+    telemetry_attach(&cursor);
+    TelemetryRecord_t records[16];
+    float dual_sp_v = 0, dual_y_v = 0;
+
     for (;;) {
         vTaskDelayUntil(&xLastWakeTime, xFrequency);
+        loop_metrics_task_begin(LOOP_TASK_PLOTTER);
+
+        int count;
+        while ((count = telemetry_drain(&cursor, records, 16)) > 0) {
+            for (int i = 0; i < count; i++) {
+                const TelemetryRecord_t *r = &records[i];
+
+                // No modo de duas malhas imprime SP/Y das duas plantas na
+                // mesma linha (a Planta 1 chega antes da Planta 2 no ciclo)
+                if (r->flags & TELEMETRY_FLAG_DUAL) {
+                    if (r->plant == 1) {
+                        dual_sp_v = r->sp_v;
+                        dual_y_v = r->y_v;
+                        continue;
+                    }
+                    Serial.print(dual_sp_v, 4);
+                    Serial.print(",");
+                    Serial.print(dual_y_v, 4);
+                    Serial.print(",");
+                }
 
-        double sp_voltage, y_voltage;
-
-        // Usa o Mutex para ler os valores de forma segura
-        if (xSemaphoreTake(xStateMutex, portMAX_DELAY) == pdTRUE) {
-            sp_voltage = (g_systemState.sp / (double)ADC_RESOLUTION) * VCC;
-            y_voltage = (g_systemState.y / (double)ADC_RESOLUTION) * VCC;
-            xSemaphoreGive(xStateMutex);
+                Serial.print(r->sp_v, 4); // Imprime com 4 casas decimais para maior precisao
+                Serial.print(",");
+                Serial.println(r->y_v, 4);
+            }
         }
-        
-        Serial.print(sp_voltage, 4); // Imprime com 4 casas decimais para maior precisao
-        Serial.print(",");
-        Serial.println(y_voltage, 4);
+        loop_metrics_task_end(LOOP_TASK_PLOTTER);
     }
 }
 
-/* void combination_selector_task(void *parameters) {
-    for(;;) {
-        // Espera um tempo antes de mudar para o proximo estado
-        vTaskDelay(pdMS_TO_TICKS(5000)); 
+// Tarefa de baixa prioridade da tabela de ganhos: grava a tabela (e a
+// calibracao do ADC) no SPIFFS quando muda e, com a varredura ligada pela
+// pagina, passa para a
+// proxima rede da tabela a cada periodo de permanencia
+void combination_selector_task(void *parameters) {
+    TickType_t xLastWakeTime = xTaskGetTickCount();
+    const TickType_t xFrequency = pdMS_TO_TICKS(GAIN_SCHEDULE_TASK_PERIOD_MS);
+
+    for (;;) {
+        vTaskDelayUntil(&xLastWakeTime, xFrequency);
+        loop_metrics_task_begin(LOOP_TASK_SELECTOR);
+
+        gain_schedule_persist();
+        adc_calibration_persist();
 
+        StateSnapshot_t state;
+        BankSnapshot_t bank;
+        state_snapshot_read(&state);
+        bank_snapshot_read(&bank);
         int new_plant, new_combination;
+        if (gain_schedule_sweep_next(millis(), state.active_plant, state.mux_combination, bank.loops > 0,
+                                     &new_plant, &new_combination)) {
+            control_loop_request_plant(new_plant, new_combination);
+            mux_report_selection(new_plant, new_combination);
+        }
+        loop_metrics_task_end(LOOP_TASK_SELECTOR);
+    }
+}
 
-        // Trava o mutex para modificar o estado do sistema com segurança
-        if (xSemaphoreTake(xStateMutex, portMAX_DELAY) == pdTRUE) {
-            
-            // Logica da maquina de estados para transicaoo
-            if (g_systemState.active_plant == 1) {
-                // Se estamos na Planta 1
-                if (g_systemState.mux_combination < 3) {
-                    g_systemState.mux_combination++;
-                } else {
-                    g_systemState.active_plant = 2;
-                    g_systemState.mux_combination = 0; 
-                }
-            } else { // if (g_systemState.active_plant == 2)
-                if (g_systemState.mux_combination < 1) {
-                    g_systemState.mux_combination++;
-                } else {
-                    g_systemState.active_plant = 1;
-                    g_systemState.mux_combination = 0; // Começa da primeira combinação da Planta 1
-                }
-            }
-            
-            new_plant = g_systemState.active_plant;
-            new_combination = g_systemState.mux_combination;
+// Saida das assinaturas (subscriptions.h): um cliente tem espaco enquanto
+// a fila de mensagens dele no AsyncWebSocket nao passa do orcamento
+// (ws.client() so devolve clientes conectados)
+static bool websocket_can_send(void *ctx, uint32_t id) {
+    AsyncWebSocketClient *client = ws.client(id);
+    return client != nullptr && client->queueLen() < SUBSCRIPTION_SEND_BUDGET;
+}
 
-            xSemaphoreGive(xStateMutex);
+static void websocket_send_frame(void *ctx, uint32_t id, const uint8_t *frame, size_t length) {
+    ws.binary(id, frame, length);
+}
+
+// Mensagem para todos os clientes serializada direto no buffer de mensagem
+// do AsyncWebSocket, que os clientes compartilham ate o ultimo enviar (com
+// ws.textAll(char*) o texto passaria por um buffer na pilha e seria copiado
+// para ele). O buffer e a alocacao conhecida desta tarefa (memory_budget.h).
+static void websocket_send_all(const JsonDocument &doc) {
+    size_t length = measureJson(doc);
+    AsyncWebSocketMessageBuffer *buffer = ws.makeBuffer(length);
+    if (buffer == nullptr || buffer->get() == nullptr) return;
+    serializeJson(doc, (char *)buffer->get(), length + 1);
+    ws.textAll(buffer);
+}
+
+static void websocket_send_autotune(const AutotuneReport_t *report) {
+    static const char *STATUS_NAMES[] = {"cancelado", "rodando", "concluido", "falhou"};
+
+    StaticJsonDocument<384> doc;
+    JsonObject result = doc.createNestedObject("autotune");
+    result["estado"] = report->status <= AUTOTUNE_FAILED ? STATUS_NAMES[report->status] : "?";
+    result["regra"] = autotune_rule_name((AutotuneRule_t)report->rule);
+    result["planta"] = report->plant;
+    result["combinacao"] = report->combination;
+    result["ku"] = report->ku;
+    result["pu"] = report->pu;
+    result["kp"] = report->kp;
+    result["ki"] = report->ki;
+    result["kd"] = report->kd;
+
+    websocket_send_all(doc);
+}
+
+// Resultado da analise de um degrau (step_response.h)
+static void websocket_send_step(const StepResult_t *step) {
+    StaticJsonDocument<384> doc;
+    JsonObject result = doc.createNestedObject("degrau");
+    result["seq"] = step->seq;
+    result["planta"] = step->plant;
+    result["combinacao"] = step->combination;
+    result["estado"] = step_response_state_name(step->flags);
+    result["de_v"] = step->from_v;
+    result["para_v"] = step->to_v;
+    result["subida_s"] = step->rise_s;
+    result["sobressinal_pct"] = step->overshoot_pct;
+    result["acomodacao_s"] = step->settling_s;
+    result["erro_regime_v"] = step->steady_error_v;
+    result["iae"] = step->iae;
+    result["duracao_s"] = step->duration_s;
+
+    websocket_send_all(doc);
+}
+
+// Tabela de ganhos por rede, para a pagina preencher os campos de ganho
+// ao trocar de planta/combinacao
+static void websocket_send_gain_table(const GainTable_t *table) {
+    static const char *SOURCE_NAMES[] = {"padrao", "pagina", "ensaio"};
+
+    StaticJsonDocument<1024> doc;
+    doc["varredura"] = gain_schedule_sweep_enabled();
+    JsonArray networks = doc.createNestedArray("ganhos");
+    for (int plant = 1; plant <= GAIN_SCHEDULE_PLANTS; plant++) {
+        for (int combination = 0; combination < GAIN_SCHEDULE_COMBINATIONS; combination++) {
+            int index = gain_schedule_index(plant, combination);
+            if (index < 0) continue;
+            const GainScheduleEntry_t *entry = &table->entries[index];
+            JsonObject network = networks.createNestedObject();
+            network["planta"] = plant;
+            network["combinacao"] = combination;
+            network["kp"] = entry->kp;
+            network["ki"] = entry->ki;
+            network["kd"] = entry->kd;
+            network["origem"] = (entry->flags & GAIN_ENTRY_AUTOTUNE) ? SOURCE_NAMES[2]
+                              : (entry->flags & GAIN_ENTRY_USER) ? SOURCE_NAMES[1] : SOURCE_NAMES[0];
         }
- 
-        mux_report_selection(new_plant, new_combination);
     }
-}*/
+
+    websocket_send_all(doc);
+}
+
+// Resumo das metricas do laco (loop_metrics.h), para quem pediu com
+// {"metricas": true}; o texto completo fica em /metrics
+static void websocket_send_metrics(const Subscriptions_t *subs) {
+    LoopMetrics_t metrics;
+    loop_metrics_read(&metrics);
+
+    StaticJsonDocument<1280> doc;
+    JsonObject result = doc.createNestedObject("metricas");
+    result["ciclos"] = metrics.cycles;
+    result["prazos_perdidos"] = metrics.missed_deadlines;
+    result["disparos_sobrepostos"] = metrics.timer_overruns;
+    result["comandos"] = metrics.commands;
+    result["comandos_recusados"] = metrics.commands_dropped;
+    JsonObject stages = result.createNestedObject("etapas_ns");
+    for (int i = 0; i < LOOP_STAGE_COUNT; i++) {
+        const LoopHistogram_t *h = &metrics.stages[i];
+        JsonObject stage = stages.createNestedObject(loop_metrics_stage_name((LoopStage_t)i));
+        stage["media"] = (uint32_t)(loop_histogram_mean(h) + 0.5);
+        stage["p99"] = loop_histogram_quantile(h, 0.99);
+        stage["max"] = h->max_ns;
+    }
+    JsonArray tasks = result.createNestedArray("tarefas");
+    for (int i = 0; i < LOOP_TASK_COUNT; i++) {
+        LoopTaskMetrics_t task;
+        loop_metrics_read_task((LoopTask_t)i, &task);
+        if (!task.registered) continue;
+        JsonObject entry = tasks.createNestedObject();
+        entry["nome"] = loop_metrics_task_name((LoopTask_t)i);
+        entry["ocupado_us"] = task.busy_us;
+        entry["pilha_livre"] = task.stack_free_bytes;
+    }
+
+    // Montado uma vez, so para quem assinou e tem espaco na fila
+    char *json = g_jsonBuffers.acquire();
+    if (json == nullptr) return;
+    serializeJson(doc, json, JSON_BUFFER_SIZE);
+    uint32_t targets[SUBSCRIPTION_MAX_CLIENTS];
+    int count = subscriptions_clients(subs, SUBSCRIPTION_CHANNEL_METRICS, targets, SUBSCRIPTION_MAX_CLIENTS);
+    for (int i = 0; i < count && i < SUBSCRIPTION_MAX_CLIENTS; i++) {
+        if (websocket_can_send(nullptr, targets[i])) ws.text(targets[i], json);
+    }
+    g_jsonBuffers.release(json);
+}
 
 void websocket_plotter_task(void *parameters) {
-    const TickType_t xFrequency = pdMS_TO_TICKS(250); // Envia dados 4 vezes por segundo
+    const TickType_t xFrequency = pdMS_TO_TICKS(250); // Envia um quadro 4 vezes por segundo
     TickType_t xLastWakeTime = xTaskGetTickCount();
 
+    // Um cursor so na telemetria alimenta o historico em varias resolucoes
+    // (history.h) e as assinaturas dos clientes (subscriptions.h); os dois
+    // sao so desta tarefa. Estaticos para nao pesar na pilha.
+    static History_t history;
+    static uint8_t history_frame[HISTORY_MAX_FRAME_SIZE];
+    static Subscriptions_t subscriptions;
+    history_init(&history);
+    subscriptions_init(&subscriptions);
+    TelemetryCursor_t cursor;
+    telemetry_attach(&cursor);
+    const SubscriptionSink_t sink = {websocket_can_send, websocket_send_frame, nullptr};
+
+    TelemetryRecord_t records[16];
+    uint32_t overflows = 0;
+    uint32_t autotune_seq = 0;
+    uint32_t step_seq = 0;
+    static StepReport_t step_report;
+    uint32_t gain_revision = 0;
+    size_t clients = 0;
+    uint32_t iterations = 0;
+
     for (;;) {
         // Aguarda o proximo ciclo
         vTaskDelayUntil(&xLastWakeTime, xFrequency);
+        loop_metrics_task_begin(LOOP_TASK_WEBSOCKET);
 
         ws.cleanupClients();
 
-        // So envia se tiver cliente web conectado
-        if (ws.count() > 0) {
-            double sp_local, y_local;
+        // Conexoes, desconexoes e pedidos {"assinar"}/{"metricas"}
+        SubscriptionRequest_t subscription;
+        while (web_server_next_subscription_request(&subscription)) {
+            if (!subscriptions_apply(&subscriptions, &subscription)) {
+                Serial.printf("Sem vaga de assinatura para o cliente #%lu\n", (unsigned long)subscription.client);
+            }
+        }
+
+        // Confirmacoes dos comandos que a tarefa de controle aplicou
+        web_server_send_acks();
+
+        // Resultado da sintonia automatica, so quando muda
+        AutotuneReport_t report;
+        autotune_report_read(&report);
+        if (report.seq != autotune_seq) {
+            autotune_seq = report.seq;
+            if (ws.count() > 0) websocket_send_autotune(&report);
+        }
 
-            if (xSemaphoreTake(xStateMutex, portMAX_DELAY) == pdTRUE) {
-                sp_local = g_systemState.sp;
-                y_local = g_systemState.y;
-                xSemaphoreGive(xStateMutex);
+        // Degraus analisados desde a ultima volta, cada um uma vez (os que
+        // nao couberem saem na volta seguinte)
+        step_response_report_read(&step_report);
+        if (step_report.seq != step_seq) {
+            StepResult_t steps[4];
+            int count = step_response_since(&step_report, step_seq, steps, 4);
+            for (int i = 0; i < count; i++) {
+                if (ws.count() > 0) websocket_send_step(&steps[i]);
             }
+            step_seq = count > 0 ? steps[count - 1].seq : step_report.seq;
+        }
 
-            // MOnta pacote JSON
-            double sp_voltage = (sp_local / (double)ADC_RESOLUTION) * VCC;
-            double y_voltage = (y_local / (double)ADC_RESOLUTION) * VCC;
-            unsigned long current_time = millis();
+        // Tabela de ganhos quando muda ou quando chega um cliente novo
+        GainTable_t gain_table;
+        gain_schedule_read(&gain_table);
+        size_t connected = ws.count();
+        if (connected > 0 && (gain_table.revision != gain_revision || connected > clients)) {
+            websocket_send_gain_table(&gain_table);
+        }
+        gain_revision = gain_table.revision;
+        clients = connected;
+
+        // Avanca o cursor mesmo sem cliente, para que quem conectar receba
+        // amostras recentes. O que o cursor perdeu vem antes do lote lido.
+        int count;
+        while ((count = telemetry_drain(&cursor, records, 16)) > 0) {
+            uint32_t lost = telemetry_overflows(&cursor) - overflows;
+            overflows += lost;
+            if (lost > 0) subscriptions_lost(&subscriptions, lost);
+            for (int i = 0; i < count; i++) {
+                history_add(&history, &records[i]);
+                subscriptions_push(&subscriptions, &records[i]);
+            }
+        }
 
-            StaticJsonDocument<128> doc;
-            doc["time"] = current_time;
-            doc["sp_v"] = sp_voltage;
-            doc["y_v"] = y_voltage;
+        // Cada cliente com espaco na fila recebe em um quadro o que acumulou;
+        // os sem espaco ficam para a proxima volta
+        subscriptions_flush(&subscriptions, &sink);
 
-            char json_buffer[128];
-            serializeJson(doc, json_buffer);
+        // Cada consulta e respondida com um unico quadro binario so para
+        // quem pediu (inclui o historico inicial de quem acabou de conectar)
+        HistoryRequest_t request;
+        while (web_server_next_history_request(&request)) {
+            size_t history_length = history_build_frame(&history, &request.query, history_frame, sizeof(history_frame));
+            if (history_length > 0) ws.binary(request.client, history_frame, history_length);
+        }
 
-            // 3. Envia o JSON para os clientes
-            ws.textAll(json_buffer);
+        // Metricas do laco a cada 2 s, para quem assinou
+        if (++iterations % 8 == 0 && ws.count() > 0) {
+            websocket_send_metrics(&subscriptions);
         }
+        loop_metrics_task_end(LOOP_TASK_WEBSOCKET);
     }
 }
 
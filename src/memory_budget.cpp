@@ -0,0 +1,228 @@
+// src/memory_budget.cpp
+
+#include "memory_budget.h"
+#include "text_buffer.h"
+#include "config.h"
+#include "telemetry.h"
+
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+
+JsonBufferPool_t g_jsonBuffers;
+
+static const char *POOL_NAMES[MEMORY_POOL_COUNT] = {"json", "telemetry"};
+
+// Cada entrada e escrita uma vez, ao criar a tarefa; as alocacoes sao
+// contadas de qualquer tarefa (dentro do malloc)
+typedef struct {
+    void *handle;
+    uint32_t stack_bytes;
+    bool static_stack;
+    std::atomic<bool> registered;
+    std::atomic<uint32_t> allocations;
+} TaskSlot_t;
+
+static TaskSlot_t tasks[LOOP_TASK_COUNT];
+static std::atomic<bool> sealed(false);
+static std::atomic<uint32_t> allocations_boot(0);
+static std::atomic<uint32_t> allocations_other(0);
+static std::atomic<uint32_t> violations(0);
+static uint32_t heap_free_at_seal;
+
+// Ha contagem quando o malloc e embrulhado (abaixo) ou no simulador, que
+// conta cada new (sim_platform.cpp)
+#if defined(STATIC_ALLOCATION) || defined(NATIVE_SIM)
+static const bool TRACKING = true;
+#else
+static const bool TRACKING = false;
+#endif
+
+void memory_budget_register_task(LoopTask_t task, void *handle, uint32_t stack_bytes, bool static_stack) {
+    tasks[task].handle = handle;
+    tasks[task].stack_bytes = stack_bytes;
+    tasks[task].static_stack = static_stack;
+    tasks[task].registered.store(true, std::memory_order_release);
+}
+
+void memory_budget_note_alloc() {
+    if (!sealed.load(std::memory_order_acquire)) {
+        allocations_boot.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    void *current = xTaskGetCurrentTaskHandle();
+    for (int i = 0; i < LOOP_TASK_COUNT; i++) {
+        if (!tasks[i].registered.load(std::memory_order_acquire) || tasks[i].handle != current) continue;
+        tasks[i].allocations.fetch_add(1, std::memory_order_relaxed);
+        if (MEMORY_NO_HEAP_TASKS & (1u << i)) violations.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    allocations_other.fetch_add(1, std::memory_order_relaxed);
+}
+
+void memory_budget_seal() {
+    if (sealed.load(std::memory_order_relaxed)) return;
+    HalHeapStats_t heap;
+    hal_heap_stats(&heap);
+    heap_free_at_seal = heap.free;
+    sealed.store(true, std::memory_order_release);
+}
+
+uint32_t memory_budget_violations() {
+    return violations.load(std::memory_order_relaxed);
+}
+
+void memory_budget_read(MemoryBudget_t *out) {
+    memset(out, 0, sizeof(*out));
+    out->sealed = sealed.load(std::memory_order_acquire);
+    hal_heap_stats(&out->heap);
+    out->heap_free_at_seal = out->sealed ? heap_free_at_seal : 0;
+    out->allocations_boot = allocations_boot.load(std::memory_order_relaxed);
+    out->allocations_other = allocations_other.load(std::memory_order_relaxed);
+    out->violations = violations.load(std::memory_order_relaxed);
+    out->tracking = TRACKING;
+
+    for (int i = 0; i < LOOP_TASK_COUNT; i++) {
+        MemoryTaskBudget_t *task = &out->tasks[i];
+        task->registered = tasks[i].registered.load(std::memory_order_acquire);
+        task->no_heap = (MEMORY_NO_HEAP_TASKS & (1u << i)) != 0;
+        if (!task->registered) continue;
+        LoopTaskMetrics_t metrics;
+        loop_metrics_read_task((LoopTask_t)i, &metrics);
+        task->stack_bytes = tasks[i].stack_bytes;
+        task->stack_free_min = metrics.stack_free_bytes;
+        task->static_stack = tasks[i].static_stack;
+        task->allocations = tasks[i].allocations.load(std::memory_order_relaxed);
+        if (task->static_stack) out->static_stack_bytes += task->stack_bytes;
+    }
+
+    g_jsonBuffers.stats(&out->pools[MEMORY_POOL_JSON]);
+    telemetry_pool_stats(&out->pools[MEMORY_POOL_TELEMETRY]);
+}
+
+const char *memory_budget_pool_name(MemoryPool_t pool) {
+    return (pool >= 0 && pool < MEMORY_POOL_COUNT) ? POOL_NAMES[pool] : "?";
+}
+
+void memory_budget_print() {
+    MemoryBudget_t b;
+    memory_budget_read(&b);
+    Serial.println("--- Memoria ---");
+    if (b.heap.total > 0) {
+        Serial.printf("  heap: %lu livres de %lu, minimo %lu, maior bloco %lu",
+                      (unsigned long)b.heap.free, (unsigned long)b.heap.total,
+                      (unsigned long)b.heap.min_free, (unsigned long)b.heap.largest_block);
+        if (b.sealed) Serial.printf(" (%lu no fim da partida)", (unsigned long)b.heap_free_at_seal);
+        Serial.println();
+    }
+    if (b.tracking) {
+        Serial.printf("  alocacoes: %lu na partida, %lu depois fora das tarefas, %lu violacoes\n",
+                      (unsigned long)b.allocations_boot, (unsigned long)b.allocations_other,
+                      (unsigned long)b.violations);
+    } else {
+        Serial.println("  alocacoes: sem contagem (compilar com -DSTATIC_ALLOCATION)");
+    }
+    Serial.printf("  %-12s %6s %6s %6s %10s\n", "tarefa", "pilha", "pico", "folga", "alocacoes");
+    for (int i = 0; i < LOOP_TASK_COUNT; i++) {
+        const MemoryTaskBudget_t *task = &b.tasks[i];
+        if (!task->registered) continue;
+        uint32_t peak = task->stack_free_min > 0 ? task->stack_bytes - task->stack_free_min : 0;
+        Serial.printf("  %-12s %6lu %6lu %6lu %10lu%s%s\n", loop_metrics_task_name((LoopTask_t)i),
+                      (unsigned long)task->stack_bytes, (unsigned long)peak, (unsigned long)task->stack_free_min,
+                      (unsigned long)task->allocations, task->static_stack ? " estatica" : "",
+                      task->no_heap && task->allocations > 0 ? " VIOLACAO" : "");
+    }
+    for (int i = 0; i < MEMORY_POOL_COUNT; i++) {
+        const BufferPoolStats_t *pool = &b.pools[i];
+        Serial.printf("  pool %-9s %3lu x %4lu bytes: em uso %lu, pico %lu, entregues %lu, faltas %lu\n",
+                      POOL_NAMES[i], (unsigned long)pool->blocks, (unsigned long)pool->block_size,
+                      (unsigned long)pool->in_use, (unsigned long)pool->peak, (unsigned long)pool->acquired,
+                      (unsigned long)pool->exhausted);
+    }
+}
+
+size_t memory_budget_format_text(char *out, size_t capacity) {
+    if (capacity == 0) return 0;
+    TextBuffer_t t = {out, capacity, 0};
+    out[0] = '\0';
+
+    static MemoryBudget_t b;
+    memory_budget_read(&b);
+    if (b.heap.total > 0) {
+        text_append(&t, "# TYPE memory_heap_bytes gauge\n");
+        text_append(&t, "memory_heap_bytes{kind=\"total\"} %lu\n", (unsigned long)b.heap.total);
+        text_append(&t, "memory_heap_bytes{kind=\"free\"} %lu\n", (unsigned long)b.heap.free);
+        text_append(&t, "memory_heap_bytes{kind=\"min_free\"} %lu\n", (unsigned long)b.heap.min_free);
+        text_append(&t, "memory_heap_bytes{kind=\"largest_block\"} %lu\n", (unsigned long)b.heap.largest_block);
+        if (b.sealed) {
+            text_append(&t, "memory_heap_bytes{kind=\"free_at_boot\"} %lu\n", (unsigned long)b.heap_free_at_seal);
+        }
+    }
+    if (b.tracking) {
+        text_append(&t, "# TYPE memory_heap_allocations_total counter\n");
+        text_append(&t, "memory_heap_allocations_total{task=\"boot\"} %lu\n", (unsigned long)b.allocations_boot);
+        for (int i = 0; i < LOOP_TASK_COUNT; i++) {
+            if (!b.tasks[i].registered) continue;
+            text_append(&t, "memory_heap_allocations_total{task=\"%s\"} %lu\n",
+                        loop_metrics_task_name((LoopTask_t)i), (unsigned long)b.tasks[i].allocations);
+        }
+        text_append(&t, "memory_heap_allocations_total{task=\"other\"} %lu\n", (unsigned long)b.allocations_other);
+        text_append(&t, "# TYPE memory_heap_violations_total counter\n");
+        text_append(&t, "memory_heap_violations_total %lu\n", (unsigned long)b.violations);
+    }
+
+    // A folga de cada pilha ja esta em task_stack_free_bytes (loop_metrics)
+    text_append(&t, "# TYPE task_stack_size_bytes gauge\n");
+    for (int i = 0; i < LOOP_TASK_COUNT; i++) {
+        if (!b.tasks[i].registered) continue;
+        text_append(&t, "task_stack_size_bytes{task=\"%s\"} %lu\n", loop_metrics_task_name((LoopTask_t)i),
+                    (unsigned long)b.tasks[i].stack_bytes);
+    }
+
+    static const struct {
+        const char *name;
+        const char *type;
+        size_t offset;
+    } POOL_GAUGES[] = {
+        {"memory_pool_blocks", "gauge", offsetof(BufferPoolStats_t, blocks)},
+        {"memory_pool_block_bytes", "gauge", offsetof(BufferPoolStats_t, block_size)},
+        {"memory_pool_in_use", "gauge", offsetof(BufferPoolStats_t, in_use)},
+        {"memory_pool_peak", "gauge", offsetof(BufferPoolStats_t, peak)},
+        {"memory_pool_exhausted_total", "counter", offsetof(BufferPoolStats_t, exhausted)},
+    };
+    for (size_t g = 0; g < sizeof(POOL_GAUGES) / sizeof(POOL_GAUGES[0]); g++) {
+        text_append(&t, "# TYPE %s %s\n", POOL_GAUGES[g].name, POOL_GAUGES[g].type);
+        for (int i = 0; i < MEMORY_POOL_COUNT; i++) {
+            uint32_t value;
+            memcpy(&value, (const char *)&b.pools[i] + POOL_GAUGES[g].offset, sizeof(value));
+            text_append(&t, "%s{pool=\"%s\"} %lu\n", POOL_GAUGES[g].name, POOL_NAMES[i], (unsigned long)value);
+        }
+    }
+    return t.length;
+}
+
+// Build com -DSTATIC_ALLOCATION: o linker troca malloc, calloc e realloc
+// (de todo o programa, inclusive das bibliotecas e do operator new) por
+// estas, que contam a alocacao antes de chamar a original
+#if defined(STATIC_ALLOCATION) && !defined(NATIVE_SIM)
+extern "C" {
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size) {
+    memory_budget_note_alloc();
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+    memory_budget_note_alloc();
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    memory_budget_note_alloc();
+    return __real_realloc(ptr, size);
+}
+}
+#endif
@@ -0,0 +1,104 @@
+// src/memory_budget.h
+//
+// Orcamento de memoria e verificacao de que o heap nao e mais usado depois
+// da partida. A partida termina no primeiro ciclo de controle (a tarefa de
+// controle chama memory_budget_seal logo depois dele); dali em diante, tudo
+// o que o firmware usa ja esta reservado: pilhas das tarefas, anel de
+// telemetria, historico, assinaturas, relatorios, e os buffers de JSON do
+// pool abaixo (antes, cada rota serializava em uma String no heap).
+//
+// Alocacoes conhecidas depois da partida: cada mensagem do WebSocket (o
+// AsyncWebSocket guarda o quadro em um buffer no heap ate enviar; as
+// mensagens para todos os clientes sao serializadas direto nele e
+// compartilhadas, websocket_send_all em main.cpp), contadas na tarefa do
+// WebSocket, e cada resposta de rota (objeto da resposta e o std::function
+// que a preenche), contadas fora das tarefas (AsyncTCP).
+//
+// Compilado com -DSTATIC_ALLOCATION (ambiente esp32-static do
+// platformio.ini), as tarefas, o semaforo e o timer de software nascem de
+// buffers estaticos (xTaskCreateStaticPinnedToCore e companhia) e malloc,
+// calloc e realloc passam por memory_budget_note_alloc (--wrap do linker),
+// que conta cada alocacao pela tarefa que a fez. As tarefas de
+// MEMORY_NO_HEAP_TASKS nao podem alocar depois da partida: cada alocacao
+// delas conta uma violacao, que a tarefa de rede avisa na Serial. As outras
+// tarefas registradas e as do sistema (Wi-Fi, lwIP, AsyncTCP, que alocam por
+// natureza) so sao contadas. Sem a flag, o relatorio fica com as medidas do
+// heap e das pilhas, sem a contagem.
+//
+// O relatorio (pilha e folga minima de cada tarefa, heap livre, minimo e
+// maior bloco, uso de cada pool) sai na Serial, em GET /memoria e no
+// /metrics (memory_*).
+
+#ifndef MEMORY_BUDGET_H
+#define MEMORY_BUDGET_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "buffer_pool.h"
+#include "hal.h"
+#include "loop_metrics.h"
+
+// Buffers de JSON: a tarefa do WebSocket serializa um documento por vez, e
+// cada resposta de rota segura o seu bloco ate terminar de ser enviada
+// (web_server_send_json). Dois envios de rota ao mesmo tempo; um terceiro
+// recebe 503.
+const size_t JSON_BUFFER_SIZE = 6144;
+const int JSON_BUFFER_COUNT = 3;
+
+// Tarefas que nao podem alocar depois da partida
+const uint32_t MEMORY_NO_HEAP_TASKS =
+    (1u << LOOP_TASK_CONTROL) | (1u << LOOP_TASK_ACQUISITION) | (1u << LOOP_TASK_PLOTTER);
+
+typedef BufferPool<JSON_BUFFER_SIZE, JSON_BUFFER_COUNT> JsonBufferPool_t;
+extern JsonBufferPool_t g_jsonBuffers;
+
+typedef enum {
+    MEMORY_POOL_JSON = 0,
+    MEMORY_POOL_TELEMETRY,      // anel de telemetria (telemetry_pool_stats)
+    MEMORY_POOL_COUNT
+} MemoryPool_t;
+
+typedef struct {
+    uint32_t stack_bytes;
+    uint32_t stack_free_min;    // menor folga da pilha (high-water mark), 0 se desconhecida
+    uint32_t allocations;       // alocacoes no heap depois da partida
+    bool registered;
+    bool static_stack;
+    bool no_heap;               // esta em MEMORY_NO_HEAP_TASKS
+} MemoryTaskBudget_t;
+
+typedef struct {
+    bool tracking;              // ha contagem de alocacoes
+    bool sealed;                // partida terminou
+    HalHeapStats_t heap;
+    uint32_t heap_free_at_seal;
+    uint32_t allocations_boot;  // ate o fim da partida
+    uint32_t allocations_other; // depois, fora das tarefas registradas
+    uint32_t violations;        // depois, das tarefas de MEMORY_NO_HEAP_TASKS
+    uint32_t static_stack_bytes;
+    MemoryTaskBudget_t tasks[LOOP_TASK_COUNT];
+    BufferPoolStats_t pools[MEMORY_POOL_COUNT];
+} MemoryBudget_t;
+
+// Chamada ao criar cada tarefa (main.cpp)
+void memory_budget_register_task(LoopTask_t task, void *handle, uint32_t stack_bytes, bool static_stack);
+
+// Uma alocacao no heap, da tarefa que esta rodando. Chamada de dentro do
+// malloc: nao aloca, nao bloqueia, nao imprime.
+void memory_budget_note_alloc();
+
+// Fim da partida: guarda o heap livre e passa a atribuir as alocacoes
+void memory_budget_seal();
+uint32_t memory_budget_violations();
+
+// Qualquer tarefa
+void memory_budget_read(MemoryBudget_t *out);
+const char *memory_budget_pool_name(MemoryPool_t pool);
+
+// Relatorio na Serial
+void memory_budget_print();
+
+// Linhas do /metrics (formato do Prometheus); retorna o tamanho escrito
+size_t memory_budget_format_text(char *out, size_t capacity);
+
+#endif // MEMORY_BUDGET_H
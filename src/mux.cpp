@@ -2,26 +2,50 @@
 
 #include "mux.h"
 #include "config.h"
+#include "hal.h"
+
+#include <atomic>
+
+// Ultimo nivel escrito em IN_A/IN_B (-1 = desconhecido)
+static int mux_last_a = -1, mux_last_b = -1;
+static std::atomic<uint32_t> mux_generation_count(0);
 
 void mux_init() {
-    pinMode(MUX_IN_A_PIN, OUTPUT);
-    pinMode(MUX_IN_B_PIN, OUTPUT);
+    hal_gpio_set_output(MUX_IN_A_PIN);
+    hal_gpio_set_output(MUX_IN_B_PIN);
+    mux_last_a = -1; // forca a proxima selecao a escrever os pinos
+    mux_last_b = -1;
 }
 
-void mux_select_plant(int plant_id, int combination) {
+bool mux_select_plant(int plant_id, int combination) {
+    int a, b;
     if (plant_id == 1) {
         // combinacao 0 (0b00) -> A=LOW, B=LOW
         // combinacao 1 (0b01) -> A=LOW, B=HIGH
         // combinacao 2 (0b10) -> A=HIGH, B=LOW
         // combinacao 3 (0b11) -> A=HIGH, B=HIGH
-        digitalWrite(MUX_IN_A_PIN, (combination & 0b10) ? HIGH : LOW); // Checa o segundo bit
-        digitalWrite(MUX_IN_B_PIN, (combination & 0b01) ? HIGH : LOW); // Checa o primeiro bit
+        a = (combination & 0b10) != 0; // Checa o segundo bit
+        b = (combination & 0b01) != 0; // Checa o primeiro bit
     } else if (plant_id == 2) {
         // combinacao 0 -> A=LOW, B=LOW
         // combinacao 1 -> A=LOW, B=HIGH
-        digitalWrite(MUX_IN_A_PIN, LOW); // Fixo em LOW para Planta 2
-        digitalWrite(MUX_IN_B_PIN, (combination == 1) ? HIGH : LOW);
+        a = 0; // Fixo em LOW para Planta 2
+        b = (combination == 1);
+    } else {
+        return false;
     }
+
+    if (a == mux_last_a && b == mux_last_b) return false;
+    mux_generation_count.fetch_add(1, std::memory_order_acq_rel);
+    hal_gpio_write(MUX_IN_A_PIN, a);
+    hal_gpio_write(MUX_IN_B_PIN, b);
+    mux_last_a = a;
+    mux_last_b = b;
+    return true;
+}
+
+uint32_t mux_generation() {
+    return mux_generation_count.load(std::memory_order_acquire);
 }
 
 void mux_report_selection(int plant_id, int combination) {
@@ -42,4 +66,5 @@ void mux_report_selection(int plant_id, int combination) {
 
     Serial.println();
     Serial.println(buffer);
-    Serial.flush();
\ No newline at end of file
+    Serial.flush();
+}
\ No newline at end of file
@@ -3,8 +3,14 @@
 #ifndef MUX_H
 #define MUX_H
 
+#include <stdint.h>
+
 void mux_init();
-void mux_select_plant(int plant_id, int combination);
+// Retorna true se os pinos do MUX mudaram (o sinal precisa acomodar)
+bool mux_select_plant(int plant_id, int combination);
+// Geracao da selecao: incrementada antes de cada mudanca dos pinos. Quem
+// converte o ADC a le antes da conversao e marca a amostra com ela.
+uint32_t mux_generation();
 void mux_report_selection(int plant_id, int combination);
 
 #endif // MUX_H
\ No newline at end of file
@@ -0,0 +1,55 @@
+// src/pid_kernel.h
+//
+// Nucleo do PID parametrizado pelo tipo numerico (double, float ou Q16_16).
+// O firmware usa float; double (referencia) e Q16_16 ficam para os
+// benchmarks e comparacoes no build nativo.
+
+#ifndef PID_KERNEL_H
+#define PID_KERNEL_H
+
+#include "config.h"
+#include "fixed_point.h"
+
+// Limites do sinal de controle, dobrados em tempo de compilacao para cada tipo
+template <typename T>
+struct PidLimits {
+    static constexpr T u_min() { return T(0); }
+    static constexpr T u_max() { return T((int)DAC_RESOLUTION); }
+};
+
+template <typename T>
+inline T pid_clamp(T v) {
+    return (v > PidLimits<T>::u_max()) ? PidLimits<T>::u_max()
+         : (v < PidLimits<T>::u_min()) ? PidLimits<T>::u_min() : v;
+}
+
+const float PID_DERIVATIVE_FILTER_N = 10.0f;    // Tf = Td / N
+
+// Um passo do PID: derivada sobre a medicao com filtro de primeira ordem
+// (Tf = Td/N, estado em dTerm), anti-windup por recalculo
+// (back-calculation) e saturacao da saida. ki e kd ja vem escalados pelo
+// periodo de amostragem (controller_scale_tunings). Retorna u em contagens
+// do DAC.
+template <typename T>
+inline T pid_kernel_compute(T sp, T y, T &iTerm, T &lastY, T &dTerm, T kp, T ki, T kd) {
+    // Erro 
+    T e = sp - y;
+
+    // Termo Derivativo filtrado: alpha = Tf/(Tf + Ts), e Td/Ts = kd/kp com
+    // os ganhos escalados
+    T dY = y - lastY;
+    lastY = y;
+    T alpha = (kp > T(0)) ? kd / (kd + T(PID_DERIVATIVE_FILTER_N) * kp) : T(0);
+    dTerm = alpha * dTerm - (T(1) - alpha) * kd * dY;
+
+    // Termo Integral com recalculo: o integrador volta pelo excesso da
+    // saturacao com ganho Ts/Ti = ki/kp, em vez de so parar
+    iTerm += ki * e;
+    T v = kp * e + iTerm + dTerm;
+    T u = pid_clamp(v);
+    T kb = (kp > T(0) && ki < kp) ? ki / kp : T(1);
+    iTerm = pid_clamp(iTerm + kb * (u - v));
+    return u;
+}
+
+#endif // PID_KERNEL_H
@@ -2,39 +2,42 @@
 
 #include "plant.h"
 #include "config.h"
+#include "hal.h"
 
 void plant_init() {
     // Configura os pinos de ADC
-    pinMode(ADC_PIN_PLANT_1, INPUT);
-    pinMode(ADC_PIN_PLANT_2, INPUT);
+    hal_gpio_set_input(ADC_PIN_PLANT_1);
+    hal_gpio_set_input(ADC_PIN_PLANT_2);
 
     // Configura os pinos de DAC
-    dac_output_enable(DAC_CHANNEL_1); // Para DAC_PIN_PLANT_1 (GPIO 25)
-    dac_output_enable(DAC_CHANNEL_2); // Para DAC_PIN_PLANT_2 (GPIO 26)
+    hal_dac_enable(DAC_PIN_PLANT_1); // DAC canal 1 (GPIO 25)
+    hal_dac_enable(DAC_PIN_PLANT_2); // DAC canal 2 (GPIO 26)
 
-    dac_output_voltage(DAC_CHANNEL_1, 0);
-    dac_output_voltage(DAC_CHANNEL_2, 0);
+    hal_dac_write(DAC_PIN_PLANT_1, 0);
+    hal_dac_write(DAC_PIN_PLANT_2, 0);
+}
+
+// Leitura bruta do ADC (0 a ADC_RESOLUTION), ja na unidade usada pelo PID
+int plant_read_raw(int plant_id) {
+    if (plant_id == 1) return hal_adc_read(ADC_PIN_PLANT_1);
+    if (plant_id == 2) return hal_adc_read(ADC_PIN_PLANT_2);
+    return 0;
 }
 
 double plant_read_voltage(int plant_id) {
-    int raw_adc = 0;
-    if (plant_id == 1) {
-        raw_adc = analogRead(ADC_PIN_PLANT_1);
-    } else if (plant_id == 2) {
-        raw_adc = analogRead(ADC_PIN_PLANT_2);
-    }
-    return (double)raw_adc * (VCC / (double)ADC_RESOLUTION);
+    constexpr double volts_per_count = VCC / (double)ADC_RESOLUTION;
+    return plant_read_raw(plant_id) * volts_per_count;
 }
 
-void plant_write_control(int plant_id, double control_signal_u) {
+void plant_write_control(int plant_id, float control_signal_u) {
     if (control_signal_u > DAC_RESOLUTION) control_signal_u = DAC_RESOLUTION;
     if (control_signal_u < 0) control_signal_u = 0;
     
     uint8_t dac_value = (uint8_t)control_signal_u;
 
     if (plant_id == 1) {
-        dac_output_voltage(DAC_CHANNEL_1, dac_value);
+        hal_dac_write(DAC_PIN_PLANT_1, dac_value);
     } else if (plant_id == 2) {
-        dac_output_voltage(DAC_CHANNEL_2, dac_value);
+        hal_dac_write(DAC_PIN_PLANT_2, dac_value);
     }
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 
 void plant_init();
 double plant_read_voltage(int plant_id);
-void plant_write_control(int plant_id, double control_signal_u);
+int plant_read_raw(int plant_id);
+void plant_write_control(int plant_id, float control_signal_u);
 
 #endif // PLANT_H
\ No newline at end of file
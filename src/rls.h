@@ -0,0 +1,89 @@
+// src/rls.h
+//
+// Minimos quadrados recursivos (RLS) com fator de esquecimento, em float e
+// com tamanho fixo: N e o maximo de parametros (dimensao das matrizes) e n,
+// escolhido no rls_init, quantos estao em uso. Nada e alocado e cada
+// atualizacao custa O(n^2), sem inversao de matriz:
+//
+//     e     = y - phi' theta              (erro a priori)
+//     k     = P phi / (lambda + phi' P phi)
+//     theta = theta + k e
+//     P     = (P - k phi' P) / lambda
+//
+// P e mantida simetrica (so o triangulo de cima e calculado). Sem excitacao,
+// a divisao por lambda faz P crescer sem limite ("estouro" da covariancia);
+// quando o traco passaria de max_trace, o esquecimento para naquele passo.
+
+#ifndef RLS_H
+#define RLS_H
+
+#include <stdint.h>
+
+template <int N>
+struct Rls {
+    int n;                      // parametros em uso (<= N)
+    float lambda;               // fator de esquecimento (0 < lambda <= 1)
+    float max_trace;            // limite do traco de P
+    float theta[N];
+    float P[N][N];
+    uint32_t updates;
+};
+
+template <int N>
+void rls_init(Rls<N> *rls, int n, float lambda, float p0, float max_trace) {
+    rls->n = (n > N) ? N : n;
+    rls->lambda = lambda;
+    rls->max_trace = max_trace;
+    rls->updates = 0;
+    for (int i = 0; i < N; i++) {
+        rls->theta[i] = 0.0f;
+        for (int j = 0; j < N; j++) rls->P[i][j] = (i == j) ? p0 : 0.0f;
+    }
+}
+
+template <int N>
+float rls_predict(const Rls<N> *rls, const float *phi) {
+    float y = 0.0f;
+    for (int i = 0; i < rls->n; i++) y += rls->theta[i] * phi[i];
+    return y;
+}
+
+// Uma amostra (regressores phi, saida y). Retorna o erro a priori.
+template <int N>
+float rls_update(Rls<N> *rls, const float *phi, float y) {
+    const int n = rls->n;
+    float Pphi[N];
+    float denom = rls->lambda;
+    for (int i = 0; i < n; i++) {
+        float s = 0.0f;
+        for (int j = 0; j < n; j++) s += rls->P[i][j] * phi[j];
+        Pphi[i] = s;
+        denom += phi[i] * s;
+    }
+
+    float e = y - rls_predict(rls, phi);
+    if (!(denom > 1e-12f)) return e;    // P degenerada (ou NaN): nao atualiza
+
+    float k[N];
+    float inv_denom = 1.0f / denom;
+    float trace = 0.0f;
+    for (int i = 0; i < n; i++) {
+        k[i] = Pphi[i] * inv_denom;
+        rls->theta[i] += k[i] * e;
+        trace += rls->P[i][i] - k[i] * Pphi[i];
+    }
+
+    // phi' P = (P phi)' porque P e simetrica
+    float scale = (trace > rls->max_trace * rls->lambda) ? 1.0f : 1.0f / rls->lambda;
+    for (int i = 0; i < n; i++) {
+        for (int j = i; j < n; j++) {
+            float v = (rls->P[i][j] - k[i] * Pphi[j]) * scale;
+            rls->P[i][j] = v;
+            rls->P[j][i] = v;
+        }
+    }
+    rls->updates++;
+    return e;
+}
+
+#endif // RLS_H
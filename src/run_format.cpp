@@ -0,0 +1,204 @@
+// src/run_format.cpp
+
+#include "run_format.h"
+#include "byte_order.h"
+
+#include <math.h>
+
+// --- varint com zigzag (valores pequenos, positivos ou negativos, em 1 byte) ---
+
+static uint32_t zigzag(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static int32_t unzigzag(uint32_t v) {
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static size_t put_varint(uint8_t *p, uint32_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+// Retorna os bytes consumidos, ou 0 se o varint passar do fim
+static size_t get_varint(const uint8_t *p, const uint8_t *end, uint32_t *v) {
+    uint32_t result = 0;
+    for (size_t n = 0; n < 5 && p + n < end; n++) {
+        result |= (uint32_t)(p[n] & 0x7F) << (7 * n);
+        if ((p[n] & 0x80) == 0) {
+            *v = result;
+            return n + 1;
+        }
+    }
+    return 0;
+}
+
+// --- Colunas ---
+
+enum { COL_CYCLE, COL_TIME, COL_SP, COL_Y, COL_U, COL_ITERM, COL_TAG };
+
+static const float VOLT_SCALE = 1e4f;   // 0,1 mV
+static const float COUNT_SCALE = 1e2f;  // 0,01 contagem do DAC
+
+static void run_record_columns(const TelemetryRecord_t *r, int32_t v[RUN_COLUMNS]) {
+    v[COL_CYCLE] = (int32_t)r->cycle;
+    v[COL_TIME] = (int32_t)r->time_ms;
+    v[COL_SP] = (int32_t)lroundf(r->sp_v * VOLT_SCALE);
+    v[COL_Y] = (int32_t)lroundf(r->y_v * VOLT_SCALE);
+    v[COL_U] = (int32_t)lroundf(r->u * COUNT_SCALE);
+    v[COL_ITERM] = (int32_t)lroundf(r->iTerm * COUNT_SCALE);
+    v[COL_TAG] = (r->plant & 0x03) | ((r->combination & 0x03) << 2) | ((r->flags & 0x0F) << 4);
+}
+
+// --- Cabecalho ---
+
+void run_header_encode(const RunHeader_t *header, uint8_t out[RUN_HEADER_SIZE]) {
+    memset(out, 0, RUN_HEADER_SIZE);
+    uint8_t *p = out;
+    p = put_u32(p, RUN_MAGIC);
+    p = put_u16(p, RUN_VERSION);
+    p = put_u16(p, (uint16_t)RUN_HEADER_SIZE);
+    p = put_u16(p, (uint16_t)RUN_BLOCK_SIZE);
+    p = put_u16(p, 0);
+    p = put_u32(p, header->sample_time_ms);
+    p = put_u32(p, header->start_cycle);
+    p = put_u32(p, header->start_time_ms);
+    p = put_f32(p, header->kp);
+    p = put_f32(p, header->ki);
+    p = put_f32(p, header->kd);
+    *p++ = header->plant;
+    *p++ = header->combination;
+    *p++ = header->dual;
+    *p++ = header->decimation;
+}
+
+bool run_header_decode(const uint8_t *data, size_t length, RunHeader_t *header) {
+    if (length < RUN_HEADER_SIZE) return false;
+    if (get_u32(data) != RUN_MAGIC || get_u16(data + 4) != RUN_VERSION) return false;
+    if (get_u16(data + 6) != RUN_HEADER_SIZE || get_u16(data + 8) != RUN_BLOCK_SIZE) return false;
+
+    header->sample_time_ms = get_u32(data + 12);
+    header->start_cycle = get_u32(data + 16);
+    header->start_time_ms = get_u32(data + 20);
+    header->kp = get_f32(data + 24);
+    header->ki = get_f32(data + 28);
+    header->kd = get_f32(data + 32);
+    header->plant = data[36];
+    header->combination = data[37];
+    header->dual = data[38];
+    header->decimation = data[39];
+    return true;
+}
+
+// --- Blocos ---
+
+void run_block_reset(RunBlockEncoder_t *enc) {
+    enc->used = 0;
+    enc->count = 0;
+}
+
+bool run_block_append(RunBlockEncoder_t *enc, const TelemetryRecord_t *record) {
+    int32_t v[RUN_COLUMNS];
+    run_record_columns(record, v);
+
+    if (enc->count == 0) {
+        enc->first_cycle = record->cycle;
+        enc->first_time_ms = record->time_ms;
+        for (int c = 0; c < RUN_COLUMNS; c++) enc->prev[c] = 0;
+        enc->prev[COL_CYCLE] = (int32_t)record->cycle;
+        enc->prev[COL_TIME] = (int32_t)record->time_ms;
+    }
+    if (enc->count == 0xFFFF) return false;
+
+    uint8_t row[RUN_COLUMNS * 5];
+    size_t n = 0;
+    for (int c = 0; c < RUN_COLUMNS; c++) {
+        n += put_varint(row + n, zigzag((int32_t)((uint32_t)v[c] - (uint32_t)enc->prev[c])));
+    }
+    if (enc->used + n > RUN_BLOCK_PAYLOAD) return false;
+
+    memcpy(enc->rows + enc->used, row, n);
+    enc->used += n;
+    enc->count++;
+    for (int c = 0; c < RUN_COLUMNS; c++) enc->prev[c] = v[c];
+    return true;
+}
+
+void run_block_finish(RunBlockEncoder_t *enc, uint8_t out[RUN_BLOCK_SIZE]) {
+    memset(out, 0, RUN_BLOCK_SIZE);
+
+    uint8_t *p = out;
+    p = put_u16(p, RUN_BLOCK_MAGIC);
+    p = put_u16(p, enc->count);
+    p = put_u32(p, enc->first_cycle);
+    p = put_u32(p, enc->first_time_ms);
+    p = put_u16(p, (uint16_t)enc->used);
+    p = put_u16(p, 0);
+
+    // Transposicao: uma passada pelas linhas por coluna, copiando so o
+    // varint daquela coluna. O tamanho total nao muda.
+    const uint8_t *end = enc->rows + enc->used;
+    for (int c = 0; c < RUN_COLUMNS; c++) {
+        const uint8_t *q = enc->rows;
+        while (q < end) {
+            for (int k = 0; k < RUN_COLUMNS; k++) {
+                const uint8_t *start = q;
+                while (*q & 0x80) q++;
+                q++;
+                if (k == c) {
+                    memcpy(p, start, q - start);
+                    p += q - start;
+                }
+            }
+        }
+    }
+
+    run_block_reset(enc);
+}
+
+int run_block_decode(const uint8_t *block, size_t length, TelemetryRecord_t *out, int max) {
+    if (length < RUN_BLOCK_HEADER_SIZE || get_u16(block) != RUN_BLOCK_MAGIC) return -1;
+
+    int count = get_u16(block + 2);
+    size_t payload = get_u16(block + 12);
+    if (count > max || RUN_BLOCK_HEADER_SIZE + payload > length) return -1;
+
+    const uint8_t *p = block + RUN_BLOCK_HEADER_SIZE;
+    const uint8_t *end = p + payload;
+    int32_t v[RUN_COLUMNS];
+    v[COL_CYCLE] = (int32_t)get_u32(block + 4);
+    v[COL_TIME] = (int32_t)get_u32(block + 8);
+
+    for (int c = 0; c < RUN_COLUMNS; c++) {
+        int32_t value = (c == COL_CYCLE || c == COL_TIME) ? v[c] : 0;
+        for (int i = 0; i < count; i++) {
+            uint32_t raw;
+            size_t n = get_varint(p, end, &raw);
+            if (n == 0) return -1;
+            p += n;
+            value = (int32_t)((uint32_t)value + (uint32_t)unzigzag(raw));
+
+            TelemetryRecord_t *r = &out[i];
+            switch (c) {
+            case COL_CYCLE: r->cycle = (uint32_t)value; break;
+            case COL_TIME: r->time_ms = (uint32_t)value; break;
+            case COL_SP: r->sp_v = value / VOLT_SCALE; break;
+            case COL_Y: r->y_v = value / VOLT_SCALE; break;
+            case COL_U: r->u = value / COUNT_SCALE; break;
+            case COL_ITERM: r->iTerm = value / COUNT_SCALE; break;
+            case COL_TAG:
+                r->plant = value & 0x03;
+                r->combination = (value >> 2) & 0x03;
+                r->flags = (value >> 4) & 0x0F;
+                r->reserved = 0;
+                break;
+            }
+        }
+    }
+    return count;
+}
@@ -0,0 +1,96 @@
+// src/run_format.h
+//
+// Formato binario das execucoes gravadas pelo run_recorder. Compartilhado
+// entre o firmware (gravacao) e o build nativo (decodificacao e replay).
+//
+// Arquivo = cabecalho de RUN_HEADER_SIZE bytes + blocos de RUN_BLOCK_SIZE
+// bytes. Todo bloco tem exatamente RUN_BLOCK_SIZE bytes (o fim e completado
+// com zeros), entao a gravacao e sempre feita em pedacos grandes e alinhados.
+//
+// Cabecalho (little-endian):
+//   u32 magic            RUN_MAGIC
+//   u16 version          RUN_VERSION
+//   u16 header_size      RUN_HEADER_SIZE
+//   u16 block_size       RUN_BLOCK_SIZE
+//   u16 reserved
+//   u32 sample_time_ms
+//   u32 start_cycle
+//   u32 start_time_ms
+//   f32 kp, ki, kd       ganhos como digitados (sem a escala do periodo)
+//   u8  plant, combination, dual, decimation
+//   (zeros ate RUN_HEADER_SIZE)
+//
+// Bloco (colunar, delta):
+//   u16 magic            RUN_BLOCK_MAGIC
+//   u16 count            registros no bloco
+//   u32 first_cycle
+//   u32 first_time_ms
+//   u16 payload_size     bytes de colunas apos o cabecalho do bloco
+//   u16 reserved
+//   colunas, uma apos a outra, cada uma com count varints (zigzag) da
+//   diferenca para o registro anterior da mesma coluna:
+//     cycle, time_ms               (o anterior do primeiro e first_*)
+//     sp, y                        (1e-4 V)
+//     u, iTerm                     (1e-2 contagens do DAC)
+//     tag                          plant | combination << 2 | flags << 4
+//   (o anterior do primeiro registro nas colunas de valor e 0)
+
+#ifndef RUN_FORMAT_H
+#define RUN_FORMAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "telemetry.h"
+
+const uint32_t RUN_MAGIC = 0x314E5552;           // "RUN1"
+const uint16_t RUN_VERSION = 1;
+const uint16_t RUN_BLOCK_MAGIC = 0x4B42;         // "BK"
+const size_t RUN_HEADER_SIZE = 64;
+const size_t RUN_BLOCK_SIZE = 4096;
+const size_t RUN_BLOCK_HEADER_SIZE = 16;
+const size_t RUN_BLOCK_PAYLOAD = RUN_BLOCK_SIZE - RUN_BLOCK_HEADER_SIZE;
+const int RUN_COLUMNS = 7;
+// Cada coluna gasta pelo menos um byte por registro
+const int RUN_MAX_BLOCK_RECORDS = (int)(RUN_BLOCK_PAYLOAD / RUN_COLUMNS);
+
+typedef struct {
+    uint32_t sample_time_ms;
+    uint32_t start_cycle;
+    uint32_t start_time_ms;
+    float kp, ki, kd;
+    uint8_t plant;
+    uint8_t combination;
+    uint8_t dual;
+    uint8_t decimation;
+} RunHeader_t;
+
+// Os registros entram em linha (varints por registro) e so sao transpostos
+// em colunas no fechamento do bloco, entao o codificador ocupa um unico
+// bloco de memoria, independente de quantos registros couberem.
+typedef struct {
+    uint8_t rows[RUN_BLOCK_PAYLOAD];
+    size_t used;
+    uint16_t count;
+    uint32_t first_cycle;
+    uint32_t first_time_ms;
+    int32_t prev[RUN_COLUMNS];
+} RunBlockEncoder_t;
+
+void run_header_encode(const RunHeader_t *header, uint8_t out[RUN_HEADER_SIZE]);
+bool run_header_decode(const uint8_t *data, size_t length, RunHeader_t *header);
+
+void run_block_reset(RunBlockEncoder_t *enc);
+
+// Acrescenta um registro; retorna false se nao couber (feche o bloco e
+// tente de novo em um bloco vazio)
+bool run_block_append(RunBlockEncoder_t *enc, const TelemetryRecord_t *record);
+
+// Transpoe em colunas e escreve o bloco completo (RUN_BLOCK_SIZE bytes) em
+// out; o codificador volta a ficar vazio
+void run_block_finish(RunBlockEncoder_t *enc, uint8_t out[RUN_BLOCK_SIZE]);
+
+// Decodifica um bloco; retorna o numero de registros (ate max) ou -1 se o
+// bloco for invalido. Um bloco so de zeros (fim do arquivo) retorna -1.
+int run_block_decode(const uint8_t *block, size_t length, TelemetryRecord_t *out, int max);
+
+#endif // RUN_FORMAT_H
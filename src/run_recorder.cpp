@@ -0,0 +1,206 @@
+// src/run_recorder.cpp
+
+#include "run_recorder.h"
+#include "run_format.h"
+#include "run_storage.h"
+#include "telemetry.h"
+#include "state_snapshot.h"
+#include "adc_acquisition.h"
+#include "loop_metrics.h"
+#include "config.h"
+
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+
+// Pedidos vindos de outras tarefas
+static std::atomic<bool> start_requested(false);
+static std::atomic<bool> stop_requested(false);
+static std::atomic<bool> recording(false);
+
+// Estado do gravador: so a tarefa do gravador mexe daqui para baixo
+static TelemetryCursor_t cursor;
+static RunBlockEncoder_t encoder;
+static uint8_t block[RUN_BLOCK_SIZE];
+static bool file_open = false;
+static RunHeader_t file_header;
+static uint32_t file_size = 0;
+static uint32_t next_index = 1;
+static uint32_t overflows_reported = 0;
+
+static bool run_recorder_parse_index(const char *name, uint32_t *index) {
+    unsigned value;
+    char tail[8];
+    if (sscanf(name, "run_%u.%7s", &value, tail) != 2 || strcmp(tail, "bin") != 0) return false;
+    *index = value;
+    return true;
+}
+
+void run_recorder_init() {
+    RunFileInfo_t files[RUN_MAX_FILES * 2];
+    int count = run_storage_list(files, RUN_MAX_FILES * 2);
+    for (int i = 0; i < count; i++) {
+        uint32_t index;
+        if (run_recorder_parse_index(files[i].name, &index) && index >= next_index) next_index = index + 1;
+    }
+}
+
+void run_recorder_request_start() {
+    start_requested.store(true);
+}
+
+void run_recorder_request_stop() {
+    stop_requested.store(true);
+}
+
+bool run_recorder_is_recording() {
+    return recording.load();
+}
+
+// Apaga os arquivos mais antigos ate sobrar espaco para mais um
+static void run_recorder_prune() {
+    RunFileInfo_t files[RUN_MAX_FILES * 2];
+    int count = run_storage_list(files, RUN_MAX_FILES * 2);
+
+    while (count >= RUN_MAX_FILES) {
+        int oldest = -1;
+        uint32_t oldest_index = 0;
+        for (int i = 0; i < count; i++) {
+            uint32_t index;
+            if (!run_recorder_parse_index(files[i].name, &index)) continue;
+            if (oldest < 0 || index < oldest_index) {
+                oldest = i;
+                oldest_index = index;
+            }
+        }
+        if (oldest < 0) return;
+        run_storage_remove(files[oldest].name);
+        files[oldest] = files[--count];
+    }
+}
+
+static void run_recorder_write_block() {
+    if (encoder.count == 0) return;
+    run_block_finish(&encoder, block);
+    if (run_storage_write(block, RUN_BLOCK_SIZE)) {
+        file_size += RUN_BLOCK_SIZE;
+    } else {
+        Serial.println("Gravador: falha ao escrever bloco");
+    }
+}
+
+static void run_recorder_close_file() {
+    if (!file_open) return;
+    run_recorder_write_block();
+    run_storage_close();
+    file_open = false;
+}
+
+static bool run_recorder_open_file(const RunHeader_t *header) {
+    run_recorder_prune();
+
+    char name[32];
+    snprintf(name, sizeof(name), "run_%04u.bin", (unsigned)next_index);
+    if (!run_storage_open(name)) {
+        Serial.printf("Gravador: nao foi possivel criar %s\n", name);
+        return false;
+    }
+    next_index++;
+
+    uint8_t data[RUN_HEADER_SIZE];
+    run_header_encode(header, data);
+    run_storage_write(data, RUN_HEADER_SIZE);
+
+    file_header = *header;
+    file_size = RUN_HEADER_SIZE;
+    file_open = true;
+    run_block_reset(&encoder);
+    Serial.printf("Gravador: gravando %s\n", name);
+    return true;
+}
+
+// Cabecalho que descreve o registro: planta/combinacao/modo vem do registro,
+// ganhos do snapshot (sem a escala do periodo de amostragem)
+static void run_recorder_header_for(const TelemetryRecord_t *r, const StateSnapshot_t *state, RunHeader_t *h) {
+    const double ts = SAMPLE_TIME_S;
+    memset(h, 0, sizeof(*h));
+    h->sample_time_ms = SAMPLE_TIME_MS;
+    h->start_cycle = r->cycle;
+    h->start_time_ms = r->time_ms;
+    h->kp = (float)state->kp;
+    h->ki = (float)(state->ki / ts);
+    h->kd = (float)(state->kd * ts);
+    h->dual = (r->flags & TELEMETRY_FLAG_DUAL) ? 1 : 0;
+    h->plant = h->dual ? 0 : r->plant;
+    h->combination = r->combination;
+    h->decimation = (uint8_t)adc_acquisition_get_mode();
+}
+
+static bool run_recorder_same_run(const RunHeader_t *a, const RunHeader_t *b) {
+    return a->plant == b->plant && a->combination == b->combination && a->dual == b->dual &&
+           a->kp == b->kp && a->ki == b->ki && a->kd == b->kd && a->decimation == b->decimation;
+}
+
+static void run_recorder_record(const TelemetryRecord_t *r, const StateSnapshot_t *state) {
+    RunHeader_t header;
+    run_recorder_header_for(r, state, &header);
+
+    if (file_open && (!run_recorder_same_run(&header, &file_header) ||
+                      file_size + RUN_BLOCK_SIZE > RUN_MAX_FILE_SIZE)) {
+        run_recorder_close_file();
+    }
+    if (!file_open && !run_recorder_open_file(&header)) return;
+
+    if (!run_block_append(&encoder, r)) {
+        run_recorder_write_block();
+        // O bloco que acabou de ser escrito pode ter enchido o arquivo
+        if (file_size + RUN_BLOCK_SIZE > RUN_MAX_FILE_SIZE) {
+            run_recorder_close_file();
+            header.start_cycle = r->cycle;
+            header.start_time_ms = r->time_ms;
+            if (!run_recorder_open_file(&header)) return;
+        }
+        run_block_append(&encoder, r);
+    }
+}
+
+void run_recorder_poll() {
+    if (start_requested.exchange(false) && !recording.load()) {
+        telemetry_attach(&cursor);
+        overflows_reported = 0;
+        recording.store(true);
+    }
+    // Ao parar, ainda grava o que estiver no anel antes de fechar o arquivo
+    if (stop_requested.exchange(false)) recording.store(false);
+    if (!recording.load() && !file_open) return;
+
+    StateSnapshot_t state;
+    state_snapshot_read(&state);
+
+    TelemetryRecord_t records[16];
+    int count;
+    while ((count = telemetry_drain(&cursor, records, 16)) > 0) {
+        for (int i = 0; i < count; i++) run_recorder_record(&records[i], &state);
+    }
+
+    uint32_t overflows = telemetry_overflows(&cursor);
+    if (overflows != overflows_reported) {
+        Serial.printf("Gravador: %u ciclos perdidos (anel cheio)\n", (unsigned)(overflows - overflows_reported));
+        overflows_reported = overflows;
+    }
+
+    if (!recording.load()) run_recorder_close_file();
+}
+
+void run_recorder_task(void *parameters) {
+    (void)parameters;
+    TickType_t xLastWakeTime = xTaskGetTickCount();
+    const TickType_t xFrequency = pdMS_TO_TICKS(RUN_RECORDER_PERIOD_MS);
+
+    for (;;) {
+        vTaskDelayUntil(&xLastWakeTime, xFrequency);
+        loop_metrics_task_begin(LOOP_TASK_RECORDER);
+        run_recorder_poll();
+        loop_metrics_task_end(LOOP_TASK_RECORDER);
+    }
+}
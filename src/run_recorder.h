@@ -0,0 +1,40 @@
+// src/run_recorder.h
+//
+// Gravador de execucoes. E mais uma consumidora do anel de telemetria: uma
+// tarefa de baixa prioridade esvazia o seu cursor periodicamente, codifica
+// os registros em blocos colunares (run_format.h) e so escreve no sistema de
+// arquivos blocos inteiros de RUN_BLOCK_SIZE bytes. A tarefa de controle
+// nunca espera pela gravacao; se o gravador atrasar mais que o anel, os
+// ciclos perdidos aparecem como buracos na numeracao dos ciclos do arquivo.
+//
+// Um arquivo novo e aberto quando a gravacao comeca, quando a planta,
+// a combinacao, o modo ou os ganhos mudam (para o cabecalho continuar
+// valido) e quando o arquivo chega a RUN_MAX_FILE_SIZE. Ficam no maximo
+// RUN_MAX_FILES arquivos; o mais antigo e apagado.
+
+#ifndef RUN_RECORDER_H
+#define RUN_RECORDER_H
+
+#include <stdint.h>
+#include "run_storage.h"
+
+const uint32_t RUN_MAX_FILE_SIZE = 128 * 1024;
+const int RUN_MAX_FILES = 8;
+const unsigned long RUN_RECORDER_PERIOD_MS = 1000;
+
+// Descobre a numeracao dos arquivos ja existentes. Chamar depois de montar
+// o sistema de arquivos.
+void run_recorder_init();
+
+// Pedidos de qualquer tarefa; aplicados no proximo run_recorder_poll()
+void run_recorder_request_start();
+void run_recorder_request_stop();
+bool run_recorder_is_recording();
+
+// Esvazia o cursor e grava os blocos completos. Chamado pela tarefa do
+// gravador ou, no simulador, direto pelo laco da simulacao.
+void run_recorder_poll();
+
+void run_recorder_task(void *parameters);
+
+#endif // RUN_RECORDER_H
@@ -0,0 +1,29 @@
+// src/run_storage.h
+//
+// Arquivos das execucoes gravadas. O run_recorder so fala com o sistema de
+// arquivos por aqui: no ESP32 os arquivos ficam no SPIFFS, em /runs
+// (run_storage_spiffs.cpp); no build nativo, em um diretorio do PC
+// (sim/run_storage_sim.cpp). Ha no maximo um arquivo aberto para escrita.
+
+#ifndef RUN_STORAGE_H
+#define RUN_STORAGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct {
+    char name[32];          // so o nome, sem diretorio (ex.: run_0003.bin)
+    uint32_t size;
+} RunFileInfo_t;
+
+// Cria (ou trunca) o arquivo e o deixa aberto para acrescentar dados
+bool run_storage_open(const char *name);
+bool run_storage_write(const uint8_t *data, size_t length);
+void run_storage_close();
+
+bool run_storage_remove(const char *name);
+
+// Lista ate max arquivos; retorna quantos encontrou
+int run_storage_list(RunFileInfo_t *out, int max);
+
+#endif // RUN_STORAGE_H
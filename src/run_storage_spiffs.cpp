@@ -0,0 +1,59 @@
+// src/run_storage_spiffs.cpp
+//
+// Implementacao do run_storage sobre o SPIFFS do ESP32.
+
+#include "run_storage.h"
+#include "config.h"
+
+#include <string.h>
+
+static const char RUN_DIR[] = "/runs";
+static File run_file;
+
+static void run_storage_path(const char *name, char *path, size_t size) {
+    snprintf(path, size, "%s/%s", RUN_DIR, name);
+}
+
+bool run_storage_open(const char *name) {
+    char path[48];
+    run_storage_path(name, path, sizeof(path));
+    if (run_file) run_file.close();
+    run_file = SPIFFS.open(path, FILE_WRITE);
+    return (bool)run_file;
+}
+
+bool run_storage_write(const uint8_t *data, size_t length) {
+    if (!run_file) return false;
+    return run_file.write(data, length) == length;
+}
+
+void run_storage_close() {
+    if (run_file) run_file.close();
+}
+
+bool run_storage_remove(const char *name) {
+    char path[48];
+    run_storage_path(name, path, sizeof(path));
+    return SPIFFS.remove(path);
+}
+
+int run_storage_list(RunFileInfo_t *out, int max) {
+    File dir = SPIFFS.open(RUN_DIR);
+    if (!dir) return 0;
+
+    int count = 0;
+    File entry = dir.openNextFile();
+    while (entry && count < max) {
+        // Dependendo da versao do core, name() traz o caminho completo
+        const char *name = entry.name();
+        const char *slash = strrchr(name, '/');
+        if (slash != NULL) name = slash + 1;
+
+        strncpy(out[count].name, name, sizeof(out[count].name) - 1);
+        out[count].name[sizeof(out[count].name) - 1] = '\0';
+        out[count].size = entry.size();
+        count++;
+        entry = dir.openNextFile();
+    }
+    return count;
+}
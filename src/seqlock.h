@@ -0,0 +1,78 @@
+// src/seqlock.h
+//
+// Seqlock de uma escritora e varias leitoras para copiar estruturas pequenas
+// entre tarefas sem bloquear a escritora. O conteudo e guardado em palavras de
+// 32 bits atomicas (relaxed), livres de lock no ESP32; o contador de
+// sequencia fica impar durante a escrita e a leitura se repete se cruzar uma.
+
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include "config.h"
+
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+#ifdef NATIVE_SIM
+#include <thread>
+#endif
+
+template <typename T>
+class Seqlock {
+public:
+    Seqlock() : seq_(0) {
+        for (int i = 0; i < WORDS; i++) words_[i].store(0, std::memory_order_relaxed);
+    }
+
+    // Somente uma escritora
+    void publish(const T &value) {
+        uint32_t words[WORDS];
+        memcpy(words, &value, sizeof(T));
+
+        uint32_t seq = seq_.load(std::memory_order_relaxed);
+        seq_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (int i = 0; i < WORDS; i++) {
+            words_[i].store(words[i], std::memory_order_relaxed);
+        }
+
+        seq_.store(seq + 2, std::memory_order_release);
+    }
+
+    void read(T *out) const {
+        uint32_t words[WORDS];
+        uint32_t before, after;
+        int attempts = 0;
+
+        do {
+            // Uma leitora de prioridade maior que interrompeu a escrita no
+            // mesmo nucleo precisa ceder a CPU para a escritora terminar
+            if (++attempts > SPINS_BEFORE_YIELD) {
+#ifdef NATIVE_SIM
+                std::this_thread::yield();
+#else
+                vTaskDelay(1);
+#endif
+            }
+            before = seq_.load(std::memory_order_acquire);
+            for (int i = 0; i < WORDS; i++) {
+                words[i] = words_[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = seq_.load(std::memory_order_relaxed);
+        } while ((before & 1) != 0 || before != after);
+
+        memcpy(out, words, sizeof(T));
+    }
+
+private:
+    static const int WORDS = sizeof(T) / sizeof(uint32_t);
+    static const int SPINS_BEFORE_YIELD = 8;
+    static_assert(sizeof(T) % sizeof(uint32_t) == 0, "tipo do seqlock deve ter tamanho multiplo de 32 bits");
+
+    std::atomic<uint32_t> seq_;
+    std::atomic<uint32_t> words_[WORDS];
+};
+
+#endif // SEQLOCK_H
@@ -3,26 +3,317 @@
 #include "setpoint.h"
 #include "config.h"
 
-void setpoint_generator_task(void *parameters) {
-    TickType_t xLastWakeTime = xTaskGetTickCount();
-    const TickType_t xFrequency = pdMS_TO_TICKS(100); // Executa a cada 100ms
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
-    for (;;) {
-        vTaskDelayUntil(&xLastWakeTime, xFrequency);
+static const double TWO_PI = 6.283185307179586;
 
-        unsigned long currentTime = millis();
-        double new_sp = g_systemState.sp;
+// Taps de realimentacao (forma de Galois) que dao periodo maximo 2^n - 1
+static const uint16_t PRBS_TAPS[SETPOINT_PRBS_MAX_ORDER + 1] = {
+    0, 0, 0x0003, 0x0006, 0x000C, 0x0014, 0x0030, 0x0060, 0x00B8,
+    0x0110, 0x0240, 0x0500, 0x0E08, 0x1C80, 0x3802, 0x6000, 0xD008,
+};
 
-        // mudança do setpoint baseada no tempo
-        if (currentTime >= (TIME_TO_DISCHARGE_MS + 5000) && currentTime < (TIME_TO_DISCHARGE_MS + 10000)) {
-            new_sp = 0.8 * ADC_RESOLUTION; // ateh 80 porcento
-        } else if (currentTime >= (TIME_TO_DISCHARGE_MS + 10000)) {
-            new_sp = 0.2 * ADC_RESOLUTION; // comeca 20 porcento
+uint16_t setpoint_prbs_taps(int order) {
+    if (order < SETPOINT_PRBS_MIN_ORDER || order > SETPOINT_PRBS_MAX_ORDER) return 0;
+    return PRBS_TAPS[order];
+}
+
+// --- Construcao ---
+
+static float setpoint_volts_to_counts(float v) {
+    if (v < 0) v = 0;
+    if (v > VCC) v = VCC;
+    return v / VCC * ADC_RESOLUTION;
+}
+
+// Duracao em amostras do periodo de controle (ao menos uma)
+static uint32_t setpoint_seconds_to_samples(float s) {
+    double samples = floor(s * 1000.0 / SAMPLE_TIME_MS + 0.5);
+    if (samples < 1) return 0;
+    if (samples > 0x7FFFFFFF) return 0;
+    return (uint32_t)samples;
+}
+
+static SetpointSegment_t *setpoint_profile_append(SetpointProfile_t *profile, uint8_t type, float duration_s) {
+    uint32_t samples = setpoint_seconds_to_samples(duration_s);
+    if (samples == 0 || profile->count >= SETPOINT_MAX_SEGMENTS) return NULL;
+    if (profile->total_samples + samples < profile->total_samples) return NULL;
+
+    SetpointSegment_t *seg = &profile->segments[profile->count];
+    memset(seg, 0, sizeof(*seg));
+    seg->type = type;
+    seg->samples = samples;
+    return seg;
+}
+
+static void setpoint_profile_commit(SetpointProfile_t *profile) {
+    profile->total_samples += profile->segments[profile->count].samples;
+    profile->count++;
+}
+
+void setpoint_profile_clear(SetpointProfile_t *profile) {
+    profile->count = 0;
+    profile->repeat = false;
+    profile->total_samples = 0;
+}
+
+bool setpoint_profile_add_hold(SetpointProfile_t *profile, float value_v, float duration_s) {
+    SetpointSegment_t *seg = setpoint_profile_append(profile, SETPOINT_HOLD, duration_s);
+    if (seg == NULL) return false;
+    seg->a = seg->b = setpoint_volts_to_counts(value_v);
+    setpoint_profile_commit(profile);
+    return true;
+}
+
+bool setpoint_profile_add_ramp(SetpointProfile_t *profile, float from_v, float to_v, float duration_s) {
+    SetpointSegment_t *seg = setpoint_profile_append(profile, SETPOINT_RAMP, duration_s);
+    if (seg == NULL) return false;
+    seg->a = setpoint_volts_to_counts(from_v);
+    seg->b = setpoint_volts_to_counts(to_v);
+    setpoint_profile_commit(profile);
+    return true;
+}
+
+// Chirp linear: fase(n) = 2.pi.(f0.n.Ts + k.(n.Ts)^2 / 2), com k = (f1 - f0) / T.
+// O passo de fase entre as amostras n e n+1 e w0 + n.dw, entao o player so
+// soma: nada de sin() de um argumento que cresce sem limite.
+bool setpoint_profile_add_sine(SetpointProfile_t *profile, float offset_v, float amplitude_v,
+                               float f0_hz, float f1_hz, float duration_s) {
+    const double ts = SAMPLE_TIME_S;
+    const double nyquist = 0.5 / ts;
+    if (f0_hz < 0 || f1_hz < 0 || f0_hz >= nyquist || f1_hz >= nyquist) return false;
+    if (amplitude_v < 0) return false;
+
+    SetpointSegment_t *seg = setpoint_profile_append(profile, SETPOINT_SINE, duration_s);
+    if (seg == NULL) return false;
+
+    // A senoide inteira cabe na faixa do ADC: o offset e limitado e a
+    // amplitude encolhe para caber
+    if (offset_v < 0) offset_v = 0;
+    if (offset_v > VCC) offset_v = VCC;
+    float max_amplitude = fminf(offset_v, VCC - offset_v);
+    if (amplitude_v > max_amplitude) amplitude_v = max_amplitude;
+
+    double k = ((double)f1_hz - f0_hz) / (seg->samples * ts);
+    seg->a = setpoint_volts_to_counts(offset_v);
+    seg->b = amplitude_v / VCC * ADC_RESOLUTION;
+    seg->w0 = 2.0 * M_PI * f0_hz * ts + M_PI * k * ts * ts;
+    seg->dw = 2.0 * M_PI * k * ts * ts;
+    setpoint_profile_commit(profile);
+    return true;
+}
+
+bool setpoint_profile_add_prbs(SetpointProfile_t *profile, float low_v, float high_v, float bit_s,
+                               int order, float duration_s) {
+    if (setpoint_prbs_taps(order) == 0) return false;
+    uint32_t bit_samples = setpoint_seconds_to_samples(bit_s);
+    if (bit_samples == 0 || bit_samples > 0xFFFF) return false;
+
+    SetpointSegment_t *seg = setpoint_profile_append(profile, SETPOINT_PRBS, duration_s);
+    if (seg == NULL) return false;
+    seg->order = (uint8_t)order;
+    seg->bit_samples = (uint16_t)bit_samples;
+    seg->a = setpoint_volts_to_counts(low_v);
+    seg->b = setpoint_volts_to_counts(high_v);
+    setpoint_profile_commit(profile);
+    return true;
+}
+
+// --- Texto ---
+
+static void setpoint_error(char *error, int error_size, int segment, const char *message) {
+    if (error == NULL || error_size <= 0) return;
+    if (segment > 0) snprintf(error, error_size, "segmento %d: %s", segment, message);
+    else snprintf(error, error_size, "%s", message);
+}
+
+// Le ate max numeros de um segmento; retorna quantos leu ou -1 se sobrou
+// algo que nao e numero
+static int setpoint_read_numbers(const char *p, const char *end, float *values, int max) {
+    int count = 0;
+    while (p < end) {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+        if (p >= end) break;
+        if (count >= max) return -1;
+        char *next;
+        values[count] = strtof(p, &next);
+        if (next == p || next > end) return -1;
+        count++;
+        p = next;
+    }
+    return count;
+}
+
+// "tabela t0:v0 t1:v1 ...": um degrau ate t0 (se t0 > 0) e uma rampa entre
+// cada par de pontos
+static bool setpoint_parse_table(const char *p, const char *end, SetpointProfile_t *profile) {
+    float last_t = 0, last_v = 0;
+    int points = 0;
+    while (p < end) {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+        if (p >= end) break;
+        char *next;
+        float t = strtof(p, &next);
+        if (next == p || next >= end || *next != ':') return false;
+        p = next + 1;
+        float v = strtof(p, &next);
+        if (next == p || next > end) return false;
+        p = next;
+
+        if (points == 0) {
+            if (t < 0) return false;
+            if (t > 0 && !setpoint_profile_add_hold(profile, v, t)) return false;
+        } else {
+            if (t <= last_t) return false;
+            bool ok = (v == last_v) ? setpoint_profile_add_hold(profile, v, t - last_t)
+                                    : setpoint_profile_add_ramp(profile, last_v, v, t - last_t);
+            if (!ok) return false;
         }
+        last_t = t;
+        last_v = v;
+        points++;
+    }
+    return points >= 2;
+}
+
+bool setpoint_profile_parse(const char *text, SetpointProfile_t *profile, char *error, int error_size) {
+    setpoint_profile_clear(profile);
+    if (error != NULL && error_size > 0) error[0] = '\0';
+
+    int segment = 0;
+    const char *p = text;
+    while (*p != '\0') {
+        const char *end = p;
+        while (*end != '\0' && *end != '\n' && *end != ';') end++;
+
+        const char *word = p;
+        while (word < end && (*word == ' ' || *word == '\t' || *word == '\r')) word++;
+        const char *word_end = word;
+        while (word_end < end && *word_end != ' ' && *word_end != '\t' && *word_end != '\r') word_end++;
+        size_t word_len = word_end - word;
+
+        if (word_len > 0) {
+            segment++;
+            float v[5];
+            int n = setpoint_read_numbers(word_end, end, v, 5);
+            bool ok;
+
+            if (word_len == 7 && strncmp(word, "repetir", 7) == 0) {
+                ok = n == 0;
+                profile->repeat = true;
+            } else if (word_len == 6 && strncmp(word, "degrau", 6) == 0) {
+                ok = n == 2 && setpoint_profile_add_hold(profile, v[0], v[1]);
+            } else if (word_len == 5 && strncmp(word, "rampa", 5) == 0) {
+                ok = n == 3 && setpoint_profile_add_ramp(profile, v[0], v[1], v[2]);
+            } else if (word_len == 4 && strncmp(word, "seno", 4) == 0) {
+                ok = n == 5 && setpoint_profile_add_sine(profile, v[0], v[1], v[2], v[3], v[4]);
+            } else if (word_len == 4 && strncmp(word, "prbs", 4) == 0) {
+                ok = n == 5 && v[3] == floorf(v[3]) &&
+                     setpoint_profile_add_prbs(profile, v[0], v[1], v[2], (int)v[3], v[4]);
+            } else if (word_len == 6 && strncmp(word, "tabela", 6) == 0) {
+                ok = setpoint_parse_table(word_end, end, profile);
+            } else {
+                setpoint_error(error, error_size, segment, "tipo desconhecido");
+                return false;
+            }
+
+            if (!ok) {
+                if (profile->count >= SETPOINT_MAX_SEGMENTS) {
+                    setpoint_error(error, error_size, segment, "segmentos demais");
+                } else {
+                    setpoint_error(error, error_size, segment, "parametros invalidos");
+                }
+                return false;
+            }
+        }
+
+        p = (*end == '\0') ? end : end + 1;
+    }
+
+    if (profile->count == 0) {
+        setpoint_error(error, error_size, 0, "perfil vazio");
+        return false;
+    }
+    return true;
+}
+
+// --- Reproducao ---
+
+static void setpoint_player_enter(SetpointPlayer_t *player, uint16_t segment) {
+    const SetpointSegment_t *seg = &player->profile->segments[segment];
+    player->segment = segment;
+    player->n = 0;
+    player->phase = 0;
+    player->w = seg->w0;
+    player->lfsr = 1;
+    player->bit_left = seg->bit_samples;
+}
+
+void setpoint_player_start(SetpointPlayer_t *player, const SetpointProfile_t *profile) {
+    memset(player, 0, sizeof(*player));
+    player->profile = profile;
+    if (profile == NULL || profile->count == 0) return;
+    player->active = true;
+    player->value = profile->segments[0].a;
+    setpoint_player_enter(player, 0);
+}
+
+bool setpoint_player_next(SetpointPlayer_t *player, float *sp) {
+    if (!player->active) return false;
+
+    // Perfil terminado: uma ultima amostra com o valor final
+    if (player->segment >= player->profile->count) {
+        player->active = false;
+        *sp = player->value;
+        return true;
+    }
+
+    const SetpointSegment_t *seg = &player->profile->segments[player->segment];
+    float value;
+    switch (seg->type) {
+    case SETPOINT_RAMP:
+        value = seg->a + (seg->b - seg->a) * ((float)player->n / (float)seg->samples);
+        break;
+    case SETPOINT_SINE:
+        value = seg->a + seg->b * sinf((float)player->phase);
+        player->phase += player->w;
+        if (player->phase >= TWO_PI) player->phase -= TWO_PI;
+        else if (player->phase < 0) player->phase += TWO_PI;
+        player->w += seg->dw;
+        break;
+    case SETPOINT_PRBS:
+        value = (player->lfsr & 1) ? seg->b : seg->a;
+        if (--player->bit_left == 0) {
+            player->bit_left = seg->bit_samples;
+            uint16_t lsb = player->lfsr & 1;
+            player->lfsr >>= 1;
+            if (lsb) player->lfsr ^= PRBS_TAPS[seg->order];
+        }
+        break;
+    default:
+        value = seg->a;
+        break;
+    }
+
+    player->value = value;
+    player->sample++;
+    *sp = value;
 
-        if (xSemaphoreTake(xStateMutex, portMAX_DELAY) == pdTRUE) {
-            g_systemState.sp = new_sp;
-            xSemaphoreGive(xStateMutex);
+    if (++player->n >= seg->samples) {
+        if (player->segment + 1 < player->profile->count) {
+            setpoint_player_enter(player, player->segment + 1);
+        } else if (player->profile->repeat) {
+            player->sample = 0;
+            setpoint_player_enter(player, 0);
+        } else {
+            // Fim: o setpoint fica onde o perfil terminou (numa rampa, no
+            // valor final dela)
+            if (seg->type == SETPOINT_RAMP) player->value = seg->b;
+            player->segment = player->profile->count;
         }
     }
-}
\ No newline at end of file
+    return true;
+}
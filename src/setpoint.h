@@ -1,8 +1,98 @@
 // src/setpoint.h
+//
+// Perfis de referencia (setpoint) ao longo do tempo. Um perfil em texto e
+// compilado uma vez em uma tabela compacta de segmentos, com as duracoes ja
+// em amostras do periodo de controle e os valores em contagens do ADC. A
+// tarefa de controle avanca o perfil uma amostra por ciclo
+// (setpoint_player_next), em O(1) e sem alocacao, entao o perfil anda no
+// mesmo relogio do controle e nunca escorrega em relacao a ele.
+//
+// Formato do texto: um segmento por linha (ou separados por ';'), tensoes em
+// volts e tempos em segundos:
+//
+//     degrau V T              constante V por T segundos
+//     rampa V0 V1 T           de V0 ate V1 em T segundos
+//     seno OFS AMP F0 F1 T    varredura senoidal (chirp linear) de F0 a F1 Hz
+//     prbs VMIN VMAX BIT N T  sequencia binaria pseudoaleatoria de ordem N
+//                             (periodo 2^N - 1 bits de BIT segundos)
+//     tabela t0:v0 t1:v1 ...  interpolacao linear entre os pontos
+//     repetir                 volta ao inicio ao terminar
+//
+// Sem "repetir", o setpoint fica no ultimo valor quando o perfil acaba.
 
 #ifndef SETPOINT_H
 #define SETPOINT_H
 
-void setpoint_generator_task(void *parameters);
+#include <stdint.h>
 
-#endif // SETPOINT_H
\ No newline at end of file
+const int SETPOINT_MAX_SEGMENTS = 32;
+// Maior texto de perfil aceito pelo comando "perfil" do WebSocket: 40
+// caracteres por segmento cobrem o seno com tres casas; com o resto do JSON
+// o quadro ainda cabe em um segmento TCP (MSS de 1436 bytes)
+const int SETPOINT_MAX_TEXT = SETPOINT_MAX_SEGMENTS * 40;
+const int SETPOINT_PRBS_MIN_ORDER = 2;
+const int SETPOINT_PRBS_MAX_ORDER = 16;
+
+typedef enum {
+    SETPOINT_HOLD = 0,
+    SETPOINT_RAMP,
+    SETPOINT_SINE,
+    SETPOINT_PRBS,
+} SetpointSegmentType_t;
+
+typedef struct {
+    uint8_t type;               // SetpointSegmentType_t
+    uint8_t order;              // PRBS: ordem do registrador
+    uint16_t bit_samples;       // PRBS: amostras por bit
+    uint32_t samples;           // duracao
+    float a, b;                 // degrau: a; rampa: a -> b; seno: offset a, amplitude b;
+                                // PRBS: niveis a (0) e b (1). Contagens do ADC.
+    double w0, dw;              // seno: passo de fase inicial (rad/amostra) e o seu incremento
+} SetpointSegment_t;
+
+typedef struct {
+    uint16_t count;
+    bool repeat;
+    uint32_t total_samples;
+    SetpointSegment_t segments[SETPOINT_MAX_SEGMENTS];
+} SetpointProfile_t;
+
+// Estado da reproducao. Copiado pela tarefa de controle, nunca compartilhado.
+typedef struct {
+    const SetpointProfile_t *profile;
+    bool active;
+    uint16_t segment;
+    uint32_t n;                 // amostra dentro do segmento
+    uint32_t sample;            // amostras desde o inicio do perfil
+    float value;                // ultimo valor produzido
+    double phase, w;            // seno: acumulados em double para a fase nao
+                                // escorregar ao longo de um chirp comprido
+    uint16_t lfsr;              // PRBS
+    uint16_t bit_left;
+} SetpointPlayer_t;
+
+// Compila o texto. Em caso de erro retorna false e escreve a mensagem em
+// error (se nao for NULL), indicando o segmento com problema.
+bool setpoint_profile_parse(const char *text, SetpointProfile_t *profile, char *error, int error_size);
+
+// Construcao direta (o parser usa estas); retornam false se o segmento for
+// invalido ou a tabela estiver cheia
+void setpoint_profile_clear(SetpointProfile_t *profile);
+bool setpoint_profile_add_hold(SetpointProfile_t *profile, float value_v, float duration_s);
+bool setpoint_profile_add_ramp(SetpointProfile_t *profile, float from_v, float to_v, float duration_s);
+bool setpoint_profile_add_sine(SetpointProfile_t *profile, float offset_v, float amplitude_v,
+                               float f0_hz, float f1_hz, float duration_s);
+bool setpoint_profile_add_prbs(SetpointProfile_t *profile, float low_v, float high_v, float bit_s,
+                               int order, float duration_s);
+
+// Comeca a reproduzir do inicio; sem segmentos o player fica inativo
+void setpoint_player_start(SetpointPlayer_t *player, const SetpointProfile_t *profile);
+
+// Setpoint da amostra atual (contagens do ADC) e avanca uma amostra.
+// Retorna false quando o player nao esta ativo (perfil terminado ou vazio).
+bool setpoint_player_next(SetpointPlayer_t *player, float *sp);
+
+// Realimentacao maxima (mascara de taps) do PRBS de ordem n, para testes
+uint16_t setpoint_prbs_taps(int order);
+
+#endif // SETPOINT_H
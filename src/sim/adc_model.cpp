@@ -0,0 +1,46 @@
+// src/sim/adc_model.cpp
+
+#include "adc_model.h"
+#include "config.h"
+
+void adc_model_init(AdcModel_t *adc, double noise_lsb, uint32_t seed) {
+    adc->v_min = 0.0;
+    adc->v_max = VCC;
+    adc->inl_lsb = 0.0;
+    adc->noise_lsb = noise_lsb;
+    adc->rng = seed ? seed : 0x9E3779B9u;
+}
+
+double sim_rand_uniform(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return (x + 0.5) / 4294967296.0; // (0, 1)
+}
+
+// Metodo polar de Marsaglia; o segundo valor de cada par nao e
+// reaproveitado para manter o gerador sem estado alem da semente
+double sim_rand_gauss(uint32_t *state) {
+    double u, v, s;
+    do {
+        u = 2.0 * sim_rand_uniform(state) - 1.0;
+        v = 2.0 * sim_rand_uniform(state) - 1.0;
+        s = u * u + v * v;
+    } while (s >= 1.0);
+    return u * sqrt(-2.0 * log(s) / s);
+}
+
+int adc_model_sample(AdcModel_t *adc, double voltage) {
+    double x = (voltage - adc->v_min) / (adc->v_max - adc->v_min);
+    double code = x * ADC_RESOLUTION;
+
+    if (x > 0.0 && x < 1.0) code += adc->inl_lsb * 4.0 * x * (1.0 - x);
+    if (adc->noise_lsb > 0) code += adc->noise_lsb * sim_rand_gauss(&adc->rng);
+
+    long raw = lround(code);
+    if (raw < 0) raw = 0;
+    if (raw > ADC_RESOLUTION) raw = ADC_RESOLUTION;
+    return (int)raw;
+}
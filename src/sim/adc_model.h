@@ -0,0 +1,26 @@
+// src/sim/adc_model.h
+//
+// Modelo do ADC SAR de 12 bits do ESP32: faixa util, curvatura (INL),
+// ruido gaussiano e quantizacao.
+
+#ifndef ADC_MODEL_H
+#define ADC_MODEL_H
+
+#include <stdint.h>
+
+typedef struct {
+    double v_min;       // tensao que le 0 (zona morta abaixo disso)
+    double v_max;       // tensao que le o fundo de escala (satura acima)
+    double inl_lsb;     // curvatura maxima no meio da escala, em LSB
+    double noise_lsb;   // desvio padrao do ruido, em LSB
+    uint32_t rng;       // estado do gerador xorshift32
+} AdcModel_t;
+
+void adc_model_init(AdcModel_t *adc, double noise_lsb, uint32_t seed);
+int adc_model_sample(AdcModel_t *adc, double voltage);
+
+// Gaussiana N(0,1) a partir do xorshift32
+double sim_rand_gauss(uint32_t *state);
+double sim_rand_uniform(uint32_t *state);
+
+#endif // ADC_MODEL_H
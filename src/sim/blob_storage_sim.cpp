@@ -0,0 +1,85 @@
+// src/sim/blob_storage_sim.cpp
+//
+// blob_storage no build nativo: os blobs ficam na memoria, entao cada
+// execucao do programa comeca como um ESP32 com o SPIFFS vazio. Cada blob
+// tem o arquivo e a copia temporaria, gravados na ordem do SPIFFS, para
+// simular um corte no meio (blob_storage_sim.h).
+
+#include "blob_storage.h"
+#include "blob_storage_sim.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static const int SIM_BLOBS = 4;
+static const size_t SIM_BLOB_CAPACITY = 1024;
+
+typedef struct {
+    uint8_t data[SIM_BLOB_CAPACITY];
+    size_t length;
+    bool exists;
+} SimFile_t;
+
+typedef struct {
+    char name[32];
+    SimFile_t file;
+    SimFile_t pending;          // nome.tmp
+} SimBlob_t;
+
+static SimBlob_t blobs[SIM_BLOBS];
+static int blob_count = 0;
+static BlobSimCut_t next_cut = BLOB_SIM_CUT_NONE;
+
+static SimBlob_t *blob_storage_find(const char *name) {
+    for (int i = 0; i < blob_count; i++) {
+        if (strcmp(blobs[i].name, name) == 0) return &blobs[i];
+    }
+    return NULL;
+}
+
+static bool blob_storage_copy(const SimFile_t *file, uint8_t *data, size_t capacity, size_t *length) {
+    if (!file->exists) return false;
+    *length = file->length < capacity ? file->length : capacity;
+    memcpy(data, file->data, *length);
+    return true;
+}
+
+bool blob_storage_read(const char *name, uint8_t *data, size_t capacity, size_t *length) {
+    SimBlob_t *blob = blob_storage_find(name);
+    return blob != NULL && blob_storage_copy(&blob->file, data, capacity, length);
+}
+
+bool blob_storage_read_pending(const char *name, uint8_t *data, size_t capacity, size_t *length) {
+    SimBlob_t *blob = blob_storage_find(name);
+    return blob != NULL && blob_storage_copy(&blob->pending, data, capacity, length);
+}
+
+void blob_storage_sim_cut_next_write(BlobSimCut_t cut) {
+    next_cut = cut;
+}
+
+bool blob_storage_write(const char *name, const uint8_t *data, size_t length) {
+    if (length > SIM_BLOB_CAPACITY) return false;
+    SimBlob_t *blob = blob_storage_find(name);
+    if (blob == NULL) {
+        if (blob_count == SIM_BLOBS) return false;
+        blob = &blobs[blob_count++];
+        memset(blob, 0, sizeof(*blob));
+        snprintf(blob->name, sizeof(blob->name), "%s", name);
+    }
+    BlobSimCut_t cut = next_cut;
+    next_cut = BLOB_SIM_CUT_NONE;
+
+    // Copia temporaria (so a metade, se o corte for durante a escrita)
+    blob->pending.length = cut == BLOB_SIM_CUT_WRITING ? length / 2 : length;
+    memcpy(blob->pending.data, data, blob->pending.length);
+    blob->pending.exists = true;
+    if (cut == BLOB_SIM_CUT_WRITING) return false;
+
+    // Apaga o antigo e renomeia a copia
+    blob->file.exists = false;
+    if (cut == BLOB_SIM_CUT_RENAME) return false;
+    blob->file = blob->pending;
+    blob->pending.exists = false;
+    return true;
+}
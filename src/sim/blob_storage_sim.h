@@ -0,0 +1,18 @@
+// src/sim/blob_storage_sim.h
+//
+// Cortes de energia simulados na proxima gravacao de um blob, nos dois
+// pontos em que o SPIFFS pode parar (ver blob_storage.h).
+
+#ifndef BLOB_STORAGE_SIM_H
+#define BLOB_STORAGE_SIM_H
+
+typedef enum {
+    BLOB_SIM_CUT_NONE = 0,
+    BLOB_SIM_CUT_WRITING,       // .tmp pela metade, arquivo antigo intacto
+    BLOB_SIM_CUT_RENAME,        // .tmp inteiro, arquivo antigo ja apagado
+} BlobSimCut_t;
+
+// Vale para a proxima blob_storage_write, que entao retorna false
+void blob_storage_sim_cut_next_write(BlobSimCut_t cut);
+
+#endif // BLOB_STORAGE_SIM_H
@@ -0,0 +1,124 @@
+// src/sim/cmd_autotune.cpp
+//
+// "autotune": faz o ensaio do rele em cada planta/combinacao pelo mesmo
+// caminho do ESP32 (control_loop_request_autotune) e compara, no laco
+// fechado com a referencia em onda quadrada, os ganhos de cada regra com
+// os ganhos padrao.
+
+#include "sim_commands.h"
+#include "sim_runner.h"
+#include "rc_plant.h"
+#include "control_loop.h"
+#include "state_snapshot.h"
+#include "autotune.h"
+#include "config.h"
+
+#include <stdio.h>
+
+typedef struct {
+    unsigned long start_ms;
+    double amplitude;
+    bool requested;
+    uint32_t start_seq;
+    AutotuneReport_t report;
+    bool finished;
+} AutotuneState_t;
+
+// Espera a planta acomodar no setpoint com o PID e so entao pede o ensaio
+static void autotune_on_cycle(void *ctx) {
+    AutotuneState_t *state = (AutotuneState_t *)ctx;
+    if (state->finished) return;
+
+    if (!state->requested) {
+        if (millis() < state->start_ms) return;
+        AutotuneReport_t report;
+        autotune_report_read(&report);
+        state->start_seq = report.seq;
+        control_loop_request_autotune(true, AUTOTUNE_RULE_ZN, state->amplitude);
+        state->requested = true;
+        return;
+    }
+
+    AutotuneReport_t report;
+    autotune_report_read(&report);
+    if (report.seq == state->start_seq) return;
+    if (report.status == AUTOTUNE_DONE || report.status == AUTOTUNE_FAILED) {
+        state->report = report;
+        state->finished = true;
+    }
+}
+
+static void autotune_print_result(const char *name, const SimRunResult_t *r, double kp, double ki, double kd) {
+    printf("    %-8s kp=%8.4f ki=%8.4f kd=%8.4f  IAE=%8.2f V.s  RMS=%.4f V  saturado=%6.1f s\n",
+           name, kp, ki, kd, r->iae, r->rms_error, r->saturated_s);
+}
+
+int sim_cmd_autotune(int argc, char **argv) {
+    int only_plant = (int)sim_arg_long(argc, argv, "--plant", 0);
+    int only_comb = (int)sim_arg_long(argc, argv, "--comb", -1);
+    double amplitude = sim_arg_double(argc, argv, "--amplitude", AUTOTUNE_DEFAULT_AMPLITUDE);
+    double warmup_s = sim_arg_double(argc, argv, "--warmup", 120.0);
+    double eval_s = sim_arg_double(argc, argv, "--minutes", 20.0) * 60.0;
+
+    Serial.set_enabled(sim_arg_flag(argc, argv, "--verbose"));
+
+    int failures = 0;
+    for (int plant = 1; plant <= 2; plant++) {
+        if (only_plant != 0 && plant != only_plant) continue;
+        for (int comb = 0; comb < rc_network_count(plant); comb++) {
+            if (only_comb >= 0 && comb != only_comb) continue;
+
+            // Ensaio com o setpoint fixo no meio da faixa. O ensaio termina
+            // sozinho antes do fim da simulacao (AUTOTUNE_TIMEOUT_S).
+            SimRunConfig_t cfg;
+            sim_run_default_config(&cfg);
+            cfg.plant_id = plant;
+            cfg.combination = comb;
+            cfg.sp_low_v = cfg.sp_high_v = 0.5 * VCC;
+            cfg.duration_s = warmup_s + AUTOTUNE_TIMEOUT_S + 10.0;
+
+            AutotuneState_t state = {};
+            state.start_ms = (unsigned long)(warmup_s * 1000.0);
+            state.amplitude = amplitude;
+            cfg.on_cycle = autotune_on_cycle;
+            cfg.on_cycle_ctx = &state;
+
+            SimRunResult_t result;
+            sim_run_closed_loop(&cfg, &result);
+
+            printf("planta %d, combinacao %d: ", plant, comb);
+            if (!state.finished || state.report.status != AUTOTUNE_DONE) {
+                printf("ensaio falhou\n");
+                failures++;
+                continue;
+            }
+            const AutotuneReport_t *r = &state.report;
+            printf("Ku=%.4f Pu=%.2f s K=%.4f\n", r->ku, r->pu, r->plant_gain);
+
+            // Avaliacao: mesma referencia em onda quadrada do comando "run"
+            SimRunConfig_t eval;
+            sim_run_default_config(&eval);
+            eval.plant_id = plant;
+            eval.combination = comb;
+            eval.duration_s = eval_s;
+
+            sim_run_closed_loop(&eval, &result);
+            autotune_print_result("padrao", &result, eval.kp, eval.ki, eval.kd);
+
+            for (int rule = AUTOTUNE_RULE_ZN; rule <= AUTOTUNE_RULE_SIMC; rule++) {
+                AutotuneGains_t gains;
+                const char *name = autotune_rule_name((AutotuneRule_t)rule);
+                if (!autotune_compute_gains(r->ku, r->pu, r->plant_gain, (AutotuneRule_t)rule, &gains)) {
+                    printf("    %-8s sem ganhos (modelo invalido)\n", name);
+                    continue;
+                }
+                eval.kp = gains.kp;
+                eval.ki = gains.ki;
+                eval.kd = gains.kd;
+                sim_run_closed_loop(&eval, &result);
+                autotune_print_result(name, &result, eval.kp, eval.ki, eval.kd);
+            }
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
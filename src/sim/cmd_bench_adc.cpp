@@ -0,0 +1,210 @@
+// src/sim/cmd_bench_adc.cpp
+//
+// "bench-adc": alimenta o caminho de aquisicao (buffer + decimacao +
+// calibracao) com uma fonte sintetica (senoide lenta passando pelo modelo do
+// ADC com ruido, INL e picos esporadicos) e compara cada filtro com o valor
+// verdadeiro. Mede tambem a vazao do produtor e o custo de cada leitura.
+
+#include "sim_commands.h"
+#include "adc_model.h"
+#include "adc_acquisition.h"
+#include "adc_calibration.h"
+#include "config.h"
+#include "mux.h"
+#include "sim_engine.h"
+#include "blob_storage_sim.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+// Tabela que desfaz a curvatura do modelo: para cada codigo bruto da grade,
+// acha a tensao x (0-1) com x*FS + inl*4x(1-x) = codigo
+static void bench_adc_build_table(double inl_lsb, float *table) {
+    for (int i = 0; i < ADC_CAL_POINTS; i++) {
+        double code = i * ADC_CAL_STEP;
+        double x = code / ADC_RESOLUTION;
+        for (int it = 0; it < 8; it++) {
+            x = (code - inl_lsb * 4.0 * x * (1.0 - x)) / ADC_RESOLUTION;
+        }
+        table[i] = (float)(x * ADC_RESOLUTION);
+    }
+}
+
+typedef struct {
+    double rms;
+    double ns_per_read;
+} BenchAdcResult_t;
+
+static BenchAdcResult_t bench_adc_mode(AdcDecimation_t mode, bool calibrated, double inl_lsb,
+                                       double noise_lsb, double spike_rate, long ticks,
+                                       double *push_rate) {
+    AdcModel_t adc;
+    adc_model_init(&adc, noise_lsb, 42);
+    adc.inl_lsb = inl_lsb;
+    uint32_t spike_rng = 7;
+
+    AdcCalibration_t calibration;
+    adc_calibration_identity(&calibration);
+    if (calibrated) bench_adc_build_table(inl_lsb, calibration.corrected[0]);
+    adc_calibration_set(&calibration);
+
+    adc_acquisition_init();
+    adc_acquisition_set_mode(mode);
+
+    const int per_tick = (int)(SAMPLE_TIME_MS / ADC_ACQ_PERIOD_MS) * ADC_ACQ_BURST;
+    const double dt = ADC_ACQ_PERIOD_MS * 1e-3 / ADC_ACQ_BURST;
+    std::vector<uint16_t> block(per_tick);
+    double sum_sq = 0, t = 0;
+    std::chrono::duration<double> push_time(0), read_time(0);
+
+    for (long k = 0; k < ticks; k++) {
+        // Gera as amostras do periodo antes de medir o produtor
+        for (int i = 0; i < per_tick; i++, t += dt) {
+            double v = VCC * (0.5 + 0.4 * sin(2 * M_PI * 0.05 * t));
+            int raw = adc_model_sample(&adc, v);
+            if (sim_rand_uniform(&spike_rng) < spike_rate) {
+                raw += (sim_rand_uniform(&spike_rng) < 0.5) ? -400 : 400;
+                raw = raw < 0 ? 0 : (raw > ADC_RESOLUTION ? ADC_RESOLUTION : raw);
+            }
+            block[i] = (uint16_t)raw;
+        }
+
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < per_tick; i++) adc_acquisition_push(1, block[i], mux_generation());
+        auto t1 = std::chrono::steady_clock::now();
+        float y = adc_acquisition_read(1);
+        auto t2 = std::chrono::steady_clock::now();
+        push_time += t1 - t0;
+        read_time += t2 - t1;
+
+        double truth = (0.5 + 0.4 * sin(2 * M_PI * 0.05 * t)) * ADC_RESOLUTION;
+        sum_sq += (y - truth) * (y - truth);
+    }
+
+    adc_calibration_identity(&calibration);
+    adc_calibration_set(&calibration);
+    *push_rate = (double)per_tick * ticks / push_time.count();
+
+    BenchAdcResult_t r;
+    r.rms = sqrt(sum_sq / ticks);
+    r.ns_per_read = read_time.count() * 1e9 / ticks;
+    return r;
+}
+
+// Calibracao pelo caminho do firmware: a tabela trocada (revisao nova) e
+// gravada por adc_calibration_persist, volta por adc_calibration_load e a
+// leitura de cada planta usa a tabela do seu canal. Gravacoes cortadas e
+// tabelas invalidas seguem as regras do blob de ganhos.
+static bool bench_adc_check_storage(double inl_lsb) {
+    AdcCalibration_t saved, loaded, newer;
+    adc_calibration_identity(&saved);
+    bench_adc_build_table(inl_lsb, saved.corrected[0]);
+    bench_adc_build_table(-inl_lsb, saved.corrected[1]);
+    saved.revision = 1;
+    adc_calibration_set(&saved);
+    adc_calibration_persist();
+
+    bool ok = adc_calibration_load(&loaded) && memcmp(loaded.corrected, saved.corrected, sizeof(saved.corrected)) == 0;
+    adc_calibration_set(&loaded);
+    adc_acquisition_init();
+    adc_acquisition_set_mode(ADC_DECIMATE_MEAN);
+    for (int k = 1; k < ADC_CAL_POINTS - 1; k++) {
+        uint16_t raw = (uint16_t)(k * ADC_CAL_STEP);
+        adc_acquisition_push(1, raw, mux_generation());
+        adc_acquisition_push(2, raw, mux_generation());
+        ok = ok && adc_acquisition_read(1) == saved.corrected[0][k] && adc_acquisition_read(2) == saved.corrected[1][k];
+    }
+    printf("Calibracao gravada e lida de volta, um canal por planta: %s\n", ok ? "ok" : "FALHOU");
+
+    newer = saved;
+    newer.corrected[0][8] += 1.0f;
+    blob_storage_sim_cut_next_write(BLOB_SIM_CUT_RENAME);
+    adc_calibration_save(&newer);
+    bool rename_ok = adc_calibration_load(&loaded) && loaded.corrected[0][8] == newer.corrected[0][8];
+    adc_calibration_save(&saved);
+    blob_storage_sim_cut_next_write(BLOB_SIM_CUT_WRITING);
+    adc_calibration_save(&newer);
+    bool writing_ok = adc_calibration_load(&loaded) && loaded.corrected[0][8] == saved.corrected[0][8];
+
+    uint8_t blob[ADC_CAL_BLOB_SIZE];
+    AdcCalibration_t bad = saved;
+    bad.corrected[1][3] = bad.corrected[1][2];
+    bool flat_rejected = !adc_calibration_decode(blob, adc_calibration_encode(&bad, blob), &loaded);
+    adc_calibration_encode(&saved, blob);
+    blob[20] ^= 0x01;
+    bool crc_rejected = !adc_calibration_decode(blob, sizeof(blob), &loaded);
+    printf("Cortes na gravacao (%s, %s), tabela sem subir e CRC errado recusados (%s, %s)\n",
+           rename_ok ? "copia temporaria lida" : "TABELA PERDIDA", writing_ok ? "arquivo anterior lido" : "ERRADO",
+           flat_rejected ? "sim" : "NAO", crc_rejected ? "sim" : "NAO");
+
+    adc_calibration_identity(&saved);
+    adc_calibration_set(&saved);
+    return ok && rename_ok && writing_ok && flat_rejected && crc_rejected;
+}
+
+// Troca do MUX com o produtor preemptado no meio de uma rajada: ele leu a
+// geracao antes da troca e so termina de escrever depois dela. Essas
+// amostras (1000) nao podem entrar na leitura da rede nova (3000), em
+// nenhum filtro; antes da primeira amostra nova vale a leitura direta.
+static bool bench_adc_check_switch() {
+    const uint16_t OLD_RAW = 1000, NEW_RAW = 3000;
+    sim_engine_reset(NULL);
+    mux_init();
+    mux_select_plant(1, 0);
+    bool ok = true;
+    for (int m = ADC_DECIMATE_MEAN; m <= ADC_DECIMATE_BOXCAR; m++) {
+        adc_acquisition_init();
+        adc_acquisition_set_mode((AdcDecimation_t)m);
+        uint32_t old_generation = mux_generation();
+        for (int i = 0; i < 64; i++) adc_acquisition_push(1, OLD_RAW, old_generation);
+        adc_acquisition_read(1);
+
+        // Rede nova em NEW_RAW; o produtor ainda escreve a rajada antiga
+        mux_select_plant(1, (m % 2) ? 0 : 3);
+        sim_engine_set_plant_voltage(1, NEW_RAW * VCC / ADC_RESOLUTION);
+        adc_acquisition_mux_switched();
+        for (int i = 0; i < ADC_ACQ_BURST; i++) adc_acquisition_push(1, OLD_RAW, old_generation);
+        float direct = adc_acquisition_read(1);
+
+        for (int i = 0; i < 8; i++) adc_acquisition_push(1, NEW_RAW, mux_generation());
+        for (int i = 0; i < ADC_ACQ_BURST; i++) adc_acquisition_push(1, OLD_RAW, old_generation);
+        float decimated = adc_acquisition_read(1);
+
+        bool mode_ok = fabsf(direct - NEW_RAW) < 60.0f && decimated == NEW_RAW;
+        if (!mode_ok) {
+            printf("  filtro %d: leitura direta %.1f, decimada %.1f (esperado %u)\n", m, direct, decimated, NEW_RAW);
+        }
+        ok = ok && mode_ok;
+    }
+    printf("troca do MUX com produtor atrasado: amostras da rede anterior descartadas  %s\n", ok ? "ok" : "FALHOU");
+    return ok;
+}
+
+int sim_cmd_bench_adc(int argc, char **argv) {
+    double inl = sim_arg_double(argc, argv, "--inl", 40.0);
+    double noise = sim_arg_double(argc, argv, "--noise", 8.0);
+    double spikes = sim_arg_double(argc, argv, "--spikes", 0.005);
+    long ticks = sim_arg_long(argc, argv, "--ticks", 20000);
+
+    static const char *MODE_NAMES[] = {"media", "mediana", "boxcar"};
+
+    printf("fonte sintetica: INL %.0f LSB, ruido %.1f LSB, picos %.2f%% | %d amostras/tick\n",
+           inl, noise, spikes * 100, (int)(SAMPLE_TIME_MS / ADC_ACQ_PERIOD_MS) * ADC_ACQ_BURST);
+    printf("%-8s %-10s %12s %14s %14s\n", "filtro", "calibracao", "RMS (LSB)", "leitura (ns)", "produtor (M/s)");
+
+    for (int m = ADC_DECIMATE_MEAN; m <= ADC_DECIMATE_BOXCAR; m++) {
+        for (int cal = 0; cal <= 1; cal++) {
+            double push_rate;
+            BenchAdcResult_t r = bench_adc_mode((AdcDecimation_t)m, cal != 0, inl, noise, spikes,
+                                                ticks, &push_rate);
+            printf("%-8s %-10s %12.2f %14.1f %14.1f\n", MODE_NAMES[m], cal ? "tabela" : "nenhuma",
+                   r.rms, r.ns_per_read, push_rate / 1e6);
+        }
+    }
+    bool storage_ok = bench_adc_check_storage(inl);
+    bool switch_ok = bench_adc_check_switch();
+    return storage_ok && switch_ok ? 0 : 1;
+}
@@ -0,0 +1,73 @@
+// src/sim/cmd_bench_bank.cpp
+//
+// "bench-bank": quantas malhas virtuais o banco de controladores atualiza
+// dentro de um tick. Cada malha tem sua propria planta de 1a ordem discreta
+// (constantes de tempo espalhadas), atualizada junto com o banco.
+
+#include "sim_commands.h"
+#include "controller_bank.h"
+#include "controller_engine.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <chrono>
+#include <memory>
+
+static const int BENCH_BANK_CAPACITY = 262144;
+
+int sim_cmd_bench_bank(int argc, char **argv) {
+    double budget_us = sim_arg_double(argc, argv, "--budget-us", 1000.0);
+    long ticks = sim_arg_long(argc, argv, "--ticks", 2000);
+
+    std::unique_ptr<ControllerBank<BENCH_BANK_CAPACITY>> bank(new ControllerBank<BENCH_BANK_CAPACITY>());
+    std::unique_ptr<float[]> plant_a(new float[BENCH_BANK_CAPACITY]);
+    std::unique_ptr<float[]> plant_v(new float[BENCH_BANK_CAPACITY]);
+
+    // Planta discreta: v += a * (ganho * u - v), com ganho ADC/DAC
+    constexpr float dac_to_adc = (float)ADC_RESOLUTION / DAC_RESOLUTION;
+    constexpr double ts = SAMPLE_TIME_S;
+
+    printf("orcamento por tick: %.0f us | %ld ticks por medida\n", budget_us, ticks);
+    printf("%8s %12s %12s %12s %10s\n", "malhas", "banco(us)", "total(us)", "ns/malha", "IAE medio");
+
+    int best = 0;
+    for (int n = 2; n <= BENCH_BANK_CAPACITY; n *= 2) {
+        controller_bank_init(bank.get(), n);
+        for (int i = 0; i < n; i++) {
+            double tau = 1.0 + 9.0 * i / n;
+            plant_a[i] = (float)(1.0 - exp(-ts / tau));
+            plant_v[i] = 0;
+            bank->sp[i] = (i & 1) ? 0.8f * ADC_RESOLUTION : 0.2f * ADC_RESOLUTION;
+            controller_scale_tunings(bank->kp[i], bank->ki[i], bank->kd[i], 0.05, 0.1, 0.0);
+        }
+
+        std::chrono::duration<double> bank_time(0), total_time(0);
+        for (long k = 0; k < ticks; k++) {
+            auto t0 = std::chrono::steady_clock::now();
+            for (int i = 0; i < n; i++) bank->y[i] = plant_v[i];
+            auto t1 = std::chrono::steady_clock::now();
+            controller_bank_compute(bank.get());
+            auto t2 = std::chrono::steady_clock::now();
+            for (int i = 0; i < n; i++) {
+                float target = floorf(bank->u[i]) * dac_to_adc;
+                plant_v[i] += plant_a[i] * (target - plant_v[i]);
+            }
+            auto t3 = std::chrono::steady_clock::now();
+            bank_time += t2 - t1;
+            total_time += t3 - t0;
+        }
+
+        double bank_us = bank_time.count() * 1e6 / ticks;
+        double total_us = total_time.count() * 1e6 / ticks;
+        double iae = 0;
+        for (int i = 0; i < n; i++) iae += bank->iae[i];
+
+        printf("%8d %12.3f %12.3f %12.2f %10.1f\n", n, bank_us, total_us,
+               bank_us * 1000.0 / n, iae / n);
+        if (total_us > budget_us) break;
+        best = n;
+    }
+
+    printf("maior banco testado dentro de %.0f us: %d malhas\n", budget_us, best);
+    return 0;
+}
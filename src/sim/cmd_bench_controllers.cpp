@@ -0,0 +1,219 @@
+// src/sim/cmd_bench_controllers.cpp
+//
+// "bench-controllers": custo por ciclo de cada controlador de
+// controller_engine.h, chamado direto pela interface CRTP e pelo despacho
+// do ControllerEngine_t, contra o periodo de amostragem; e o desempenho de
+// cada um em laco fechado nas redes simuladas. O MPC usa o modelo que a
+// identificacao em linha levantou com o PRBS nos primeiros minutos, pelo
+// mesmo caminho do ESP32 (control_loop_request_controller).
+
+#include "sim_commands.h"
+#include "sim_runner.h"
+#include "sim_engine.h"
+#include "rc_plant.h"
+#include "control_loop.h"
+#include "controller_engine.h"
+#include "identification.h"
+#include "state_snapshot.h"
+#include "config.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+
+// Medicoes ruidosas em torno do setpoint, as mesmas para todos
+static void bench_samples(std::vector<float> &ys) {
+    uint32_t seed = 12345;
+    for (size_t i = 0; i < ys.size(); i++) {
+        seed = seed * 1664525u + 1013904223u;
+        ys[i] = 2048.0f + 600.0f * sinf(i * 0.01f) + (float)(seed >> 24) - 128.0f;
+    }
+}
+
+static void bench_state(SystemState_t *s) {
+    s->sp = 2048.0f;
+    s->y = 2048.0f;
+    s->u = 128.0f;
+    s->iTerm = 128.0f;
+    s->lastY = 2048.0f;
+    s->kp = 0.05f;
+    s->ki = 0.1f * (float)SAMPLE_TIME_S;
+    s->kd = 0.01f / (float)SAMPLE_TIME_S;
+    s->active_plant = 2;
+    s->mux_combination = 0;
+}
+
+// Modelo da P2/C0 discretizado (polos e ganho do circuito), em contagens
+static void bench_model(ControllerModel_t *m) {
+    double tau1, tau2;
+    rc_network_time_constants(rc_network_for(2, 0), &tau1, &tau2);
+    double ts = SAMPLE_TIME_S;
+    double p1 = exp(-ts / tau1), p2 = exp(-ts / tau2);
+    double k = (double)ADC_RESOLUTION / DAC_RESOLUTION;
+    m->a[0] = (float)(p1 + p2);
+    m->a[1] = (float)(-p1 * p2);
+    m->b[0] = (float)(0.5 * k * (1 - p1) * (1 - p2));
+    m->b[1] = m->b[0];
+}
+
+// Pela interface CRTP: o tipo concreto e conhecido e compute() e expandido
+template <typename C>
+static double bench_direct(Controller<C> &controller, const std::vector<float> &ys, long iterations) {
+    SystemState_t s;
+    bench_state(&s);
+    controller.reset(&s);
+    const size_t n = ys.size();
+    float acc = 0.0f;
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; i++) {
+        s.y = ys[(size_t)i % n];
+        s.u = controller.compute(&s);
+        acc += s.u;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    volatile float sink = acc;
+    (void)sink;
+    return elapsed.count() * 1e9 / iterations;
+}
+
+// Pelo despacho do ciclo (switch no tipo)
+static double bench_engine(ControllerEngine_t *engine, const std::vector<float> &ys, long iterations) {
+    SystemState_t s;
+    bench_state(&s);
+    controller_engine_reset(engine, &s);
+    const size_t n = ys.size();
+    float acc = 0.0f;
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; i++) {
+        s.y = ys[(size_t)i % n];
+        s.u = controller_engine_compute(engine, &s);
+        acc += s.u;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    volatile float sink = acc;
+    (void)sink;
+    return elapsed.count() * 1e9 / iterations;
+}
+
+static double bench_set_model(LoopMpc_t *mpc, const ControllerModel_t *model, long iterations) {
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; i++) mpc->set_model(model, MPC_DEFAULT_WEIGHT + (i & 1) * 1e-6f);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() * 1e9 / iterations;
+}
+
+typedef struct {
+    int plant_id;
+    int kind;                   // controlador avaliado depois do aquecimento
+    double weight;
+    double excitation;
+    unsigned long switch_ms;    // fim da identificacao, troca de controlador
+    int stage;
+    bool accepted;
+    int final_kind;
+    double iae, sq, n;          // a partir da troca (V.s, V^2, amostras)
+} ControllerRun_t;
+
+static void controllers_on_cycle(void *ctx) {
+    ControllerRun_t *run = (ControllerRun_t *)ctx;
+    unsigned long now = millis();
+    if (run->stage == 0) {
+        control_loop_request_identification(run->excitation, IDENT_ACTION_NONE);
+        run->stage = 1;
+        return;
+    }
+    if (run->stage == 1) {
+        if (now < run->switch_ms) return;
+        control_loop_request_identification(0.0, IDENT_ACTION_NONE);
+        control_loop_request_controller(run->kind, run->weight);
+        run->stage = 2;
+        return;
+    }
+
+    StateSnapshot_t state;
+    state_snapshot_read(&state);
+    if (run->stage == 2) {
+        run->accepted = state.controller == run->kind;
+        run->stage = 3;
+    }
+    run->final_kind = state.controller;
+    double err = state.sp * VCC / ADC_RESOLUTION - sim_engine_plant_voltage(run->plant_id);
+    run->iae += fabs(err) * SAMPLE_TIME_S;
+    run->sq += err * err;
+    run->n += 1;
+}
+
+int sim_cmd_bench_controllers(int argc, char **argv) {
+    long iterations = sim_arg_long(argc, argv, "--iterations", 5000000);
+    double warmup_s = sim_arg_double(argc, argv, "--warmup", 180.0);
+    double eval_s = sim_arg_double(argc, argv, "--minutes", 10.0) * 60.0;
+    double weight = sim_arg_double(argc, argv, "--weight", MPC_DEFAULT_WEIGHT);
+    double excitation = sim_arg_double(argc, argv, "--excitation", 20.0);
+
+    std::vector<float> ys(4096);
+    bench_samples(ys);
+    ControllerModel_t model;
+    bench_model(&model);
+
+    PidController pid;
+    LoopMpc_t mpc;
+    mpc.set_model(&model, MPC_DEFAULT_WEIGHT);
+    ControllerEngine_t engine;
+    engine.mpc = mpc;
+
+    double period_ns = CONTROL_PERIOD_US * 1e3;
+    printf("custo por ciclo (%ld iteracoes, periodo de %lu ms)\n", iterations, (unsigned long)SAMPLE_TIME_MS);
+    printf("  %-28s %10s %14s\n", "controlador", "ns", "% do periodo");
+    struct {
+        const char *name;
+        double ns;
+    } rows[5];
+    rows[0] = {"pid (CRTP direto)", bench_direct(pid, ys, iterations)};
+    rows[1] = {"mpc (CRTP direto)", bench_direct(mpc, ys, iterations)};
+    engine.kind = CONTROLLER_PID;
+    rows[2] = {"pid (despacho do engine)", bench_engine(&engine, ys, iterations)};
+    engine.kind = CONTROLLER_MPC;
+    rows[3] = {"mpc (despacho do engine)", bench_engine(&engine, ys, iterations)};
+    rows[4] = {"mpc set_model (por modelo)", bench_set_model(&mpc, &model, iterations / 100)};
+    for (int i = 0; i < 5; i++) {
+        printf("  %-28s %10.1f %13.5f%%\n", rows[i].name, rows[i].ns, rows[i].ns / period_ns * 100.0);
+    }
+
+    // Laco fechado: identificacao com PRBS e PID durante o aquecimento,
+    // depois cada controlador sozinho com a referencia em onda quadrada
+    Serial.set_enabled(sim_arg_flag(argc, argv, "--verbose"));
+    printf("\nlaco fechado (%.0f s de identificacao, %.0f s avaliados, peso do MPC %.3f)\n", warmup_s, eval_s, weight);
+    printf("  %-34s %12s %12s %12s %12s\n", "rede", "IAE pid", "IAE mpc", "RMS pid", "RMS mpc");
+    int failures = 0;
+    for (int plant = 1; plant <= 2; plant++) {
+        for (int comb = 0; comb < rc_network_count(plant); comb++) {
+            ControllerRun_t runs[CONTROLLER_KIND_COUNT];
+            for (int kind = 0; kind < CONTROLLER_KIND_COUNT; kind++) {
+                SimRunConfig_t cfg;
+                sim_run_default_config(&cfg);
+                cfg.plant_id = plant;
+                cfg.combination = comb;
+                cfg.duration_s = warmup_s + eval_s;
+                ControllerRun_t *run = &runs[kind];
+                *run = ControllerRun_t();
+                run->plant_id = plant;
+                run->kind = kind;
+                run->weight = weight;
+                run->excitation = excitation;
+                run->switch_ms = (unsigned long)(warmup_s * 1000.0);
+                cfg.on_cycle = controllers_on_cycle;
+                cfg.on_cycle_ctx = run;
+
+                SimRunResult_t result;
+                sim_run_closed_loop(&cfg, &result);
+                if (!run->accepted || run->final_kind != kind) failures++;
+            }
+            const ControllerRun_t *p = &runs[CONTROLLER_PID], *m = &runs[CONTROLLER_MPC];
+            printf("  %-34s %12.2f %12.2f %12.4f %12.4f%s\n", rc_network_for(plant, comb)->name, p->iae, m->iae,
+                   sqrt(p->sq / p->n), sqrt(m->sq / m->n), m->accepted ? "" : "  (mpc recusado)");
+        }
+    }
+    printf("%s\n", failures == 0 ? "controladores ok" : "controladores FALHOU");
+    return failures == 0 ? 0 : 1;
+}
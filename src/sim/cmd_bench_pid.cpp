@@ -0,0 +1,174 @@
+// src/sim/cmd_bench_pid.cpp
+//
+// "bench-pid": custo por compute() de cada variante do kernel do PID
+// (double de referencia, float, Q16.16) e equivalencia das variantes em laco
+// fechado contra as plantas simuladas.
+
+#include "sim_commands.h"
+#include "sim_engine.h"
+#include "rc_plant.h"
+#include "pid_kernel.h"
+#include "mux.h"
+#include "plant.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAS_TSC 1
+#endif
+
+// Conversoes de/para double para os tres tipos
+template <typename T> inline T bench_from(double v) { return T(v); }
+template <typename T> inline double bench_to(T v) { return (double)v; }
+template <> inline double bench_to<Q16_16>(Q16_16 v) { return v.to_double(); }
+
+typedef struct {
+    double ns_per_call;
+    double cycles_per_call;     // 0 se nao houver TSC
+} BenchTiming_t;
+
+template <typename T>
+static BenchTiming_t bench_kernel(const std::vector<double> &samples, long iterations) {
+    std::vector<T> ys(samples.size());
+    for (size_t i = 0; i < samples.size(); i++) ys[i] = bench_from<T>(samples[i]);
+
+    const T sp = bench_from<T>(2048.0);
+    const T kp = bench_from<T>(0.05), ki = bench_from<T>(0.02), kd = bench_from<T>(0.01);
+    T iTerm = T(0), lastY = T(0), dTerm = T(0), acc = T(0);
+    const size_t n = ys.size();
+
+    auto start = std::chrono::steady_clock::now();
+#ifdef BENCH_HAS_TSC
+    unsigned long long tsc_start = __rdtsc();
+#endif
+    for (long i = 0; i < iterations; i++) {
+        acc += pid_kernel_compute<T>(sp, ys[(size_t)i % n], iTerm, lastY, dTerm, kp, ki, kd);
+    }
+#ifdef BENCH_HAS_TSC
+    unsigned long long tsc_end = __rdtsc();
+#endif
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    // Impede que o compilador descarte o laco
+    volatile double sink = bench_to<T>(acc);
+    (void)sink;
+
+    BenchTiming_t t;
+    t.ns_per_call = elapsed.count() * 1e9 / iterations;
+#ifdef BENCH_HAS_TSC
+    t.cycles_per_call = (double)(tsc_end - tsc_start) / iterations;
+#else
+    t.cycles_per_call = 0;
+#endif
+    return t;
+}
+
+// Laco fechado direto sobre a HAL simulada, com o kernel do tipo T
+template <typename T>
+static void bench_closed_loop(int plant_id, int combination, double seconds,
+                              std::vector<double> &y_out, double *iae) {
+    SimEngineConfig_t cfg;
+    sim_engine_default_config(&cfg);
+    sim_engine_reset(&cfg);
+    mux_init();
+    plant_init();
+
+    constexpr double ts = SAMPLE_TIME_S;
+    const T kp = bench_from<T>(0.05), ki = bench_from<T>(0.1 * ts), kd = bench_from<T>(0.01 / ts);
+    T iTerm = T(0), lastY = T(0), dTerm = T(0);
+    const long cycles = (long)(seconds / ts);
+
+    y_out.clear();
+    *iae = 0;
+    for (long k = 0; k < cycles; k++) {
+        sim_engine_advance_to_us((uint64_t)k * CONTROL_PERIOD_US);
+        double sp = (fmod(k * ts, 60.0) < 30.0) ? 0.8 * ADC_RESOLUTION : 0.2 * ADC_RESOLUTION;
+
+        mux_select_plant(plant_id, combination);
+        sim_engine_advance_us(1000);
+        T y = bench_from<T>((double)plant_read_raw(plant_id));
+        T u = pid_kernel_compute<T>(bench_from<T>(sp), y, iTerm, lastY, dTerm, kp, ki, kd);
+        plant_write_control(plant_id, (float)bench_to<T>(u));
+
+        double y_v = sim_engine_plant_voltage(plant_id);
+        y_out.push_back(y_v);
+        *iae += fabs(sp * VCC / ADC_RESOLUTION - y_v) * ts;
+    }
+}
+
+int sim_cmd_bench_pid(int argc, char **argv) {
+    long iterations = sim_arg_long(argc, argv, "--iterations", 20000000);
+    double seconds = sim_arg_double(argc, argv, "--seconds", 600.0);
+    double tolerance = sim_arg_double(argc, argv, "--tol", 0.02);
+
+    // Sequencia de medicoes ruidosas em torno do setpoint
+    std::vector<double> samples(4096);
+    uint32_t seed = 12345;
+    for (size_t i = 0; i < samples.size(); i++) {
+        seed = seed * 1664525u + 1013904223u;
+        samples[i] = 2048.0 + 600.0 * sin(i * 0.01) + (double)(seed >> 24) - 128.0;
+    }
+
+    BenchTiming_t t_double = bench_kernel<double>(samples, iterations);
+    BenchTiming_t t_float = bench_kernel<float>(samples, iterations);
+    BenchTiming_t t_fixed = bench_kernel<Q16_16>(samples, iterations);
+
+    printf("custo por compute() (%ld iteracoes)\n", iterations);
+    printf("  %-8s %8s %10s\n", "tipo", "ns", "ciclos");
+    printf("  %-8s %8.2f %10.1f\n", "double", t_double.ns_per_call, t_double.cycles_per_call);
+    printf("  %-8s %8.2f %10.1f\n", "float", t_float.ns_per_call, t_float.cycles_per_call);
+    printf("  %-8s %8.2f %10.1f\n", "Q16.16", t_fixed.ns_per_call, t_fixed.cycles_per_call);
+
+    printf("\nequivalencia em laco fechado (%.0f s por rede, tolerancia de IAE %.1f%%)\n",
+           seconds, tolerance * 100);
+    printf("  %-34s %10s %10s %10s %10s\n", "rede", "dIAE float", "dIAE Q16", "max|dy| f", "max|dy| Q");
+
+    Serial.set_enabled(false);
+    bool ok = true;
+    for (int plant = 1; plant <= 2; plant++) {
+        for (int comb = 0; comb < rc_network_count(plant); comb++) {
+            std::vector<double> y_ref, y_f, y_q;
+            double iae_ref, iae_f, iae_q;
+            bench_closed_loop<double>(plant, comb, seconds, y_ref, &iae_ref);
+            bench_closed_loop<float>(plant, comb, seconds, y_f, &iae_f);
+            bench_closed_loop<Q16_16>(plant, comb, seconds, y_q, &iae_q);
+
+            double dy_f = 0, dy_q = 0;
+            for (size_t i = 0; i < y_ref.size(); i++) {
+                dy_f = fmax(dy_f, fabs(y_f[i] - y_ref[i]));
+                dy_q = fmax(dy_q, fabs(y_q[i] - y_ref[i]));
+            }
+            double rel_f = fabs(iae_f - iae_ref) / iae_ref;
+            double rel_q = fabs(iae_q - iae_ref) / iae_ref;
+            if (rel_f > tolerance || rel_q > tolerance) ok = false;
+
+            printf("  %-34s %9.3f%% %9.3f%% %9.4fV %9.4fV\n", rc_network_for(plant, comb)->name,
+                   rel_f * 100, rel_q * 100, dy_f, dy_q);
+        }
+    }
+
+    printf("%s\n", ok ? "variantes equivalentes" : "DIVERGENCIA acima da tolerancia");
+
+    // Divisao Q16.16 nos limites: satura em vez de estourar o int32
+    static const struct { double a, b; int32_t raw; } DIVISIONS[] = {
+        {3.0, 2.0, 98304},
+        {1.0, 0.0, INT32_MAX},
+        {-1.0, 0.0, INT32_MIN},
+        {0.0, 0.0, 0},
+        {30000.0, 0.001, INT32_MAX},
+        {-30000.0, 0.001, INT32_MIN},
+    };
+    int division_failures = 0;
+    for (const auto &d : DIVISIONS) {
+        int32_t got = (Q16_16(d.a) / Q16_16(d.b)).raw;
+        if (got != d.raw) {
+            printf("  Q16.16 %g / %g: %ld (esperado %ld)\n", d.a, d.b, (long)got, (long)d.raw);
+            division_failures++;
+        }
+    }
+    printf("divisao Q16.16 nos limites %s\n", division_failures == 0 ? "satura" : "FALHOU");
+    return ok && division_failures == 0 ? 0 : 1;
+}
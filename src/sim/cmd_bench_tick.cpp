@@ -0,0 +1,156 @@
+// src/sim/cmd_bench_tick.cpp
+//
+// "bench-tick": compara, com threads reais do PC, os dois caminhos do
+// disparo do ciclo de controle (main.cpp):
+//   software  tick -> tarefa de servico dos timers -> semaforo -> controle,
+//             com o periodo arredondado para o tick do FreeRTOS (1 ms)
+//   notify    interrupcao do timer -> notificacao -> controle, periodo em us
+// Para cada um mede o atraso do despertar da tarefa de controle em relacao
+// ao instante ideal e o jitter do periodo (|intervalo - periodo|). O PC nao
+// e o ESP32: os numeros mostram o salto a mais e o arredondamento ao tick;
+// na placa, as mesmas medidas saem em loop_stage_ns{stage="wake"|"jitter"}
+// do /metrics, com e sem -DCONTROL_TICK_SOFTWARE_TIMER. Com --load, uma
+// thread ocupada disputa a CPU (no ESP32 ela estaria no outro nucleo).
+
+#include "sim_commands.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock TickClock;
+
+// Semaforo binario (ou notificacao com "zera ao pegar")
+typedef struct {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool given;
+    bool stop;
+} TickSignal_t;
+
+static void tick_give(TickSignal_t *s) {
+    std::lock_guard<std::mutex> lock(s->mutex);
+    s->given = true;
+    s->cv.notify_one();
+}
+
+static bool tick_take(TickSignal_t *s) {
+    std::unique_lock<std::mutex> lock(s->mutex);
+    s->cv.wait(lock, [s] { return s->given || s->stop; });
+    s->given = false;
+    return !s->stop;
+}
+
+static void tick_stop(TickSignal_t *s) {
+    std::lock_guard<std::mutex> lock(s->mutex);
+    s->stop = true;
+    s->cv.notify_all();
+}
+
+typedef struct {
+    double p50_us, p99_us, max_us;
+} TickStats_t;
+
+static TickStats_t tick_stats(std::vector<double> &v) {
+    TickStats_t s = {0, 0, 0};
+    if (v.empty()) return s;
+    std::sort(v.begin(), v.end());
+    s.p50_us = v[v.size() / 2];
+    s.p99_us = v[v.size() * 99 / 100];
+    s.max_us = v.back();
+    return s;
+}
+
+// Roda um caminho por seconds; retorna atrasos do despertar e jitter (us)
+static void tick_run(bool software, uint32_t period_us, double seconds, uint32_t *effective_period_us,
+                     std::vector<double> *wake_us, std::vector<double> *jitter_us) {
+    // Timer de software: periodo em ticks inteiros de 1 ms (minimo 1 tick)
+    uint32_t period = period_us;
+    if (software) period = std::max<uint32_t>(1, (period_us + 500) / 1000) * 1000;
+    *effective_period_us = period;
+
+    TickSignal_t service = {};
+    TickSignal_t control = {};
+    const TickClock::time_point start = TickClock::now() + std::chrono::milliseconds(10);
+    const long cycles = (long)(seconds * 1e6 / period);
+    std::atomic<long> fired(0);
+
+    // "Interrupcao": acorda no instante exato de cada disparo
+    std::thread isr([&] {
+        for (long i = 1; i <= cycles; i++) {
+            std::this_thread::sleep_until(start + std::chrono::microseconds((uint64_t)i * period));
+            fired.store(i, std::memory_order_relaxed);
+            tick_give(software ? &service : &control);
+        }
+        tick_stop(&service);
+        tick_stop(&control);
+    });
+
+    // Tarefa de servico dos timers: so existe no caminho antigo
+    std::thread timer_service;
+    if (software) {
+        timer_service = std::thread([&] {
+            while (tick_take(&service)) tick_give(&control);
+            tick_stop(&control);
+        });
+    }
+
+    std::thread controller([&] {
+        TickClock::time_point last;
+        bool have_last = false;
+        while (tick_take(&control)) {
+            TickClock::time_point now = TickClock::now();
+            long i = fired.load(std::memory_order_relaxed);
+            TickClock::time_point ideal = start + std::chrono::microseconds((uint64_t)i * period);
+            wake_us->push_back(std::chrono::duration<double, std::micro>(now - ideal).count());
+            if (have_last) {
+                double interval = std::chrono::duration<double, std::micro>(now - last).count();
+                jitter_us->push_back(interval > period ? interval - period : period - interval);
+            }
+            last = now;
+            have_last = true;
+        }
+    });
+
+    isr.join();
+    if (software) timer_service.join();
+    controller.join();
+}
+
+int sim_cmd_bench_tick(int argc, char **argv) {
+    uint32_t period_us = (uint32_t)sim_arg_long(argc, argv, "--period-us", 500);
+    double seconds = sim_arg_double(argc, argv, "--seconds", 3.0);
+    bool load = sim_arg_flag(argc, argv, "--load");
+
+    std::atomic<bool> loading(load);
+    std::thread busy;
+    if (load) {
+        busy = std::thread([&] {
+            volatile uint64_t x = 0;
+            while (loading.load(std::memory_order_relaxed)) x = x + 1;
+        });
+    }
+
+    printf("Periodo pedido %lu us, %.1f s por caminho%s\n", (unsigned long)period_us, seconds,
+           load ? ", com uma thread ocupada disputando a CPU" : "");
+    printf("%-9s %10s %8s | %-28s | %-28s\n", "caminho", "periodo", "ciclos", "despertar us (p50/p99/max)",
+           "jitter us (p50/p99/max)");
+    for (int software = 1; software >= 0; software--) {
+        uint32_t effective;
+        std::vector<double> wake, jitter;
+        tick_run(software != 0, period_us, seconds, &effective, &wake, &jitter);
+        TickStats_t w = tick_stats(wake);
+        TickStats_t j = tick_stats(jitter);
+        printf("%-9s %7lu us %8zu | %8.1f %8.1f %9.1f  | %8.1f %8.1f %9.1f\n", software ? "software" : "notify",
+               (unsigned long)effective, wake.size(), w.p50_us, w.p99_us, w.max_us, j.p50_us, j.p99_us, j.max_us);
+    }
+
+    loading.store(false);
+    if (load) busy.join();
+    return 0;
+}
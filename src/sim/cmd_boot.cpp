@@ -0,0 +1,145 @@
+// src/sim/cmd_boot.cpp
+//
+// "boot": tempo ate o primeiro ciclo de controle depois de um reset, com os
+// capacitores carregados em varias tensoes (brownout no meio de um ensaio) e
+// com o AP do Wi-Fi presente ou ausente. A partida nova roda de verdade
+// (boot.h: descarga medida no ADC simulado, Wi-Fi fora do caminho); a antiga
+// e a conta da sequencia que existia em setup(): 1 s para a Serial, espera
+// bloqueante do Wi-Fi, e 8 s fixos de descarga. Para cada caso mostra o
+// tempo ate o primeiro ciclo, a descarga e a tensao que sobrou nas plantas
+// no primeiro ciclo. Um caso com limiar impossivel confere o timeout.
+
+#include "sim_commands.h"
+#include "sim_engine.h"
+#include "boot.h"
+#include "mux.h"
+#include "plant.h"
+#include "config.h"
+
+#include <stdio.h>
+
+typedef struct {
+    double v_initial;
+    double wifi_ms;         // < 0: AP ausente
+    int threshold_counts;
+    bool expect_timeout;
+    const char *label;
+} BootScenario_t;
+
+static const double LEGACY_SERIAL_MS = 1000.0;
+
+static double boot_ms(const BootReport_t *report, BootPhase_t phase) {
+    return report->phase_us[phase] / 1000.0;
+}
+
+// Partida nova; retorna o relatorio e as tensoes reais no primeiro ciclo
+static void boot_run_new(const BootScenario_t *s, double setup_ms, double residual_v[2], BootReport_t *report) {
+    SimEngineConfig_t engine;
+    sim_engine_default_config(&engine);
+    engine.v_initial = s->v_initial;
+    sim_engine_reset(&engine);
+    boot_reset();
+
+    mux_init();
+    plant_init();
+    boot_mark(BOOT_PHASE_HARDWARE);
+    sim_engine_advance_us((uint64_t)(setup_ms * 1000));     // SPIFFS, gravador, tabela
+    boot_mark(BOOT_PHASE_STORAGE);
+    boot_discharge_plants(1, 0, s->threshold_counts, TIME_TO_DISCHARGE_MS, NULL);
+    boot_mark(BOOT_PHASE_DISCHARGE);
+    boot_mark(BOOT_PHASE_TASKS);
+
+    // O timer de controle dispara um periodo depois de ligado
+    sim_engine_advance_us(CONTROL_PERIOD_US);
+    boot_mark(BOOT_PHASE_FIRST_CYCLE);
+    residual_v[0] = sim_engine_plant_voltage(1);
+    residual_v[1] = sim_engine_plant_voltage(2);
+
+    boot_read(report);
+}
+
+// Partida antiga: so a tensao que sobra, descarregando pelo mesmo tempo fixo
+static void boot_run_legacy(const BootScenario_t *s, double residual_v[2]) {
+    SimEngineConfig_t engine;
+    sim_engine_default_config(&engine);
+    engine.v_initial = s->v_initial;
+    sim_engine_reset(&engine);
+    mux_init();
+    plant_init();
+    mux_select_plant(1, 0);
+    plant_write_control(1, 0);
+    plant_write_control(2, 0);
+    sim_engine_advance_us((uint64_t)(TIME_TO_DISCHARGE_MS + SAMPLE_TIME_MS) * 1000);
+    residual_v[0] = sim_engine_plant_voltage(1);
+    residual_v[1] = sim_engine_plant_voltage(2);
+}
+
+int sim_cmd_boot(int argc, char **argv) {
+    double wifi_ms = sim_arg_double(argc, argv, "--wifi-ms", 3000.0);
+    double setup_ms = sim_arg_double(argc, argv, "--setup-ms", 250.0);
+    bool show_text = sim_arg_flag(argc, argv, "--text");
+    Serial.set_enabled(sim_arg_flag(argc, argv, "--verbose"));
+
+    const BootScenario_t SCENARIOS[] = {
+        {0.0, wifi_ms, DISCHARGE_THRESHOLD_COUNTS, false, "reset a frio"},
+        {0.3, wifi_ms, DISCHARGE_THRESHOLD_COUNTS, false, "brownout"},
+        {1.65, wifi_ms, DISCHARGE_THRESHOLD_COUNTS, false, "brownout"},
+        // Fundo de escala: a rede de 2a ordem da Planta 2 nao chega ao limiar
+        // nem nos 8 s (a espera fixa tambem deixava mais que isso)
+        {3.3, wifi_ms, DISCHARGE_THRESHOLD_COUNTS, true, "brownout"},
+        {1.65, -1.0, DISCHARGE_THRESHOLD_COUNTS, false, "sem AP"},
+        {1.65, wifi_ms, -1, true, "timeout"},
+    };
+    const double threshold_v = DISCHARGE_THRESHOLD_COUNTS * VCC / ADC_RESOLUTION;
+
+    printf("Limiar %d contagens (%.3f V), timeout %lu ms, setup %.0f ms, Wi-Fi em %.0f ms\n",
+           DISCHARGE_THRESHOLD_COUNTS, threshold_v, TIME_TO_DISCHARGE_MS, setup_ms, wifi_ms);
+    printf("%-13s %6s | %9s %9s %13s | %9s %9s %13s | %8s\n", "caso", "V0", "antigo ms", "web ms", "resto P1/P2 V",
+           "novo ms", "descarga", "resto P1/P2 V", "web ms");
+
+    int failures = 0;
+    BootReport_t report = {};
+    for (const BootScenario_t &s : SCENARIOS) {
+        double legacy_residual[2], residual[2];
+        boot_run_legacy(&s, legacy_residual);
+        boot_run_new(&s, setup_ms, residual, &report);
+
+        // Antes, o Wi-Fi vinha antes de tudo: sem AP, o controle nunca comecava
+        bool legacy_starts = s.wifi_ms >= 0;
+        double legacy_wifi_ms = LEGACY_SERIAL_MS + s.wifi_ms;
+        double legacy_ms = legacy_wifi_ms + setup_ms + TIME_TO_DISCHARGE_MS + SAMPLE_TIME_MS;
+        double first_ms = boot_ms(&report, BOOT_PHASE_FIRST_CYCLE);
+
+        // O Wi-Fi corre em paralelo com a descarga (tarefa de rede); o
+        // servidor sobe quando ele chega e o setup() ja passou do SPIFFS
+        bool web = s.wifi_ms >= 0;
+        double storage_ms = boot_ms(&report, BOOT_PHASE_STORAGE);
+        double web_ms = s.wifi_ms > storage_ms ? s.wifi_ms : storage_ms;
+
+        char legacy_text[16], legacy_web[16], web_text[16];
+        snprintf(legacy_text, sizeof(legacy_text), legacy_starts ? "%.0f" : "nunca", legacy_ms);
+        snprintf(legacy_web, sizeof(legacy_web), legacy_starts ? "%.0f" : "nunca", legacy_wifi_ms + setup_ms);
+        snprintf(web_text, sizeof(web_text), web ? "%.0f" : "-", web_ms);
+        printf("%-13s %6.2f | %9s %9s %6.3f/%6.3f | %9.0f %6lu%-3s %6.3f/%6.3f | %8s\n", s.label, s.v_initial,
+               legacy_text, legacy_web, legacy_residual[0], legacy_residual[1], first_ms,
+               (unsigned long)report.discharge.duration_ms, report.discharge.timed_out ? " TO" : "", residual[0],
+               residual[1], web_text);
+
+        // Nunca mais lento que antes; descarregado de fato (ruido do ADC:
+        // ate 20% acima do limiar); timeout so onde e esperado, e no limite
+        if (report.discharge.timed_out != s.expect_timeout) failures++;
+        if (legacy_starts && first_ms > legacy_ms) failures++;
+        if (!s.expect_timeout && (residual[0] > threshold_v * 1.2 || residual[1] > threshold_v * 1.2)) failures++;
+        if (s.expect_timeout && report.discharge.duration_ms > TIME_TO_DISCHARGE_MS + BOOT_DISCHARGE_POLL_MS * 2) {
+            failures++;
+        }
+    }
+
+    if (show_text) {
+        static char text[2048];
+        boot_format_text(text, sizeof(text));
+        printf("\n%s", text);
+    }
+    printf("%s\n", failures == 0 ? "Partida dentro do esperado" : "Partida FORA do esperado");
+    return failures == 0 ? 0 : 1;
+}
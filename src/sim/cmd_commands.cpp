@@ -0,0 +1,590 @@
+// src/sim/cmd_commands.cpp
+//
+// "commands": confere o caminho dos comandos para a tarefa de controle
+// (control_command.h): ida e volta do quadro binario e recusa de quadros
+// invalidos; a fila sem lock com varias produtoras (ordem por produtora,
+// lotes contiguos, nada perdido nem duplicado); e o laco fechado sob uma
+// enxurrada de lotes vindos de outra thread, como a tarefa do AsyncTCP faria,
+// conferindo que cada lote e aplicado inteiro, confirmado uma vez, e que o
+// custo da etapa de comandos no ciclo fica limitado; e, no modo duplo, a
+// recusa das combinacoes que a Planta 2 nao tem.
+
+#include "sim_commands.h"
+#include "sim_runner.h"
+#include "control_loop.h"
+#include "control_command.h"
+#include "command_queue.h"
+#include "state_snapshot.h"
+#include "gain_schedule.h"
+#include "loop_metrics.h"
+#include "setpoint.h"
+#include "autotune.h"
+#include "config.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+// --- Quadro binario ---
+
+static ControlCommand_t commands_random(std::mt19937 &rng) {
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    ControlCommand_t c;
+    memset(&c, 0, sizeof(c));
+    c.type = (uint8_t)(CONTROL_CMD_TUNINGS + rng() % 7);
+    switch (c.type) {
+    case CONTROL_CMD_TUNINGS:
+        c.tunings.kp = unit(rng);
+        c.tunings.ki = unit(rng);
+        c.tunings.kd = unit(rng) * 0.1f;
+        break;
+    case CONTROL_CMD_PLANT:
+        c.plant.plant_id = 1 + rng() % 2;
+        c.plant.combination = rng() % (c.plant.plant_id == 1 ? 4 : 2);
+        break;
+    case CONTROL_CMD_SETPOINT:
+        c.sp = control_command_setpoint_counts(unit(rng) * VCC);
+        break;
+    case CONTROL_CMD_DUAL:
+        c.dual = rng() & 1;
+        break;
+    case CONTROL_CMD_LOOP_SETPOINT:
+        c.loop_sp.plant_id = 1 + rng() % 2;
+        c.loop_sp.sp = control_command_setpoint_counts(unit(rng) * VCC);
+        break;
+    case CONTROL_CMD_AUTOTUNE:
+        c.autotune.rule = (int)(rng() % 4) - 1;
+        c.autotune.amplitude = 1.0f + unit(rng) * 100.0f;
+        break;
+    case CONTROL_CMD_PROFILE:
+        c.profile_start = false;
+        break;
+    }
+    return c;
+}
+
+// Os valores passam por f32 no quadro: a segunda volta tem que ser exata
+static int commands_check_codec(int frames) {
+    std::mt19937 rng(12345);
+    int failures = 0;
+    size_t total_bytes = 0;
+    for (int f = 0; f < frames; f++) {
+        ControlCommand_t in[CONTROL_COMMAND_MAX_BATCH], once[CONTROL_COMMAND_MAX_BATCH], twice[CONTROL_COMMAND_MAX_BATCH];
+        int count = 1 + rng() % CONTROL_COMMAND_MAX_BATCH;
+        for (int i = 0; i < count; i++) in[i] = commands_random(rng);
+
+        uint8_t a[128], b[128];
+        uint16_t id_a, id_b;
+        size_t length_a = control_command_encode(a, sizeof(a), (uint16_t)f, in, count);
+        int got_a = control_command_decode(a, length_a, &id_a, once, CONTROL_COMMAND_MAX_BATCH);
+        size_t length_b = got_a > 0 ? control_command_encode(b, sizeof(b), id_a, once, got_a) : 0;
+        int got_b = control_command_decode(b, length_b, &id_b, twice, CONTROL_COMMAND_MAX_BATCH);
+        total_bytes += length_a;
+
+        bool ok = length_a > 0 && got_a == count && id_a == (uint16_t)f && length_b == length_a &&
+                  memcmp(a, b, length_a) == 0 && got_b == count && memcmp(once, twice, sizeof(ControlCommand_t) * count) == 0;
+        for (int i = 0; ok && i < count; i++) ok = once[i].type == in[i].type;
+        failures += !ok;
+    }
+    printf("Quadro binario: %d quadros ida e volta, %d diferentes, %.1f bytes por quadro em media\n", frames, failures,
+           (double)total_bytes / frames);
+
+    // Quadros invalidos: nada pode passar
+    ControlCommand_t tunings;
+    memset(&tunings, 0, sizeof(tunings));
+    tunings.type = CONTROL_CMD_TUNINGS;
+    tunings.tunings.kp = 0.5;
+    uint8_t good[64];
+    size_t good_length = control_command_encode(good, sizeof(good), 7, &tunings, 1);
+
+    struct { const char *name; uint8_t frame[32]; size_t length; } bad[8];
+    int n = 0;
+    auto add = [&](const char *name, size_t length) -> uint8_t * {
+        bad[n].name = name;
+        memcpy(bad[n].frame, good, good_length);
+        bad[n].length = length;
+        return bad[n++].frame;
+    };
+    add("magic", good_length)[0] ^= 0xFF;
+    add("versao", good_length)[2] = CONTROL_COMMAND_VERSION + 1;
+    add("sem comandos", good_length)[3] = 0;
+    add("lote grande", good_length)[3] = CONTROL_COMMAND_MAX_BATCH + 1;
+    add("tipo", good_length)[CONTROL_FRAME_HEADER_SIZE] = 0x7F;
+    add("truncado", good_length - 1);
+    add("sobra", good_length + 1);
+    {
+        uint8_t *frame = add("kp NaN", good_length);
+        float nan_value = NAN;
+        memcpy(frame + CONTROL_FRAME_HEADER_SIZE + 1, &nan_value, 4);
+    }
+
+    int accepted = 0;
+    for (int i = 0; i < n; i++) {
+        ControlCommand_t out[CONTROL_COMMAND_MAX_BATCH];
+        uint16_t id;
+        if (control_command_decode(bad[i].frame, bad[i].length, &id, out, CONTROL_COMMAND_MAX_BATCH) >= 0) {
+            printf("  quadro invalido aceito: %s\n", bad[i].name);
+            accepted++;
+        }
+    }
+
+    // Valores fora da faixa montados pelo JSON
+    ControlCommand_t invalid[4];
+    memset(invalid, 0, sizeof(invalid));
+    invalid[0].type = CONTROL_CMD_PLANT;
+    invalid[0].plant.plant_id = 2;
+    invalid[0].plant.combination = 3;
+    invalid[1].type = CONTROL_CMD_TUNINGS;
+    invalid[1].tunings.kp = -1.0;
+    invalid[2].type = CONTROL_CMD_AUTOTUNE;
+    invalid[2].autotune.rule = 0;
+    invalid[2].autotune.amplitude = 0.0;
+    invalid[3].type = CONTROL_CMD_LOOP_SETPOINT;
+    invalid[3].loop_sp.plant_id = 3;
+    for (int i = 0; i < 4; i++) {
+        if (control_command_valid(&invalid[i]) || control_loop_submit(&invalid[i], 1)) {
+            printf("  comando invalido aceito: tipo %u\n", invalid[i].type);
+            accepted++;
+        }
+    }
+    printf("Validacao: %d de %d quadros/comandos invalidos recusados\n", n + 4 - accepted, n + 4);
+
+    // Tamanho do pedido tipico da pagina (planta, ganhos e setpoint)
+    ControlCommand_t page[3];
+    memset(page, 0, sizeof(page));
+    page[0].type = CONTROL_CMD_PLANT;
+    page[0].plant.plant_id = 1;
+    page[1].type = CONTROL_CMD_TUNINGS;
+    page[1].tunings.kp = 0.05;
+    page[1].tunings.ki = 0.1;
+    page[2].type = CONTROL_CMD_SETPOINT;
+    page[2].sp = control_command_setpoint_counts(1.65);
+    uint8_t frame[64];
+    const char *json = "{\"kp\":0.050,\"ki\":0.100,\"kd\":0.000,\"planta\":1,\"combinacao\":0,\"setpoint_v\":1.650,\"id\":7}";
+    printf("Pedido da pagina: %zu bytes em binario, %zu em JSON\n", control_command_encode(frame, sizeof(frame), 7, page, 3),
+           strlen(json));
+
+    return failures + accepted;
+}
+
+// --- Fila com varias produtoras ---
+
+typedef struct {
+    uint32_t producer;
+    uint32_t seq;           // por produtora
+    uint32_t batch_left;    // itens que ainda faltam no lote depois deste
+} QueueItem_t;
+
+static int commands_check_queue(int producers, double seconds) {
+    static CommandQueue<QueueItem_t, 32> queue;
+    std::atomic<bool> producing(true);
+    std::vector<unsigned long> pushed(producers, 0), rejected(producers, 0);
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&, p] {
+            std::mt19937 rng(p + 1);
+            uint32_t seq = 0;
+            while (producing.load(std::memory_order_relaxed)) {
+                QueueItem_t items[4];
+                int count = 1 + rng() % 4;
+                for (int i = 0; i < count; i++) items[i] = {(uint32_t)p, seq + i, (uint32_t)(count - 1 - i)};
+                if (queue.push(items, count)) {
+                    seq += count;
+                    pushed[p] += count;
+                } else {
+                    rejected[p]++;
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    // Consumidora: ordem por produtora e lotes sem itens de outra no meio
+    std::vector<uint32_t> next(producers, 0);
+    unsigned long popped = 0, out_of_order = 0, interleaved = 0;
+    int open_producer = -1;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(seconds);
+    for (;;) {
+        bool more = producing.load(std::memory_order_relaxed);
+        if (more && std::chrono::steady_clock::now() >= deadline) {
+            producing.store(false, std::memory_order_relaxed);
+            for (auto &t : threads) t.join();
+            more = false;
+        }
+        QueueItem_t item;
+        bool any = false;
+        while (queue.pop(&item)) {
+            any = true;
+            popped++;
+            if (item.seq != next[item.producer]) out_of_order++;
+            next[item.producer] = item.seq + 1;
+            if (open_producer >= 0 && (int)item.producer != open_producer) interleaved++;
+            open_producer = item.batch_left > 0 ? (int)item.producer : -1;
+        }
+        if (!more && !any) break;
+        if (!any) std::this_thread::yield();
+    }
+
+    unsigned long total_pushed = 0, total_rejected = 0;
+    for (int p = 0; p < producers; p++) {
+        total_pushed += pushed[p];
+        total_rejected += rejected[p];
+    }
+    bool ok = popped == total_pushed && out_of_order == 0 && interleaved == 0 && queue.rejected() == total_rejected;
+    printf("Fila: %d produtoras, %lu itens (%.1f M/s), %lu lotes recusados com a fila cheia; "
+           "fora de ordem %lu, lotes misturados %lu, perdidos %ld  %s\n",
+           producers, popped, popped / seconds / 1e6, total_rejected, out_of_order, interleaved,
+           (long)total_pushed - (long)popped, ok ? "ok" : "FALHOU");
+    return ok ? 0 : 1;
+}
+
+// --- Laco fechado sob enxurrada ---
+
+// Cada lote leva a combinacao e um kp que a codifica: se um lote fosse
+// aplicado pela metade, o snapshot mostraria os dois fora de par
+static void commands_flood_batch(uint32_t n, ControlCommand_t *batch) {
+    memset(batch, 0, 2 * sizeof(ControlCommand_t));
+    batch[0].type = CONTROL_CMD_PLANT;
+    batch[0].plant.plant_id = 1;
+    batch[0].plant.combination = (int32_t)(n % 4);
+    batch[1].type = CONTROL_CMD_TUNINGS;
+    batch[1].tunings.kp = 0.01 * (n % 100 + 1);
+    batch[1].tunings.ki = 0.1;
+    for (int i = 0; i < 2; i++) {
+        batch[i].id = (uint16_t)(n % 65535 + 1);
+        batch[i].client = 1;
+    }
+}
+
+typedef struct {
+    std::atomic<bool> flooding;
+    std::atomic<unsigned long> submitted, rejected;
+    unsigned long cycles, stop_cycle;
+    unsigned long torn;
+    unsigned long acks, acks_not_applied, acks_out_of_order;
+    uint16_t last_ack_id;
+} FloodState_t;
+
+static void commands_drain_acks(FloodState_t *state) {
+    ControlAck_t acks[16];
+    int count;
+    while ((count = control_loop_drain_acks(acks, 16)) > 0) {
+        for (int i = 0; i < count; i++) {
+            state->acks++;
+            if (acks[i].status != CONTROL_ACK_APPLIED) state->acks_not_applied++;
+            uint16_t expected = (uint16_t)(state->last_ack_id % 65535 + 1);
+            if (state->last_ack_id != 0 && acks[i].id != expected) state->acks_out_of_order++;
+            state->last_ack_id = acks[i].id;
+        }
+    }
+}
+
+static void commands_on_cycle(void *ctx) {
+    FloodState_t *state = (FloodState_t *)ctx;
+    StateSnapshot_t snapshot;
+    state_snapshot_read(&snapshot);
+    if (snapshot.kp != 0.05f) {
+        long n = lround(snapshot.kp * 100.0) - 1;
+        if (n < 0 || n % 4 != snapshot.mux_combination) state->torn++;
+    }
+    commands_drain_acks(state);
+    if (++state->cycles == state->stop_cycle) state->flooding.store(false, std::memory_order_relaxed);
+
+    // No ESP32 a tarefa do AsyncTCP roda nos 200 ms entre dois ciclos; aqui
+    // o relogio virtual nao deixa esse intervalo, entao cede a CPU para a
+    // produtora encher a fila (com um nucleo so, ela nao rodaria)
+    if (state->flooding.load(std::memory_order_relaxed)) std::this_thread::yield();
+}
+
+typedef struct {
+    double mean_us, p99_us, max_us;
+    double total_p99_us;
+} FloodTiming_t;
+
+static void commands_run(bool flood, double minutes, FloodState_t *state, FloodTiming_t *timing) {
+    // Perfil constante: o executor nao manda setpoints, so a enxurrada mexe
+    static SetpointProfile_t hold;
+    setpoint_profile_parse("degrau 1.65 10; repetir", &hold, NULL, 0);
+
+    SimRunConfig_t cfg;
+    sim_run_default_config(&cfg);
+    cfg.duration_s = minutes * 60.0;
+    cfg.profile = &hold;
+    cfg.on_cycle = commands_on_cycle;
+    cfg.on_cycle_ctx = state;
+
+    state->flooding.store(flood, std::memory_order_relaxed);
+    state->stop_cycle = (unsigned long)(cfg.duration_s * 1000.0 / SAMPLE_TIME_MS) - 20;
+
+    // Produtora: monta o quadro binario e o decodifica, como o servidor web,
+    // e entrega o lote o mais rapido que a fila aceitar
+    std::thread producer([state] {
+        uint32_t n = 0;
+        while (state->flooding.load(std::memory_order_relaxed)) {
+            ControlCommand_t batch[2], decoded[CONTROL_COMMAND_MAX_BATCH];
+            commands_flood_batch(n, batch);
+            uint8_t frame[64];
+            uint16_t id;
+            size_t length = control_command_encode(frame, sizeof(frame), batch[0].id, batch, 2);
+            int count = control_command_decode(frame, length, &id, decoded, CONTROL_COMMAND_MAX_BATCH);
+            for (int i = 0; i < count; i++) {
+                decoded[i].id = id;
+                decoded[i].client = 1;
+            }
+            if (count == 2 && control_loop_submit(decoded, 2)) {
+                state->submitted.fetch_add(1, std::memory_order_relaxed);
+                n++;
+            } else {
+                state->rejected.fetch_add(1, std::memory_order_relaxed);
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    SimRunResult_t result;
+    sim_run_closed_loop(&cfg, &result);
+    state->flooding.store(false, std::memory_order_relaxed);
+    producer.join();
+    commands_drain_acks(state);
+
+    LoopMetrics_t metrics;
+    loop_metrics_read(&metrics);
+    const LoopHistogram_t *requests = &metrics.stages[LOOP_STAGE_REQUESTS];
+    timing->mean_us = loop_histogram_mean(requests) / 1000.0;
+    timing->p99_us = loop_histogram_quantile(requests, 0.99) / 1000.0;
+    timing->max_us = requests->max_ns / 1000.0;
+    timing->total_p99_us = loop_histogram_quantile(&metrics.stages[LOOP_STAGE_TOTAL], 0.99) / 1000.0;
+}
+
+static int commands_check_flood(double minutes) {
+    static FloodState_t quiet, flood;
+    FloodTiming_t quiet_timing, flood_timing;
+    commands_run(false, minutes, &quiet, &quiet_timing);
+    commands_run(true, minutes, &flood, &flood_timing);
+
+    // Cada lote aplicado e confirmado uma vez, entao as confirmacoes contam
+    // os lotes aplicados
+    unsigned long submitted = flood.submitted.load();
+    printf("Enxurrada: %lu lotes entregues (%.0f por ciclo), %lu recusados com a fila cheia, em %lu ciclos\n",
+           submitted, (double)submitted / flood.cycles, flood.rejected.load(), flood.cycles);
+    printf("  confirmacoes %lu (nao aplicado %lu, fora de ordem %lu), lotes aplicados pela metade %lu\n", flood.acks,
+           flood.acks_not_applied, flood.acks_out_of_order, flood.torn);
+    printf("  etapa de comandos: media %.3f us, p99 %.3f us, max %.3f us (sem enxurrada: %.3f / %.3f / %.3f us)\n",
+           flood_timing.mean_us, flood_timing.p99_us, flood_timing.max_us, quiet_timing.mean_us, quiet_timing.p99_us,
+           quiet_timing.max_us);
+    printf("  ciclo inteiro p99: %.3f us com, %.3f us sem\n", flood_timing.total_p99_us, quiet_timing.total_p99_us);
+
+    bool ok = submitted > 0 && flood.acks == submitted && flood.acks_not_applied == 0 && flood.acks_out_of_order == 0 &&
+              flood.torn == 0;
+    printf("  %s\n", ok ? "ok" : "FALHOU");
+    return ok ? 0 : 1;
+}
+
+// --- Modo duplo ---
+
+// Pedidos feitos a partir de um ciclo, com a confirmacao esperada e a
+// combinacao que o snapshot deve mostrar depois
+typedef struct {
+    unsigned long cycle;
+    ControlCommand_t command;
+    uint8_t expected;
+} DualStep_t;
+
+typedef struct {
+    const DualStep_t *steps;
+    int count;
+    int next;
+    unsigned long cycles;
+    unsigned long invalid_cycles;   // ciclos do modo duplo numa combinacao sem a Planta 2
+    int wrong_acks;
+} DualState_t;
+
+static void commands_dual_on_cycle(void *ctx) {
+    DualState_t *state = (DualState_t *)ctx;
+    StateSnapshot_t snapshot;
+    BankSnapshot_t bank;
+    state_snapshot_read(&snapshot);
+    bank_snapshot_read(&bank);
+    if (bank.loops > 0 && gain_schedule_index(2, snapshot.mux_combination) < 0) state->invalid_cycles++;
+
+    ControlAck_t acks[4];
+    int count = control_loop_drain_acks(acks, 4);
+    for (int i = 0; i < count; i++) {
+        const DualStep_t *step = &state->steps[acks[i].id - 1];
+        if (acks[i].status != step->expected) {
+            printf("  lote %u: %s, esperado %s\n", acks[i].id, control_ack_status_name(acks[i].status),
+                   control_ack_status_name(step->expected));
+            state->wrong_acks++;
+        }
+    }
+
+    state->cycles++;
+    if (state->next < state->count && state->cycles == state->steps[state->next].cycle) {
+        control_loop_submit(&state->steps[state->next].command, 1);
+        state->next++;
+    }
+}
+
+static int commands_check_dual() {
+    static DualStep_t steps[5];
+    memset(steps, 0, sizeof(steps));
+    const struct { uint8_t type; int plant, combination; bool dual; uint8_t expected; } plan[5] = {
+        {CONTROL_CMD_PLANT, 1, 2, true, CONTROL_ACK_REJECTED},     // malha 2 sem rede
+        {CONTROL_CMD_PLANT, 2, 0, true, CONTROL_ACK_APPLIED},
+        {CONTROL_CMD_DUAL, 0, 0, false, CONTROL_ACK_APPLIED},
+        {CONTROL_CMD_PLANT, 1, 3, false, CONTROL_ACK_APPLIED},     // modo simples: vale
+        {CONTROL_CMD_DUAL, 0, 0, true, CONTROL_ACK_REJECTED},      // ligar na combinacao 3
+    };
+    for (int i = 0; i < 5; i++) {
+        steps[i].cycle = 10 * (i + 1);
+        steps[i].command.type = plan[i].type;
+        steps[i].command.plant.plant_id = plan[i].plant;
+        steps[i].command.plant.combination = plan[i].combination;
+        if (plan[i].type == CONTROL_CMD_DUAL) steps[i].command.dual = plan[i].dual;
+        steps[i].command.id = (uint16_t)(i + 1);
+        steps[i].command.client = 1;
+        steps[i].expected = plan[i].expected;
+    }
+
+    SimRunConfig_t cfg;
+    sim_run_default_config(&cfg);
+    cfg.duration_s = 60.0 * SAMPLE_TIME_S + 1.0;
+    cfg.dual = true;
+    cfg.combination = 1;
+    DualState_t state;
+    memset(&state, 0, sizeof(state));
+    state.steps = steps;
+    state.count = 5;
+    cfg.on_cycle = commands_dual_on_cycle;
+    cfg.on_cycle_ctx = &state;
+    SimRunResult_t result;
+    sim_run_closed_loop(&cfg, &result);
+
+    StateSnapshot_t snapshot;
+    BankSnapshot_t bank;
+    state_snapshot_read(&snapshot);
+    bank_snapshot_read(&bank);
+    bool final_ok = bank.loops == 0 && snapshot.active_plant == 1 && snapshot.mux_combination == 3;
+
+    // A varredura da tabela no modo duplo passa so pelas combinacoes 0 e 1
+    gain_schedule_request_sweep(true, 1);
+    int plant = 1, combination = 0, swept_invalid = 0;
+    gain_schedule_sweep_next(0, plant, combination, true, &plant, &combination);
+    for (unsigned long now = 1; now <= 8; now++) {
+        if (gain_schedule_sweep_next(now, plant, combination, true, &plant, &combination) &&
+            gain_schedule_index(2, combination) < 0) {
+            swept_invalid++;
+        }
+    }
+    gain_schedule_request_sweep(false, 0);
+
+    bool ok = state.next == 5 && state.wrong_acks == 0 && state.invalid_cycles == 0 && final_ok &&
+              swept_invalid == 0;
+    printf("Modo duplo: combinacoes 2 e 3 recusadas (%lu ciclos sem a Planta 2, %d confirmacoes erradas, "
+           "%d trocas da varredura fora da Planta 2)  %s\n",
+           state.invalid_cycles, state.wrong_acks, swept_invalid, ok ? "ok" : "FALHOU");
+    return ok ? 0 : 1;
+}
+
+// --- Lote inteiro ou nada ---
+
+// No modo duplo, um lote com setpoint, troca de planta e ensaio do rele e
+// recusado pelo ensaio, e o setpoint e a planta ficam como estavam. O mesmo
+// ensaio depois de desligar o modo duplo, no mesmo lote, passa.
+typedef struct {
+    unsigned long cycles;
+    double sp_before;
+    bool rejected_ok, unchanged_ok, applied_ok;
+} AtomicState_t;
+
+static void commands_atomic_on_cycle(void *ctx) {
+    AtomicState_t *state = (AtomicState_t *)ctx;
+    StateSnapshot_t snapshot;
+    state_snapshot_read(&snapshot);
+
+    ControlAck_t acks[4];
+    int count = control_loop_drain_acks(acks, 4);
+    for (int i = 0; i < count; i++) {
+        if (acks[i].id == 1) {
+            state->rejected_ok = acks[i].status == CONTROL_ACK_REJECTED && acks[i].type == CONTROL_CMD_AUTOTUNE;
+        }
+        if (acks[i].id == 2) state->applied_ok = acks[i].status == CONTROL_ACK_APPLIED;
+    }
+
+    state->cycles++;
+    if (state->cycles == 10) {
+        state->sp_before = snapshot.sp;
+        ControlCommand_t batch[3];
+        memset(batch, 0, sizeof(batch));
+        batch[0].type = CONTROL_CMD_SETPOINT;
+        batch[0].sp = control_command_setpoint_counts(0.5);
+        batch[1].type = CONTROL_CMD_PLANT;
+        batch[1].plant.plant_id = 2;
+        batch[1].plant.combination = 0;
+        batch[2].type = CONTROL_CMD_AUTOTUNE;
+        batch[2].autotune.rule = AUTOTUNE_RULE_ZN;
+        batch[2].autotune.amplitude = AUTOTUNE_DEFAULT_AMPLITUDE;
+        for (int i = 0; i < 3; i++) {
+            batch[i].id = 1;
+            batch[i].client = 1;
+        }
+        control_loop_submit(batch, 3);
+    } else if (state->cycles == 20) {
+        state->unchanged_ok = snapshot.sp == state->sp_before && snapshot.active_plant == 1 &&
+                              snapshot.mux_combination == 1;
+        ControlCommand_t batch[3];
+        memset(batch, 0, sizeof(batch));
+        batch[0].type = CONTROL_CMD_DUAL;
+        batch[0].dual = false;
+        batch[1].type = CONTROL_CMD_AUTOTUNE;
+        batch[1].autotune.rule = AUTOTUNE_RULE_ZN;
+        batch[1].autotune.amplitude = AUTOTUNE_DEFAULT_AMPLITUDE;
+        batch[2].type = CONTROL_CMD_AUTOTUNE;
+        batch[2].autotune.rule = -1;
+        for (int i = 0; i < 3; i++) {
+            batch[i].id = 2;
+            batch[i].client = 1;
+        }
+        control_loop_submit(batch, 3);
+    }
+}
+
+static int commands_check_atomic() {
+    SimRunConfig_t cfg;
+    sim_run_default_config(&cfg);
+    cfg.duration_s = 30.0 * SAMPLE_TIME_S + 1.0;
+    cfg.dual = true;
+    cfg.combination = 1;
+    AtomicState_t state;
+    memset(&state, 0, sizeof(state));
+    cfg.on_cycle = commands_atomic_on_cycle;
+    cfg.on_cycle_ctx = &state;
+    SimRunResult_t result;
+    sim_run_closed_loop(&cfg, &result);
+
+    bool ok = state.rejected_ok && state.unchanged_ok && state.applied_ok;
+    printf("Lote recusado nao deixa comandos aplicados (recusa %s, estado %s, lote valido %s)  %s\n",
+           state.rejected_ok ? "ok" : "errada", state.unchanged_ok ? "intacto" : "alterado",
+           state.applied_ok ? "aplicado" : "recusado", ok ? "ok" : "FALHOU");
+    return ok ? 0 : 1;
+}
+
+int sim_cmd_commands(int argc, char **argv) {
+    int frames = (int)sim_arg_long(argc, argv, "--frames", 100000);
+    int producers = (int)sim_arg_long(argc, argv, "--producers", 3);
+    double seconds = sim_arg_double(argc, argv, "--seconds", 1.0);
+    double minutes = sim_arg_double(argc, argv, "--minutes", 10.0);
+    Serial.set_enabled(sim_arg_flag(argc, argv, "--verbose"));
+
+    int failures = commands_check_codec(frames);
+    failures += commands_check_queue(producers, seconds);
+    failures += commands_check_flood(minutes);
+    failures += commands_check_dual();
+    failures += commands_check_atomic();
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,214 @@
+// src/sim/cmd_history.cpp
+//
+// "history": roda o laco fechado alimentando o historico em varias
+// resolucoes (history.h) pela telemetria, como a tarefa do WebSocket faz, e
+// guarda todas as amostras a parte. Cada nivel e consultado inteiro e
+// comparado com os buckets calculados direto das amostras (minimo, maximo,
+// media, contagem, tempo do ponto); pontos que juntam buckets sao conferidos
+// contra as amostras com tolerancia de 1 na media. Com --drop, alguns ciclos
+// nao chegam ao historico, como um cursor que ficou para tras, e viram
+// lacunas. Mostra tambem a memoria, o custo por amostra e o tamanho da
+// resposta de cada janela.
+
+#include "sim_commands.h"
+#include "sim_runner.h"
+#include "history.h"
+#include "telemetry.h"
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+typedef struct {
+    uint32_t cycle;
+    uint32_t time_ms;
+    int16_t value[HISTORY_SIGNALS];
+    uint8_t plant;
+    uint8_t flags;
+} HistoryReference_t;
+
+typedef struct {
+    History_t *history;
+    TelemetryCursor_t cursor;
+    std::vector<HistoryReference_t> samples;
+    long drop_every;            // 0: nenhum ciclo perdido
+    unsigned long dropped;
+    std::vector<float> add_ns;
+} HistoryRun_t;
+
+static void history_on_cycle(void *ctx) {
+    HistoryRun_t *run = (HistoryRun_t *)ctx;
+    TelemetryRecord_t records[8];
+    int count;
+    while ((count = telemetry_drain(&run->cursor, records, 8)) > 0) {
+        for (int i = 0; i < count; i++) {
+            const TelemetryRecord_t *r = &records[i];
+            if (!(r->flags & TELEMETRY_FLAG_ACTIVE)) continue;
+            // Rajadas de 25 ciclos perdidos a cada drop_every ciclos
+            if (run->drop_every > 0 && r->cycle % run->drop_every < 25) {
+                run->dropped++;
+                continue;
+            }
+
+            auto t0 = std::chrono::steady_clock::now();
+            history_add(run->history, r);
+            std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - t0;
+            run->add_ns.push_back((float)elapsed.count());
+
+            HistoryReference_t ref;
+            ref.cycle = r->cycle;
+            ref.time_ms = r->time_ms;
+            for (int s = 0; s < HISTORY_SIGNALS; s++) ref.value[s] = history_quantize(r, s);
+            ref.plant = r->plant;
+            ref.flags = r->flags;
+            run->samples.push_back(ref);
+        }
+    }
+}
+
+// Ponto esperado para os ciclos [from, to) a partir das amostras
+static void history_reference_point(const std::vector<HistoryReference_t> &samples, uint32_t from, uint32_t to,
+                                    HistoryBucket_t *point, uint32_t *first_time_ms) {
+    memset(point, 0, sizeof(*point));
+    int32_t sum[HISTORY_SIGNALS] = {0, 0, 0};
+    *first_time_ms = 0;
+    for (const HistoryReference_t &s : samples) {
+        if (s.cycle < from || s.cycle >= to) continue;
+        if (point->samples == 0) *first_time_ms = s.time_ms - (s.cycle - from) * (uint32_t)SAMPLE_TIME_MS;
+        for (int i = 0; i < HISTORY_SIGNALS; i++) {
+            if (point->samples == 0 || s.value[i] < point->min[i]) point->min[i] = s.value[i];
+            if (point->samples == 0 || s.value[i] > point->max[i]) point->max[i] = s.value[i];
+            sum[i] += s.value[i];
+        }
+        point->samples++;
+        point->plant = s.plant;
+        point->flags |= s.flags;
+    }
+    for (int i = 0; i < HISTORY_SIGNALS && point->samples > 0; i++) {
+        int32_t half = point->samples / 2;
+        point->mean[i] = (int16_t)((sum[i] >= 0 ? sum[i] + half : sum[i] - half) / (int32_t)point->samples);
+    }
+}
+
+static int history_abs(int v) {
+    return v < 0 ? -v : v;
+}
+
+// Consulta e confere um nivel inteiro; retorna os pontos que nao bateram
+static int history_check_query(const HistoryRun_t *run, const HistoryQuery_t *query, int expected_level,
+                               int mean_tolerance, size_t *bytes, int *points_out) {
+    static uint8_t frame[HISTORY_MAX_FRAME_SIZE];
+    static HistoryBucket_t points[HISTORY_MAX_POINTS];
+
+    size_t length = history_build_frame(run->history, query, frame, sizeof(frame));
+    HistoryFrameHeader_t header;
+    int count = history_decode_frame(frame, length, &header, points, HISTORY_MAX_POINTS);
+    *bytes = length;
+    *points_out = count;
+    if (count < 0 || header.level != expected_level || header.id != query->id) return 1;
+
+    // Ponto i cobre os ciclos [c0 + i*step, c0 + (i+1)*step)
+    uint32_t step = header.period_ms / SAMPLE_TIME_MS;
+    uint32_t offset = run->history->time_offset_ms;
+    uint32_t c0 = (header.first_ms - offset) / SAMPLE_TIME_MS;
+    int mismatches = 0;
+    for (int i = 0; i < count; i++) {
+        HistoryBucket_t expected;
+        uint32_t first_time_ms;
+        history_reference_point(run->samples, c0 + i * step, c0 + (i + 1) * step, &expected, &first_time_ms);
+
+        const HistoryBucket_t *got = &points[i];
+        bool ok = got->samples == expected.samples && got->plant == expected.plant && got->flags == expected.flags;
+        for (int s = 0; ok && s < HISTORY_SIGNALS && expected.samples > 0; s++) {
+            ok = got->min[s] == expected.min[s] && got->max[s] == expected.max[s] &&
+                 history_abs(got->mean[s] - expected.mean[s]) <= mean_tolerance;
+        }
+        if (ok && expected.samples > 0) ok = first_time_ms == header.first_ms + (uint32_t)i * header.period_ms;
+        if (!ok) mismatches++;
+    }
+    return mismatches;
+}
+
+int sim_cmd_history(int argc, char **argv) {
+    double minutes = sim_arg_double(argc, argv, "--minutes", 120.0);
+    bool dual = sim_arg_flag(argc, argv, "--dual");
+    long drop_every = sim_arg_long(argc, argv, "--drop", 0);
+    Serial.set_enabled(sim_arg_flag(argc, argv, "--verbose"));
+
+    static History_t history;
+    history_init(&history);
+    HistoryRun_t run;
+    run.history = &history;
+    run.drop_every = drop_every;
+    run.dropped = 0;
+    telemetry_attach(&run.cursor);
+
+    SimRunConfig_t cfg;
+    sim_run_default_config(&cfg);
+    cfg.duration_s = minutes * 60.0;
+    cfg.dual = dual;
+    cfg.on_cycle = history_on_cycle;
+    cfg.on_cycle_ctx = &run;
+    SimRunResult_t result;
+    sim_run_closed_loop(&cfg, &result);
+
+    // Custo por amostra (tempo real, com a leitura do relogio)
+    std::vector<float> &costs = run.add_ns;
+    double total_ns = 0;
+    for (float c : costs) total_ns += c;
+    std::sort(costs.begin(), costs.end());
+    size_t n = costs.size();
+    printf("%lu ciclos (%.0f min simulados%s), %zu amostras no historico, %lu ciclos perdidos de proposito\n",
+           result.cycles, minutes, dual ? ", duas malhas" : "", n, run.dropped);
+    printf("Memoria: %zu bytes; custo por amostra: media %.0f ns, p50 %.0f ns, p99 %.0f ns\n",
+           sizeof(History_t), n ? total_ns / n : 0.0, n ? costs[n / 2] : 0.0f, n ? costs[n * 99 / 100] : 0.0f);
+
+    // 1. Cada nivel inteiro, na propria resolucao: tem que ser exato
+    int failures = 0;
+    printf("%-6s %8s %8s %10s %10s\n", "nivel", "pontos", "bytes", "periodo", "errados");
+    for (int level = HISTORY_RAW; level < HISTORY_LEVELS; level++) {
+        HistoryQuery_t query;
+        query.id = (uint16_t)(level + 1);
+        query.window_s = HISTORY_CAPACITY[level] * HISTORY_PERIOD_MS[level] / 1000;
+        query.resolution_ms = HISTORY_PERIOD_MS[level];
+        size_t bytes;
+        int points;
+        int wrong = history_check_query(&run, &query, level, 0, &bytes, &points);
+        printf("%-6d %8d %8zu %8lu ms %10d\n", level, points, bytes, (unsigned long)HISTORY_PERIOD_MS[level], wrong);
+        failures += wrong;
+    }
+
+    // 2. Resolucoes que juntam buckets de um nivel (media com tolerancia de
+    // 1: e a media ponderada das medias ja arredondadas)
+    static const uint32_t MERGED[][3] = {   // resolucao (ms), janela (s), nivel esperado
+        {400, 120, HISTORY_RAW}, {5000, 600, HISTORY_1S}, {30000, 3600, HISTORY_10S}, {300000, 28800, HISTORY_60S},
+    };
+    for (const auto &m : MERGED) {
+        HistoryQuery_t query = {99, m[1], m[0]};
+        size_t bytes;
+        int points;
+        int wrong = history_check_query(&run, &query, (int)m[2], 1, &bytes, &points);
+        printf("resolucao %6lu ms, janela %5lu s: %4d pontos, %5zu bytes, %d errados\n",
+               (unsigned long)m[0], (unsigned long)m[1], points, bytes, wrong);
+        failures += wrong;
+    }
+
+    // 3. Resolucao automatica das janelas do seletor da pagina
+    static const uint32_t WINDOWS[] = {60, HISTORY_DEFAULT_WINDOW_S, 3600, 28800};
+    for (uint32_t window_s : WINDOWS) {
+        HistoryQuery_t query = {7, window_s, 0};
+        int level, points;
+        uint32_t merge;
+        history_select(&history, &query, &level, &merge, &points);
+        static uint8_t frame[HISTORY_MAX_FRAME_SIZE];
+        size_t bytes = history_build_frame(&history, &query, frame, sizeof(frame));
+        printf("janela %5lu s (automatica): nivel %d x%lu, %d pontos pedidos, %zu bytes\n",
+               (unsigned long)window_s, level, (unsigned long)merge, points, bytes);
+    }
+
+    printf("%s\n", failures == 0 ? "Historico confere com as amostras" : "Historico DIVERGE das amostras");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,243 @@
+// src/sim/cmd_identify.cpp
+//
+// "identify": identificacao em linha (identification.h) contra as redes
+// simuladas, cujos parametros sao conhecidos. Cada rede roda em laco
+// fechado com a referencia em onda quadrada e o PRBS ligado; no fim, o
+// modelo publicado e comparado com o ganho e as constantes de tempo do
+// circuito e com a resposta ao degrau verdadeira. Depois, um capacitor
+// "envelhece" no meio da execucao e a deriva tem que aparecer. Mede tambem
+// o custo de uma atualizacao do RLS.
+
+#include "sim_commands.h"
+#include "sim_runner.h"
+#include "rc_plant.h"
+#include "control_loop.h"
+#include "identification.h"
+#include "rls.h"
+#include "config.h"
+#include "adc_acquisition.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <chrono>
+
+typedef struct {
+    double excitation;
+    bool requested;
+    // Troca de capacitancia no meio da execucao (drift_at_ms = 0 desliga)
+    int plant_id, combination;
+    unsigned long drift_at_ms;
+    double drift_scale;
+    bool drifted;
+    IdentModel_t before;        // modelo publicado antes da troca
+} IdentifyState_t;
+
+static void identify_on_cycle(void *ctx) {
+    IdentifyState_t *state = (IdentifyState_t *)ctx;
+    if (!state->requested) {
+        control_loop_request_identification(state->excitation, IDENT_ACTION_NONE);
+        state->requested = true;
+    }
+    if (state->drift_at_ms > 0 && !state->drifted && millis() >= state->drift_at_ms) {
+        IdentReport_t report;
+        ident_report_read(&report);
+        state->before = report.models[gain_schedule_index(state->plant_id, state->combination)];
+        rc_network_set_capacitance_scale(state->plant_id, state->combination, state->drift_scale);
+        state->drifted = true;
+    }
+}
+
+// Ajuste da resposta ao degrau do modelo ARX a da rede (1 - NRMSE), em
+// amostras de SAMPLE_TIME_MS ate 5 constantes de tempo. A amostra
+// verdadeira e a que o laco le: a media das leituras do ADC mais recentes
+// (no maximo meio buffer da aquisicao, ADC_DECIMATE_MEAN), nao a tensao no
+// instante.
+static double identify_step_fit(const RcNetwork_t *net, const IdentModel_t *m) {
+    double ts = SAMPLE_TIME_S;
+    double tau1, tau2;
+    rc_network_time_constants(net, &tau1, &tau2);
+    int samples = (int)ceil(5.0 * (tau1 + tau2) / ts) + 1;
+
+    RcPlant_t plant;
+    plant.net = net;
+    rc_plant_reset(&plant, 0.0);
+    double y[2] = {0, 0}, u[2] = {0, 0};
+    double err_sq = 0, dev_sq = 0, mean = 0;
+    double *truth = new double[samples];
+    double *model = new double[samples];
+    double acq_s = ADC_ACQ_PERIOD_MS / 1000.0;
+    int acq_per_sample = (int)(SAMPLE_TIME_MS / ADC_ACQ_PERIOD_MS);
+    int averaged = (ADC_RING_SIZE / 2) / ADC_ACQ_BURST;
+    if (averaged > acq_per_sample) averaged = acq_per_sample;
+    double sample_mean = 0.0;
+    for (int k = 0; k < samples; k++) {
+        truth[k] = sample_mean;
+        model[k] = y[0];
+        // y[k+1] = a1 y[k] + a2 y[k-1] + b1 u[k] + b2 u[k-1]; u = 1 a partir de k = 0
+        double next = m->a[0] * y[0] + m->a[1] * y[1] + m->b[0] * 1.0 + m->b[1] * u[0];
+        y[1] = y[0];
+        y[0] = next;
+        u[1] = u[0];
+        u[0] = 1.0;
+        sample_mean = 0.0;
+        for (int i = 0; i < acq_per_sample; i++) {
+            rc_plant_step(&plant, 1.0, acq_s, true);
+            if (i >= acq_per_sample - averaged) sample_mean += rc_plant_output(&plant) / averaged;
+        }
+        mean += truth[k];
+    }
+    mean /= samples;
+    for (int k = 0; k < samples; k++) {
+        err_sq += (truth[k] - model[k]) * (truth[k] - model[k]);
+        dev_sq += (truth[k] - mean) * (truth[k] - mean);
+    }
+    delete[] truth;
+    delete[] model;
+    return 1.0 - sqrt(err_sq / dev_sq);
+}
+
+static bool identify_within(double value, double expected, double tolerance) {
+    return fabs(value - expected) <= tolerance * expected;
+}
+
+// Confere o modelo da rede contra o circuito; retorna true se passou
+static bool identify_check(const IdentModel_t *m, int plant, int comb, double gain_tol, double tau_tol,
+                           double min_fit) {
+    const RcNetwork_t *net = rc_network_for(plant, comb);
+    double tau1, tau2;
+    rc_network_time_constants(net, &tau1, &tau2);
+
+    printf("  P%d/C%d  amostras=%5u  ", plant, comb, (unsigned)m->updates);
+    if (!(m->flags & IDENT_MODEL_VALID)) {
+        printf("modelo invalido  FALHOU\n");
+        return false;
+    }
+    double fit = identify_step_fit(net, m);
+    bool ok = identify_within(m->gain, 1.0, gain_tol) && identify_within(m->tau1_s, tau1, tau_tol) &&
+              (m->order == 1 || identify_within(m->tau2_s, tau2, 1.5 * tau_tol)) && fit >= min_fit;
+    printf("K=%.3f  tau1=%.2f s (%.2f)", m->gain, m->tau1_s, tau1);
+    if (m->order == 2) printf("  tau2=%.2f s (%.2f)", m->tau2_s, tau2);
+    printf("  FOPDT tau=%.2f s theta=%.2f s  erro=%.1f mV  ajuste=%.1f%%  %s\n", m->tau_s, m->theta_s,
+           m->rms_error_v * 1000.0, fit * 100.0, ok ? "ok" : "FALHOU");
+    return ok;
+}
+
+template <int N>
+static double identify_bench_rls(int n, long iterations) {
+    Rls<N> rls;
+    rls_init(&rls, n, IDENT_FORGETTING, IDENT_P0, IDENT_MAX_TRACE);
+    float phi[N];
+    float acc = 0.0f;
+    uint32_t lfsr = 1;
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; i++) {
+        for (int j = 0; j < n; j++) {
+            lfsr = lfsr * 1664525u + 1013904223u;
+            phi[j] = (float)(lfsr >> 8) * (1.0f / 16777216.0f);
+        }
+        acc += rls_update(&rls, phi, phi[0] * 0.5f + 0.1f);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    volatile float sink = acc;
+    (void)sink;
+    return elapsed.count() * 1e9 / iterations;
+}
+
+int sim_cmd_identify(int argc, char **argv) {
+    double minutes = sim_arg_double(argc, argv, "--minutes", 6.0);
+    double excitation = sim_arg_double(argc, argv, "--excitation", 20.0);
+    double gain_tol = sim_arg_double(argc, argv, "--gain-tol", 0.05);
+    double tau_tol = sim_arg_double(argc, argv, "--tau-tol", 0.10);
+    double min_fit = sim_arg_double(argc, argv, "--fit", 0.95);
+    double drift_scale = sim_arg_double(argc, argv, "--drift", 1.3);
+
+    Serial.set_enabled(sim_arg_flag(argc, argv, "--verbose"));
+    int failures = 0;
+
+    // 1) Cada rede sozinha no modo simples
+    printf("redes (%.0f min cada, PRBS +-%.0f contagens):\n", minutes, excitation);
+    for (int plant = 1; plant <= 2; plant++) {
+        for (int comb = 0; comb < rc_network_count(plant); comb++) {
+            SimRunConfig_t cfg;
+            sim_run_default_config(&cfg);
+            cfg.plant_id = plant;
+            cfg.combination = comb;
+            cfg.duration_s = minutes * 60.0;
+            IdentifyState_t state = {};
+            state.excitation = excitation;
+            cfg.on_cycle = identify_on_cycle;
+            cfg.on_cycle_ctx = &state;
+
+            SimRunResult_t result;
+            sim_run_closed_loop(&cfg, &result);
+            IdentReport_t report;
+            ident_report_read(&report);
+            if (!identify_check(&report.models[gain_schedule_index(plant, comb)], plant, comb, gain_tol, tau_tol,
+                                min_fit)) {
+                failures++;
+            }
+        }
+    }
+
+    // 2) Modo duplo: as duas malhas identificadas ao mesmo tempo
+    printf("modo duplo, combinacao 0:\n");
+    {
+        SimRunConfig_t cfg;
+        sim_run_default_config(&cfg);
+        cfg.dual = true;
+        cfg.duration_s = minutes * 60.0;
+        IdentifyState_t state = {};
+        state.excitation = excitation;
+        cfg.on_cycle = identify_on_cycle;
+        cfg.on_cycle_ctx = &state;
+
+        SimRunResult_t result;
+        sim_run_closed_loop(&cfg, &result);
+        IdentReport_t report;
+        ident_report_read(&report);
+        for (int plant = 1; plant <= 2; plant++) {
+            if (!identify_check(&report.models[gain_schedule_index(plant, 0)], plant, 0, gain_tol, tau_tol, min_fit)) {
+                failures++;
+            }
+        }
+    }
+
+    // 3) Deriva: C x drift_scale na Planta 1, combinacao 0, aos 4 min
+    printf("deriva: capacitor da P1/C0 x%.2f aos 4 min:\n", drift_scale);
+    {
+        SimRunConfig_t cfg;
+        sim_run_default_config(&cfg);
+        cfg.duration_s = 4 * 60.0 + minutes * 60.0;
+        IdentifyState_t state = {};
+        state.excitation = excitation;
+        state.plant_id = 1;
+        state.combination = 0;
+        state.drift_at_ms = 4 * 60 * 1000;
+        state.drift_scale = drift_scale;
+        cfg.on_cycle = identify_on_cycle;
+        cfg.on_cycle_ctx = &state;
+
+        SimRunResult_t result;
+        sim_run_closed_loop(&cfg, &result);
+        IdentReport_t report;
+        ident_report_read(&report);
+        const IdentModel_t *after = &report.models[gain_schedule_index(1, 0)];
+
+        bool reference_before = (state.before.flags & IDENT_MODEL_REFERENCE) && !(state.before.flags & IDENT_MODEL_DRIFT);
+        bool drift_after = (after->flags & IDENT_MODEL_DRIFT) != 0;
+        printf("  antes: referencia %s, tau=%.2f s  depois: tau=%.2f s (ref %.2f), deriva=%.0f%%, marcada=%s\n",
+               reference_before ? "sim" : "nao", state.before.tau_s, after->tau_s, after->tau_ref_s,
+               after->drift * 100.0, drift_after ? "sim" : "nao");
+        if (!reference_before || !drift_after) failures++;
+        if (!identify_check(after, 1, 0, gain_tol, tau_tol, min_fit)) failures++;
+        rc_network_set_capacitance_scale(1, 0, 1.0);
+    }
+
+    // 4) Custo de uma atualizacao
+    long iterations = sim_arg_long(argc, argv, "--iterations", 2000000);
+    printf("rls_update: n=4 %.1f ns, n=5 %.1f ns\n", identify_bench_rls<IDENT_MAX_PARAMS>(4, iterations),
+           identify_bench_rls<IDENT_MAX_PARAMS>(5, iterations));
+
+    printf("%s\n", failures == 0 ? "identificacao ok" : "identificacao FALHOU");
+    return failures == 0 ? 0 : 1;
+}
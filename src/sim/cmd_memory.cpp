@@ -0,0 +1,133 @@
+// src/sim/cmd_memory.cpp
+//
+// "memory": laco fechado com o heap vigiado (memory_budget.h). O primeiro
+// ciclo encerra a partida; dali em diante, o ciclo de controle e o trabalho
+// das consumidoras da telemetria (historico, assinaturas, quadros do
+// historico, texto do /metrics, pool de JSON) nao podem fazer nenhum new.
+// A unica thread do simulador e registrada como a tarefa de controle, entao
+// qualquer new conta como violacao. --inject-alloc faz um new por segundo
+// simulado, para conferir que o detector acusa. Mostra o relatorio de
+// memoria e, com --text, as linhas memory_* do /metrics.
+
+#include "sim_commands.h"
+#include "sim_runner.h"
+#include "memory_budget.h"
+#include "telemetry.h"
+#include "history.h"
+#include "subscriptions.h"
+#include "identification.h"
+#include "step_response.h"
+#include "config.h"
+
+#include <stdio.h>
+#include <vector>
+
+typedef struct {
+    TelemetryCursor_t cursor;
+    History_t history;
+    Subscriptions_t subscriptions;
+    uint8_t history_frame[HISTORY_MAX_FRAME_SIZE];
+    char text[LOOP_METRICS_TEXT_SIZE];
+    unsigned long cycles;
+    unsigned long sent_bytes;
+    bool inject;
+    std::vector<int> *leak;     // destino das alocacoes de --inject-alloc
+} MemoryRun_t;
+
+static bool memory_can_send(void *ctx, uint32_t client) {
+    (void)ctx;
+    (void)client;
+    return true;
+}
+
+static void memory_send(void *ctx, uint32_t client, const uint8_t *frame, size_t length) {
+    (void)client;
+    (void)frame;
+    ((MemoryRun_t *)ctx)->sent_bytes += length;
+}
+
+// O que as tarefas do plotter e do WebSocket e as rotas fariam, a cada ciclo
+// ou de tempos em tempos
+static void memory_on_cycle(void *ctx) {
+    MemoryRun_t *run = (MemoryRun_t *)ctx;
+    if (run->cycles++ == 0) {
+        memory_budget_seal();
+        return;
+    }
+
+    TelemetryRecord_t records[16];
+    int count;
+    while ((count = telemetry_drain(&run->cursor, records, 16)) > 0) {
+        for (int i = 0; i < count; i++) {
+            history_add(&run->history, &records[i]);
+            subscriptions_push(&run->subscriptions, &records[i]);
+        }
+    }
+    const SubscriptionSink_t sink = {memory_can_send, memory_send, run};
+    subscriptions_flush(&run->subscriptions, &sink);
+
+    if (run->cycles % 50 == 0) {
+        HistoryQuery_t query = {1, 600, 1000};
+        run->sent_bytes += history_build_frame(&run->history, &query, run->history_frame,
+                                               sizeof(run->history_frame));
+        size_t length = loop_metrics_format_text(run->text, sizeof(run->text));
+        length += ident_format_text(run->text + length, sizeof(run->text) - length);
+        length += step_response_format_text(run->text + length, sizeof(run->text) - length);
+        memory_budget_format_text(run->text + length, sizeof(run->text) - length);
+
+        char *json = g_jsonBuffers.acquire();
+        if (json != NULL) snprintf(json, JSON_BUFFER_SIZE, "{\"ciclos\":%lu}", run->cycles);
+        g_jsonBuffers.release(json);
+    }
+
+    if (run->inject && run->cycles % (1000 / SAMPLE_TIME_MS) == 0) run->leak->push_back((int)run->cycles);
+}
+
+int sim_cmd_memory(int argc, char **argv) {
+    double minutes = sim_arg_double(argc, argv, "--minutes", 10.0);
+    bool dual = sim_arg_flag(argc, argv, "--dual");
+    bool text = sim_arg_flag(argc, argv, "--text");
+    Serial.set_enabled(sim_arg_flag(argc, argv, "--verbose"));
+
+    static MemoryRun_t run;
+    std::vector<int> leak;
+    run.inject = sim_arg_flag(argc, argv, "--inject-alloc");
+    run.leak = &leak;
+    history_init(&run.history);
+    subscriptions_init(&run.subscriptions);
+    SubscriptionRequest_t request = {1, SUBSCRIPTION_SET, SUBSCRIPTION_CHANNELS_TELEMETRY, 1};
+    subscriptions_apply(&run.subscriptions, &request);
+    telemetry_attach(&run.cursor);
+
+    loop_metrics_register_task(LOOP_TASK_CONTROL, NULL);
+    memory_budget_register_task(LOOP_TASK_CONTROL, NULL, 0, false);
+
+    SimRunConfig_t cfg;
+    sim_run_default_config(&cfg);
+    cfg.duration_s = minutes * 60.0;
+    cfg.dual = dual;
+    cfg.on_cycle = memory_on_cycle;
+    cfg.on_cycle_ctx = &run;
+    SimRunResult_t result;
+    sim_run_closed_loop(&cfg, &result);
+
+    MemoryBudget_t budget;
+    memory_budget_read(&budget);
+    Serial.set_enabled(true);
+    printf("%lu ciclos (%.0f min simulados%s), %lu bytes em quadros\n", result.cycles, minutes,
+           dual ? ", duas malhas" : "", run.sent_bytes);
+    memory_budget_print();
+    if (text) {
+        memory_budget_format_text(run.text, sizeof(run.text));
+        fputs(run.text, stdout);
+    }
+
+    // Sem --inject-alloc, nenhuma alocacao depois da partida; com, uma por
+    // segundo (o vector dobra de tamanho: ao menos log2 delas)
+    uint32_t after = budget.tasks[LOOP_TASK_CONTROL].allocations;
+    bool ok = run.inject ? (after > 0 && budget.violations == after) : (after == 0 && budget.violations == 0);
+    printf("%s: %lu alocacoes depois da partida (%lu na partida)%s\n", ok ? "OK" : "FALHOU",
+           (unsigned long)after, (unsigned long)budget.allocations_boot,
+           run.inject ? ", provocadas por --inject-alloc" : "");
+    return ok ? 0 : 1;
+}
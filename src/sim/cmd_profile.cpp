@@ -0,0 +1,272 @@
+// src/sim/cmd_profile.cpp
+//
+// "profile": confere o perfil de setpoint compilado (setpoint.h) contra uma
+// referencia em double calculada de forma fechada amostra a amostra, o
+// periodo e o equilibrio do PRBS de cada ordem, as mensagens de erro do
+// parser, e que o setpoint aplicado em cada ciclo do laco fechado e
+// exatamente o que o player produz fora dele.
+
+#include "sim_commands.h"
+#include "sim_runner.h"
+#include "control_loop.h"
+#include "state_snapshot.h"
+#include "setpoint.h"
+#include "config.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+static const char *PROFILE_DEFAULT_TEXT =
+    "degrau 0.66 20; rampa 0.66 2.64 40; seno 1.65 0.8 0.01 0.5 120;"
+    "prbs 1.2 2.1 1 7 127; tabela 0:2.0 10:1.0 15:1.0 30:2.5";
+
+// --- Referencia independente ---
+
+typedef struct {
+    double max_error[4];        // por tipo de segmento, em contagens
+    long samples;
+} ProfileCheck_t;
+
+static void profile_check_sample(ProfileCheck_t *check, int type, double expected, float got) {
+    double e = fabs(expected - (double)got);
+    if (e > check->max_error[type]) check->max_error[type] = e;
+    check->samples++;
+}
+
+// Percorre o perfil com o player e compara segmento a segmento com a
+// formula fechada. Os parametros do segmento vem do proprio perfil (ja em
+// contagens e amostras); para o seno a fase e recalculada em double a
+// partir de f0/f1, nao pelo acumulador.
+static bool profile_check_exact(const SetpointProfile_t *profile, const double (*sine_hz)[2], ProfileCheck_t *check) {
+    const double ts = SAMPLE_TIME_S;
+    SetpointPlayer_t player;
+    setpoint_player_start(&player, profile);
+    memset(check, 0, sizeof(*check));
+
+    int sine_index = 0;
+    for (int s = 0; s < profile->count; s++) {
+        const SetpointSegment_t *seg = &profile->segments[s];
+        double f0 = 0, k = 0;
+        uint16_t lfsr = 1;
+        if (seg->type == SETPOINT_SINE) {
+            f0 = sine_hz[sine_index][0];
+            k = (sine_hz[sine_index][1] - f0) / (seg->samples * ts);
+            sine_index++;
+        }
+
+        for (uint32_t n = 0; n < seg->samples; n++) {
+            double expected;
+            switch (seg->type) {
+            case SETPOINT_RAMP:
+                expected = seg->a + ((double)seg->b - seg->a) * n / seg->samples;
+                break;
+            case SETPOINT_SINE: {
+                double t = n * ts;
+                expected = seg->a + seg->b * sin(2.0 * M_PI * (f0 * t + 0.5 * k * t * t));
+                break;
+            }
+            case SETPOINT_PRBS:
+                // Mesmo LFSR de Galois, avancado bit a bit
+                if (n > 0 && n % seg->bit_samples == 0) {
+                    uint16_t lsb = lfsr & 1;
+                    lfsr >>= 1;
+                    if (lsb) lfsr ^= setpoint_prbs_taps(seg->order);
+                }
+                expected = (lfsr & 1) ? seg->b : seg->a;
+                break;
+            default:
+                expected = seg->a;
+                break;
+            }
+
+            float got;
+            if (!setpoint_player_next(&player, &got)) return false;
+            profile_check_sample(check, seg->type, expected, got);
+        }
+    }
+
+    // Depois do ultimo segmento vem uma amostra com o valor final e o
+    // player para
+    float got;
+    if (!setpoint_player_next(&player, &got)) return false;
+    const SetpointSegment_t *last = &profile->segments[profile->count - 1];
+    if (last->type == SETPOINT_RAMP && got != last->b) return false;
+    return !setpoint_player_next(&player, &got);
+}
+
+// --- PRBS ---
+
+static bool profile_check_prbs(int order, uint32_t *period, uint32_t *ones) {
+    uint16_t taps = setpoint_prbs_taps(order);
+    uint16_t lfsr = 1;
+    *period = 0;
+    *ones = 0;
+    do {
+        *ones += lfsr & 1;
+        uint16_t lsb = lfsr & 1;
+        lfsr >>= 1;
+        if (lsb) lfsr ^= taps;
+        (*period)++;
+    } while (lfsr != 1 && *period <= (1u << order));
+    return *period == (1u << order) - 1 && *ones == (1u << (order - 1));
+}
+
+// --- Laco fechado ---
+
+typedef struct {
+    SetpointPlayer_t reference;
+    long cycles;
+    long mismatches;
+    long flagged;
+} ProfileLoopState_t;
+
+static void profile_on_cycle(void *ctx) {
+    ProfileLoopState_t *state = (ProfileLoopState_t *)ctx;
+    StateSnapshot_t snapshot;
+    state_snapshot_read(&snapshot);
+
+    float expected;
+    if (setpoint_player_next(&state->reference, &expected)) {
+        // O snapshot guarda o float do estado em double: a conversao e exata
+        if (snapshot.sp != (double)expected) state->mismatches++;
+        state->flagged++;
+    } else if (snapshot.sp != state->reference.value) {
+        state->mismatches++;
+    }
+    state->cycles++;
+}
+
+int sim_cmd_profile(int argc, char **argv) {
+    const char *text = sim_arg_string(argc, argv, "--text", PROFILE_DEFAULT_TEXT);
+    double laps = sim_arg_double(argc, argv, "--laps", 2.5);
+    Serial.set_enabled(sim_arg_flag(argc, argv, "--verbose"));
+    int failures = 0;
+
+    // 1. Compilacao
+    static SetpointProfile_t profile;
+    char error[64];
+    if (!setpoint_profile_parse(text, &profile, error, sizeof(error))) {
+        printf("ERRO: %s\n", error);
+        return 1;
+    }
+    printf("Perfil: %u segmentos, %lu amostras (%.1f s), %u bytes compilado\n", profile.count,
+           (unsigned long)profile.total_samples, profile.total_samples * SAMPLE_TIME_S,
+           (unsigned)(sizeof(SetpointSegment_t) * profile.count));
+
+    // 2. Exatidao contra a referencia em double. As frequencias dos senos
+    //    sao relidas do texto para a referencia nao depender de w0/dw (em
+    //    float, como o parser as le).
+    double sine_hz[SETPOINT_MAX_SEGMENTS][2];
+    int sines = 0;
+    for (const char *p = strstr(text, "seno"); p != NULL && sines < SETPOINT_MAX_SEGMENTS; p = strstr(p + 4, "seno")) {
+        float ofs, amp, f0, f1;
+        if (sscanf(p + 4, "%f %f %f %f", &ofs, &amp, &f0, &f1) == 4) {
+            sine_hz[sines][0] = f0;
+            sine_hz[sines][1] = f1;
+            sines++;
+        }
+    }
+
+    ProfileCheck_t check;
+    bool ended = profile_check_exact(&profile, sine_hz, &check);
+    static const char *TYPE_NAMES[] = {"degrau", "rampa", "seno", "prbs"};
+    static const double TOLERANCE[] = {0.0, 1e-3, 0.05, 0.0};
+    printf("Exatidao em %ld amostras (erro maximo, contagens do ADC):\n", check.samples);
+    for (int type = 0; type < 4; type++) {
+        bool ok = check.max_error[type] <= TOLERANCE[type];
+        printf("  %-7s %.6f  %s\n", TYPE_NAMES[type], check.max_error[type], ok ? "ok" : "FALHOU");
+        failures += !ok;
+    }
+    printf("  fim do perfil: %s\n", ended ? "valor final mantido, player parado" : "FALHOU");
+    failures += !ended;
+
+    // 3. PRBS de cada ordem: periodo maximo e um a mais de uns que de zeros
+    int prbs_failures = 0;
+    for (int order = SETPOINT_PRBS_MIN_ORDER; order <= SETPOINT_PRBS_MAX_ORDER; order++) {
+        uint32_t period, ones;
+        if (!profile_check_prbs(order, &period, &ones)) {
+            printf("  PRBS ordem %d: periodo %lu, %lu uns  FALHOU\n", order, (unsigned long)period, (unsigned long)ones);
+            prbs_failures++;
+        }
+    }
+    printf("PRBS ordens %d-%d: %s\n", SETPOINT_PRBS_MIN_ORDER, SETPOINT_PRBS_MAX_ORDER,
+           prbs_failures == 0 ? "periodo 2^n-1 e 2^(n-1) uns em todas" : "FALHOU");
+    failures += prbs_failures;
+
+    // 4. Erros do parser
+    static const struct { const char *text; const char *error; } BAD[] = {
+        {"degrau 1.0 5; subida 1 2 3", "segmento 2: tipo desconhecido"},
+        {"rampa 1.0 2.0", "segmento 1: parametros invalidos"},
+        {"seno 1.65 0.5 0.1 3.0 60", "segmento 1: parametros invalidos"},
+        {"prbs 1 2 1 17 60", "segmento 1: parametros invalidos"},
+        {"tabela 0:1 5:2 4:3", "segmento 1: parametros invalidos"},
+        {"degrau 1.0 0", "segmento 1: parametros invalidos"},
+        {" ; \n", "perfil vazio"},
+    };
+    int parser_failures = 0;
+    SetpointProfile_t scratch;
+    for (const auto &bad : BAD) {
+        bool accepted = setpoint_profile_parse(bad.text, &scratch, error, sizeof(error));
+        if (accepted || strcmp(error, bad.error) != 0) {
+            printf("  \"%s\": %s (esperado \"%s\")\n", bad.text, accepted ? "aceito" : error, bad.error);
+            parser_failures++;
+        }
+    }
+    printf("Parser: %d de %d entradas invalidas rejeitadas com a mensagem certa\n",
+           (int)(sizeof(BAD) / sizeof(BAD[0])) - parser_failures, (int)(sizeof(BAD) / sizeof(BAD[0])));
+    failures += parser_failures;
+
+    // O maior perfil (SETPOINT_MAX_SEGMENTS senos com tres casas) cabe no
+    // texto que o comando do WebSocket aceita
+    char longest[SETPOINT_MAX_SEGMENTS * 64];
+    int used = 0;
+    for (int i = 0; i < SETPOINT_MAX_SEGMENTS; i++) {
+        used += snprintf(longest + used, sizeof(longest) - used, "seno 1.650 0.800 0.010 0.500 120.000;");
+    }
+    bool longest_ok = used <= SETPOINT_MAX_TEXT && setpoint_profile_parse(longest, &scratch, error, sizeof(error)) &&
+                      scratch.count == SETPOINT_MAX_SEGMENTS;
+    printf("Maior perfil: %d segmentos em %d caracteres (limite do comando %d)  %s\n", SETPOINT_MAX_SEGMENTS, used,
+           SETPOINT_MAX_TEXT, longest_ok ? "ok" : "FALHOU");
+    if (!longest_ok) failures++;
+
+    // 5. Custo por ciclo
+    SetpointPlayer_t player;
+    setpoint_profile_parse(PROFILE_DEFAULT_TEXT, &scratch, NULL, 0);
+    scratch.repeat = true;
+    setpoint_player_start(&player, &scratch);
+    const long iterations = 5000000;
+    float sink = 0, sp;
+    auto t0 = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; i++) {
+        setpoint_player_next(&player, &sp);
+        sink += sp;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - t0;
+    printf("Custo: %.1f ns por amostra (soma %.0f)\n", elapsed.count() * 1e9 / iterations, sink);
+
+    // 6. Laco fechado: o setpoint de cada ciclo e o do player, bit a bit,
+    //    inclusive ao dar a volta
+    profile.repeat = true;
+    SimRunConfig_t cfg;
+    sim_run_default_config(&cfg);
+    cfg.profile = &profile;
+    cfg.duration_s = laps * profile.total_samples * SAMPLE_TIME_S;
+
+    ProfileLoopState_t state;
+    memset(&state, 0, sizeof(state));
+    setpoint_player_start(&state.reference, &profile);
+    cfg.on_cycle = profile_on_cycle;
+    cfg.on_cycle_ctx = &state;
+
+    SimRunResult_t result;
+    sim_run_closed_loop(&cfg, &result);
+    bool exact = state.mismatches == 0 && state.flagged == state.cycles;
+    printf("Laco fechado (%.1f voltas, %ld ciclos): %ld setpoints diferentes do player  %s\n", laps, state.cycles,
+           state.mismatches, exact ? "ok" : "FALHOU");
+    printf("  seguimento: IAE %.2f V.s, RMS %.4f V\n", result.iae, result.rms_error);
+    failures += !exact;
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,77 @@
+// src/sim/cmd_record.cpp
+//
+// "record": roda o laco fechado com o gravador de execucoes ligado, como no
+// ESP32, e grava os arquivos em --dir. O gravador e chamado a cada
+// RUN_RECORDER_PERIOD_MS virtuais, no lugar da sua tarefa.
+
+#include "sim_commands.h"
+#include "sim_runner.h"
+#include "run_storage_sim.h"
+#include "run_recorder.h"
+#include "run_format.h"
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+typedef struct {
+    unsigned long next_poll_ms;
+} RecordState_t;
+
+static void record_on_cycle(void *ctx) {
+    RecordState_t *state = (RecordState_t *)ctx;
+    if (millis() < state->next_poll_ms) return;
+    state->next_poll_ms += RUN_RECORDER_PERIOD_MS;
+    run_recorder_poll();
+}
+
+int sim_cmd_record(int argc, char **argv) {
+    SimRunConfig_t cfg;
+    sim_run_default_config(&cfg);
+    cfg.plant_id = (int)sim_arg_long(argc, argv, "--plant", cfg.plant_id);
+    cfg.combination = (int)sim_arg_long(argc, argv, "--comb", cfg.combination);
+    cfg.kp = sim_arg_double(argc, argv, "--kp", cfg.kp);
+    cfg.ki = sim_arg_double(argc, argv, "--ki", cfg.ki);
+    cfg.kd = sim_arg_double(argc, argv, "--kd", cfg.kd);
+    cfg.duration_s = sim_arg_double(argc, argv, "--minutes", 30.0) * 60.0;
+    cfg.dual = sim_arg_flag(argc, argv, "--dual");
+    run_storage_sim_set_dir(sim_arg_string(argc, argv, "--dir", run_storage_sim_dir()));
+
+    Serial.set_enabled(sim_arg_flag(argc, argv, "--verbose"));
+
+    RecordState_t state = {RUN_RECORDER_PERIOD_MS};
+    cfg.on_cycle = record_on_cycle;
+    cfg.on_cycle_ctx = &state;
+
+    // Arquivos que ja estavam no diretorio, para listar so os novos
+    RunFileInfo_t before[RUN_MAX_FILES * 2];
+    int before_count = run_storage_list(before, RUN_MAX_FILES * 2);
+
+    run_recorder_init();
+    run_recorder_request_start();
+
+    SimRunResult_t result;
+    sim_run_closed_loop(&cfg, &result);
+
+    run_recorder_request_stop();
+    run_recorder_poll();
+
+    RunFileInfo_t files[RUN_MAX_FILES * 2];
+    int count = run_storage_list(files, RUN_MAX_FILES * 2);
+    unsigned long total = 0;
+    printf("%lu ciclos gravados em %s/:\n", result.cycles, run_storage_sim_dir());
+    for (int i = 0; i < count; i++) {
+        bool existed = false;
+        for (int j = 0; j < before_count; j++) existed |= strcmp(files[i].name, before[j].name) == 0;
+        if (existed) continue;
+        printf("  %-16s %8u bytes\n", files[i].name, (unsigned)files[i].size);
+        total += files[i].size;
+    }
+
+    unsigned long records = result.cycles * (cfg.dual ? 2 : 1);
+    if (records > 0) {
+        printf("%.2f bytes/registro no arquivo (registro de telemetria: %u bytes)\n",
+               (double)total / records, (unsigned)TELEMETRY_RECORD_SIZE);
+    }
+    return 0;
+}
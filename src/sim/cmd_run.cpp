@@ -0,0 +1,72 @@
+// src/sim/cmd_run.cpp
+//
+// "run": roda o laco fechado por horas de tempo simulado em cada combinacao
+// de planta/MUX (ou so na escolhida) e imprime um resumo por execucao.
+
+#include "sim_commands.h"
+#include "sim_runner.h"
+#include "rc_plant.h"
+#include "config.h"
+
+#include <stdio.h>
+
+int sim_cmd_run(int argc, char **argv) {
+    SimRunConfig_t cfg;
+    sim_run_default_config(&cfg);
+
+    int only_plant = (int)sim_arg_long(argc, argv, "--plant", 0);
+    int only_comb = (int)sim_arg_long(argc, argv, "--comb", -1);
+    cfg.duration_s = sim_arg_double(argc, argv, "--hours", 1.0) * 3600.0;
+    cfg.kp = sim_arg_double(argc, argv, "--kp", cfg.kp);
+    cfg.ki = sim_arg_double(argc, argv, "--ki", cfg.ki);
+    cfg.kd = sim_arg_double(argc, argv, "--kd", cfg.kd);
+    cfg.sp_period_s = sim_arg_double(argc, argv, "--sp-period", cfg.sp_period_s);
+    cfg.engine.adc_noise_lsb = sim_arg_double(argc, argv, "--noise", cfg.engine.adc_noise_lsb);
+    cfg.engine.adc_inl_lsb = sim_arg_double(argc, argv, "--inl", cfg.engine.adc_inl_lsb);
+    cfg.engine.seed = (uint32_t)sim_arg_long(argc, argv, "--seed", cfg.engine.seed);
+    cfg.dual = sim_arg_flag(argc, argv, "--dual");
+    cfg.decimation = (AdcDecimation_t)sim_arg_long(argc, argv, "--filter", cfg.decimation);
+
+    const char *csv_path = sim_arg_string(argc, argv, "--csv", NULL);
+    if (csv_path != NULL) {
+        cfg.trace = fopen(csv_path, "w");
+        if (cfg.trace == NULL) {
+            fprintf(stderr, "nao foi possivel abrir %s\n", csv_path);
+            return 1;
+        }
+    }
+
+    Serial.set_enabled(sim_arg_flag(argc, argv, "--verbose"));
+
+    printf("Kp=%.4f Ki=%.4f Kd=%.4f | %.1f h simuladas por execucao, Ts=%lu ms\n",
+           cfg.kp, cfg.ki, cfg.kd, cfg.duration_s / 3600.0, SAMPLE_TIME_MS);
+    printf("%-34s %9s %10s %9s %9s %8s %9s\n",
+           "rede", "ciclos", "IAE(V.s)", "RMS(V)", "sat(s)", "real(s)", "acel.");
+
+    for (int plant = 1; plant <= 2; plant++) {
+        if (only_plant != 0 && plant != only_plant) continue;
+
+        for (int comb = 0; comb < rc_network_count(plant); comb++) {
+            if (only_comb >= 0 && comb != only_comb) continue;
+            // No modo duplo a Planta 1 conduz o MUX e a Planta 2 acompanha
+            // (so existe nas combinacoes 0 e 1)
+            if (cfg.dual && (plant != 1 || comb >= rc_network_count(2))) continue;
+
+            SimRunResult_t r;
+            cfg.plant_id = plant;
+            cfg.combination = comb;
+            sim_run_closed_loop(&cfg, &r);
+
+            printf("%-34s %9lu %10.2f %9.4f %9.1f %8.3f %8.0fx\n",
+                   rc_network_for(plant, comb)->name, r.cycles, r.iae, r.rms_error,
+                   r.saturated_s, r.wall_s, cfg.duration_s / (r.wall_s > 0 ? r.wall_s : 1e-9));
+            if (cfg.dual) {
+                printf("  + %-30s %9s %10.2f  (malha simultanea)\n",
+                       rc_network_for(3 - plant, comb)->name, "", r.iae_other);
+            }
+        }
+    }
+
+    if (cfg.trace) fclose(cfg.trace);
+    return 0;
+}
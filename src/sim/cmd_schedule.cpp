@@ -0,0 +1,313 @@
+// src/sim/cmd_schedule.cpp
+//
+// "schedule": monta a tabela de ganhos com o ensaio do rele em cada rede
+// (pelo caminho do ESP32: o resultado do ensaio vai para a entrada da rede
+// ativa), confere o blob gravado (tambem com a gravacao cortada no meio e
+// com ganhos invalidos) e compara o transitorio das trocas de rede na
+// varredura programada, com e sem a tabela. Em cada troca, o y do primeiro
+// ciclo tem que ser o da rede nova.
+
+#include "sim_commands.h"
+#include "sim_runner.h"
+#include "blob_storage_sim.h"
+#include "control_loop.h"
+#include "state_snapshot.h"
+#include "gain_schedule.h"
+#include "autotune.h"
+#include "config.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static bool schedule_same_entries(const GainTable_t *a, const GainTable_t *b) {
+    return memcmp(a->entries, b->entries, sizeof(a->entries)) == 0;
+}
+
+// Gravacao cortada nos dois pontos do SPIFFS: entre apagar e renomear vale
+// a copia nova; durante a escrita, o arquivo antigo. Um blob com ganho NaN
+// ou negativo (CRC correto) e recusado.
+static bool schedule_check_storage(const GainTable_t *saved) {
+    GainTable_t newer = *saved, newest = *saved, loaded;
+    newer.entries[0].kp += 1.0f;
+    newest.entries[0].kp += 2.0f;
+
+    blob_storage_sim_cut_next_write(BLOB_SIM_CUT_RENAME);
+    gain_schedule_save(&newer);
+    bool rename_ok = gain_schedule_load(&loaded) && schedule_same_entries(&loaded, &newer);
+    printf("Corte entre apagar e renomear: %s\n", rename_ok ? "copia temporaria lida" : "TABELA PERDIDA");
+
+    gain_schedule_save(&newer);
+    blob_storage_sim_cut_next_write(BLOB_SIM_CUT_WRITING);
+    gain_schedule_save(&newest);
+    bool writing_ok = gain_schedule_load(&loaded) && schedule_same_entries(&loaded, &newer);
+    printf("Corte durante a escrita: %s\n", writing_ok ? "arquivo anterior lido" : "ERRADO");
+
+    uint8_t blob[GAIN_SCHEDULE_BLOB_SIZE];
+    GainTable_t bad = *saved;
+    bad.entries[1].kp = NAN;
+    bool nan_rejected = !gain_schedule_decode(blob, gain_schedule_encode(&bad, blob), &loaded);
+    bad = *saved;
+    bad.entries[2].ki = -0.1f;
+    bool negative_rejected = !gain_schedule_decode(blob, gain_schedule_encode(&bad, blob), &loaded);
+    printf("Ganho NaN / negativo: %s / %s\n", nan_rejected ? "recusado" : "ACEITO",
+           negative_rejected ? "recusado" : "ACEITO");
+
+    // Deixa gravada a tabela original
+    gain_schedule_save(saved);
+    return rename_ok && writing_ok && nan_rejected && negative_rejected;
+}
+
+static int schedule_network_count() {
+    int count = 0;
+    for (int plant = 1; plant <= GAIN_SCHEDULE_PLANTS; plant++) {
+        for (int comb = 0; comb < GAIN_SCHEDULE_COMBINATIONS; comb++) count += gain_schedule_index(plant, comb) >= 0;
+    }
+    return count;
+}
+
+// --- Sintonia de todas as redes ---
+
+typedef struct {
+    int network;                // entrada da tabela em ensaio
+    unsigned long phase_ms;     // inicio da fase atual
+    bool testing;
+    uint32_t report_seq;
+    int rule;
+    double amplitude;
+    double warmup_s;
+    bool done;
+} TuneState_t;
+
+static bool schedule_next_network(int from, int *plant, int *combination) {
+    for (int i = from; i < GAIN_SCHEDULE_ENTRIES; i++) {
+        int p = i / GAIN_SCHEDULE_COMBINATIONS + 1;
+        int c = i % GAIN_SCHEDULE_COMBINATIONS;
+        if (gain_schedule_index(p, c) == i) {
+            *plant = p;
+            *combination = c;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void tune_on_cycle(void *ctx) {
+    TuneState_t *state = (TuneState_t *)ctx;
+    if (state->done) return;
+    unsigned long now = millis();
+
+    if (!state->testing) {
+        if (now - state->phase_ms < (unsigned long)(state->warmup_s * 1000.0)) return;
+        AutotuneReport_t report;
+        autotune_report_read(&report);
+        state->report_seq = report.seq;
+        control_loop_request_autotune(true, state->rule, state->amplitude);
+        state->testing = true;
+        return;
+    }
+
+    AutotuneReport_t report;
+    autotune_report_read(&report);
+    if (report.seq == state->report_seq || report.status == AUTOTUNE_RUNNING) return;
+
+    int plant, combination;
+    if (!schedule_next_network(state->network + 1, &plant, &combination)) {
+        state->done = true;
+        return;
+    }
+    state->network = gain_schedule_index(plant, combination);
+    control_loop_request_plant(plant, combination);
+    state->phase_ms = now;
+    state->testing = false;
+}
+
+// --- Varredura ---
+
+static const double SWITCH_WINDOW_S = 20.0;
+static const double SWITCH_Y_TOLERANCE_V = 0.05;   // ruido e INL do ADC simulado
+
+typedef struct {
+    unsigned long switch_ms;
+    bool in_window;
+    int switches;               // trocas vistas (a primeira volta e descartada)
+    double iae[GAIN_SCHEDULE_ENTRIES];
+    double peak[GAIN_SCHEDULE_ENTRIES];
+    int count[GAIN_SCHEDULE_ENTRIES];
+    double window_iae, window_peak;
+    int window_network;
+    // y do primeiro ciclo depois da troca contra a tensao da rede nova e
+    // contra o y anterior (da rede velha)
+    bool switch_pending;
+    float y_before;
+    int switch_checks;
+    double switch_error_max, switch_jump_max;
+} SweepState_t;
+
+static void sweep_on_cycle(void *ctx) {
+    SweepState_t *state = (SweepState_t *)ctx;
+    unsigned long now = millis();
+
+    StateSnapshot_t snapshot;
+    state_snapshot_read(&snapshot);
+
+    if (state->switch_pending && gain_schedule_index(snapshot.active_plant, snapshot.mux_combination) ==
+                                     state->window_network) {
+        double to_volts = VCC / ADC_RESOLUTION;
+        double v = sim_engine_plant_voltage(snapshot.active_plant);
+        state->switch_error_max = fmax(state->switch_error_max, fabs(snapshot.y * to_volts - v));
+        state->switch_jump_max = fmax(state->switch_jump_max, fabs(state->y_before * to_volts - v));
+        state->switch_checks++;
+        state->switch_pending = false;
+    }
+
+    if (state->in_window) {
+        double sp_v = snapshot.sp / ADC_RESOLUTION * VCC;
+        double e = fabs(sp_v - sim_engine_plant_voltage(snapshot.active_plant));
+        state->window_iae += e * SAMPLE_TIME_S;
+        if (e > state->window_peak) state->window_peak = e;
+        if (now - state->switch_ms >= (unsigned long)(SWITCH_WINDOW_S * 1000.0)) {
+            // A primeira volta visita cada rede pela primeira vez (capacitores
+            // descarregados); so as voltas seguintes entram na media
+            if (state->switches > schedule_network_count()) {
+                int n = state->window_network;
+                state->iae[n] += state->window_iae;
+                if (state->window_peak > state->peak[n]) state->peak[n] = state->window_peak;
+                state->count[n]++;
+            }
+            state->in_window = false;
+        }
+    }
+
+    BankSnapshot_t bank;
+    bank_snapshot_read(&bank);
+    int plant, combination;
+    if (gain_schedule_sweep_next(now, snapshot.active_plant, snapshot.mux_combination, bank.loops > 0, &plant,
+                                 &combination)) {
+        control_loop_request_plant(plant, combination);
+        state->switch_pending = true;
+        state->y_before = snapshot.y;
+        state->switch_ms = now;
+        state->in_window = true;
+        state->window_iae = 0;
+        state->window_peak = 0;
+        state->window_network = gain_schedule_index(plant, combination);
+        state->switches++;
+    }
+}
+
+static bool schedule_run_sweep(const char *name, const GainTable_t *table, float kp, float ki, float kd,
+                               double dwell_s, int laps) {
+    SimRunConfig_t cfg;
+    sim_run_default_config(&cfg);
+    cfg.kp = kp;
+    cfg.ki = ki;
+    cfg.kd = kd;
+    cfg.gain_schedule = table;
+    cfg.duration_s = dwell_s * schedule_network_count() * laps + 1.0;
+
+    // A referencia troca no meio da permanencia, uma vez a cada duas redes:
+    // nenhuma janela pega um degrau de referencia, e como sao 6 redes cada
+    // uma volta ao laco com a referencia oposta a de quando saiu (os
+    // capacitores guardaram a tensao antiga)
+    cfg.sp_period_s = 4.0 * dwell_s;
+    cfg.sp_phase_s = 1.5 * dwell_s;
+
+    SweepState_t state;
+    memset(&state, 0, sizeof(state));
+    cfg.on_cycle = sweep_on_cycle;
+    cfg.on_cycle_ctx = &state;
+
+    gain_schedule_request_sweep(true, (uint32_t)(dwell_s * 1000.0));
+    SimRunResult_t result;
+    sim_run_closed_loop(&cfg, &result);
+    gain_schedule_request_sweep(false, 0);
+
+    double total_iae = 0, worst_peak = 0;
+    int total = 0;
+    printf("  %s\n", name);
+    for (int i = 0; i < GAIN_SCHEDULE_ENTRIES; i++) {
+        if (state.count[i] == 0) continue;
+        printf("    -> P%d/C%d  IAE medio %6.2f V.s   pico %.3f V\n", i / GAIN_SCHEDULE_COMBINATIONS + 1,
+               i % GAIN_SCHEDULE_COMBINATIONS, state.iae[i] / state.count[i], state.peak[i]);
+        total_iae += state.iae[i];
+        total += state.count[i];
+        if (state.peak[i] > worst_peak) worst_peak = state.peak[i];
+    }
+    if (total > 0) {
+        printf("    media de %d trocas: IAE %.2f V.s nos %.0f s seguintes, pior pico %.3f V\n", total,
+               total_iae / total, SWITCH_WINDOW_S, worst_peak);
+    }
+    bool ok = state.switch_checks > 0 && state.switch_error_max <= SWITCH_Y_TOLERANCE_V;
+    printf("    y no ciclo da troca: erro maximo %.3f V para a rede nova (a rede anterior chegava a %.3f V)  %s\n",
+           state.switch_error_max, state.switch_jump_max, ok ? "ok" : "FALHOU");
+    return ok;
+}
+
+int sim_cmd_schedule(int argc, char **argv) {
+    const char *rule_name = sim_arg_string(argc, argv, "--rule", "zn");
+    int rule = AUTOTUNE_RULE_ZN;
+    if (strcmp(rule_name, "tl") == 0) rule = AUTOTUNE_RULE_TL;
+    else if (strcmp(rule_name, "simc") == 0) rule = AUTOTUNE_RULE_SIMC;
+    double dwell_s = sim_arg_double(argc, argv, "--dwell", 45.0);
+    int laps = (int)sim_arg_long(argc, argv, "--laps", 4);
+
+    Serial.set_enabled(sim_arg_flag(argc, argv, "--verbose"));
+
+    // 1. Ensaio do rele rede a rede, com a tabela ligada
+    GainTable_t table;
+    gain_schedule_defaults(&table, 0.05f, 0.1f, 0.0f);
+
+    SimRunConfig_t cfg;
+    sim_run_default_config(&cfg);
+    cfg.gain_schedule = &table;
+    cfg.sp_low_v = cfg.sp_high_v = 0.5 * VCC;
+    cfg.duration_s = schedule_network_count() * (120.0 + AUTOTUNE_TIMEOUT_S);
+
+    TuneState_t tune;
+    memset(&tune, 0, sizeof(tune));
+    tune.rule = rule;
+    tune.amplitude = AUTOTUNE_DEFAULT_AMPLITUDE;
+    tune.warmup_s = 120.0;
+    cfg.on_cycle = tune_on_cycle;
+    cfg.on_cycle_ctx = &tune;
+
+    SimRunResult_t result;
+    sim_run_closed_loop(&cfg, &result);
+
+    GainTable_t tuned;
+    gain_schedule_read(&tuned);
+    printf("Tabela de ganhos (%s):\n", autotune_rule_name((AutotuneRule_t)rule));
+    for (int i = 0; i < GAIN_SCHEDULE_ENTRIES; i++) {
+        int plant = i / GAIN_SCHEDULE_COMBINATIONS + 1;
+        int comb = i % GAIN_SCHEDULE_COMBINATIONS;
+        if (gain_schedule_index(plant, comb) != i) continue;
+        const GainScheduleEntry_t *e = &tuned.entries[i];
+        printf("  P%d/C%d  kp=%8.4f ki=%8.4f kd=%8.4f  %s\n", plant, comb, e->kp, e->ki, e->kd,
+               (e->flags & GAIN_ENTRY_AUTOTUNE) ? "ensaio" : "padrao");
+    }
+
+    // 2. Blob: grava como a combination_selector_task e le como no boot
+    gain_schedule_persist();
+    GainTable_t loaded;
+    if (!gain_schedule_load(&loaded)) {
+        printf("ERRO: tabela gravada nao pode ser lida\n");
+        return 1;
+    }
+    bool same = true;
+    for (int i = 0; i < GAIN_SCHEDULE_ENTRIES; i++) {
+        same &= memcmp(&loaded.entries[i], &tuned.entries[i], sizeof(GainScheduleEntry_t)) == 0;
+    }
+    printf("Blob de %u bytes: %s\n", (unsigned)GAIN_SCHEDULE_BLOB_SIZE, same ? "lido igual ao gravado" : "DIFERENTE");
+    if (!same) return 1;
+    if (!schedule_check_storage(&loaded)) return 1;
+
+    // 3. Varredura com a referencia em onda quadrada: so ganhos fixos
+    //    (padrao e os da P1/C0) contra a tabela
+    printf("Varredura: %.0f s por rede, %d voltas (a primeira e descartada)\n", dwell_s, laps);
+    bool ok = schedule_run_sweep("sem tabela, ganhos padrao", NULL, 0.05f, 0.1f, 0.0f, dwell_s, laps);
+    const GainScheduleEntry_t *first = &loaded.entries[0];
+    ok &= schedule_run_sweep("sem tabela, ganhos da P1/C0", NULL, first->kp, first->ki, first->kd, dwell_s, laps);
+    ok &= schedule_run_sweep("tabela de ganhos", &loaded, 0, 0, 0, dwell_s, laps);
+    return ok ? 0 : 1;
+}
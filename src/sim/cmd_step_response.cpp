@@ -0,0 +1,291 @@
+// src/sim/cmd_step_response.cpp
+//
+// "step-response": analise de degraus em linha (step_response.h) contra a
+// mesma analise feita depois, sobre todas as amostras gravadas. Cada rede
+// roda em laco fechado com a referencia em onda quadrada; cada salto tem
+// que virar exatamente um resultado, e as medidas incrementais tem que
+// bater com as calculadas em lote sobre a janela de cada degrau. Um perfil
+// so de rampas nao pode gerar degrau nenhum. Depois, um capacitor
+// "envelhece" no meio da execucao e a acomodacao dos degraus seguintes tem
+// que piorar. Mede tambem o custo de uma amostra.
+
+#include "sim_commands.h"
+#include "sim_runner.h"
+#include "rc_plant.h"
+#include "state_snapshot.h"
+#include "step_response.h"
+#include "setpoint.h"
+#include "config.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+
+typedef struct {
+    std::vector<float> sp, y;   // por ciclo, a partir de base
+    uint32_t base;              // ciclo da primeira amostra (o contador segue entre execucoes)
+    int plant_id, combination;
+    unsigned long drift_at_ms;  // 0 desliga
+    double drift_scale;
+    bool drifted;
+} StepRecording_t;
+
+static void step_on_cycle(void *ctx) {
+    StepRecording_t *rec = (StepRecording_t *)ctx;
+    StateSnapshot_t state;
+    state_snapshot_read(&state);
+    // O snapshot sai depois de contar o ciclo
+    if (rec->sp.empty()) rec->base = state.cycle - 1;
+    size_t index = state.cycle - 1 - rec->base;
+    if (rec->sp.size() <= index) {
+        rec->sp.resize(index + 1);
+        rec->y.resize(index + 1);
+    }
+    rec->sp[index] = (float)state.sp;
+    rec->y[index] = (float)state.y;
+    if (rec->drift_at_ms > 0 && !rec->drifted && millis() >= rec->drift_at_ms) {
+        rec->drifted = true;
+        rc_network_set_capacitance_scale(rec->plant_id, rec->combination, rec->drift_scale);
+    }
+}
+
+// Medidas do degrau que comeca em start e dura samples amostras, com as
+// definicoes do step_response.h, a partir das amostras gravadas
+static void step_batch(const StepRecording_t *rec, uint32_t start, uint32_t samples, StepResult_t *out) {
+    const float to_v = (float)VCC / ADC_RESOLUTION;
+    const double ts = SAMPLE_TIME_S;
+    float from = rec->sp[start - 1], target = rec->sp[start];
+    float size = fabsf(target - from), dir = target > from ? 1.0f : -1.0f;
+    float band = fmaxf(STEP_SETTLE_BAND * size, STEP_MIN_BAND);
+
+    int rise10 = -1, rise90 = -1, last_out = -1;
+    double peak = 0.0, iae = 0.0;
+    for (uint32_t k = 0; k < samples; k++) {
+        float y = rec->y[start + k];
+        float e = target - y;
+        iae += fabs(e);
+        peak = fmax(peak, dir * (y - target));
+        float progress = dir * (y - from) / size;
+        if (rise10 < 0 && progress >= 0.1f) rise10 = (int)k;
+        if (rise90 < 0 && progress >= 0.9f) rise90 = (int)k;
+        if (fabsf(e) > band) last_out = (int)k;
+    }
+    // Acomodado: as ultimas STEP_HOLD_SAMPLES (ou mais) dentro da faixa
+    bool settled = (int)samples - 1 - last_out >= (int)STEP_HOLD_SAMPLES;
+    double steady = 0.0;
+    if (settled) {
+        for (uint32_t k = last_out + 1; k < samples; k++) steady += rec->sp[start] - rec->y[start + k];
+        steady /= samples - (last_out + 1);
+    } else {
+        steady = target - rec->y[start + samples - 1];
+    }
+
+    out->rise_s = (rise10 >= 0 && rise90 >= 0) ? (float)((rise90 - rise10) * ts) : -1.0f;
+    out->overshoot_pct = (float)(peak / size * 100.0);
+    out->settling_s = settled ? (float)((last_out + 1) * ts) : -1.0f;
+    out->steady_error_v = (float)(steady * to_v);
+    out->iae = (float)(iae * to_v * ts);
+    out->flags = settled ? STEP_RESULT_SETTLED : 0;
+}
+
+static bool step_close(double a, double b, double tolerance) {
+    return fabs(a - b) <= tolerance * fmax(1.0, fabs(b));
+}
+
+// Confere cada resultado guardado contra o lote; retorna quantos falharam
+static int step_check(const StepRecording_t *rec, const StepHistory_t *history, bool verbose) {
+    int failures = 0;
+    uint32_t kept = history->count < (uint32_t)STEP_HISTORY ? history->count : STEP_HISTORY;
+    for (uint32_t k = history->count - kept; k < history->count; k++) {
+        const StepResult_t *step = &history->steps[k % STEP_HISTORY];
+        StepResult_t batch;
+        uint32_t samples = (uint32_t)lround(step->duration_s * 1000.0 / SAMPLE_TIME_MS);
+        step_batch(rec, step->cycle - rec->base, samples, &batch);
+        bool ok = step_close(step->rise_s, batch.rise_s, 1e-4) &&
+                  step_close(step->overshoot_pct, batch.overshoot_pct, 1e-3) &&
+                  step_close(step->settling_s, batch.settling_s, 1e-4) &&
+                  step_close(step->steady_error_v, batch.steady_error_v, 1e-3) &&
+                  step_close(step->iae, batch.iae, 1e-3) && (step->flags & STEP_RESULT_SETTLED) == batch.flags;
+        if (!ok) failures++;
+        if (verbose || !ok) {
+            printf("    #%-3u %.2f->%.2f V  subida %5.2f s (%5.2f)  sobressinal %5.2f%% (%5.2f)  acomodacao %6.2f s (%6.2f)"
+                   "  erro %6.1f mV (%6.1f)  IAE %6.3f (%6.3f)  %s%s\n",
+                   (unsigned)step->seq, step->from_v, step->to_v, step->rise_s, batch.rise_s, step->overshoot_pct,
+                   batch.overshoot_pct, step->settling_s, batch.settling_s, step->steady_error_v * 1000.0,
+                   batch.steady_error_v * 1000.0, step->iae, batch.iae, step_response_state_name(step->flags),
+                   ok ? "" : "  FALHOU");
+        }
+    }
+    return failures;
+}
+
+static int step_count_jumps(const StepRecording_t *rec) {
+    int jumps = 0;
+    for (size_t k = 1; k < rec->sp.size(); k++) {
+        if (fabsf(rec->sp[k] - rec->sp[k - 1]) >= STEP_MIN_COUNTS) jumps++;
+    }
+    return jumps;
+}
+
+static void step_run(StepRecording_t *rec, SimRunConfig_t *cfg) {
+    rec->sp.clear();
+    rec->y.clear();
+    cfg->on_cycle = step_on_cycle;
+    cfg->on_cycle_ctx = rec;
+    SimRunResult_t result;
+    sim_run_closed_loop(cfg, &result);
+}
+
+int sim_cmd_step_response(int argc, char **argv) {
+    double minutes = sim_arg_double(argc, argv, "--minutes", 10.0);
+    double drift_scale = sim_arg_double(argc, argv, "--drift", 1.5);
+    bool verbose = sim_arg_flag(argc, argv, "--verbose");
+    Serial.set_enabled(false);
+    int failures = 0;
+    StepReport_t report;
+
+    // 1) Onda quadrada em cada rede: um resultado por salto, igual ao lote
+    printf("redes (%.0f min, onda quadrada de 60 s):\n", minutes);
+    for (int plant = 1; plant <= 2; plant++) {
+        for (int comb = 0; comb < rc_network_count(plant); comb++) {
+            SimRunConfig_t cfg;
+            sim_run_default_config(&cfg);
+            cfg.plant_id = plant;
+            cfg.combination = comb;
+            cfg.duration_s = minutes * 60.0;
+            StepRecording_t rec = {};
+            step_run(&rec, &cfg);
+            step_response_report_read(&report);
+            const StepHistory_t *history = &report.networks[gain_schedule_index(plant, comb)];
+            const StepResult_t *last = step_response_latest(&report, gain_schedule_index(plant, comb));
+            int jumps = step_count_jumps(&rec);
+            // O ultimo degrau pode estar em andamento no fim da execucao
+            bool counted = (int)history->count == jumps || (int)history->count == jumps - 1;
+            int mismatches = step_check(&rec, history, verbose);
+            printf("  P%d/C%d  saltos=%2d degraus=%2u  ultimo: subida %.2f s, sobressinal %.1f%%, acomodacao %.1f s, "
+                   "erro %.1f mV, IAE %.2f V.s  %s\n",
+                   plant, comb, jumps, (unsigned)history->count, last ? last->rise_s : 0.0,
+                   last ? last->overshoot_pct : 0.0, last ? last->settling_s : 0.0,
+                   last ? last->steady_error_v * 1000.0 : 0.0, last ? last->iae : 0.0,
+                   counted && mismatches == 0 ? "ok" : "FALHOU");
+            if (!counted || mismatches > 0) failures++;
+        }
+    }
+
+    // 2) Modo duplo: as duas malhas analisadas ao mesmo tempo
+    printf("modo duplo, combinacao 0:\n");
+    {
+        SimRunConfig_t cfg;
+        sim_run_default_config(&cfg);
+        cfg.dual = true;
+        cfg.duration_s = minutes * 60.0;
+        StepRecording_t rec = {};
+        step_run(&rec, &cfg);
+        step_response_report_read(&report);
+        for (int plant = 1; plant <= 2; plant++) {
+            const StepHistory_t *history = &report.networks[gain_schedule_index(plant, 0)];
+            int jumps = step_count_jumps(&rec);
+            bool counted = (int)history->count == jumps || (int)history->count == jumps - 1;
+            // A gravacao e da malha ativa (Planta 1); a outra so e contada
+            int mismatches = plant == 1 ? step_check(&rec, history, verbose) : 0;
+            printf("  P%d/C0  degraus=%2u  %s\n", plant, (unsigned)history->count,
+                   counted && mismatches == 0 ? "ok" : "FALHOU");
+            if (!counted || mismatches > 0) failures++;
+        }
+    }
+
+    // 3) Rampas: a referencia anda sem saltar, nenhum degrau
+    printf("perfil de rampas:\n");
+    {
+        SetpointProfile_t ramps;
+        setpoint_profile_parse("rampa 0.7 2.6 30; rampa 2.6 0.7 30; repetir", &ramps, NULL, 0);
+        SimRunConfig_t cfg;
+        sim_run_default_config(&cfg);
+        cfg.duration_s = 5 * 60.0;
+        cfg.profile = &ramps;
+        StepRecording_t rec = {};
+        step_run(&rec, &cfg);
+        step_response_report_read(&report);
+        bool ok = report.seq == 0;
+        printf("  degraus=%u  %s\n", (unsigned)report.seq, ok ? "ok" : "FALHOU");
+        if (!ok) failures++;
+    }
+
+    // 4) Deriva: C x drift_scale na P2/C0 no meio; os degraus seguintes
+    // demoram mais para acomodar
+    printf("deriva: capacitores da P2/C0 x%.2f no meio da execucao:\n", drift_scale);
+    {
+        SimRunConfig_t cfg;
+        sim_run_default_config(&cfg);
+        cfg.plant_id = 2;
+        cfg.combination = 0;
+        cfg.duration_s = 2 * minutes * 60.0;
+        StepRecording_t rec = {};
+        rec.plant_id = 2;
+        rec.combination = 0;
+        rec.drift_at_ms = (unsigned long)(minutes * 60.0 * 1000.0);
+        rec.drift_scale = drift_scale;
+
+        // Acomodacao media antes e depois, pelos resultados publicados
+        struct DriftWatch {
+            StepRecording_t *rec;
+            uint32_t seen;
+            double before, after;
+            int n_before, n_after;
+        } watch = {&rec, 0, 0.0, 0.0, 0, 0};
+        cfg.on_cycle = [](void *ctx) {
+            DriftWatch *w = (DriftWatch *)ctx;
+            step_on_cycle(w->rec);
+            StepReport_t r;
+            step_response_report_read(&r);
+            StepResult_t fresh[4];
+            int count = step_response_since(&r, w->seen, fresh, 4);
+            for (int i = 0; i < count; i++) {
+                w->seen = fresh[i].seq;
+                if (!(fresh[i].flags & STEP_RESULT_SETTLED)) continue;
+                // O degrau que atravessa a troca nao conta para nenhum lado
+                double start_ms = (double)(fresh[i].cycle - w->rec->base) * SAMPLE_TIME_MS;
+                bool after = start_ms >= w->rec->drift_at_ms;
+                bool before = start_ms + fresh[i].duration_s * 1000.0 < w->rec->drift_at_ms;
+                if (after) { w->after += fresh[i].settling_s; w->n_after++; }
+                if (before) { w->before += fresh[i].settling_s; w->n_before++; }
+            }
+        };
+        cfg.on_cycle_ctx = &watch;
+        SimRunResult_t result;
+        sim_run_closed_loop(&cfg, &result);
+        rc_network_set_capacitance_scale(2, 0, 1.0);
+
+        double before = watch.n_before ? watch.before / watch.n_before : 0.0;
+        double after = watch.n_after ? watch.after / watch.n_after : 0.0;
+        bool ok = watch.n_before > 0 && watch.n_after > 0 && after > before * 1.1;
+        printf("  acomodacao media: antes %.1f s (%d degraus), depois %.1f s (%d degraus)  %s\n", before,
+               watch.n_before, after, watch.n_after, ok ? "ok" : "FALHOU");
+        if (!ok) failures++;
+    }
+
+    // 5) Custo de uma amostra (com degraus a cada 100 amostras)
+    long iterations = sim_arg_long(argc, argv, "--iterations", 5000000);
+    step_response_init();
+    float y = 1000.0f;
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; i++) {
+        float sp = ((i / 100) & 1) ? 3000.0f : 1000.0f;
+        y += 0.1f * (sp - y);
+        step_response_update(1, 0, sp, y, (uint32_t)i);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    step_response_report_read(&report);
+    printf("step_response_update: %.1f ns por amostra (%u degraus publicados), relatorio de %zu bytes\n",
+           elapsed.count() * 1e9 / iterations, (unsigned)report.seq, sizeof(StepReport_t));
+
+    if (sim_arg_flag(argc, argv, "--text")) {
+        static char text[4096];
+        step_response_format_text(text, sizeof(text));
+        printf("%s", text);
+    }
+
+    printf("%s\n", failures == 0 ? "degraus ok" : "degraus FALHOU");
+    return failures == 0 ? 0 : 1;
+}
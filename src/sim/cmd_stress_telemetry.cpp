@@ -0,0 +1,151 @@
+// src/sim/cmd_stress_telemetry.cpp
+//
+// "stress-telemetry": uma thread produtora grava registros no anel de
+// telemetria na taxa pedida (ou o mais rapido possivel) enquanto varias
+// consumidoras, cada uma com seu cursor, esvaziam o anel em lotes. Confere
+// que cada consumidora recebe os ciclos em ordem, sem registros rasgados, e
+// que recebidos + perdidos (overflow) == produzidos. As ultimas --slow
+// consumidoras dormem entre lotes para forcar overflow so nelas.
+
+#include "sim_commands.h"
+#include "telemetry.h"
+
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+static void stress_fill(TelemetryRecord_t *r, uint32_t n) {
+    r->cycle = n;
+    r->time_ms = n * 3;
+    r->sp_v = (float)(n & 0xFFFF);
+    r->y_v = (float)(n & 0xFFFF) * 0.5f;
+    r->u = (float)(n & 0xFF);
+    r->iTerm = -(float)(n & 0xFFF);
+    r->plant = (uint8_t)((n & 1) + 1);
+    r->combination = (uint8_t)(n & 3);
+    r->flags = (uint8_t)(n & 2);
+    r->reserved = 0;
+}
+
+static bool stress_is_consistent(const TelemetryRecord_t *r) {
+    TelemetryRecord_t expected;
+    stress_fill(&expected, r->cycle);
+    return r->time_ms == expected.time_ms && r->sp_v == expected.sp_v && r->y_v == expected.y_v &&
+           r->u == expected.u && r->iTerm == expected.iTerm && r->plant == expected.plant &&
+           r->combination == expected.combination && r->flags == expected.flags;
+}
+
+typedef struct {
+    unsigned long received;
+    unsigned long torn;
+    unsigned long out_of_order;
+    unsigned long gaps;         // registros faltando entre recebidos
+    uint32_t overflows;
+    double seconds;
+} StressConsumer_t;
+
+int sim_cmd_stress_telemetry(int argc, char **argv) {
+    int consumers = (int)sim_arg_long(argc, argv, "--consumers", 3);
+    int slow = (int)sim_arg_long(argc, argv, "--slow", 1);
+    int batch = (int)sim_arg_long(argc, argv, "--batch", 32);
+    double rate = sim_arg_double(argc, argv, "--rate", 100000.0);   // registros/s, 0 = sem limite
+    double seconds = sim_arg_double(argc, argv, "--seconds", 2.0);
+    if (batch < 1) batch = 1;
+
+    std::atomic<bool> producing(true);
+    std::vector<StressConsumer_t> results(consumers);
+    std::vector<TelemetryCursor_t> cursors(consumers);
+    for (int c = 0; c < consumers; c++) telemetry_attach(&cursors[c]);
+    uint32_t first = telemetry_produced();
+
+    std::vector<std::thread> threads;
+    for (int c = 0; c < consumers; c++) {
+        threads.emplace_back([&, c] {
+            StressConsumer_t &res = results[c];
+            TelemetryCursor_t *cursor = &cursors[c];
+            std::vector<TelemetryRecord_t> records(batch);
+            bool is_slow = c >= consumers - slow;
+            bool have_last = false;
+            uint32_t last = 0;
+            res = StressConsumer_t();
+
+            auto start = std::chrono::steady_clock::now();
+            for (;;) {
+                // Le a flag antes de esvaziar: a ultima volta pega tudo o
+                // que foi produzido antes da produtora parar
+                bool more = producing.load(std::memory_order_acquire);
+                int count;
+                while ((count = telemetry_drain(cursor, records.data(), batch)) > 0) {
+                    for (int i = 0; i < count; i++) {
+                        const TelemetryRecord_t *r = &records[i];
+                        if (!stress_is_consistent(r)) res.torn++;
+                        if (have_last) {
+                            if (r->cycle <= last) res.out_of_order++;
+                            else res.gaps += r->cycle - last - 1;
+                        }
+                        have_last = true;
+                        last = r->cycle;
+                    }
+                    res.received += count;
+                    if (is_slow) std::this_thread::sleep_for(std::chrono::microseconds(500));
+                }
+                if (!more) break;
+                std::this_thread::yield();
+            }
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            res.seconds = elapsed.count();
+            res.overflows = telemetry_overflows(cursor);
+        });
+    }
+
+    // Produtora: com --rate grava em rajadas a cada 250 us e dorme entre
+    // elas, como a tarefa de controle com um periodo curto; sem --rate grava
+    // sem parar
+    const auto burst_period = std::chrono::microseconds(250);
+    unsigned long produced = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::duration<double>(seconds);
+    auto next_burst = start;
+    for (;;) {
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) break;
+        unsigned long target = produced + 1000;
+        if (rate > 0) {
+            std::chrono::duration<double> elapsed = now - start;
+            target = (unsigned long)(elapsed.count() * rate);
+        }
+        while (produced < target) {
+            TelemetryRecord_t r;
+            stress_fill(&r, first + (uint32_t)produced);
+            telemetry_push(&r);
+            produced++;
+        }
+        if (rate > 0) {
+            next_burst += burst_period;
+            std::this_thread::sleep_until(next_burst);
+        }
+    }
+    std::chrono::duration<double> produce_time = std::chrono::steady_clock::now() - start;
+    producing.store(false, std::memory_order_release);
+    for (auto &t : threads) t.join();
+
+    printf("produtora: %lu registros em %.2f s (%.2f M/s), anel de %d registros (%u bytes)\n",
+           produced, produce_time.count(), produced / produce_time.count() / 1e6, TELEMETRY_RING_SIZE,
+           (unsigned)(TELEMETRY_RING_SIZE * (sizeof(TelemetryRecord_t) + 4) + 4));
+    printf("%-4s %-6s %10s %10s %8s %8s %10s\n", "cons", "tipo", "recebidos", "overflow", "rasgados", "ordem", "M/s");
+
+    bool ok = true;
+    for (int c = 0; c < consumers; c++) {
+        const StressConsumer_t &res = results[c];
+        bool accounted = res.received + res.overflows == produced && res.gaps <= res.overflows;
+        printf("%-4d %-6s %10lu %10u %8lu %8lu %10.2f%s\n", c, c >= consumers - slow ? "lenta" : "rapida",
+               res.received, res.overflows, res.torn, res.out_of_order,
+               res.seconds > 0 ? res.received / res.seconds / 1e6 : 0.0, accounted ? "" : "  CONTAGEM ERRADA");
+        if (res.torn != 0 || res.out_of_order != 0 || !accounted) ok = false;
+    }
+
+    printf(ok ? "OK: todos os registros entregues ou contados como overflow\n" : "FALHA\n");
+    return ok ? 0 : 1;
+}
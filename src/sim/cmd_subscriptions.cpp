@@ -0,0 +1,300 @@
+// src/sim/cmd_subscriptions.cpp
+//
+// "subscriptions": roda o laco fechado alimentando as assinaturas
+// (subscriptions.h) pela telemetria, como a tarefa do WebSocket faz, com
+// clientes simulados de velocidades diferentes. Cada cliente tem uma fila
+// de envio como a do AsyncWebSocket (can_send: menos de
+// SUBSCRIPTION_SEND_BUDGET quadros esperando) e a esvazia no seu ritmo:
+//   rapido   le tudo depois de cada envio (A e B iguais, C entra e sai)
+//   decimado so y, um ciclo a cada 5
+//   lento    le um quadro a cada --slow-s
+//   travado  para de ler no meio da execucao e depois volta
+//   metricas so o quadro JSON, nenhum binario
+// Confere em todos: continuidade (first == next anterior + dropped +
+// skipped),
+// valores contra o fluxo de referencia, fila nunca acima do orcamento; nos
+// rapidos, nada descartado, nada adiado e tudo entregue no mesmo envio; e
+// que assinaturas iguais compartilham o quadro (codificados < entregues).
+
+#include "sim_commands.h"
+#include "sim_runner.h"
+#include "sim_engine.h"
+#include "subscriptions.h"
+#include "telemetry.h"
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <deque>
+#include <vector>
+
+typedef enum {
+    SUB_CLIENT_FAST = 0,
+    SUB_CLIENT_SLOW,
+    SUB_CLIENT_STALLED,
+} SubClientKind_t;
+
+typedef struct {
+    uint32_t id;
+    const char *label;
+    SubClientKind_t kind;
+    uint8_t channels;
+    uint8_t decimation;
+    double join, leave;             // fracao da execucao
+    bool connected;
+    bool have_next;
+    uint32_t expected_next;
+    uint64_t next_read_ms;          // lento: proxima leitura
+    uint32_t checked;               // rapido: fluxo conferido ate aqui
+    unsigned long selected;         // rapido: registros que deviam ter chegado
+    std::deque<std::vector<uint8_t>> queue;
+    size_t max_queue;
+    unsigned long frames, records, bytes, dropped;
+    unsigned long breaks, mismatches, late, overfull, after_leave;
+} SubClient_t;
+
+typedef struct {
+    Subscriptions_t *subs;
+    TelemetryCursor_t cursor;
+    uint32_t overflows;
+    std::vector<TelemetryRecord_t> reference;   // indice = posicao no fluxo
+    std::vector<SubClient_t> clients;
+    uint64_t duration_ms;
+    uint64_t flush_ms;
+    uint64_t next_flush_ms;
+    uint64_t slow_ms;
+    double stall_from, stall_to;
+    unsigned long flushes;
+} SubRun_t;
+
+static SubClient_t *sub_client(SubRun_t *run, uint32_t id) {
+    for (SubClient_t &c : run->clients) {
+        if (c.id == id) return &c;
+    }
+    return NULL;
+}
+
+static bool sub_can_send(void *ctx, uint32_t id) {
+    SubClient_t *c = sub_client((SubRun_t *)ctx, id);
+    return c != NULL && c->connected && c->queue.size() < (size_t)SUBSCRIPTION_SEND_BUDGET;
+}
+
+static void sub_send(void *ctx, uint32_t id, const uint8_t *frame, size_t length) {
+    SubClient_t *c = sub_client((SubRun_t *)ctx, id);
+    if (c == NULL) return;
+    if (!c->connected) c->after_leave++;
+    if (c->queue.size() >= (size_t)SUBSCRIPTION_SEND_BUDGET) c->overfull++;
+    c->queue.push_back(std::vector<uint8_t>(frame, frame + length));
+    if (c->queue.size() > c->max_queue) c->max_queue = c->queue.size();
+}
+
+static bool sub_same(float a, float b) {
+    return memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+// Quadro que o cliente leu: continuidade e cada registro contra a referencia
+static void sub_receive(SubRun_t *run, SubClient_t *c, const std::vector<uint8_t> &frame) {
+    static TelemetryRecord_t records[SUBSCRIPTION_MAX_RECORDS];
+    SubscriptionFrameHeader_t header;
+    int count = subscriptions_decode_frame(frame.data(), frame.size(), &header, records, SUBSCRIPTION_MAX_RECORDS);
+    if (count < 0) {
+        c->mismatches++;
+        return;
+    }
+    if (c->have_next && header.first != c->expected_next + header.dropped + header.skipped) c->breaks++;
+    c->have_next = true;
+    c->expected_next = header.next;
+    c->frames++;
+    c->records += (unsigned long)count;
+    c->bytes += frame.size();
+    c->dropped += header.dropped;
+
+    uint32_t index = header.first;
+    for (int i = 0; i < count; i++) {
+        while (index < header.next && header.decimation > 1 && run->reference[index].cycle % header.decimation != 0) {
+            index++;
+        }
+        if (index >= header.next) {
+            c->mismatches++;
+            return;
+        }
+        const TelemetryRecord_t *want = &run->reference[index++];
+        const TelemetryRecord_t *got = &records[i];
+        float zero = 0.0f;
+        bool ok = got->cycle == want->cycle && got->time_ms == want->time_ms && got->plant == want->plant &&
+                  got->combination == want->combination && got->flags == want->flags;
+        ok = ok && sub_same(got->sp_v, (header.channels & SUBSCRIPTION_CHANNEL_SP) ? want->sp_v : zero);
+        ok = ok && sub_same(got->y_v, (header.channels & SUBSCRIPTION_CHANNEL_Y) ? want->y_v : zero);
+        ok = ok && sub_same(got->u, (header.channels & SUBSCRIPTION_CHANNEL_U) ? want->u : zero);
+        ok = ok && sub_same(got->iTerm, (header.channels & SUBSCRIPTION_CHANNEL_ITERM) ? want->iTerm : zero);
+        if (!ok) c->mismatches++;
+    }
+}
+
+// Cada cliente le a sua fila no seu ritmo
+static void sub_read(SubRun_t *run, uint64_t now_ms) {
+    double progress = (double)now_ms / run->duration_ms;
+    for (SubClient_t &c : run->clients) {
+        if (c.kind == SUB_CLIENT_STALLED && progress >= run->stall_from && progress < run->stall_to) continue;
+        if (c.kind == SUB_CLIENT_SLOW) {
+            if (now_ms < c.next_read_ms || c.queue.empty()) continue;
+            c.next_read_ms = now_ms + run->slow_ms;
+            sub_receive(run, &c, c.queue.front());
+            c.queue.pop_front();
+            continue;
+        }
+        while (!c.queue.empty()) {
+            sub_receive(run, &c, c.queue.front());
+            c.queue.pop_front();
+        }
+    }
+}
+
+static void sub_request(SubRun_t *run, uint32_t id, uint8_t op, uint8_t channels, uint8_t decimation) {
+    SubscriptionRequest_t request = {id, op, channels, decimation};
+    if (!subscriptions_apply(run->subs, &request)) printf("Sem vaga para o cliente #%lu\n", (unsigned long)id);
+}
+
+static void sub_flush(SubRun_t *run, uint64_t now_ms) {
+    double progress = (double)now_ms / run->duration_ms;
+    for (SubClient_t &c : run->clients) {
+        bool should = progress >= c.join && progress < c.leave;
+        if (should && !c.connected) {
+            c.connected = true;
+            c.checked = run->subs->head;
+            sub_request(run, c.id, SUBSCRIPTION_SET, c.channels, c.decimation);
+        } else if (!should && c.connected) {
+            c.connected = false;
+            c.queue.clear();
+            sub_request(run, c.id, SUBSCRIPTION_DISCONNECT, 0, 0);
+        }
+    }
+
+    SubscriptionSink_t sink = {sub_can_send, sub_send, run};
+    subscriptions_flush(run->subs, &sink);
+    run->flushes++;
+    sub_read(run, now_ms);
+
+    // Rapidos: tudo o que a assinatura seleciona ate aqui ja chegou
+    for (SubClient_t &c : run->clients) {
+        if (c.kind != SUB_CLIENT_FAST || !c.connected || (c.channels & SUBSCRIPTION_CHANNELS_TELEMETRY) == 0) continue;
+        for (; c.checked != run->subs->head; c.checked++) {
+            if (c.decimation <= 1 || run->reference[c.checked].cycle % c.decimation == 0) c.selected++;
+        }
+        if (c.records != c.selected) c.late++;
+    }
+}
+
+static void sub_on_cycle(void *ctx) {
+    SubRun_t *run = (SubRun_t *)ctx;
+    TelemetryRecord_t records[8];
+    int count;
+    while ((count = telemetry_drain(&run->cursor, records, 8)) > 0) {
+        uint32_t lost = telemetry_overflows(&run->cursor) - run->overflows;
+        run->overflows += lost;
+        if (lost > 0) {
+            subscriptions_lost(run->subs, lost);
+            run->reference.resize(run->reference.size() + lost);
+        }
+        for (int i = 0; i < count; i++) {
+            subscriptions_push(run->subs, &records[i]);
+            run->reference.push_back(records[i]);
+        }
+    }
+
+    uint64_t now_ms = sim_engine_now_us() / 1000;
+    if (now_ms >= run->next_flush_ms) {
+        sub_flush(run, now_ms);
+        run->next_flush_ms = now_ms + run->flush_ms;
+    }
+}
+
+static SubClient_t sub_make(uint32_t id, const char *label, SubClientKind_t kind, uint8_t channels,
+                            uint8_t decimation, double join, double leave) {
+    SubClient_t c = {};
+    c.id = id;
+    c.label = label;
+    c.kind = kind;
+    c.channels = channels;
+    c.decimation = decimation;
+    c.join = join;
+    c.leave = leave;
+    return c;
+}
+
+int sim_cmd_subscriptions(int argc, char **argv) {
+    double minutes = sim_arg_double(argc, argv, "--minutes", 10.0);
+    bool dual = sim_arg_flag(argc, argv, "--dual");
+    Serial.set_enabled(sim_arg_flag(argc, argv, "--verbose"));
+
+    static Subscriptions_t subs;
+    subscriptions_init(&subs);
+    SubRun_t run;
+    run.subs = &subs;
+    run.overflows = 0;
+    run.duration_ms = (uint64_t)(minutes * 60000.0);
+    run.flush_ms = (uint64_t)sim_arg_long(argc, argv, "--flush-ms", 250);
+    run.next_flush_ms = 0;
+    run.slow_ms = (uint64_t)(sim_arg_double(argc, argv, "--slow-s", 20.0) * 1000.0);
+    run.stall_from = 0.25;
+    run.stall_to = 0.5;
+    run.flushes = 0;
+    telemetry_attach(&run.cursor);
+
+    const uint8_t SP_Y = SUBSCRIPTION_CHANNEL_SP | SUBSCRIPTION_CHANNEL_Y;
+    run.clients.push_back(sub_make(1, "rapido A", SUB_CLIENT_FAST, SP_Y, 1, 0.0, 2.0));
+    run.clients.push_back(sub_make(2, "rapido B", SUB_CLIENT_FAST, SP_Y, 1, 0.0, 2.0));
+    run.clients.push_back(sub_make(3, "rapido C", SUB_CLIENT_FAST, SP_Y, 1, 0.3, 0.7));
+    run.clients.push_back(sub_make(4, "decimado", SUB_CLIENT_FAST, SUBSCRIPTION_CHANNEL_Y, 5, 0.0, 2.0));
+    run.clients.push_back(sub_make(5, "lento", SUB_CLIENT_SLOW, SUBSCRIPTION_CHANNELS_TELEMETRY, 1, 0.0, 2.0));
+    run.clients.push_back(sub_make(6, "travado", SUB_CLIENT_STALLED,
+                                   SP_Y | SUBSCRIPTION_CHANNEL_U, 1, 0.0, 2.0));
+    run.clients.push_back(sub_make(7, "metricas", SUB_CLIENT_FAST, SUBSCRIPTION_CHANNEL_METRICS, 1, 0.0, 2.0));
+
+    SimRunConfig_t cfg;
+    sim_run_default_config(&cfg);
+    cfg.duration_s = minutes * 60.0;
+    cfg.dual = dual;
+    cfg.on_cycle = sub_on_cycle;
+    cfg.on_cycle_ctx = &run;
+    SimRunResult_t result;
+    sim_run_closed_loop(&cfg, &result);
+
+    // Ultimo envio, para o travado mostrar que voltou a ficar em dia
+    sub_flush(&run, run.duration_ms);
+
+    printf("%lu ciclos (%.0f min simulados%s), %zu registros, %lu envios a cada %lu ms\n", result.cycles, minutes,
+           dual ? ", duas malhas" : "", run.reference.size(), run.flushes, (unsigned long)run.flush_ms);
+    printf("Memoria: %zu bytes (anel de %d registros, %d clientes, quadro de %zu bytes)\n", sizeof(Subscriptions_t),
+           SUBSCRIPTION_BACKLOG, SUBSCRIPTION_MAX_CLIENTS, SUBSCRIPTION_MAX_FRAME_SIZE);
+    printf("%-9s %5s %3s %7s %8s %9s %9s %8s %6s %7s %7s %7s\n", "cliente", "canais", "dec", "quadros", "registros",
+           "bytes", "descartes", "adiados", "fila", "quebras", "errados", "atraso");
+
+    int failures = 0;
+    for (SubClient_t &c : run.clients) {
+        const Subscriber_t *s = subscriptions_find(&subs, c.id);
+        unsigned long deferred = s ? s->deferred : 0;
+        printf("%-9s  0x%02x %3u %7lu %8lu %9lu %9lu %8lu %6zu %7lu %7lu %7lu\n", c.label, c.channels, c.decimation,
+               c.frames, c.records, c.bytes, c.dropped, deferred, c.max_queue, c.breaks, c.mismatches, c.late);
+
+        failures += (int)(c.breaks + c.mismatches + c.overfull + c.after_leave);
+        if (c.max_queue > (size_t)SUBSCRIPTION_SEND_BUDGET) failures++;
+        bool telemetry = (c.channels & SUBSCRIPTION_CHANNELS_TELEMETRY) != 0;
+        if (!telemetry && c.frames > 0) failures++;
+        if (c.kind == SUB_CLIENT_FAST && telemetry) {
+            if (c.dropped > 0 || deferred > 0 || c.late > 0 || c.frames == 0) failures++;
+        }
+        // O travado perde o que passou do anel e volta a ficar em dia
+        if (c.kind == SUB_CLIENT_STALLED && (c.dropped == 0 || c.expected_next != subs.head)) failures++;
+        if (c.kind == SUB_CLIENT_SLOW && c.dropped == 0) failures++;
+    }
+
+    uint32_t metrics[SUBSCRIPTION_MAX_CLIENTS];
+    int metrics_clients = subscriptions_clients(&subs, SUBSCRIPTION_CHANNEL_METRICS, metrics, SUBSCRIPTION_MAX_CLIENTS);
+    printf("Quadros codificados %lu, entregues %lu; %d cliente(s) com metricas\n", (unsigned long)subs.encodes,
+           (unsigned long)subs.sends, metrics_clients);
+    if (subs.encodes >= subs.sends || metrics_clients != 1) failures++;
+
+    printf("%s\n", failures == 0 ? "Assinaturas dentro do esperado" : "Assinaturas FORA do esperado");
+    return failures == 0 ? 0 : 1;
+}
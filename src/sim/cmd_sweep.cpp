@@ -0,0 +1,437 @@
+// src/sim/cmd_sweep.cpp
+//
+// "sweep": varredura de sintonia do PID. Cada candidato (kp, ki, kd,
+// periodo de amostragem, perfil de referencia) roda em laco fechado contra
+// as seis redes RC (Planta 1 C0-C3, Planta 2 C0-C1) e recebe IAE, ISE,
+// sobressinal, tempo de acomodacao e tempo com o DAC saturado. Os
+// candidatos vem de uma grade (--mode grid) ou de sorteio (--mode random) e
+// sao repartidos entre as threads do PC com roubo de trabalho (work_pool.h).
+//
+// O laco de cada execucao e o do ESP32 sem o relogio virtual global: o
+// PidController de controller_engine.h (o mesmo que controller_compute
+// chama), os ganhos escalados por controller_scale_tunings, o ADC com ruido
+// lido ADC_ACQ_BURST vezes por milissegundo e a media das leituras mais
+// recentes (ADC_DECIMATE_MEAN), e o DAC truncado em 8 bits. Tudo no estado
+// da propria execucao, sem nada compartilhado entre as threads. Por padrao
+// o ruido entra uma vez na media (desvio de noise/sqrt(leituras)), que e o
+// que a media de leituras independentes da; --exact-adc sorteia cada
+// leitura pelo adc_model, com quantizacao, a um custo ~8x maior.
+//
+// A saida e um CSV com uma linha por candidato, ordenado pela metrica
+// escolhida dentro de cada perfil.
+
+#include "sim_commands.h"
+#include "work_pool.h"
+#include "rc_plant.h"
+#include "adc_model.h"
+#include "adc_acquisition.h"
+#include "controller_engine.h"
+#include "config.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+const int SWEEP_NETWORKS = 6;
+const int SWEEP_MAX_TS = 8;
+const double SWEEP_LOW_V = 0.2 * VCC;       // mesma onda do "run"
+const double SWEEP_HIGH_V = 0.8 * VCC;
+const double SWEEP_PERIOD_S = 60.0;
+const double SWEEP_STEP_V = 0.1 * VCC;      // salto da referencia que conta como degrau
+const double SWEEP_SETTLE_BAND = 0.02;      // faixa de acomodacao (fracao do degrau)
+
+typedef enum {
+    SWEEP_PROFILE_STEP = 0,     // um degrau para cima e, na metade, para baixo
+    SWEEP_PROFILE_SQUARE,       // onda quadrada de SWEEP_PERIOD_S
+    SWEEP_PROFILE_RAMP,         // trapezio: rampas de 20 s e patamares de 10 s
+    SWEEP_PROFILE_COUNT,
+} SweepProfile_t;
+
+static const char *const sweep_profile_names[SWEEP_PROFILE_COUNT] = {"degrau", "quadrada", "rampa"};
+
+typedef enum {
+    SWEEP_RANK_IAE = 0,
+    SWEEP_RANK_ISE,
+    SWEEP_RANK_OVERSHOOT,
+    SWEEP_RANK_SETTLING,
+    SWEEP_RANK_SATURATED,
+    SWEEP_RANK_COUNT,
+} SweepRank_t;
+
+static const char *const sweep_rank_names[SWEEP_RANK_COUNT] = {"iae", "ise", "overshoot", "settling", "saturated"};
+
+typedef struct {
+    float kp, ki, kd;           // por segundo, como controller_set_tunings
+    uint16_t ts_ms;
+    uint8_t profile;            // SweepProfile_t
+} SweepCandidate_t;
+
+typedef struct {
+    float iae;                  // V.s
+    float ise;                  // V^2.s
+    float overshoot;            // maior sobressinal (% do degrau)
+    float settling_s;           // maior tempo de acomodacao (s)
+    float saturated_s;          // tempo com o DAC no limite (s)
+} SweepScore_t;
+
+typedef struct {
+    double duration_s;
+    double noise_lsb;
+    bool exact_adc;             // cada leitura pelo adc_model
+    uint32_t seed;
+} SweepOptions_t;
+
+static double sweep_setpoint_v(int profile, double t, double duration_s) {
+    switch (profile) {
+    case SWEEP_PROFILE_STEP:
+        return t < duration_s / 2 ? SWEEP_HIGH_V : SWEEP_LOW_V;
+    case SWEEP_PROFILE_SQUARE:
+        return fmod(t, SWEEP_PERIOD_S) < SWEEP_PERIOD_S / 2 ? SWEEP_HIGH_V : SWEEP_LOW_V;
+    case SWEEP_PROFILE_RAMP:
+    default: {
+        double p = fmod(t, SWEEP_PERIOD_S) / SWEEP_PERIOD_S;
+        double x = p < 1.0 / 3 ? 3 * p : p < 0.5 ? 1.0 : p < 5.0 / 6 ? 1.0 - 3 * (p - 0.5) : 0.0;
+        return SWEEP_LOW_V + x * (SWEEP_HIGH_V - SWEEP_LOW_V);
+    }
+    }
+}
+
+// Degrau em andamento: sobressinal e ultima amostra fora da faixa
+typedef struct {
+    bool active;
+    double target, size, dir;   // dir: +1 subida, -1 descida
+    double start_s, last_out_s, peak;
+} SweepStep_t;
+
+static void sweep_step_close(SweepStep_t *step, double now_s, SweepScore_t *score) {
+    if (!step->active) return;
+    double overshoot = step->peak / step->size * 100.0;
+    double settling = step->last_out_s < 0 ? 0.0 : step->last_out_s - step->start_s;
+    if (step->last_out_s >= now_s) settling = now_s - step->start_s;     // nao acomodou
+    if (overshoot > score->overshoot) score->overshoot = (float)overshoot;
+    if (settling > score->settling_s) score->settling_s = (float)settling;
+    step->active = false;
+}
+
+// Uma execucao: candidato na rede net, partindo do regime em SWEEP_LOW_V
+static void sweep_run(const SweepCandidate_t *c, const RcNetwork_t *net, const SweepOptions_t *opt, uint32_t seed,
+                      SweepScore_t *score) {
+    const int ts_ms = c->ts_ms;
+    const double ts = ts_ms / 1000.0;
+    const double acq_s = ADC_ACQ_PERIOD_MS / 1000.0;
+    const int acq_per_sample = ts_ms / (int)ADC_ACQ_PERIOD_MS;
+    int averaged = (ADC_RING_SIZE / 2) / ADC_ACQ_BURST;
+    if (averaged > acq_per_sample) averaged = acq_per_sample;
+    const double to_counts = ADC_RESOLUTION / VCC;
+    const int readings = averaged * ADC_ACQ_BURST;
+    const double noise_mean = opt->noise_lsb / sqrt((double)readings);
+
+    RcPlant_t plant;
+    plant.net = net;
+    rc_plant_reset(&plant, SWEEP_LOW_V);
+    AdcModel_t adc;
+    adc_model_init(&adc, opt->noise_lsb, seed);
+
+    SystemState_t s;
+    memset(&s, 0, sizeof(s));
+    controller_scale_tunings(s.kp, s.ki, s.kd, c->kp, c->ki, c->kd, ts);
+    s.sp = (float)(SWEEP_LOW_V * to_counts);
+    s.y = s.lastY = s.sp;
+    s.u = s.iTerm = (float)(SWEEP_LOW_V / VCC * DAC_RESOLUTION);
+    PidController pid;
+    pid.reset(&s);
+
+    *score = SweepScore_t();
+    SweepStep_t step = {};
+    double prev_sp = SWEEP_LOW_V;
+    long samples = (long)(opt->duration_s / ts);
+    for (long k = 0; k < samples; k++) {
+        double t = k * ts;
+        double sp = sweep_setpoint_v(c->profile, t, opt->duration_s);
+        double v = rc_plant_output(&plant);
+        double e = sp - v;
+        score->iae += (float)(fabs(e) * ts);
+        score->ise += (float)(e * e * ts);
+
+        if (fabs(sp - prev_sp) >= SWEEP_STEP_V) {
+            sweep_step_close(&step, t, score);
+            step.active = true;
+            step.target = sp;
+            step.size = fabs(sp - prev_sp);
+            step.dir = sp > prev_sp ? 1.0 : -1.0;
+            step.start_s = t;
+            step.last_out_s = -1.0;
+            step.peak = 0.0;
+        }
+        prev_sp = sp;
+        if (step.active) {
+            double excess = step.dir * (v - step.target);
+            if (excess > step.peak) step.peak = excess;
+            if (fabs(v - step.target) > SWEEP_SETTLE_BAND * step.size) step.last_out_s = t;
+        }
+
+        // Ciclo de controle com o y da media do periodo anterior
+        s.sp = (float)(sp * to_counts);
+        s.u = pid.compute(&s);
+        float u = s.u;
+        if (u <= 0.0f || u >= DAC_RESOLUTION) score->saturated_s += (float)ts;
+        uint8_t dac = (uint8_t)(u > DAC_RESOLUTION ? DAC_RESOLUTION : u < 0 ? 0 : u);
+        double vin = dac * (VCC / DAC_RESOLUTION);
+
+        double sum = 0.0;
+        for (int i = 0; i < acq_per_sample; i++) {
+            rc_plant_step(&plant, vin, acq_s, true);
+            if (i < acq_per_sample - averaged) continue;
+            double out = rc_plant_output(&plant);
+            if (opt->exact_adc) {
+                for (int b = 0; b < ADC_ACQ_BURST; b++) sum += adc_model_sample(&adc, out);
+            } else {
+                sum += out * to_counts * ADC_ACQ_BURST;
+            }
+        }
+        s.y = (float)(sum / readings);
+        if (!opt->exact_adc) s.y += (float)(noise_mean * sim_rand_gauss(&adc.rng));
+    }
+    sweep_step_close(&step, samples * ts, score);
+}
+
+static float sweep_metric(const SweepScore_t *s, int rank) {
+    switch (rank) {
+    case SWEEP_RANK_ISE: return s->ise;
+    case SWEEP_RANK_OVERSHOOT: return s->overshoot;
+    case SWEEP_RANK_SETTLING: return s->settling_s;
+    case SWEEP_RANK_SATURATED: return s->saturated_s;
+    case SWEEP_RANK_IAE:
+    default: return s->iae;
+    }
+}
+
+// Nota do candidato: soma da metrica nas seis redes (sobressinal e
+// acomodacao: o pior caso)
+static float sweep_total(const SweepScore_t *scores, int rank) {
+    float total = 0.0f;
+    for (int n = 0; n < SWEEP_NETWORKS; n++) {
+        float m = sweep_metric(&scores[n], rank);
+        if (rank == SWEEP_RANK_OVERSHOOT || rank == SWEEP_RANK_SETTLING) total = std::max(total, m);
+        else total += m;
+    }
+    return total;
+}
+
+// "100,200,500" -> lista de periodos em ms (multiplos de ADC_ACQ_PERIOD_MS)
+static int sweep_parse_ts(const char *text, uint16_t *out) {
+    int n = 0;
+    while (*text && n < SWEEP_MAX_TS) {
+        char *end;
+        long v = strtol(text, &end, 10);
+        if (end == text) break;
+        if (v >= 10 && v <= 5000) out[n++] = (uint16_t)v;
+        text = (*end == ',') ? end + 1 : end;
+    }
+    return n;
+}
+
+static int sweep_parse_profiles(const char *text, uint8_t *out) {
+    int n = 0;
+    for (int p = 0; p < SWEEP_PROFILE_COUNT; p++) {
+        if (strstr(text, sweep_profile_names[p])) out[n++] = (uint8_t)p;
+    }
+    return n;
+}
+
+static int sweep_parse_rank(const char *text) {
+    for (int r = 0; r < SWEEP_RANK_COUNT; r++) {
+        if (strcmp(text, sweep_rank_names[r]) == 0) return r;
+    }
+    return -1;
+}
+
+typedef struct {
+    double lo, hi;
+} SweepRange_t;
+
+static double sweep_log_point(const SweepRange_t *r, double x) {
+    return r->lo * pow(r->hi / r->lo, x);
+}
+
+// Grade: k pontos em escala log por ganho (kd: 0 e k-1 pontos) x periodos x perfis
+static void sweep_grid(std::vector<SweepCandidate_t> &out, int k, const SweepRange_t *kp, const SweepRange_t *ki,
+                       const SweepRange_t *kd, const uint16_t *ts, int ts_count, const uint8_t *profiles,
+                       int profile_count) {
+    for (int pr = 0; pr < profile_count; pr++)
+        for (int t = 0; t < ts_count; t++)
+            for (int a = 0; a < k; a++)
+                for (int b = 0; b < k; b++)
+                    for (int d = 0; d < k; d++) {
+                        SweepCandidate_t c;
+                        c.kp = (float)sweep_log_point(kp, k > 1 ? (double)a / (k - 1) : 0.0);
+                        c.ki = (float)sweep_log_point(ki, k > 1 ? (double)b / (k - 1) : 0.0);
+                        c.kd = d == 0 ? 0.0f : (float)sweep_log_point(kd, k > 2 ? (double)(d - 1) / (k - 2) : 0.0);
+                        c.ts_ms = ts[t];
+                        c.profile = profiles[pr];
+                        out.push_back(c);
+                    }
+}
+
+// Sorteio: ganhos log-uniformes, kd = 0 em um terco dos candidatos
+static void sweep_random(std::vector<SweepCandidate_t> &out, size_t count, uint32_t seed, const SweepRange_t *kp,
+                         const SweepRange_t *ki, const SweepRange_t *kd, const uint16_t *ts, int ts_count,
+                         const uint8_t *profiles, int profile_count) {
+    uint32_t rng = seed ? seed : 1;
+    for (size_t i = 0; i < count; i++) {
+        SweepCandidate_t c;
+        c.kp = (float)sweep_log_point(kp, sim_rand_uniform(&rng));
+        c.ki = (float)sweep_log_point(ki, sim_rand_uniform(&rng));
+        c.kd = sim_rand_uniform(&rng) < 1.0 / 3 ? 0.0f : (float)sweep_log_point(kd, sim_rand_uniform(&rng));
+        c.ts_ms = ts[(int)(sim_rand_uniform(&rng) * ts_count)];
+        c.profile = profiles[(int)(sim_rand_uniform(&rng) * profile_count)];
+        out.push_back(c);
+    }
+}
+
+// Executa todos os candidatos nas seis redes; retorna o tempo real (s)
+static double sweep_execute(const std::vector<SweepCandidate_t> &candidates, const SweepOptions_t *opt, int threads,
+                            std::vector<SweepScore_t> &scores, WorkPoolStats_t *stats) {
+    const RcNetwork_t *nets[SWEEP_NETWORKS];
+    int n = 0;
+    for (int plant = 1; plant <= 2; plant++) {
+        for (int comb = 0; comb < rc_network_count(plant); comb++) nets[n++] = rc_network_for(plant, comb);
+    }
+    scores.assign(candidates.size() * SWEEP_NETWORKS, SweepScore_t());
+
+    // Uma tarefa por execucao (candidato x rede): as tarefas ficam pequenas e
+    // o roubo equilibra periodos curtos (caros) e longos
+    auto start = std::chrono::steady_clock::now();
+    work_pool_run(scores.size(), threads, 16, [&](int worker, size_t index) {
+        (void)worker;
+        size_t c = index / SWEEP_NETWORKS;
+        int net = (int)(index % SWEEP_NETWORKS);
+        sweep_run(&candidates[c], nets[net], opt, opt->seed * 2654435761u + (uint32_t)index, &scores[index]);
+    }, stats);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+int sim_cmd_sweep(int argc, char **argv) {
+    const char *mode = sim_arg_string(argc, argv, "--mode", "random");
+    long runs = sim_arg_long(argc, argv, "--runs", 100000);
+    int grid = (int)sim_arg_long(argc, argv, "--grid", 12);
+    int threads = (int)sim_arg_long(argc, argv, "--threads", work_pool_default_threads());
+    int top = (int)sim_arg_long(argc, argv, "--top", 5);
+    const char *out_path = sim_arg_string(argc, argv, "--out", "sweep.csv");
+    int rank = sweep_parse_rank(sim_arg_string(argc, argv, "--rank", "iae"));
+    SweepRange_t kp = {sim_arg_double(argc, argv, "--kp-min", 0.01), sim_arg_double(argc, argv, "--kp-max", 3.0)};
+    SweepRange_t ki = {sim_arg_double(argc, argv, "--ki-min", 0.01), sim_arg_double(argc, argv, "--ki-max", 3.0)};
+    SweepRange_t kd = {sim_arg_double(argc, argv, "--kd-min", 0.001), sim_arg_double(argc, argv, "--kd-max", 0.5)};
+    uint16_t ts[SWEEP_MAX_TS];
+    int ts_count = sweep_parse_ts(sim_arg_string(argc, argv, "--ts", "100,200,500"), ts);
+    uint8_t profiles[SWEEP_PROFILE_COUNT];
+    int profile_count = sweep_parse_profiles(sim_arg_string(argc, argv, "--profiles", "degrau,quadrada,rampa"), profiles);
+
+    SweepOptions_t opt;
+    opt.duration_s = sim_arg_double(argc, argv, "--seconds", 120.0);
+    opt.noise_lsb = sim_arg_double(argc, argv, "--noise", 3.0);
+    opt.exact_adc = sim_arg_flag(argc, argv, "--exact-adc");
+    opt.seed = (uint32_t)sim_arg_long(argc, argv, "--seed", 1);
+
+    if (rank < 0 || ts_count == 0 || profile_count == 0 || !(kp.lo > 0 && kp.hi >= kp.lo) ||
+        !(ki.lo > 0 && ki.hi >= ki.lo) || !(kd.lo > 0 && kd.hi >= kd.lo) || threads <= 0 || opt.duration_s <= 0) {
+        fprintf(stderr, "sweep: parametros invalidos (--rank %s, --ts em ms, --profiles %s, %s, %s)\n",
+                "iae|ise|overshoot|settling|saturated", "degrau,quadrada,rampa", "faixas com 0 < min <= max",
+                "--threads > 0");
+        return 2;
+    }
+
+    std::vector<SweepCandidate_t> candidates;
+    if (strcmp(mode, "grid") == 0) {
+        if (grid < 1) grid = 1;
+        sweep_grid(candidates, grid, &kp, &ki, &kd, ts, ts_count, profiles, profile_count);
+    } else {
+        size_t count = (size_t)((runs + SWEEP_NETWORKS - 1) / SWEEP_NETWORKS);
+        sweep_random(candidates, count, opt.seed, &kp, &ki, &kd, ts, ts_count, profiles, profile_count);
+    }
+
+    // Escalabilidade: a mesma amostra de candidatos com 1, 2, 4... threads
+    std::vector<SweepScore_t> scores;
+    if (sim_arg_flag(argc, argv, "--scaling")) {
+        std::vector<SweepCandidate_t> sample(candidates.begin(),
+                                             candidates.begin() + std::min<size_t>(candidates.size(), 2000));
+        printf("escalabilidade (%zu execucoes):\n", sample.size() * SWEEP_NETWORKS);
+        double base = 0.0;
+        for (int t = 1;; t = std::min(t * 2, threads)) {
+            WorkPoolStats_t stats;
+            double wall = sweep_execute(sample, &opt, t, scores, &stats);
+            double rate = scores.size() / wall;
+            if (t == 1) base = rate;
+            printf("  %3d threads  %9.0f execucoes/s  aceleracao %5.2fx  eficiencia %5.1f%%  roubos %zu\n", t, rate,
+                   rate / base, rate / base / t * 100.0, stats.steals);
+            if (t >= threads) break;
+        }
+    }
+
+    WorkPoolStats_t stats;
+    double wall = sweep_execute(candidates, &opt, threads, scores, &stats);
+    size_t total_runs = scores.size();
+    printf("%zu candidatos x %d redes = %zu execucoes de %.0f s simulados em %.1f s com %d threads "
+           "(%.0f execucoes/s, %zu roubos, %zu execucoes roubadas)\n",
+           candidates.size(), SWEEP_NETWORKS, total_runs, opt.duration_s, wall, stats.threads, total_runs / wall,
+           stats.steals, stats.stolen);
+
+    // Classificacao dentro de cada perfil
+    std::vector<size_t> order(candidates.size());
+    std::vector<float> totals(candidates.size());
+    for (size_t i = 0; i < candidates.size(); i++) {
+        order[i] = i;
+        totals[i] = sweep_total(&scores[i * SWEEP_NETWORKS], rank);
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        if (candidates[a].profile != candidates[b].profile) return candidates[a].profile < candidates[b].profile;
+        return totals[a] < totals[b];
+    });
+
+    FILE *out = fopen(out_path, "w");
+    if (!out) {
+        fprintf(stderr, "sweep: nao foi possivel criar %s\n", out_path);
+        return 1;
+    }
+    fprintf(out, "perfil,pos,kp,ki,kd,ts_ms,%s_total,iae,ise,sobressinal_pct,acomodacao_s,saturado_s,"
+                 "iae_p1c0,iae_p1c1,iae_p1c2,iae_p1c3,iae_p2c0,iae_p2c1\n", sweep_rank_names[rank]);
+    int position = 0, last_profile = -1;
+    for (size_t i : order) {
+        const SweepCandidate_t *c = &candidates[i];
+        const SweepScore_t *s = &scores[i * SWEEP_NETWORKS];
+        if (c->profile != last_profile) {
+            position = 0;
+            last_profile = c->profile;
+            printf("\n%s, melhores por %s (soma nas %d redes; sobressinal e acomodacao: pior rede):\n",
+                   sweep_profile_names[c->profile], sweep_rank_names[rank], SWEEP_NETWORKS);
+            printf("  %4s %8s %8s %8s %6s %10s %10s %8s %8s %8s\n", "pos", "kp", "ki", "kd", "ts", "nota", "IAE",
+                   "sobr. %", "acom. s", "sat. s");
+        }
+        position++;
+        SweepScore_t sum = {};
+        for (int n = 0; n < SWEEP_NETWORKS; n++) {
+            sum.iae += s[n].iae;
+            sum.ise += s[n].ise;
+            sum.overshoot = std::max(sum.overshoot, s[n].overshoot);
+            sum.settling_s = std::max(sum.settling_s, s[n].settling_s);
+            sum.saturated_s += s[n].saturated_s;
+        }
+        fprintf(out, "%s,%d,%.4g,%.4g,%.4g,%u,%.4g,%.4g,%.4g,%.3g,%.3g,%.4g", sweep_profile_names[c->profile],
+                position, c->kp, c->ki, c->kd, (unsigned)c->ts_ms, totals[i], sum.iae, sum.ise, sum.overshoot,
+                sum.settling_s, sum.saturated_s);
+        for (int n = 0; n < SWEEP_NETWORKS; n++) fprintf(out, ",%.4g", s[n].iae);
+        fprintf(out, "\n");
+        if (position <= top) {
+            printf("  %4d %8.4f %8.4f %8.4f %6u %10.3f %10.2f %8.1f %8.1f %8.1f\n", position, c->kp, c->ki, c->kd,
+                   (unsigned)c->ts_ms, totals[i], sum.iae, sum.overshoot, sum.settling_s, sum.saturated_s);
+        }
+    }
+    fclose(out);
+    printf("\nresultado em %s\n", out_path);
+    return 0;
+}
@@ -0,0 +1,130 @@
+// src/sim/cmd_telemetry.cpp
+//
+// "telemetry": roda o laco fechado e, a cada --flush-ms virtuais, esvazia a
+// cursor de telemetria em quadros binarios como a websocket_plotter_task faz.
+// Cada quadro e decodificado e conferido: sequencia sem buracos, todos os
+// ciclos presentes (ou contados em dropped) e recodificacao identica. No fim
+// compara o trafego com um JSON por amostra.
+
+#include "sim_commands.h"
+#include "sim_runner.h"
+#include "telemetry.h"
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+typedef struct {
+    unsigned long flush_ms;
+    unsigned long next_flush_ms;
+    bool have_seq;
+    uint32_t next_seq;
+    bool have_cycle[2];
+    uint32_t last_cycle[2];
+    unsigned long frames, records, dropped, missing, seq_gaps, bad_frames;
+    unsigned long binary_bytes, json_bytes;
+    TelemetryCursor_t cursor;
+} TelemetryCheck_t;
+
+// Cabecalho de um quadro WebSocket do servidor (sem mascara)
+static unsigned long ws_frame_overhead(size_t payload) {
+    return payload < 126 ? 2 : (payload < 65536 ? 4 : 10);
+}
+
+static void telemetry_check_frame(TelemetryCheck_t *check, const uint8_t *frame, size_t length) {
+    static TelemetryRecord_t records[TELEMETRY_MAX_RECORDS];
+    static uint8_t reencoded[TELEMETRY_MAX_FRAME_SIZE];
+    TelemetryFrameHeader_t header;
+
+    int count = telemetry_decode_frame(frame, length, &header, records, TELEMETRY_MAX_RECORDS);
+    if (count < 0 || telemetry_encode_frame(reencoded, sizeof(reencoded), &header, records) != length ||
+        memcmp(reencoded, frame, length) != 0) {
+        check->bad_frames++;
+        return;
+    }
+
+    if (check->have_seq && header.seq != check->next_seq) check->seq_gaps++;
+    check->have_seq = true;
+    check->next_seq = header.seq + 1;
+
+    check->frames++;
+    check->records += count;
+    check->dropped += header.dropped;
+    check->binary_bytes += length + ws_frame_overhead(length);
+
+    for (int i = 0; i < count; i++) {
+        const TelemetryRecord_t *r = &records[i];
+        int loop = r->plant - 1;
+        if (loop < 0 || loop > 1) {
+            check->bad_frames++;
+            continue;
+        }
+        if (check->have_cycle[loop] && r->cycle != check->last_cycle[loop] + 1) {
+            check->missing += r->cycle - check->last_cycle[loop] - 1;
+        }
+        check->have_cycle[loop] = true;
+        check->last_cycle[loop] = r->cycle;
+
+        char json[160];
+        int n = snprintf(json, sizeof(json),
+                         "{\"cycle\":%lu,\"time\":%lu,\"sp_v\":%.4f,\"y_v\":%.4f,\"u\":%.2f,\"iTerm\":%.2f,"
+                         "\"planta\":%d,\"combinacao\":%d}",
+                         (unsigned long)r->cycle, (unsigned long)r->time_ms, r->sp_v, r->y_v, r->u, r->iTerm,
+                         r->plant, r->combination);
+        check->json_bytes += n + ws_frame_overhead(n);
+    }
+}
+
+static void telemetry_flush(TelemetryCheck_t *check) {
+    static uint8_t frame[TELEMETRY_MAX_FRAME_SIZE];
+    size_t length;
+    while ((length = telemetry_build_frame(&check->cursor, frame, sizeof(frame))) > 0) {
+        telemetry_check_frame(check, frame, length);
+    }
+}
+
+static void telemetry_on_cycle(void *ctx) {
+    TelemetryCheck_t *check = (TelemetryCheck_t *)ctx;
+    if (millis() < check->next_flush_ms) return;
+    check->next_flush_ms += check->flush_ms;
+    telemetry_flush(check);
+}
+
+int sim_cmd_telemetry(int argc, char **argv) {
+    SimRunConfig_t cfg;
+    sim_run_default_config(&cfg);
+    cfg.plant_id = (int)sim_arg_long(argc, argv, "--plant", cfg.plant_id);
+    cfg.combination = (int)sim_arg_long(argc, argv, "--comb", cfg.combination);
+    cfg.duration_s = sim_arg_double(argc, argv, "--minutes", 10.0) * 60.0;
+    cfg.dual = sim_arg_flag(argc, argv, "--dual");
+
+    TelemetryCheck_t check;
+    memset(&check, 0, sizeof(check));
+    check.flush_ms = (unsigned long)sim_arg_long(argc, argv, "--flush-ms", 250);
+    check.next_flush_ms = check.flush_ms;
+    telemetry_attach(&check.cursor);
+    cfg.on_cycle = telemetry_on_cycle;
+    cfg.on_cycle_ctx = &check;
+
+    Serial.set_enabled(false);
+
+    SimRunResult_t result;
+    sim_run_closed_loop(&cfg, &result);
+    telemetry_flush(&check);
+
+    double seconds = cfg.duration_s;
+    printf("%lu ciclos, %lu quadros, %lu registros (%lu perdidos pelo cursor, %lu faltando)\n",
+           result.cycles, check.frames, check.records, check.dropped, check.missing);
+    printf("binario: %.0f B/s | JSON por amostra: %.0f B/s | %.1fx menor\n",
+           check.binary_bytes / seconds, check.json_bytes / seconds,
+           check.binary_bytes > 0 ? (double)check.json_bytes / check.binary_bytes : 0.0);
+
+    bool ok = check.bad_frames == 0 && check.seq_gaps == 0 && check.missing <= check.dropped &&
+              check.records + check.dropped == result.cycles * (cfg.dual ? 2 : 1);
+    if (!ok) {
+        printf("FALHA: %lu quadros invalidos, %lu saltos de sequencia\n", check.bad_frames, check.seq_gaps);
+        return 1;
+    }
+    printf("OK: sequencia continua e todos os ciclos entregues ou contados\n");
+    return 0;
+}
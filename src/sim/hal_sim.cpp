@@ -0,0 +1,63 @@
+// src/sim/hal_sim.cpp
+//
+// Implementacao da HAL sobre o motor de simulacao (build nativo).
+
+#include "hal.h"
+#include "sim_engine.h"
+
+#include <chrono>
+
+void hal_gpio_set_output(int pin) {
+    (void)pin;
+}
+
+void hal_gpio_set_input(int pin) {
+    (void)pin;
+}
+
+void hal_gpio_write(int pin, bool high) {
+    sim_engine_gpio_write(pin, high);
+}
+
+int hal_adc_read(int pin) {
+    return sim_engine_adc_read(pin);
+}
+
+void hal_dac_enable(int pin) {
+    (void)pin;
+}
+
+void hal_dac_write(int pin, uint8_t value) {
+    sim_engine_dac_write(pin, value);
+}
+
+uint32_t hal_micros() {
+    return (uint32_t)sim_engine_now_us();
+}
+
+void hal_delay_us(uint32_t us) {
+    sim_engine_advance_us(us);
+}
+
+// O relogio virtual nao anda enquanto o codigo roda: o "contador de ciclos"
+// e o relogio real do PC, em ns
+uint32_t hal_cycle_count() {
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+}
+
+uint32_t hal_cycles_per_us() {
+    return 1000;
+}
+
+// Sem interrupcoes no simulador: sim_runner.cpp dispara os ciclos
+bool hal_timer_start(uint32_t period_us, HalTimerCallback_t callback, void *arg) {
+    (void)period_us;
+    (void)callback;
+    (void)arg;
+    return false;
+}
+
+void hal_heap_stats(HalHeapStats_t *out) {
+    out->total = out->free = out->min_free = out->largest_block = 0;
+}
@@ -0,0 +1,149 @@
+// src/sim/rc_plant.cpp
+
+#include "rc_plant.h"
+#include <math.h>
+#include <stddef.h>
+
+// Valores nominais das redes de cada combinacao do MUX. Ajustar aqui se a
+// montagem da bancada mudar. c_scale so muda por
+// rc_network_set_capacitance_scale().
+static RcNetwork_t PLANT_1_NETWORKS[] = {
+    {"P1/C0 1a ordem 10k/100u", 1, 10e3, 100e-6, 0, 0, 1.0, 0},
+    {"P1/C1 1a ordem 15k/100u", 1, 15e3, 100e-6, 0, 0, 1.0, 0},
+    {"P1/C2 1a ordem 22k/100u", 1, 22e3, 100e-6, 0, 0, 1.0, 0},
+    {"P1/C3 1a ordem 33k/100u", 1, 33e3, 100e-6, 0, 0, 1.0, 0},
+};
+
+static RcNetwork_t PLANT_2_NETWORKS[] = {
+    {"P2/C0 2a ordem 10k/100u-10k/100u", 2, 10e3, 100e-6, 10e3, 100e-6, 1.0, 0},
+    {"P2/C1 2a ordem 10k/100u-22k/100u", 2, 10e3, 100e-6, 22e3, 100e-6, 1.0, 0},
+};
+
+int rc_network_count(int plant_id) {
+    if (plant_id == 1) return sizeof(PLANT_1_NETWORKS) / sizeof(PLANT_1_NETWORKS[0]);
+    if (plant_id == 2) return sizeof(PLANT_2_NETWORKS) / sizeof(PLANT_2_NETWORKS[0]);
+    return 0;
+}
+
+const RcNetwork_t *rc_network_for(int plant_id, int combination) {
+    if (combination < 0 || combination >= rc_network_count(plant_id)) return NULL;
+    return (plant_id == 1) ? &PLANT_1_NETWORKS[combination] : &PLANT_2_NETWORKS[combination];
+}
+
+bool rc_network_set_capacitance_scale(int plant_id, int combination, double c_scale) {
+    if (combination < 0 || combination >= rc_network_count(plant_id) || !(c_scale > 0)) return false;
+    RcNetwork_t *n = (plant_id == 1) ? &PLANT_1_NETWORKS[combination] : &PLANT_2_NETWORKS[combination];
+    n->c_scale = c_scale;
+    n->revision++;
+    return true;
+}
+
+void rc_network_time_constants(const RcNetwork_t *n, double *tau1, double *tau2) {
+    double c1 = n->c1 * n->c_scale;
+    if (n->order == 1) {
+        *tau1 = n->r1 * c1;
+        *tau2 = 0;
+        return;
+    }
+    // Autovalores da matriz do circuito (ver rc2_derivatives), ambos reais
+    // e negativos
+    double c2 = n->c2 * n->c_scale;
+    double a11 = -(1.0 / n->r1 + 1.0 / n->r2) / c1, a12 = 1.0 / (n->r2 * c1);
+    double a21 = 1.0 / (n->r2 * c2), a22 = -1.0 / (n->r2 * c2);
+    double tr = a11 + a22, det = a11 * a22 - a12 * a21;
+    double root = sqrt(tr * tr / 4 - det);
+    *tau1 = -1.0 / (tr / 2 + root);
+    *tau2 = -1.0 / (tr / 2 - root);
+}
+
+void rc_plant_reset(RcPlant_t *plant, double v0) {
+    plant->v1 = v0;
+    plant->v2 = v0;
+    plant->map.net = NULL;
+}
+
+// Derivadas do circuito de 2a ordem. g1 = 0 representa a entrada em aberto.
+static void rc2_derivatives(const RcNetwork_t *n, double g1, double vin,
+                            double v1, double v2, double *dv1, double *dv2) {
+    double i1 = g1 * (vin - v1);
+    double i2 = (v1 - v2) / n->r2;
+    *dv1 = (i1 - i2) / (n->c1 * n->c_scale);
+    *dv2 = i2 / (n->c2 * n->c_scale);
+}
+
+// Integra um passo "de verdade" (exato na 1a ordem, RK4 com subpassos de no
+// maximo 1/20 da menor constante na 2a ordem)
+static void rc_plant_integrate(const RcNetwork_t *n, double vin, double dt, bool connected,
+                               double *pv1, double *pv2) {
+    if (n->order == 1) {
+        // Solucao exata com entrada constante no intervalo (ZOH)
+        if (connected) {
+            double a = exp(-dt / (n->r1 * n->c1 * n->c_scale));
+            *pv1 = vin + (*pv1 - vin) * a;
+        }
+        *pv2 = *pv1;
+        return;
+    }
+
+    double g1 = connected ? 1.0 / n->r1 : 0.0;
+    double tau_min = fmin(fmin(n->r1 * n->c1, n->r2 * n->c1), n->r2 * n->c2) * n->c_scale;
+    int steps = (int)ceil(dt / (tau_min / 20.0));
+    double h = dt / steps;
+    double v1 = *pv1, v2 = *pv2;
+
+    for (int i = 0; i < steps; i++) {
+        double k1a, k1b, k2a, k2b, k3a, k3b, k4a, k4b;
+        rc2_derivatives(n, g1, vin, v1, v2, &k1a, &k1b);
+        rc2_derivatives(n, g1, vin, v1 + 0.5 * h * k1a, v2 + 0.5 * h * k1b, &k2a, &k2b);
+        rc2_derivatives(n, g1, vin, v1 + 0.5 * h * k2a, v2 + 0.5 * h * k2b, &k3a, &k3b);
+        rc2_derivatives(n, g1, vin, v1 + h * k3a, v2 + h * k3b, &k4a, &k4b);
+        v1 += h / 6.0 * (k1a + 2 * k2a + 2 * k3a + k4a);
+        v2 += h / 6.0 * (k1b + 2 * k2b + 2 * k3b + k4b);
+    }
+
+    *pv1 = v1;
+    *pv2 = v2;
+}
+
+// Monta o mapa linear do passo aplicando a integracao aos vetores da base
+static void rc_plant_build_map(RcStepMap_t *map, const RcNetwork_t *n, double dt, bool connected) {
+    double a, b;
+
+    a = 1; b = (n->order == 1) ? 1 : 0;
+    rc_plant_integrate(n, 0, dt, connected, &a, &b);
+    map->m11 = a; map->m21 = (n->order == 1) ? 0 : b;
+
+    a = 0; b = 1;
+    if (n->order == 1) { map->m12 = 0; map->m22 = 0; }
+    else { rc_plant_integrate(n, 0, dt, connected, &a, &b); map->m12 = a; map->m22 = b; }
+
+    a = 0; b = 0;
+    rc_plant_integrate(n, 1, dt, connected, &a, &b);
+    map->n1 = a; map->n2 = (n->order == 1) ? 0 : b;
+
+    map->net = n;
+    map->revision = n->revision;
+    map->dt = dt;
+    map->connected = connected;
+}
+
+void rc_plant_step(RcPlant_t *plant, double vin, double dt, bool connected) {
+    const RcNetwork_t *n = plant->net;
+    if (n == NULL || dt <= 0) return;
+    // 1a ordem com a entrada em aberto: o capacitor nao tem por onde descarregar
+    if (!connected && n->order == 1) return;
+
+    RcStepMap_t *map = &plant->map;
+    if (map->net != n || map->revision != n->revision || map->dt != dt || map->connected != connected) {
+        rc_plant_build_map(map, n, dt, connected);
+    }
+
+    double v1 = map->m11 * plant->v1 + map->m12 * plant->v2 + map->n1 * vin;
+    double v2 = map->m21 * plant->v1 + map->m22 * plant->v2 + map->n2 * vin;
+    plant->v1 = v1;
+    plant->v2 = (n->order == 1) ? v1 : v2;
+}
+
+double rc_plant_output(const RcPlant_t *plant) {
+    return (plant->net != NULL && plant->net->order == 2) ? plant->v2 : plant->v1;
+}
@@ -0,0 +1,62 @@
+// src/sim/rc_plant.h
+//
+// Modelos em tempo discreto das plantas RC da bancada.
+//   1a ordem: vin -R1- v1 (C1 ao GND), saida v1
+//   2a ordem: vin -R1- v1 (C1 ao GND) -R2- v2 (C2 ao GND), saida v2
+
+#ifndef RC_PLANT_H
+#define RC_PLANT_H
+
+typedef struct {
+    const char *name;
+    int order;          // 1 ou 2
+    double r1, c1;      // primeiro estagio (ohm, farad)
+    double r2, c2;      // segundo estagio (apenas ordem 2)
+    double c_scale;     // capacitancia real / nominal (1: nominal)
+    unsigned revision;  // muda a cada alteracao da rede
+} RcNetwork_t;
+
+// O circuito e linear, entao um passo de dt e um mapa fixo
+//   [v1 v2]' = M [v1 v2] + N vin
+// calculado uma vez por (rede, dt, ligacao) e reaproveitado nos passos
+// seguintes (a simulacao anda quase sempre com o mesmo dt).
+typedef struct {
+    const RcNetwork_t *net;
+    unsigned revision;
+    double dt;
+    bool connected;
+    double m11, m12, m21, m22;
+    double n1, n2;
+} RcStepMap_t;
+
+typedef struct {
+    const RcNetwork_t *net;
+    double v1;          // tensao no primeiro capacitor
+    double v2;          // tensao no segundo capacitor (ordem 2)
+    RcStepMap_t map;    // cache do ultimo passo
+} RcPlant_t;
+
+// Numero de combinacoes do MUX por planta (Planta 1: 0-3, Planta 2: 0-1)
+int rc_network_count(int plant_id);
+
+// Rede RC selecionada pela combinacao do MUX, ou NULL se nao existir
+const RcNetwork_t *rc_network_for(int plant_id, int combination);
+
+// Capacitores da rede com c_scale vezes o valor nominal (envelhecimento,
+// troca de componente), a partir do proximo passo. Retorna false se a rede
+// nao existir.
+bool rc_network_set_capacitance_scale(int plant_id, int combination, double c_scale);
+
+// Constantes de tempo da rede ligada (s), a mais lenta em tau1; tau2 = 0 na
+// 1a ordem
+void rc_network_time_constants(const RcNetwork_t *net, double *tau1, double *tau2);
+
+void rc_plant_reset(RcPlant_t *plant, double v0);
+
+// Avanca dt segundos com entrada vin. Com connected == false a entrada fica
+// em aberto (canal do MUX sem ligacao) e os capacitores so redistribuem carga.
+void rc_plant_step(RcPlant_t *plant, double vin, double dt, bool connected);
+
+double rc_plant_output(const RcPlant_t *plant);
+
+#endif // RC_PLANT_H
@@ -0,0 +1,71 @@
+// src/sim/run_storage_sim.cpp
+
+#include "run_storage.h"
+#include "run_storage_sim.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+static char run_dir[256] = "runs";
+static FILE *run_file = NULL;
+
+void run_storage_sim_set_dir(const char *dir) {
+    snprintf(run_dir, sizeof(run_dir), "%s", dir);
+}
+
+const char *run_storage_sim_dir() {
+    return run_dir;
+}
+
+static void run_storage_path(const char *name, char *path, size_t size) {
+    snprintf(path, size, "%s/%s", run_dir, name);
+}
+
+bool run_storage_open(const char *name) {
+    char path[sizeof(run_dir) + 300];
+    run_storage_path(name, path, sizeof(path));
+    mkdir(run_dir, 0755);
+    if (run_file) fclose(run_file);
+    run_file = fopen(path, "wb");
+    return run_file != NULL;
+}
+
+bool run_storage_write(const uint8_t *data, size_t length) {
+    if (run_file == NULL) return false;
+    return fwrite(data, 1, length, run_file) == length;
+}
+
+void run_storage_close() {
+    if (run_file) fclose(run_file);
+    run_file = NULL;
+}
+
+bool run_storage_remove(const char *name) {
+    char path[sizeof(run_dir) + 300];
+    run_storage_path(name, path, sizeof(path));
+    return remove(path) == 0;
+}
+
+int run_storage_list(RunFileInfo_t *out, int max) {
+    DIR *dir = opendir(run_dir);
+    if (dir == NULL) return 0;
+
+    int count = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL && count < max) {
+        if (entry->d_name[0] == '.') continue;
+
+        char path[sizeof(run_dir) + 300];
+        struct stat st;
+        run_storage_path(entry->d_name, path, sizeof(path));
+        if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) continue;
+
+        snprintf(out[count].name, sizeof(out[count].name), "%.31s", entry->d_name);
+        out[count].size = (uint32_t)st.st_size;
+        count++;
+    }
+    closedir(dir);
+    return count;
+}
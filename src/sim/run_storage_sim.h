@@ -0,0 +1,12 @@
+// src/sim/run_storage_sim.h
+//
+// run_storage no build nativo: os arquivos das execucoes ficam em um
+// diretorio do PC (padrao "runs", criado se nao existir).
+
+#ifndef RUN_STORAGE_SIM_H
+#define RUN_STORAGE_SIM_H
+
+void run_storage_sim_set_dir(const char *dir);
+const char *run_storage_sim_dir();
+
+#endif // RUN_STORAGE_SIM_H
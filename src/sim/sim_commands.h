@@ -0,0 +1,38 @@
+// src/sim/sim_commands.h
+//
+// Subcomandos do executavel nativo e utilitarios de linha de comando.
+
+#ifndef SIM_COMMANDS_H
+#define SIM_COMMANDS_H
+
+// Valor de "--nome valor" em argv, ou o padrao se a opcao nao existir
+double sim_arg_double(int argc, char **argv, const char *name, double fallback);
+long sim_arg_long(int argc, char **argv, const char *name, long fallback);
+const char *sim_arg_string(int argc, char **argv, const char *name, const char *fallback);
+bool sim_arg_flag(int argc, char **argv, const char *name);
+
+int sim_cmd_run(int argc, char **argv);
+int sim_cmd_stress_snapshot(int argc, char **argv);
+int sim_cmd_bench_pid(int argc, char **argv);
+int sim_cmd_bench_bank(int argc, char **argv);
+int sim_cmd_bench_adc(int argc, char **argv);
+int sim_cmd_bench_tick(int argc, char **argv);
+int sim_cmd_telemetry(int argc, char **argv);
+int sim_cmd_stress_telemetry(int argc, char **argv);
+int sim_cmd_record(int argc, char **argv);
+int sim_cmd_replay(int argc, char **argv);
+int sim_cmd_autotune(int argc, char **argv);
+int sim_cmd_schedule(int argc, char **argv);
+int sim_cmd_profile(int argc, char **argv);
+int sim_cmd_metrics(int argc, char **argv);
+int sim_cmd_commands(int argc, char **argv);
+int sim_cmd_history(int argc, char **argv);
+int sim_cmd_boot(int argc, char **argv);
+int sim_cmd_subscriptions(int argc, char **argv);
+int sim_cmd_identify(int argc, char **argv);
+int sim_cmd_bench_controllers(int argc, char **argv);
+int sim_cmd_sweep(int argc, char **argv);
+int sim_cmd_step_response(int argc, char **argv);
+int sim_cmd_memory(int argc, char **argv);
+
+#endif // SIM_COMMANDS_H
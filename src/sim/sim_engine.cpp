@@ -0,0 +1,115 @@
+// src/sim/sim_engine.cpp
+
+#include "sim_engine.h"
+#include "rc_plant.h"
+#include "adc_model.h"
+#include "config.h"
+
+// Cada canal do MUX liga uma rede RC fisicamente separada: as redes que nao
+// estao selecionadas ficam com a entrada em aberto e guardam a sua carga ate
+// voltarem a ser ligadas.
+static const int SIM_MAX_NETWORKS = 4;
+
+typedef struct {
+    uint64_t now_us;
+    bool mux_a, mux_b;
+    uint8_t dac[2];         // codigos dos DACs das plantas 1 e 2
+    RcPlant_t networks[2][SIM_MAX_NETWORKS];
+    int active[2];          // rede lida pelo ADC de cada planta
+    AdcModel_t adc[2];
+} SimEngine_t;
+
+static SimEngine_t engine;
+
+void sim_engine_default_config(SimEngineConfig_t *cfg) {
+    cfg->adc_noise_lsb = 3.0;
+    cfg->adc_inl_lsb = 0.0;
+    cfg->v_initial = 0.0;
+    cfg->seed = 1;
+}
+
+// Aplica a selecao do MUX as duas plantas: o canal k liga a rede k de cada
+// planta; a Planta 2 so tem os canais 0 e 1 ligados.
+static void sim_engine_route_mux() {
+    int channel = sim_engine_mux_channel();
+    for (int p = 0; p < 2; p++) {
+        if (rc_network_for(p + 1, channel) != NULL) engine.active[p] = channel;
+    }
+}
+
+void sim_engine_reset(const SimEngineConfig_t *cfg) {
+    SimEngineConfig_t defaults;
+    if (cfg == NULL) {
+        sim_engine_default_config(&defaults);
+        cfg = &defaults;
+    }
+
+    engine.now_us = 0;
+    engine.mux_a = false;
+    engine.mux_b = false;
+    engine.dac[0] = 0;
+    engine.dac[1] = 0;
+
+    for (int p = 0; p < 2; p++) {
+        for (int k = 0; k < SIM_MAX_NETWORKS; k++) {
+            engine.networks[p][k].net = rc_network_for(p + 1, k);
+            rc_plant_reset(&engine.networks[p][k], cfg->v_initial);
+        }
+        engine.active[p] = 0;
+        adc_model_init(&engine.adc[p], cfg->adc_noise_lsb, cfg->seed * 2654435761u + p);
+        engine.adc[p].inl_lsb = cfg->adc_inl_lsb;
+    }
+}
+
+uint64_t sim_engine_now_us() {
+    return engine.now_us;
+}
+
+void sim_engine_advance_us(uint64_t dt_us) {
+    if (dt_us == 0) return;
+    int channel = sim_engine_mux_channel();
+    double dt = dt_us * 1e-6;
+
+    for (int p = 0; p < 2; p++) {
+        double vin = engine.dac[p] * (VCC / DAC_RESOLUTION);
+        for (int k = 0; k < rc_network_count(p + 1); k++) {
+            rc_plant_step(&engine.networks[p][k], vin, dt, k == channel);
+        }
+    }
+    engine.now_us += dt_us;
+}
+
+void sim_engine_advance_to_us(uint64_t t_us) {
+    if (t_us > engine.now_us) sim_engine_advance_us(t_us - engine.now_us);
+}
+
+void sim_engine_gpio_write(int pin, bool high) {
+    if (pin == MUX_IN_A_PIN) engine.mux_a = high;
+    else if (pin == MUX_IN_B_PIN) engine.mux_b = high;
+    sim_engine_route_mux();
+}
+
+void sim_engine_dac_write(int pin, uint8_t value) {
+    if (pin == DAC_PIN_PLANT_1) engine.dac[0] = value;
+    else if (pin == DAC_PIN_PLANT_2) engine.dac[1] = value;
+}
+
+int sim_engine_adc_read(int pin) {
+    int p = (pin == ADC_PIN_PLANT_2) ? 1 : 0;
+    if (pin != ADC_PIN_PLANT_1 && pin != ADC_PIN_PLANT_2) return 0;
+    return adc_model_sample(&engine.adc[p], rc_plant_output(&engine.networks[p][engine.active[p]]));
+}
+
+int sim_engine_mux_channel() {
+    return (engine.mux_a ? 0b10 : 0) | (engine.mux_b ? 0b01 : 0);
+}
+
+double sim_engine_plant_voltage(int plant_id) {
+    if (plant_id != 1 && plant_id != 2) return 0.0;
+    return rc_plant_output(&engine.networks[plant_id - 1][engine.active[plant_id - 1]]);
+}
+
+void sim_engine_set_plant_voltage(int plant_id, double v) {
+    if (plant_id != 1 && plant_id != 2) return;
+    for (int k = 0; k < SIM_MAX_NETWORKS; k++) rc_plant_reset(&engine.networks[plant_id - 1][k], v);
+}
@@ -0,0 +1,43 @@
+// src/sim/sim_engine.h
+//
+// Motor de simulacao da bancada: relogio virtual, as duas plantas RC, o MUX
+// (CD4052, pinos IN_A/IN_B compartilhados) e os modelos de ADC/DAC. A HAL
+// nativa (hal_sim.cpp) e os substitutos do FreeRTOS chamam estas funcoes.
+
+#ifndef SIM_ENGINE_H
+#define SIM_ENGINE_H
+
+#include <stdint.h>
+
+typedef struct {
+    double adc_noise_lsb;   // ruido do ADC (desvio padrao, LSB)
+    double adc_inl_lsb;     // curvatura do ADC no meio da escala (LSB)
+    double v_initial;       // tensao inicial dos capacitores
+    uint32_t seed;          // semente do ruido
+} SimEngineConfig_t;
+
+void sim_engine_default_config(SimEngineConfig_t *cfg);
+
+// Reinicia relogio, plantas, MUX e DACs
+void sim_engine_reset(const SimEngineConfig_t *cfg);
+
+// Relogio virtual (us desde o reset). Avancar o relogio integra as plantas.
+uint64_t sim_engine_now_us();
+void sim_engine_advance_us(uint64_t dt_us);
+void sim_engine_advance_to_us(uint64_t t_us);
+
+// Lado "hardware", usado pela HAL nativa
+void sim_engine_gpio_write(int pin, bool high);
+void sim_engine_dac_write(int pin, uint8_t value);
+int sim_engine_adc_read(int pin);
+
+// Canal atual do MUX (IN_A e o bit 1, IN_B o bit 0)
+int sim_engine_mux_channel();
+
+// Tensao real na saida da rede selecionada da planta (sem ADC), para metricas
+double sim_engine_plant_voltage(int plant_id);
+
+// Carrega os capacitores de todas as redes da planta com a tensao v (replay)
+void sim_engine_set_plant_voltage(int plant_id, double v);
+
+#endif // SIM_ENGINE_H
@@ -0,0 +1,98 @@
+// src/sim/sim_main.cpp
+//
+// Ponto de entrada do build nativo (env:native).
+//   program [comando] [opcoes]    -- sem comando executa "run"
+
+#include "sim_commands.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    const char *name;
+    int (*fn)(int argc, char **argv);
+    const char *help;
+} SimCommand_t;
+
+static const SimCommand_t COMMANDS[] = {
+    {"run", sim_cmd_run, "laco fechado nas plantas simuladas (--plant --comb --hours --kp --ki --kd --noise --seed --csv --dual --filter)"},
+    {"stress-snapshot", sim_cmd_stress_snapshot, "estressa o snapshot do estado com varias leitoras (--readers --seconds)"},
+    {"bench-pid", sim_cmd_bench_pid, "custo e equivalencia do PID em double/float/Q16.16 (--iterations --seconds --tol)"},
+    {"bench-bank", sim_cmd_bench_bank, "quantas malhas do banco cabem em um tick (--budget-us --ticks)"},
+    {"bench-adc", sim_cmd_bench_adc, "filtros e vazao da aquisicao do ADC com fonte sintetica (--inl --noise --spikes --ticks)"},
+    {"bench-tick", sim_cmd_bench_tick, "disparo do ciclo: timer de software + semaforo contra interrupcao + notificacao, atraso e jitter (--period-us --seconds --load)"},
+    {"telemetry", sim_cmd_telemetry, "quadros binarios de telemetria: continuidade e trafego (--minutes --flush-ms --dual)"},
+    {"stress-telemetry", sim_cmd_stress_telemetry, "anel de telemetria com produtora rapida e varias consumidoras (--consumers --slow --batch --rate --seconds)"},
+    {"record", sim_cmd_record, "laco fechado com o gravador de execucoes ligado (--plant --comb --minutes --dual --dir)"},
+    {"replay", sim_cmd_replay, "decodifica uma execucao gravada e a reproduz na planta simulada (ARQUIVO --csv)"},
+    {"autotune", sim_cmd_autotune, "ensaio do rele em cada planta e comparacao das regras ZN/TL/SIMC (--plant --comb --amplitude --warmup --minutes)"},
+    {"schedule", sim_cmd_schedule, "tabela de ganhos por rede: ensaio em cada rede, blob e transitorio das trocas na varredura (--rule --dwell --laps)"},
+    {"profile", sim_cmd_profile, "perfil de setpoint: exatidao contra referencia em double, PRBS, parser e laco fechado (--text --laps)"},
+    {"metrics", sim_cmd_metrics, "tempo de cada etapa do ciclo de controle, texto do /metrics e custo da coleta (--minutes --dual --text)"},
+    {"commands", sim_cmd_commands, "fila de comandos: quadro binario, fila com varias produtoras e laco fechado sob enxurrada (--frames --producers --seconds --minutes)"},
+    {"history", sim_cmd_history, "historico em varias resolucoes: cada nivel contra as amostras, lacunas, custo e tamanho das respostas (--minutes --dual --drop)"},
+    {"boot", sim_cmd_boot, "partida apos reset/brownout: descarga medida, Wi-Fi fora do caminho e tempo ate o primeiro ciclo (--wifi-ms --setup-ms --text)"},
+    {"subscriptions", sim_cmd_subscriptions, "assinaturas por cliente do WebSocket: canais, decimacao, clientes lentos e travados sem atrasar os rapidos (--minutes --dual --flush-ms --slow-s)"},
+    {"identify", sim_cmd_identify, "identificacao em linha (RLS) de cada rede contra os parametros do circuito, deriva de um capacitor e custo da atualizacao (--minutes --excitation --drift --tau-tol)"},
+    {"bench-controllers", sim_cmd_bench_controllers, "controladores da malha simples (PID, MPC): custo por ciclo contra o periodo e laco fechado com o modelo identificado (--iterations --warmup --minutes --weight)"},
+    {"sweep", sim_cmd_sweep, "varredura de sintonia do PID em paralelo nas seis redes, classificada por IAE/ISE/sobressinal/acomodacao/saturacao (--mode --runs --grid --ts --profiles --rank --threads --out --scaling --exact-adc)"},
+    {"step-response", sim_cmd_step_response, "analise de degraus em linha contra a mesma analise em lote, perfil sem degraus, deriva de um capacitor e custo por amostra (--minutes --drift --verbose --text)"},
+    {"memory", sim_cmd_memory, "laco fechado com o heap vigiado: nenhuma alocacao depois da partida no controle e nas consumidoras, relatorio de memoria (--minutes --dual --inject-alloc --text)"},
+};
+
+static const int COMMAND_COUNT = sizeof(COMMANDS) / sizeof(COMMANDS[0]);
+
+static const char *sim_find_arg(int argc, char **argv, const char *name) {
+    for (int i = 1; i < argc - 1; i++) {
+        if (strcmp(argv[i], name) == 0) return argv[i + 1];
+    }
+    return NULL;
+}
+
+double sim_arg_double(int argc, char **argv, const char *name, double fallback) {
+    const char *v = sim_find_arg(argc, argv, name);
+    return v ? atof(v) : fallback;
+}
+
+long sim_arg_long(int argc, char **argv, const char *name, long fallback) {
+    const char *v = sim_find_arg(argc, argv, name);
+    return v ? strtol(v, NULL, 0) : fallback;
+}
+
+const char *sim_arg_string(int argc, char **argv, const char *name, const char *fallback) {
+    const char *v = sim_find_arg(argc, argv, name);
+    return v ? v : fallback;
+}
+
+bool sim_arg_flag(int argc, char **argv, const char *name) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], name) == 0) return true;
+    }
+    return false;
+}
+
+static void sim_print_usage(const char *program) {
+    printf("uso: %s [comando] [opcoes]\n\ncomandos:\n", program);
+    for (int i = 0; i < COMMAND_COUNT; i++) {
+        printf("  %-14s %s\n", COMMANDS[i].name, COMMANDS[i].help);
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)) {
+        sim_print_usage(argv[0]);
+        return 0;
+    }
+
+    // Sem comando (ou comecando por opcao) executa "run"
+    if (argc < 2 || argv[1][0] == '-') return sim_cmd_run(argc, argv);
+
+    for (int i = 0; i < COMMAND_COUNT; i++) {
+        if (strcmp(argv[1], COMMANDS[i].name) == 0) return COMMANDS[i].fn(argc - 1, argv + 1);
+    }
+
+    fprintf(stderr, "comando desconhecido: %s\n", argv[1]);
+    sim_print_usage(argv[0]);
+    return 1;
+}
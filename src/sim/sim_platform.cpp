@@ -0,0 +1,212 @@
+// src/sim/sim_platform.cpp
+
+#include "sim_platform.h"
+#include "sim_engine.h"
+#include "memory_budget.h"
+
+#include <stdarg.h>
+#include <string.h>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+#include <stdlib.h>
+#include <vector>
+
+SimSerial Serial;
+
+// Semaforo de contagem com teto; o mutex e um semaforo com teto 1 que ja
+// nasce disponivel. Um timeout diferente de zero e tratado como espera
+// indefinida (nao ha tempo real no simulador).
+struct SimSemaphore {
+    std::mutex m;
+    std::condition_variable cv;
+    unsigned count;
+    unsigned max_count;
+};
+
+static SemaphoreHandle_t sim_semaphore_create(unsigned initial, unsigned max_count) {
+    SimSemaphore *sem = new SimSemaphore();
+    sem->count = initial;
+    sem->max_count = max_count;
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    return sim_semaphore_create(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+    return sim_semaphore_create(0, 1);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks_to_wait) {
+    std::unique_lock<std::mutex> lock(sem->m);
+    if (sem->count == 0) {
+        if (ticks_to_wait == 0) return pdFALSE;
+        sem->cv.wait(lock, [sem] { return sem->count > 0; });
+    }
+    sem->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    {
+        std::lock_guard<std::mutex> lock(sem->m);
+        if (sem->count >= sem->max_count) return pdFALSE;
+        sem->count++;
+    }
+    sem->cv.notify_one();
+    return pdTRUE;
+}
+
+// Fila circular de bytes protegida por mutex
+struct SimQueue {
+    std::mutex m;
+    std::condition_variable not_empty, not_full;
+    std::vector<uint8_t> storage;
+    unsigned length, item_size, head, count;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    SimQueue *queue = new SimQueue();
+    queue->storage.resize((size_t)length * item_size);
+    queue->length = length;
+    queue->item_size = item_size;
+    queue->head = 0;
+    queue->count = 0;
+    return queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks_to_wait) {
+    {
+        std::unique_lock<std::mutex> lock(queue->m);
+        if (queue->count == queue->length) {
+            if (ticks_to_wait == 0) return pdFALSE;
+            queue->not_full.wait(lock, [queue] { return queue->count < queue->length; });
+        }
+        unsigned tail = (queue->head + queue->count) % queue->length;
+        memcpy(&queue->storage[(size_t)tail * queue->item_size], item, queue->item_size);
+        queue->count++;
+    }
+    queue->not_empty.notify_one();
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks_to_wait) {
+    {
+        std::unique_lock<std::mutex> lock(queue->m);
+        if (queue->count == 0) {
+            if (ticks_to_wait == 0) return pdFALSE;
+            queue->not_empty.wait(lock, [queue] { return queue->count > 0; });
+        }
+        memcpy(item, &queue->storage[(size_t)queue->head * queue->item_size], queue->item_size);
+        queue->head = (queue->head + 1) % queue->length;
+        queue->count--;
+    }
+    queue->not_full.notify_one();
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> lock(queue->m);
+    return queue->count;
+}
+
+void vTaskDelay(TickType_t ticks) {
+    sim_engine_advance_us((uint64_t)ticks * portTICK_PERIOD_MS * 1000);
+}
+
+void vTaskDelayUntil(TickType_t *previous_wake_time, TickType_t increment) {
+    *previous_wake_time += increment;
+    sim_engine_advance_to_us((uint64_t)*previous_wake_time * portTICK_PERIOD_MS * 1000);
+}
+
+TickType_t xTaskGetTickCount() {
+    return (TickType_t)(sim_engine_now_us() / (portTICK_PERIOD_MS * 1000));
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    (void)task;
+    return 0;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return NULL;
+}
+
+// --- Heap ---
+// No lugar do --wrap=malloc do ESP32 (memory_budget.h): cada new do
+// programa e contado. O codigo do firmware e C++; o que so usa malloc (a
+// biblioteca C) nao entra na conta.
+void *operator new(size_t size) {
+    memory_budget_note_alloc();
+    void *p = malloc(size > 0 ? size : 1);
+    if (p == NULL) throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+    free(p);
+}
+
+unsigned long millis() {
+    return (unsigned long)(sim_engine_now_us() / 1000);
+}
+
+unsigned long micros() {
+    return (unsigned long)sim_engine_now_us();
+}
+
+// --- Serial ---
+
+size_t SimSerial::print(const char *s) {
+    if (!enabled_) return 0;
+    fputs(s, stdout);
+    return strlen(s);
+}
+
+size_t SimSerial::print(char c) {
+    if (enabled_) fputc(c, stdout);
+    return enabled_ ? 1 : 0;
+}
+
+size_t SimSerial::print(int v) { return printf("%d", v); }
+size_t SimSerial::print(unsigned int v) { return printf("%u", v); }
+size_t SimSerial::print(long v) { return printf("%ld", v); }
+size_t SimSerial::print(unsigned long v) { return printf("%lu", v); }
+size_t SimSerial::print(double v, int digits) { return printf("%.*f", digits, v); }
+
+size_t SimSerial::println() { return print('\n'); }
+size_t SimSerial::println(const char *s) { return print(s) + println(); }
+size_t SimSerial::println(int v) { return print(v) + println(); }
+size_t SimSerial::println(unsigned long v) { return print(v) + println(); }
+size_t SimSerial::println(double v, int digits) { return print(v, digits) + println(); }
+
+size_t SimSerial::printf(const char *fmt, ...) {
+    if (!enabled_) return 0;
+    va_list args;
+    va_start(args, fmt);
+    int n = vfprintf(stdout, fmt, args);
+    va_end(args);
+    return n > 0 ? (size_t)n : 0;
+}
+
+void SimSerial::flush() {
+    if (enabled_) fflush(stdout);
+}
@@ -0,0 +1,89 @@
+// src/sim/sim_platform.h
+//
+// Substitutos minimos das APIs do Arduino e do FreeRTOS usadas pelo codigo
+// compartilhado (controller, control_loop, mux, plant) no build nativo.
+// O tempo vem do relogio virtual do simulador (sim_engine), entao
+// vTaskDelay/millis nao esperam tempo real: apenas avancam a simulacao.
+
+#ifndef SIM_PLATFORM_H
+#define SIM_PLATFORM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <math.h>
+
+// --- FreeRTOS ---
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef struct SimSemaphore* SemaphoreHandle_t;
+typedef struct SimTimer* TimerHandle_t;
+typedef struct SimQueue* QueueHandle_t;
+typedef void* TaskHandle_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS 1
+#define portMAX_DELAY 0xFFFFFFFFu
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(((TickType_t)(ms) * configTICK_RATE_HZ) / 1000))
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+SemaphoreHandle_t xSemaphoreCreateBinary();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks_to_wait);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
+
+// Fila de itens de tamanho fixo; como nos semaforos, qualquer timeout
+// diferente de zero espera indefinidamente
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size);
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks_to_wait);
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks_to_wait);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t *previous_wake_time, TickType_t increment);
+TickType_t xTaskGetTickCount();
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);   // sem tarefas: 0
+TaskHandle_t xTaskGetCurrentTaskHandle();                       // sem tarefas: NULL
+
+// --- Arduino ---
+#define LOW 0
+#define HIGH 1
+#define INPUT 0x01
+#define OUTPUT 0x03
+
+unsigned long millis();
+unsigned long micros();
+
+// Serial que escreve em stdout (pode ser silenciada nas varreduras longas)
+class SimSerial {
+public:
+    void begin(unsigned long baud) { (void)baud; }
+    void set_enabled(bool enabled) { enabled_ = enabled; }
+
+    size_t print(const char *s);
+    size_t print(char c);
+    size_t print(int v);
+    size_t print(unsigned int v);
+    size_t print(long v);
+    size_t print(unsigned long v);
+    size_t print(double v, int digits = 2);
+
+    size_t println();
+    size_t println(const char *s);
+    size_t println(int v);
+    size_t println(unsigned long v);
+    size_t println(double v, int digits = 2);
+
+    size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+    void flush();
+
+private:
+    bool enabled_ = true;
+};
+
+extern SimSerial Serial;
+
+#endif // SIM_PLATFORM_H
@@ -0,0 +1,136 @@
+// src/sim/sim_runner.cpp
+
+#include "sim_runner.h"
+#include "config.h"
+#include "mux.h"
+#include "plant.h"
+#include "controller.h"
+#include "control_loop.h"
+#include "state_snapshot.h"
+#include "adc_acquisition.h"
+#include "loop_metrics.h"
+
+#include <math.h>
+#include <chrono>
+
+void sim_run_default_config(SimRunConfig_t *cfg) {
+    cfg->plant_id = 1;
+    cfg->combination = 0;
+    cfg->kp = 0.05;
+    cfg->ki = 0.1;
+    cfg->kd = 0.0;
+    cfg->duration_s = 3600.0;
+    cfg->sp_low_v = 0.2 * VCC;
+    cfg->sp_high_v = 0.8 * VCC;
+    cfg->sp_period_s = 60.0;
+    cfg->sp_phase_s = 0.0;
+    cfg->profile = NULL;
+    sim_engine_default_config(&cfg->engine);
+    cfg->dual = false;
+    cfg->decimation = ADC_DECIMATE_MEAN;
+    cfg->gain_schedule = NULL;
+    cfg->trace = NULL;
+    cfg->on_cycle = NULL;
+    cfg->on_cycle_ctx = NULL;
+}
+
+void sim_advance_with_acquisition(uint64_t t_us) {
+    const uint64_t acq_period_us = ADC_ACQ_PERIOD_MS * 1000ULL;
+
+    // A decimacao nunca olha mais que meio buffer para tras, entao as
+    // amostras anteriores a isso nao mudam nada: pula direto ate o trecho
+    // que sera lido
+    const uint64_t useful_us = (uint64_t)(ADC_RING_SIZE / 2 / ADC_ACQ_BURST) * acq_period_us;
+    if (t_us > useful_us && sim_engine_now_us() + acq_period_us < t_us - useful_us) {
+        uint64_t now = sim_engine_now_us();
+        uint64_t skip = (t_us - useful_us - now) / acq_period_us * acq_period_us;
+        sim_engine_advance_us(skip);
+    }
+
+    while (sim_engine_now_us() + acq_period_us <= t_us) {
+        sim_engine_advance_us(acq_period_us);
+        adc_acquisition_sample_now();
+    }
+    sim_engine_advance_to_us(t_us);
+}
+
+void sim_run_closed_loop(const SimRunConfig_t *cfg, SimRunResult_t *result) {
+    auto wall_start = std::chrono::steady_clock::now();
+
+    control_loop_init();
+
+    sim_engine_reset(&cfg->engine);
+    mux_init();
+    plant_init();
+    adc_acquisition_init();
+    adc_acquisition_set_mode(cfg->decimation);
+
+    loop_metrics_reset();
+
+    controller_init(cfg->kp, cfg->ki, cfg->kd);
+    g_systemState.active_plant = cfg->plant_id;
+    g_systemState.mux_combination = cfg->combination;
+    control_loop_set_gain_schedule(cfg->gain_schedule);
+    control_loop_request_dual_mode(cfg->dual);
+
+    // O perfil e entregue como a pagina faz: compilado no buffer de quem
+    // envia e trocado no primeiro ciclo
+    if (cfg->profile) {
+        *control_loop_profile_buffer() = *cfg->profile;
+        control_loop_request_profile(true);
+    }
+
+    const uint64_t period_us = CONTROL_PERIOD_US;
+    const uint64_t total_cycles = (uint64_t)(cfg->duration_s * 1e6 / period_us);
+    const double dt = period_us * 1e-6;
+    double sum_sq = 0;
+
+    *result = SimRunResult_t();
+    if (cfg->trace) fprintf(cfg->trace, "t_s,sp_v,y_v,u\n");
+
+    for (uint64_t k = 0; k < total_cycles; k++) {
+        // Proximo disparo do timer de controle
+        sim_advance_with_acquisition(k * period_us);
+        loop_metrics_timer_fired(false);
+
+        double t = k * dt;
+        double sp_v = 0;
+        if (cfg->profile) {
+            control_loop_step();
+        } else {
+            bool high = fmod(t + cfg->sp_phase_s, cfg->sp_period_s) < 0.5 * cfg->sp_period_s;
+            sp_v = high ? cfg->sp_high_v : cfg->sp_low_v;
+
+            double sp = (sp_v / VCC) * ADC_RESOLUTION;
+            if (cfg->dual) {
+                control_loop_request_loop_setpoint(1, sp);
+                control_loop_request_loop_setpoint(2, sp);
+            } else {
+                control_loop_request_setpoint(sp);
+            }
+            control_loop_step();
+        }
+
+        StateSnapshot_t state;
+        state_snapshot_read(&state);
+        double u = state.u;
+        if (cfg->profile) sp_v = state.sp / ADC_RESOLUTION * VCC;
+
+        double y_v = sim_engine_plant_voltage(cfg->plant_id);
+        double e = sp_v - y_v;
+        result->iae += fabs(e) * dt;
+        if (cfg->dual) result->iae_other += fabs(sp_v - sim_engine_plant_voltage(3 - cfg->plant_id)) * dt;
+        sum_sq += e * e;
+        if (u <= 0.0 || u >= DAC_RESOLUTION) result->saturated_s += dt;
+        result->final_y_v = y_v;
+        result->cycles++;
+
+        if (cfg->trace) fprintf(cfg->trace, "%.3f,%.4f,%.4f,%.2f\n", t, sp_v, y_v, u);
+        if (cfg->on_cycle) cfg->on_cycle(cfg->on_cycle_ctx);
+    }
+
+    if (result->cycles > 0) result->rms_error = sqrt(sum_sq / result->cycles);
+
+    std::chrono::duration<double> wall = std::chrono::steady_clock::now() - wall_start;
+    result->wall_s = wall.count();
+}
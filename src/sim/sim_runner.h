@@ -0,0 +1,51 @@
+// src/sim/sim_runner.h
+//
+// Executa o laco fechado (control_loop_step) contra o motor de simulacao,
+// com o relogio virtual disparando um ciclo a cada SAMPLE_TIME_MS.
+
+#ifndef SIM_RUNNER_H
+#define SIM_RUNNER_H
+
+#include <stdio.h>
+#include "sim_engine.h"
+#include "adc_acquisition.h"
+#include "gain_schedule.h"
+#include "setpoint.h"
+
+typedef struct {
+    int plant_id;
+    int combination;
+    double kp, ki, kd;
+    double duration_s;      // tempo simulado
+    double sp_low_v;        // referencia em onda quadrada entre sp_low_v
+    double sp_high_v;       // e sp_high_v...
+    double sp_period_s;     // ...com este periodo
+    double sp_phase_s;      // adianta a onda quadrada (0: comeca em sp_high_v)
+    const SetpointProfile_t *profile;   // perfil no lugar da onda quadrada, NULL desliga
+    bool dual;              // controla as duas plantas ao mesmo tempo
+    AdcDecimation_t decimation;
+    const GainTable_t *gain_schedule;   // tabela de ganhos por rede, NULL desliga
+    SimEngineConfig_t engine;
+    FILE *trace;            // CSV opcional (t,sp,y,u), NULL desliga
+    void (*on_cycle)(void *ctx);    // chamado apos cada ciclo, NULL desliga
+    void *on_cycle_ctx;
+} SimRunConfig_t;
+
+typedef struct {
+    unsigned long cycles;
+    double iae;             // integral do erro absoluto (V.s), saida real
+    double iae_other;       // IAE da outra planta no modo duplo
+    double rms_error;       // erro RMS (V)
+    double saturated_s;     // tempo com u no limite do DAC (s)
+    double final_y_v;
+    double wall_s;          // tempo real gasto
+} SimRunResult_t;
+
+void sim_run_default_config(SimRunConfig_t *cfg);
+void sim_run_closed_loop(const SimRunConfig_t *cfg, SimRunResult_t *result);
+
+// Avanca o relogio virtual ate t_us alimentando a aquisicao do ADC a cada
+// ADC_ACQ_PERIOD_MS, como a tarefa de aquisicao faria no ESP32
+void sim_advance_with_acquisition(uint64_t t_us);
+
+#endif // SIM_RUNNER_H
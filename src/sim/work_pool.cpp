@@ -0,0 +1,92 @@
+// src/sim/work_pool.cpp
+
+#include "work_pool.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Faixa [begin, end) de uma thread. A dona tira do inicio, os ladroes do fim;
+// o mutex so e disputado quando alguem rouba.
+struct WorkRange {
+    std::mutex lock;
+    size_t begin = 0, end = 0;
+};
+
+int work_pool_default_threads() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n > 0 ? (int)n : 1;
+}
+
+// Tira ate chunk indices do inicio da propria faixa
+static bool work_pool_take(WorkRange *range, size_t chunk, size_t *first, size_t *last) {
+    std::lock_guard<std::mutex> guard(range->lock);
+    if (range->begin >= range->end) return false;
+    *first = range->begin;
+    *last = (range->end - range->begin > chunk) ? range->begin + chunk : range->end;
+    range->begin = *last;
+    return true;
+}
+
+// Rouba a metade do fim da faixa de uma vitima (pelo menos um indice)
+static bool work_pool_steal(WorkRange *victim, size_t *first, size_t *last) {
+    std::lock_guard<std::mutex> guard(victim->lock);
+    size_t left = victim->end - victim->begin;
+    if (victim->begin >= victim->end) return false;
+    size_t half = (left + 1) / 2;
+    *last = victim->end;
+    *first = victim->end - half;
+    victim->end = *first;
+    return true;
+}
+
+void work_pool_run(size_t count, int threads, size_t chunk,
+                   const std::function<void(int worker, size_t index)> &fn, WorkPoolStats_t *stats) {
+    if (threads <= 0) threads = work_pool_default_threads();
+    if (chunk == 0) chunk = 1;
+    if (stats) *stats = WorkPoolStats_t{threads, 0, 0};
+    if (count == 0) return;
+
+    std::unique_ptr<WorkRange[]> ranges(new WorkRange[threads]);
+    for (int w = 0; w < threads; w++) {
+        ranges[w].begin = count * w / threads;
+        ranges[w].end = count * (w + 1) / threads;
+    }
+    std::atomic<size_t> steals(0), stolen(0);
+
+    auto worker = [&](int w) {
+        WorkRange *own = &ranges[w];
+        for (;;) {
+            size_t first, last;
+            while (work_pool_take(own, chunk, &first, &last)) {
+                for (size_t i = first; i < last; i++) fn(w, i);
+            }
+
+            // Sem trabalho: procura uma vitima a partir da vizinha. Como
+            // nenhuma tarefa cria outras, uma volta inteira sem achar nada
+            // quer dizer que o resto ja esta com quem vai executa-lo.
+            bool found = false;
+            for (int k = 1; k < threads && !found; k++) {
+                found = work_pool_steal(&ranges[(w + k) % threads], &first, &last);
+            }
+            if (!found) return;
+            steals.fetch_add(1, std::memory_order_relaxed);
+            stolen.fetch_add(last - first, std::memory_order_relaxed);
+            std::lock_guard<std::mutex> guard(own->lock);
+            own->begin = first;
+            own->end = last;
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (int w = 1; w < threads; w++) pool.emplace_back(worker, w);
+    worker(0);
+    for (auto &t : pool) t.join();
+
+    if (stats) {
+        stats->steals = steals.load();
+        stats->stolen = stolen.load();
+    }
+}
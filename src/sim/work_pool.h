@@ -0,0 +1,31 @@
+// src/sim/work_pool.h
+//
+// Execucao paralela de um lote de tarefas independentes (indices 0..count-1)
+// em threads do PC, com roubo de trabalho: cada thread comeca com uma faixa
+// contigua de indices e tira pedacos do inicio dela; quem esvazia a sua
+// rouba a metade do fim da faixa de outra. Tarefas de custo desigual (um
+// ganho instavel satura e custa o mesmo, um periodo curto custa mais) nao
+// deixam threads paradas esperando a mais lenta.
+
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+#include <stddef.h>
+#include <functional>
+
+typedef struct {
+    int threads;
+    size_t steals;          // faixas roubadas
+    size_t stolen;          // indices que mudaram de thread
+} WorkPoolStats_t;
+
+// Threads do PC (pelo menos 1)
+int work_pool_default_threads();
+
+// Chama fn(worker, index) para cada index em [0, count), uma vez cada, com
+// threads threads (0: work_pool_default_threads). chunk e quantos indices
+// uma thread tira da sua faixa de cada vez. Retorna quando todos acabarem.
+void work_pool_run(size_t count, int threads, size_t chunk,
+                   const std::function<void(int worker, size_t index)> &fn, WorkPoolStats_t *stats);
+
+#endif // WORK_POOL_H
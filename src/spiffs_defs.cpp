@@ -1,9 +1,52 @@
 #include <config.h>
 #include <spiffs_defs.h>
+#include <blob_storage.h>
 
 void initSPIFFS() {         
   if (!SPIFFS.begin(true)) {
     Serial.println("An error has occurred while mounting LittleFS");
   }
   Serial.println("LittleFS mounted successfully");
-}
\ No newline at end of file
+}
+
+static bool blob_storage_read_path(const char *path, uint8_t *data, size_t capacity, size_t *length) {
+  if (!SPIFFS.exists(path)) return false;
+
+  File file = SPIFFS.open(path, FILE_READ);
+  if (!file) return false;
+  *length = file.read(data, capacity);
+  file.close();
+  return true;
+}
+
+bool blob_storage_read(const char *name, uint8_t *data, size_t capacity, size_t *length) {
+  char path[40];
+  snprintf(path, sizeof(path), "/%s", name);
+  return blob_storage_read_path(path, data, capacity, length);
+}
+
+bool blob_storage_read_pending(const char *name, uint8_t *data, size_t capacity, size_t *length) {
+  char tmp_path[44];
+  snprintf(tmp_path, sizeof(tmp_path), "/%s.tmp", name);
+  return blob_storage_read_path(tmp_path, data, capacity, length);
+}
+
+bool blob_storage_write(const char *name, const uint8_t *data, size_t length) {
+  char path[40], tmp_path[44];
+  snprintf(path, sizeof(path), "/%s", name);
+  snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+  File file = SPIFFS.open(tmp_path, FILE_WRITE);
+  if (!file) return false;
+  bool ok = file.write(data, length) == length;
+  file.close();
+  if (!ok) {
+    SPIFFS.remove(tmp_path);
+    return false;
+  }
+
+  // O SPIFFS nao renomeia por cima de um arquivo existente. Um reset entre
+  // as duas chamadas deixa so o .tmp (blob_storage_read_pending).
+  if (SPIFFS.exists(path)) SPIFFS.remove(path);
+  return SPIFFS.rename(tmp_path, path);
+}
@@ -0,0 +1,32 @@
+// src/state_snapshot.cpp
+
+#include "state_snapshot.h"
+#include "seqlock.h"
+
+static Seqlock<StateSnapshot_t> state_seqlock;
+static Seqlock<BankSnapshot_t> bank_seqlock;
+static Seqlock<AutotuneReport_t> autotune_seqlock;
+
+void state_snapshot_publish(const StateSnapshot_t *snapshot) {
+    state_seqlock.publish(*snapshot);
+}
+
+void state_snapshot_read(StateSnapshot_t *out) {
+    state_seqlock.read(out);
+}
+
+void bank_snapshot_publish(const BankSnapshot_t *snapshot) {
+    bank_seqlock.publish(*snapshot);
+}
+
+void bank_snapshot_read(BankSnapshot_t *out) {
+    bank_seqlock.read(out);
+}
+
+void autotune_report_publish(const AutotuneReport_t *report) {
+    autotune_seqlock.publish(*report);
+}
+
+void autotune_report_read(AutotuneReport_t *out) {
+    autotune_seqlock.read(out);
+}
@@ -0,0 +1,57 @@
+// src/state_snapshot.h
+//
+// Copia consistente do estado do laco de controle para os leitores
+// (plotters serial/WebSocket, servidor web). A pid_controller_task e a unica
+// escritora e publica uma vez por ciclo; os leitores nunca bloqueiam a
+// escritora (ver seqlock.h).
+
+#ifndef STATE_SNAPSHOT_H
+#define STATE_SNAPSHOT_H
+
+#include <stdint.h>
+
+typedef struct {
+    uint32_t cycle;         // numero do ciclo de controle
+    uint32_t time_ms;       // millis() no momento da publicacao
+    double sp;              // referencia (contagens do ADC)
+    double y;               // saida medida (contagens do ADC)
+    double u;               // sinal de controle (contagens do DAC)
+    double iTerm;           // termo integral
+    double kp, ki, kd;      // ganhos (ja escalados por SAMPLE_TIME_MS)
+    int active_plant;
+    int mux_combination;
+    int controller;         // ControllerKind_t da malha simples
+} StateSnapshot_t;
+
+// Telemetria por malha do modo de duas malhas (loops == 0 no modo simples)
+typedef struct {
+    uint32_t cycle;
+    uint32_t loops;
+    float sp[2], y[2], u[2], iTerm[2];
+    uint32_t saturated[2];      // ciclos com u saturado
+    float iae[2];               // integral do erro absoluto (contagens.s)
+} BankSnapshot_t;
+
+// Resultado do ultimo ensaio de sintonia automatica (autotune.h). seq muda a
+// cada ensaio iniciado ou concluido.
+typedef struct {
+    uint32_t seq;
+    uint32_t status;            // AutotuneStatus_t
+    uint32_t rule;              // AutotuneRule_t
+    uint32_t plant, combination;
+    float ku, pu;               // ganho critico (DAC/ADC) e periodo critico (s)
+    float plant_gain;
+    float kp, ki, kd;           // ganhos aplicados (ki, kd por segundo)
+} AutotuneReport_t;
+
+// Somente a tarefa de controle chama
+void state_snapshot_publish(const StateSnapshot_t *snapshot);
+void bank_snapshot_publish(const BankSnapshot_t *snapshot);
+void autotune_report_publish(const AutotuneReport_t *report);
+
+// Qualquer tarefa/contexto pode chamar; nunca bloqueia a escritora
+void state_snapshot_read(StateSnapshot_t *out);
+void bank_snapshot_read(BankSnapshot_t *out);
+void autotune_report_read(AutotuneReport_t *out);
+
+#endif // STATE_SNAPSHOT_H
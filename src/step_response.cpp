@@ -0,0 +1,211 @@
+// src/step_response.cpp
+
+#include "step_response.h"
+#include "text_buffer.h"
+#include "config.h"
+#include "seqlock.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// Degrau em andamento de uma malha. Tempos em amostras desde o degrau.
+typedef struct {
+    bool primed;                // ja tem a amostra anterior desta rede
+    bool active;
+    int index;                  // rede (gain_schedule_index)
+    uint32_t last_cycle;
+    float sp;                   // setpoint da amostra anterior
+    float from, target, size, dir, band;
+    uint32_t cycle;             // ciclo do degrau
+    uint32_t n;                 // amostras analisadas
+    int32_t rise10, rise90;     // primeira amostra em 10 % e 90 % (-1: ainda nao)
+    int32_t last_out;           // ultima amostra fora da faixa (-1: nenhuma)
+    float peak;                 // maior passagem alem da referencia
+    float abs_error;            // soma de |e|
+    float in_band_error;        // soma de e desde que entrou na faixa
+    uint32_t in_band;           // amostras seguidas dentro da faixa
+    float last_error;
+} StepTracker_t;
+
+static StepTracker_t trackers[GAIN_SCHEDULE_PLANTS];
+static StepReport_t report;
+static Seqlock<StepReport_t> report_seqlock;
+
+static const float COUNTS_TO_V = (float)VCC / (float)ADC_RESOLUTION;
+static constexpr float SAMPLE_S = (float)SAMPLE_TIME_S;
+
+void step_response_init() {
+    memset(trackers, 0, sizeof(trackers));
+    memset(&report, 0, sizeof(report));
+    report_seqlock.publish(report);
+}
+
+static void step_begin(StepTracker_t *t, float from, float to, uint32_t cycle) {
+    t->active = true;
+    t->from = from;
+    t->target = to;
+    t->size = fabsf(to - from);
+    t->dir = to > from ? 1.0f : -1.0f;
+    t->band = fmaxf(STEP_SETTLE_BAND * t->size, STEP_MIN_BAND);
+    t->cycle = cycle;
+    t->n = 0;
+    t->rise10 = t->rise90 = -1;
+    t->last_out = -1;
+    t->peak = 0.0f;
+    t->abs_error = 0.0f;
+    t->in_band_error = 0.0f;
+    t->in_band = 0;
+    t->last_error = 0.0f;
+}
+
+// Fecha o degrau, guarda no historico da rede e publica
+static void step_finish(StepTracker_t *t, uint8_t flags) {
+    t->active = false;
+    if (t->n == 0) return;
+    if (t->in_band >= STEP_HOLD_SAMPLES) flags |= STEP_RESULT_SETTLED;
+
+    StepHistory_t *history = &report.networks[t->index];
+    StepResult_t *r = &history->steps[history->count % STEP_HISTORY];
+    history->count++;
+    r->seq = ++report.seq;
+    r->cycle = t->cycle;
+    r->plant = (uint8_t)(t->index / GAIN_SCHEDULE_COMBINATIONS + 1);
+    r->combination = (uint8_t)(t->index % GAIN_SCHEDULE_COMBINATIONS);
+    r->flags = flags;
+    r->reserved = 0;
+    r->from_v = t->from * COUNTS_TO_V;
+    r->to_v = t->target * COUNTS_TO_V;
+    r->rise_s = (t->rise10 >= 0 && t->rise90 >= 0) ? (t->rise90 - t->rise10) * SAMPLE_S : -1.0f;
+    r->overshoot_pct = t->peak / t->size * 100.0f;
+    r->settling_s = (flags & STEP_RESULT_SETTLED) ? (t->last_out + 1) * SAMPLE_S : -1.0f;
+    r->steady_error_v = ((flags & STEP_RESULT_SETTLED) ? t->in_band_error / t->in_band : t->last_error) * COUNTS_TO_V;
+    r->iae = t->abs_error * COUNTS_TO_V * SAMPLE_S;
+    r->duration_s = t->n * SAMPLE_S;
+    report_seqlock.publish(report);
+}
+
+void step_response_update(int plant_id, int combination, float sp, float y, uint32_t cycle) {
+    int index = gain_schedule_index(plant_id, combination);
+    if (index < 0 || plant_id < 1 || plant_id > GAIN_SCHEDULE_PLANTS) return;
+    StepTracker_t *t = &trackers[plant_id - 1];
+
+    // Amostra que nao segue a anterior da mesma rede: recomeca
+    bool follows = t->primed && t->index == index && cycle == t->last_cycle + 1;
+    t->last_cycle = cycle;
+    if (!follows) {
+        t->primed = true;
+        t->active = false;
+        t->index = index;
+        t->sp = sp;
+        return;
+    }
+
+    float jump = sp - t->sp;
+    t->sp = sp;
+    if (fabsf(jump) >= STEP_MIN_COUNTS) {
+        if (t->active) step_finish(t, STEP_RESULT_INTERRUPTED);
+        step_begin(t, sp - jump, sp, cycle);
+    } else if (t->active && fabsf(sp - t->target) > t->band) {
+        step_finish(t, STEP_RESULT_INTERRUPTED);
+    }
+    if (!t->active) return;
+
+    float e = t->target - y;
+    t->abs_error += fabsf(e);
+    t->last_error = e;
+    float excess = -t->dir * e;
+    if (excess > t->peak) t->peak = excess;
+    float progress = t->dir * (y - t->from) / t->size;
+    if (t->rise10 < 0 && progress >= 0.1f) t->rise10 = (int32_t)t->n;
+    if (t->rise90 < 0 && progress >= 0.9f) t->rise90 = (int32_t)t->n;
+    if (fabsf(e) > t->band) {
+        t->last_out = (int32_t)t->n;
+        t->in_band = 0;
+        t->in_band_error = 0.0f;
+    } else {
+        t->in_band++;
+        t->in_band_error += e;
+    }
+    t->n++;
+
+    if (t->in_band >= STEP_HOLD_SAMPLES) step_finish(t, 0);
+    else if (t->n >= STEP_MAX_SAMPLES) step_finish(t, STEP_RESULT_TIMEOUT);
+}
+
+void step_response_report_read(StepReport_t *out) {
+    report_seqlock.read(out);
+}
+
+int step_response_since(const StepReport_t *r, uint32_t after, StepResult_t *out, int max) {
+    int count = 0;
+    for (int i = 0; i < GAIN_SCHEDULE_ENTRIES; i++) {
+        for (int k = 0; k < STEP_HISTORY; k++) {
+            const StepResult_t *step = &r->networks[i].steps[k];
+            if (step->seq == 0 || step->seq <= after) continue;
+            // Insercao ordenada por seq; cheio, fica com os mais antigos
+            int pos = count;
+            while (pos > 0 && out[pos - 1].seq > step->seq) pos--;
+            if (pos >= max) continue;
+            int last = count < max ? count : max - 1;
+            for (int j = last; j > pos; j--) out[j] = out[j - 1];
+            out[pos] = *step;
+            if (count < max) count++;
+        }
+    }
+    return count;
+}
+
+const StepResult_t *step_response_latest(const StepReport_t *r, int index) {
+    if (index < 0 || index >= GAIN_SCHEDULE_ENTRIES) return NULL;
+    const StepHistory_t *history = &r->networks[index];
+    if (history->count == 0) return NULL;
+    return &history->steps[(history->count - 1) % STEP_HISTORY];
+}
+
+const char *step_response_state_name(uint8_t flags) {
+    if (flags & STEP_RESULT_SETTLED) return "acomodado";
+    if (flags & STEP_RESULT_TIMEOUT) return "tempo";
+    return "interrompido";
+}
+
+size_t step_response_format_text(char *out, size_t capacity) {
+    if (capacity == 0) return 0;
+    TextBuffer_t t = {out, capacity, 0};
+    out[0] = '\0';
+
+    static StepReport_t r;
+    step_response_report_read(&r);
+    text_append(&t, "# TYPE step_response_total counter\n");
+    for (int i = 0; i < GAIN_SCHEDULE_ENTRIES; i++) {
+        if (r.networks[i].count == 0) continue;
+        text_append(&t, "step_response_total{plant=\"%d\",combination=\"%d\"} %lu\n",
+                    i / GAIN_SCHEDULE_COMBINATIONS + 1, i % GAIN_SCHEDULE_COMBINATIONS,
+                    (unsigned long)r.networks[i].count);
+    }
+
+    // Ultimo degrau de cada rede; subida e acomodacao so quando houve
+    static const struct {
+        const char *name;
+        size_t offset;
+    } GAUGES[] = {
+        {"step_response_rise_seconds", offsetof(StepResult_t, rise_s)},
+        {"step_response_overshoot_percent", offsetof(StepResult_t, overshoot_pct)},
+        {"step_response_settling_seconds", offsetof(StepResult_t, settling_s)},
+        {"step_response_steady_error_volts", offsetof(StepResult_t, steady_error_v)},
+        {"step_response_iae_volt_seconds", offsetof(StepResult_t, iae)},
+    };
+    for (size_t g = 0; g < sizeof(GAUGES) / sizeof(GAUGES[0]); g++) {
+        text_append(&t, "# TYPE %s gauge\n", GAUGES[g].name);
+        for (int i = 0; i < GAIN_SCHEDULE_ENTRIES; i++) {
+            const StepResult_t *step = step_response_latest(&r, i);
+            if (step == NULL) continue;
+            float value;
+            memcpy(&value, (const char *)step + GAUGES[g].offset, sizeof(value));
+            if (value < 0.0f && GAUGES[g].offset != offsetof(StepResult_t, steady_error_v)) continue;
+            text_append(&t, "%s{plant=\"%d\",combination=\"%d\"} %.4f\n", GAUGES[g].name, step->plant,
+                        step->combination, value);
+        }
+    }
+    return t.length;
+}
@@ -0,0 +1,97 @@
+// src/step_response.h
+//
+// Analise da resposta ao degrau em linha. A tarefa de controle entrega a
+// cada ciclo o setpoint e o y de cada malha; um salto do setpoint de pelo
+// menos STEP_MIN_COUNTS abre um degrau, e as medidas saem incrementalmente,
+// em O(1) por amostra e sem guardar amostras:
+//
+//   subida        tempo de 10 % a 90 % do degrau (da referencia anterior a nova)
+//   sobressinal   maior passagem alem da referencia, em % do degrau
+//   acomodacao    do degrau ate a ultima amostra fora da faixa
+//                 (STEP_SETTLE_BAND do degrau, no minimo STEP_MIN_BAND)
+//   erro regime   media do erro depois de acomodar
+//   IAE           integral do erro absoluto do degrau ate o fim da analise
+//
+// O degrau termina acomodado (STEP_HOLD_SAMPLES seguidas dentro da faixa),
+// interrompido (novo degrau, ou a referencia andou sem saltar: rampa,
+// perfil) ou por tempo (STEP_MAX_SAMPLES). Um ciclo sem amostra da malha
+// (troca de rede, modo simples com a outra planta, ensaio do rele) descarta
+// o degrau em andamento.
+//
+// Cada rede (planta, combinacao) guarda os ultimos STEP_HISTORY resultados.
+// O relatorio e publicado (seqlock) so quando um degrau termina; o
+// WebSocket manda cada resultado novo uma vez e GET /degraus devolve o
+// historico.
+
+#ifndef STEP_RESPONSE_H
+#define STEP_RESPONSE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "gain_schedule.h"
+
+const float STEP_MIN_COUNTS = 100.0f;       // salto minimo do setpoint (~80 mV)
+const float STEP_SETTLE_BAND = 0.02f;       // faixa de acomodacao (fracao do degrau)
+const float STEP_MIN_BAND = 8.0f;           // contagens do ADC
+const uint32_t STEP_HOLD_SAMPLES = 25;      // dentro da faixa para dar por acomodado (5 s)
+const uint32_t STEP_MAX_SAMPLES = 900;      // analise mais longa (3 min)
+const int STEP_HISTORY = 4;                 // resultados guardados por rede
+
+enum {
+    STEP_RESULT_SETTLED     = 1 << 0,
+    STEP_RESULT_INTERRUPTED = 1 << 1,       // novo degrau ou referencia mudou
+    STEP_RESULT_TIMEOUT     = 1 << 2,
+};
+
+// Um degrau analisado. Tempos em segundos, -1 quando nao houve (a subida
+// nao chegou a 90 %, nao acomodou); sem acomodar, o erro de regime e o da
+// ultima amostra.
+typedef struct {
+    uint32_t seq;               // numero do degrau (crescente, 0: vazio)
+    uint32_t cycle;             // ciclo de controle do degrau
+    uint8_t plant;
+    uint8_t combination;
+    uint8_t flags;              // STEP_RESULT_*
+    uint8_t reserved;
+    float from_v, to_v;         // referencia antes e depois
+    float rise_s;
+    float overshoot_pct;
+    float settling_s;
+    float steady_error_v;
+    float iae;                  // V.s
+    float duration_s;           // tempo analisado
+} StepResult_t;
+
+typedef struct {
+    uint32_t count;             // degraus analisados na rede
+    StepResult_t steps[STEP_HISTORY];   // anel: o mais recente em (count - 1) % STEP_HISTORY
+} StepHistory_t;
+
+typedef struct {
+    uint32_t seq;               // seq do ultimo degrau publicado
+    StepHistory_t networks[GAIN_SCHEDULE_ENTRIES];  // por gain_schedule_index()
+} StepReport_t;
+
+// Somente a tarefa de controle chama as duas abaixo
+void step_response_init();
+
+// Amostra do ciclo da malha de plant_id: setpoint e y em contagens do ADC
+void step_response_update(int plant_id, int combination, float sp, float y, uint32_t cycle);
+
+// Qualquer tarefa
+void step_response_report_read(StepReport_t *out);
+
+// Resultados do relatorio com seq > after, do mais antigo ao mais novo (no
+// maximo max). Retorna quantos.
+int step_response_since(const StepReport_t *report, uint32_t after, StepResult_t *out, int max);
+
+// Mais recente da rede, ou NULL se nenhum
+const StepResult_t *step_response_latest(const StepReport_t *report, int index);
+
+// "acomodado", "interrompido" ou "tempo"
+const char *step_response_state_name(uint8_t flags);
+
+// Texto do /metrics (step_response_*) do ultimo degrau de cada rede
+size_t step_response_format_text(char *out, size_t capacity);
+
+#endif // STEP_RESPONSE_H
@@ -0,0 +1,267 @@
+// src/subscriptions.cpp
+
+#include "subscriptions.h"
+#include "byte_order.h"
+
+#include <string.h>
+
+static_assert((SUBSCRIPTION_BACKLOG & (SUBSCRIPTION_BACKLOG - 1)) == 0, "SUBSCRIPTION_BACKLOG deve ser potencia de 2");
+static_assert(SUBSCRIPTION_MAX_RECORDS <= SUBSCRIPTION_BACKLOG, "quadro maior que o anel");
+
+static const uint32_t BACKLOG_MASK = SUBSCRIPTION_BACKLOG - 1;
+
+static const struct {
+    const char *name;
+    uint8_t channel;
+} CHANNEL_NAMES[] = {
+    {"sp", SUBSCRIPTION_CHANNEL_SP},
+    {"y", SUBSCRIPTION_CHANNEL_Y},
+    {"u", SUBSCRIPTION_CHANNEL_U},
+    {"iTerm", SUBSCRIPTION_CHANNEL_ITERM},
+    {"metricas", SUBSCRIPTION_CHANNEL_METRICS},
+};
+
+void subscriptions_init(Subscriptions_t *subs) {
+    memset(subs, 0, sizeof(*subs));
+}
+
+static Subscriber_t *subscription_slot(Subscriptions_t *subs, uint32_t client, bool create) {
+    Subscriber_t *free_slot = NULL;
+    for (int i = 0; i < SUBSCRIPTION_MAX_CLIENTS; i++) {
+        Subscriber_t *c = &subs->clients[i];
+        if (c->used && c->client == client) return c;
+        if (!c->used && free_slot == NULL) free_slot = c;
+    }
+    if (!create || free_slot == NULL) return NULL;
+    memset(free_slot, 0, sizeof(*free_slot));
+    free_slot->used = true;
+    free_slot->client = client;
+    free_slot->next = subs->head;
+    free_slot->channels = SUBSCRIPTION_CHANNELS_DEFAULT;
+    free_slot->decimation = 1;
+    return free_slot;
+}
+
+bool subscriptions_apply(Subscriptions_t *subs, const SubscriptionRequest_t *request) {
+    if (request->op == SUBSCRIPTION_DISCONNECT) {
+        Subscriber_t *c = subscription_slot(subs, request->client, false);
+        if (c) c->used = false;
+        return true;
+    }
+
+    Subscriber_t *c = subscription_slot(subs, request->client, true);
+    if (c == NULL) return false;
+    if (request->op == SUBSCRIPTION_SET) c->channels = request->channels;
+    else if (request->op == SUBSCRIPTION_ADD) c->channels |= request->channels;
+    else if (request->op == SUBSCRIPTION_REMOVE) c->channels &= (uint8_t)~request->channels;
+    if (request->decimation > 0) c->decimation = request->decimation;
+    return true;
+}
+
+void subscriptions_push(Subscriptions_t *subs, const TelemetryRecord_t *record) {
+    subs->backlog[subs->head & BACKLOG_MASK] = *record;
+    subs->head++;
+}
+
+void subscriptions_lost(Subscriptions_t *subs, uint32_t count) {
+    // Os indices continuam contando os perdidos; o anel antes deles fica
+    // invalido e quem estava atras recebe o buraco como descarte
+    subs->head += count;
+    subs->valid_from = subs->head;
+}
+
+int subscriptions_clients(const Subscriptions_t *subs, uint8_t channel, uint32_t *out, int max) {
+    int count = 0;
+    for (int i = 0; i < SUBSCRIPTION_MAX_CLIENTS; i++) {
+        const Subscriber_t *c = &subs->clients[i];
+        if (!c->used || !(c->channels & channel)) continue;
+        if (count < max) out[count] = c->client;
+        count++;
+    }
+    return count;
+}
+
+const Subscriber_t *subscriptions_find(const Subscriptions_t *subs, uint32_t client) {
+    for (int i = 0; i < SUBSCRIPTION_MAX_CLIENTS; i++) {
+        if (subs->clients[i].used && subs->clients[i].client == client) return &subs->clients[i];
+    }
+    return NULL;
+}
+
+uint8_t subscriptions_channel_from_name(const char *name) {
+    if (name == NULL) return 0;
+    for (const auto &c : CHANNEL_NAMES) {
+        if (strcmp(c.name, name) == 0) return c.channel;
+    }
+    return 0;
+}
+
+size_t subscriptions_record_size(uint8_t channels) {
+    return 12 + 4 * (size_t)__builtin_popcount(channels & SUBSCRIPTION_CHANNELS_TELEMETRY);
+}
+
+static inline bool subscription_selects(const Subscriber_t *c, const TelemetryRecord_t *r) {
+    return c->decimation <= 1 || r->cycle % c->decimation == 0;
+}
+
+// Trecho [*from, head) que o cliente recebe agora e quantos registros ele
+// perde antes disso: o que ja saiu do anel e, se passar de
+// SUBSCRIPTION_MAX_RECORDS selecionados, os mais antigos. Retorna quantos
+// registros vao no quadro.
+static int subscription_range(const Subscriptions_t *subs, const Subscriber_t *c, uint32_t *from, uint32_t *dropped) {
+    uint32_t oldest = subs->valid_from;
+    if (subs->head - oldest > (uint32_t)SUBSCRIPTION_BACKLOG) oldest = subs->head - SUBSCRIPTION_BACKLOG;
+    uint32_t start = c->next;
+    uint32_t lost = c->pending_dropped;
+    if ((int32_t)(oldest - start) > 0) {
+        lost += oldest - start;
+        start = oldest;
+    }
+
+    int selected = 0;
+    for (uint32_t i = subs->head; i != start; i--) {
+        if (!subscription_selects(c, &subs->backlog[(i - 1) & BACKLOG_MASK])) continue;
+        if (selected == SUBSCRIPTION_MAX_RECORDS) {
+            lost += i - start;
+            start = i;
+            break;
+        }
+        selected++;
+    }
+    *from = start;
+    *dropped = lost;
+    return selected;
+}
+
+static inline uint16_t subscription_u16(uint32_t value) {
+    return (uint16_t)(value > 0xFFFF ? 0xFFFF : value);
+}
+
+static size_t subscription_encode(Subscriptions_t *subs, const Subscriber_t *c, uint32_t from, uint32_t dropped,
+                                  int count) {
+    uint8_t channels = c->channels & SUBSCRIPTION_CHANNELS_TELEMETRY;
+    uint8_t *p = subs->frame;
+    p = put_u16(p, TELEMETRY_MAGIC);
+    *p++ = SUBSCRIPTION_FRAME_VERSION;
+    *p++ = (uint8_t)subscriptions_record_size(channels);
+    p = put_u32(p, from);
+    p = put_u32(p, subs->head);
+    p = put_u16(p, (uint16_t)count);
+    p = put_u16(p, subscription_u16(dropped));
+    *p++ = channels;
+    *p++ = c->decimation;
+    p = put_u16(p, subscription_u16(c->pending_skipped));
+
+    for (uint32_t i = from; i != subs->head; i++) {
+        const TelemetryRecord_t *r = &subs->backlog[i & BACKLOG_MASK];
+        if (!subscription_selects(c, r)) continue;
+        p = put_u32(p, r->cycle);
+        p = put_u32(p, r->time_ms);
+        if (channels & SUBSCRIPTION_CHANNEL_SP) p = put_f32(p, r->sp_v);
+        if (channels & SUBSCRIPTION_CHANNEL_Y) p = put_f32(p, r->y_v);
+        if (channels & SUBSCRIPTION_CHANNEL_U) p = put_f32(p, r->u);
+        if (channels & SUBSCRIPTION_CHANNEL_ITERM) p = put_f32(p, r->iTerm);
+        *p++ = r->plant;
+        *p++ = r->combination;
+        *p++ = r->flags;
+        *p++ = 0;
+    }
+    subs->encodes++;
+    return (size_t)(p - subs->frame);
+}
+
+static void subscription_sent(Subscriptions_t *subs, Subscriber_t *c, uint32_t dropped, int count) {
+    c->next = subs->head;
+    c->pending_dropped = 0;
+    c->pending_skipped = 0;
+    c->frames++;
+    c->records += (uint32_t)count;
+    c->dropped += dropped;
+    subs->sends++;
+}
+
+void subscriptions_flush(Subscriptions_t *subs, const SubscriptionSink_t *sink) {
+    uint32_t from[SUBSCRIPTION_MAX_CLIENTS], dropped[SUBSCRIPTION_MAX_CLIENTS];
+    int count[SUBSCRIPTION_MAX_CLIENTS];
+    bool pending[SUBSCRIPTION_MAX_CLIENTS];
+    for (int i = 0; i < SUBSCRIPTION_MAX_CLIENTS; i++) {
+        const Subscriber_t *c = &subs->clients[i];
+        pending[i] = c->used && (c->channels & SUBSCRIPTION_CHANNELS_TELEMETRY);
+        if (pending[i]) count[i] = subscription_range(subs, c, &from[i], &dropped[i]);
+    }
+
+    for (int i = 0; i < SUBSCRIPTION_MAX_CLIENTS; i++) {
+        if (!pending[i]) continue;
+        pending[i] = false;
+        Subscriber_t *c = &subs->clients[i];
+
+        // Nada selecionado no trecho: so anda o cursor; o descarte e o
+        // que a decimacao pulou vao no proximo quadro
+        if (count[i] == 0) {
+            c->pending_skipped += subs->head - from[i];
+            c->pending_dropped = dropped[i];
+            c->next = subs->head;
+            continue;
+        }
+        if (!sink->can_send(sink->ctx, c->client)) {
+            c->deferred++;
+            continue;
+        }
+
+        size_t length = subscription_encode(subs, c, from[i], dropped[i], count[i]);
+        sink->send(sink->ctx, c->client, subs->frame, length);
+        subscription_sent(subs, c, dropped[i], count[i]);
+
+        // Mesmo quadro para quem tem a mesma assinatura e o mesmo trecho
+        for (int j = i + 1; j < SUBSCRIPTION_MAX_CLIENTS; j++) {
+            Subscriber_t *other = &subs->clients[j];
+            if (!pending[j] || from[j] != from[i] || dropped[j] != dropped[i] ||
+                other->decimation != c->decimation || other->pending_skipped != c->pending_skipped ||
+                ((other->channels ^ c->channels) & SUBSCRIPTION_CHANNELS_TELEMETRY) != 0) {
+                continue;
+            }
+            pending[j] = false;
+            if (!sink->can_send(sink->ctx, other->client)) {
+                other->deferred++;
+                continue;
+            }
+            sink->send(sink->ctx, other->client, subs->frame, length);
+            subscription_sent(subs, other, dropped[j], count[j]);
+        }
+    }
+}
+
+int subscriptions_decode_frame(const uint8_t *frame, size_t length, SubscriptionFrameHeader_t *header,
+                               TelemetryRecord_t *records, int max_records) {
+    if (length < SUBSCRIPTION_HEADER_SIZE) return -1;
+    if (get_u16(frame) != TELEMETRY_MAGIC || frame[2] != SUBSCRIPTION_FRAME_VERSION) return -1;
+
+    size_t record_size = frame[3];
+    header->first = get_u32(frame + 4);
+    header->next = get_u32(frame + 8);
+    header->count = get_u16(frame + 12);
+    header->dropped = get_u16(frame + 14);
+    header->channels = frame[16];
+    header->decimation = frame[17];
+    header->skipped = get_u16(frame + 18);
+    if (record_size != subscriptions_record_size(header->channels)) return -1;
+    if (length < SUBSCRIPTION_HEADER_SIZE + (size_t)header->count * record_size) return -1;
+
+    int count = header->count < max_records ? header->count : max_records;
+    for (int i = 0; i < count; i++) {
+        const uint8_t *p = frame + SUBSCRIPTION_HEADER_SIZE + (size_t)i * record_size;
+        TelemetryRecord_t *r = &records[i];
+        memset(r, 0, sizeof(*r));
+        r->cycle = get_u32(p);
+        r->time_ms = get_u32(p + 4);
+        p += 8;
+        if (header->channels & SUBSCRIPTION_CHANNEL_SP) { r->sp_v = get_f32(p); p += 4; }
+        if (header->channels & SUBSCRIPTION_CHANNEL_Y) { r->y_v = get_f32(p); p += 4; }
+        if (header->channels & SUBSCRIPTION_CHANNEL_U) { r->u = get_f32(p); p += 4; }
+        if (header->channels & SUBSCRIPTION_CHANNEL_ITERM) { r->iTerm = get_f32(p); p += 4; }
+        r->plant = p[0];
+        r->combination = p[1];
+        r->flags = p[2];
+    }
+    return count;
+}
@@ -0,0 +1,153 @@
+// src/subscriptions.h
+//
+// Assinaturas da telemetria por cliente do WebSocket. Cada cliente escolhe
+// os canais (sp, y, u, iTerm e o quadro de metricas) e a decimacao (so os
+// ciclos multiplos de N). A tarefa do WebSocket guarda os registros recentes
+// em um anel proprio (SUBSCRIPTION_BACKLOG) e cada cliente tem apenas um
+// cursor nele. A cada envio:
+//  - cliente com espaco na fila de envio (can_send: menos de
+//    SUBSCRIPTION_SEND_BUDGET mensagens esperando) recebe em um unico quadro
+//    tudo o que acumulou desde o seu cursor;
+//  - cliente sem espaco fica para o envio seguinte, sem nada guardado para
+//    ele alem do cursor. Se ficar mais de SUBSCRIPTION_BACKLOG registros para
+//    tras, ou acumular mais que SUBSCRIPTION_MAX_RECORDS, os mais antigos sao
+//    descartados e o quadro seguinte diz quantos;
+//  - clientes com a mesma assinatura e o mesmo cursor (o caso normal de
+//    varias paginas abertas) recebem o mesmo quadro, codificado uma vez.
+// A memoria e fixa, quantos clientes lentos houver, e a tarefa nunca espera
+// por um cliente: um lento nao atrasa os outros.
+//
+// Quadro da assinatura (little-endian, versao 2 da telemetria):
+//
+//   cabecalho (SUBSCRIPTION_HEADER_SIZE bytes)
+//     u16 magic        TELEMETRY_MAGIC
+//     u8  version      SUBSCRIPTION_FRAME_VERSION
+//     u8  record_size  8 + 4 por canal + 4
+//     u32 first        indice no fluxo do primeiro registro coberto
+//     u32 next         indice seguinte ao ultimo coberto (first do proximo)
+//     u16 count        registros no quadro
+//     u16 dropped      registros descartados desde o quadro anterior
+//     u8  channels     SUBSCRIPTION_CHANNEL_* da assinatura
+//     u8  decimation
+//     u16 skipped      registros pulados pela decimacao em envios sem quadro
+//
+//   count registros
+//     u32 cycle, u32 time_ms
+//     f32 de cada canal assinado, na ordem sp_v, y_v, u, iTerm
+//     u8  plant, u8 combination, u8 flags, u8 reserved
+//
+// Os indices contam todos os registros do fluxo, inclusive os que a
+// decimacao pula: first == next do quadro anterior + dropped + skipped,
+// sempre.
+
+#ifndef SUBSCRIPTIONS_H
+#define SUBSCRIPTIONS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "telemetry.h"
+
+const uint8_t SUBSCRIPTION_FRAME_VERSION = 2;
+const size_t SUBSCRIPTION_HEADER_SIZE = 20;
+const int SUBSCRIPTION_MAX_CLIENTS = 8;
+const int SUBSCRIPTION_BACKLOG = 128;          // registros guardados (potencia de 2)
+const int SUBSCRIPTION_MAX_RECORDS = 64;       // registros por quadro
+const int SUBSCRIPTION_SEND_BUDGET = 4;        // mensagens na fila de cada cliente
+const size_t SUBSCRIPTION_MAX_FRAME_SIZE = SUBSCRIPTION_HEADER_SIZE + SUBSCRIPTION_MAX_RECORDS * 28;
+
+enum {
+    SUBSCRIPTION_CHANNEL_SP      = 1 << 0,
+    SUBSCRIPTION_CHANNEL_Y       = 1 << 1,
+    SUBSCRIPTION_CHANNEL_U       = 1 << 2,
+    SUBSCRIPTION_CHANNEL_ITERM   = 1 << 3,
+    SUBSCRIPTION_CHANNEL_METRICS = 1 << 4,     // quadro JSON "metricas" a cada 2 s
+};
+const uint8_t SUBSCRIPTION_CHANNELS_TELEMETRY = 0x0F;
+const uint8_t SUBSCRIPTION_CHANNELS_DEFAULT = SUBSCRIPTION_CHANNELS_TELEMETRY;
+
+typedef enum {
+    SUBSCRIPTION_SET = 0,       // troca canais e decimacao
+    SUBSCRIPTION_ADD,           // liga canais
+    SUBSCRIPTION_REMOVE,        // desliga canais
+    SUBSCRIPTION_DISCONNECT,    // libera o cliente
+} SubscriptionOp_t;
+
+// Pedido vindo do evento do WebSocket, aplicado pela tarefa que envia
+typedef struct {
+    uint32_t client;
+    uint8_t op;
+    uint8_t channels;
+    uint8_t decimation;         // 0: mantem (ou 1 para cliente novo)
+} SubscriptionRequest_t;
+
+typedef struct {
+    uint32_t client;
+    uint32_t next;              // proximo registro do fluxo para este cliente
+    uint32_t pending_dropped;   // descartados ainda nao avisados
+    uint32_t pending_skipped;   // pulados pela decimacao sem quadro
+    uint32_t frames;            // quadros enviados
+    uint32_t records;           // registros enviados
+    uint32_t dropped;           // registros descartados por atraso
+    uint32_t deferred;          // envios adiados sem espaco na fila
+    uint8_t channels;
+    uint8_t decimation;
+    bool used;
+} Subscriber_t;
+
+typedef struct {
+    TelemetryRecord_t backlog[SUBSCRIPTION_BACKLOG];
+    uint32_t head;              // registros ja recebidos (indice do proximo)
+    uint32_t valid_from;        // anel valido a partir daqui (subscriptions_lost)
+    Subscriber_t clients[SUBSCRIPTION_MAX_CLIENTS];
+    uint8_t frame[SUBSCRIPTION_MAX_FRAME_SIZE];
+    uint32_t encodes;           // quadros codificados
+    uint32_t sends;             // quadros entregues (um codificado pode ir a varios)
+} Subscriptions_t;
+
+// Saida dos quadros: can_send diz se o cliente tem espaco, send entrega
+typedef struct {
+    bool (*can_send)(void *ctx, uint32_t client);
+    void (*send)(void *ctx, uint32_t client, const uint8_t *frame, size_t length);
+    void *ctx;
+} SubscriptionSink_t;
+
+typedef struct {
+    uint32_t first;
+    uint32_t next;
+    uint16_t count;
+    uint16_t dropped;
+    uint8_t channels;
+    uint8_t decimation;
+    uint16_t skipped;
+} SubscriptionFrameHeader_t;
+
+// Tudo abaixo e da tarefa dona das assinaturas (a do WebSocket)
+void subscriptions_init(Subscriptions_t *subs);
+
+// Cliente novo comeca no registro mais recente. Retorna false se nao ha vaga.
+bool subscriptions_apply(Subscriptions_t *subs, const SubscriptionRequest_t *request);
+
+void subscriptions_push(Subscriptions_t *subs, const TelemetryRecord_t *record);
+
+// Registros que nem chegaram ao anel (o cursor da tarefa na telemetria
+// ficou para tras): viram descarte para todos os clientes
+void subscriptions_lost(Subscriptions_t *subs, uint32_t count);
+
+// Envia a cada cliente com espaco o que ele acumulou
+void subscriptions_flush(Subscriptions_t *subs, const SubscriptionSink_t *sink);
+
+// Clientes que assinam o canal; retorna quantos (ate max em out)
+int subscriptions_clients(const Subscriptions_t *subs, uint8_t channel, uint32_t *out, int max);
+const Subscriber_t *subscriptions_find(const Subscriptions_t *subs, uint32_t client);
+
+// "sp", "y", "u", "iTerm", "metricas" -> SUBSCRIPTION_CHANNEL_*, 0 se nenhum
+uint8_t subscriptions_channel_from_name(const char *name);
+
+size_t subscriptions_record_size(uint8_t channels);
+
+// Retorna o numero de registros (ate max_records) ou -1 se o quadro for
+// invalido; canais fora da assinatura voltam 0
+int subscriptions_decode_frame(const uint8_t *frame, size_t length, SubscriptionFrameHeader_t *header,
+                               TelemetryRecord_t *records, int max_records);
+
+#endif // SUBSCRIPTIONS_H
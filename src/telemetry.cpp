@@ -0,0 +1,149 @@
+// src/telemetry.cpp
+
+#include "telemetry.h"
+#include "byte_order.h"
+
+#include <atomic>
+
+static TelemetryRing<TelemetryRecord_t, TELEMETRY_RING_SIZE> telemetry_ring;
+
+// Uso do anel pelas consumidoras, para o relatorio de memoria
+static std::atomic<uint32_t> last_backlog(0);
+static std::atomic<uint32_t> peak_backlog(0);
+static std::atomic<uint32_t> lost_records(0);
+
+void telemetry_push(const TelemetryRecord_t *record) {
+    telemetry_ring.push(*record);
+}
+
+void telemetry_attach(TelemetryCursor_t *cursor) {
+    telemetry_ring.attach(&cursor->ring);
+    cursor->overflows_reported = 0;
+    cursor->frame_seq = 0;
+}
+
+int telemetry_drain(TelemetryCursor_t *cursor, TelemetryRecord_t *out, int max) {
+    uint32_t backlog = telemetry_ring.produced() - cursor->ring.next;
+    last_backlog.store(backlog, std::memory_order_relaxed);
+    uint32_t peak = peak_backlog.load(std::memory_order_relaxed);
+    while (backlog > peak && !peak_backlog.compare_exchange_weak(peak, backlog, std::memory_order_relaxed)) {}
+
+    uint32_t overflows = cursor->ring.overflows;
+    int count = telemetry_ring.drain(&cursor->ring, out, max);
+    if (cursor->ring.overflows != overflows) {
+        lost_records.fetch_add(cursor->ring.overflows - overflows, std::memory_order_relaxed);
+    }
+    return count;
+}
+
+uint32_t telemetry_overflows(const TelemetryCursor_t *cursor) {
+    return cursor->ring.overflows;
+}
+
+uint32_t telemetry_produced() {
+    return telemetry_ring.produced();
+}
+
+void telemetry_pool_stats(BufferPoolStats_t *out) {
+    out->block_size = (uint32_t)sizeof(TelemetryRecord_t);
+    out->blocks = (uint32_t)TELEMETRY_RING_SIZE;
+    out->in_use = last_backlog.load(std::memory_order_relaxed);
+    out->peak = peak_backlog.load(std::memory_order_relaxed);
+    out->acquired = telemetry_ring.produced();
+    out->exhausted = lost_records.load(std::memory_order_relaxed);
+}
+
+static uint8_t *telemetry_encode_header(uint8_t *p, const TelemetryFrameHeader_t *header) {
+    p = put_u16(p, TELEMETRY_MAGIC);
+    *p++ = TELEMETRY_VERSION;
+    *p++ = (uint8_t)TELEMETRY_RECORD_SIZE;
+    p = put_u32(p, header->seq);
+    p = put_u16(p, header->count);
+    return put_u16(p, header->dropped);
+}
+
+static uint8_t *telemetry_encode_record(uint8_t *p, const TelemetryRecord_t *r) {
+    p = put_u32(p, r->cycle);
+    p = put_u32(p, r->time_ms);
+    p = put_f32(p, r->sp_v);
+    p = put_f32(p, r->y_v);
+    p = put_f32(p, r->u);
+    p = put_f32(p, r->iTerm);
+    *p++ = r->plant;
+    *p++ = r->combination;
+    *p++ = r->flags;
+    *p++ = 0;
+    return p;
+}
+
+size_t telemetry_encode_frame(uint8_t *out, size_t capacity, const TelemetryFrameHeader_t *header,
+                              const TelemetryRecord_t *records) {
+    size_t length = TELEMETRY_HEADER_SIZE + (size_t)header->count * TELEMETRY_RECORD_SIZE;
+    if (length > capacity) return 0;
+
+    uint8_t *p = telemetry_encode_header(out, header);
+    for (int i = 0; i < header->count; i++) p = telemetry_encode_record(p, &records[i]);
+    return length;
+}
+
+size_t telemetry_build_frame(TelemetryCursor_t *cursor, uint8_t *out, size_t capacity) {
+    // Esvazia em lotes pequenos direto para o quadro, para nao precisar de
+    // um buffer de TELEMETRY_MAX_RECORDS registros na pilha da consumidora
+    const int CHUNK = 8;
+    TelemetryRecord_t records[CHUNK];
+
+    if (capacity < TELEMETRY_HEADER_SIZE + TELEMETRY_RECORD_SIZE) return 0;
+    int max = (int)((capacity - TELEMETRY_HEADER_SIZE) / TELEMETRY_RECORD_SIZE);
+    if (max > TELEMETRY_MAX_RECORDS) max = TELEMETRY_MAX_RECORDS;
+
+    int count = 0;
+    uint8_t *p = out + TELEMETRY_HEADER_SIZE;
+    while (count < max) {
+        int want = (max - count) < CHUNK ? (max - count) : CHUNK;
+        int got = telemetry_drain(cursor, records, want);
+        for (int i = 0; i < got; i++) p = telemetry_encode_record(p, &records[i]);
+        count += got;
+        if (got < want) break;
+    }
+    if (count == 0) return 0;
+
+    uint32_t lost = cursor->ring.overflows - cursor->overflows_reported;
+    cursor->overflows_reported = cursor->ring.overflows;
+
+    TelemetryFrameHeader_t header;
+    header.seq = cursor->frame_seq++;
+    header.count = (uint16_t)count;
+    header.dropped = (uint16_t)(lost > 0xFFFF ? 0xFFFF : lost);
+    telemetry_encode_header(out, &header);
+    return (size_t)(p - out);
+}
+
+int telemetry_decode_frame(const uint8_t *frame, size_t length, TelemetryFrameHeader_t *header,
+                           TelemetryRecord_t *records, int max_records) {
+    if (length < TELEMETRY_HEADER_SIZE) return -1;
+    if (get_u16(frame) != TELEMETRY_MAGIC || frame[2] != TELEMETRY_VERSION) return -1;
+
+    size_t record_size = frame[3];
+    header->seq = get_u32(frame + 4);
+    header->count = get_u16(frame + 8);
+    header->dropped = get_u16(frame + 10);
+    if (record_size < TELEMETRY_RECORD_SIZE) return -1;
+    if (length < TELEMETRY_HEADER_SIZE + (size_t)header->count * record_size) return -1;
+
+    int count = header->count < max_records ? header->count : max_records;
+    for (int i = 0; i < count; i++) {
+        const uint8_t *p = frame + TELEMETRY_HEADER_SIZE + (size_t)i * record_size;
+        TelemetryRecord_t *r = &records[i];
+        r->cycle = get_u32(p);
+        r->time_ms = get_u32(p + 4);
+        r->sp_v = get_f32(p + 8);
+        r->y_v = get_f32(p + 12);
+        r->u = get_f32(p + 16);
+        r->iTerm = get_f32(p + 20);
+        r->plant = p[24];
+        r->combination = p[25];
+        r->flags = p[26];
+        r->reserved = 0;
+    }
+    return count;
+}
@@ -0,0 +1,116 @@
+// src/telemetry.h
+//
+// Telemetria binaria do laco de controle. A tarefa de controle grava um
+// registro por ciclo (por malha, no modo duplo) no anel de telemetria
+// (telemetry_ring.h) sem nunca esperar. Cada consumidora (plotter serial,
+// WebSocket, gravadores) tem o proprio cursor e esvazia o anel em lotes, no
+// seu ritmo, sem duplicar nem pular ciclos; a do WebSocket manda tudo o que
+// acumulou em um unico quadro binario (ws.binaryAll) por intervalo de envio.
+//
+// Formato do quadro (little-endian, sem preenchimento implicito):
+//
+//   cabecalho (TELEMETRY_HEADER_SIZE bytes)
+//     u16 magic        TELEMETRY_MAGIC
+//     u8  version      TELEMETRY_VERSION
+//     u8  record_size  TELEMETRY_RECORD_SIZE
+//     u32 seq          numero do quadro (+1 por quadro, detecta perdas)
+//     u16 count        registros no quadro
+//     u16 dropped      registros perdidos pelo cursor desde o quadro anterior
+//
+//   count registros (TELEMETRY_RECORD_SIZE bytes cada)
+//     u32 cycle        numero do ciclo de controle
+//     u32 time_ms      millis() no ciclo
+//     f32 sp_v         referencia (V)
+//     f32 y_v          saida medida (V)
+//     f32 u            sinal de controle (contagens do DAC)
+//     f32 iTerm        termo integral (contagens do DAC)
+//     u8  plant        planta (1 ou 2)
+//     u8  combination  combinacao do MUX
+//     u8  flags        TELEMETRY_FLAG_*
+//     u8  reserved
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "telemetry_ring.h"
+#include "buffer_pool.h"
+
+const uint16_t TELEMETRY_MAGIC = 0x4D54;            // "TM"
+const uint8_t TELEMETRY_VERSION = 1;
+const size_t TELEMETRY_HEADER_SIZE = 12;
+const size_t TELEMETRY_RECORD_SIZE = 28;
+const int TELEMETRY_MAX_RECORDS = 64;               // registros por quadro
+const int TELEMETRY_RING_SIZE = 128;                // registros no anel (potencia de 2)
+const size_t TELEMETRY_MAX_FRAME_SIZE = TELEMETRY_HEADER_SIZE + TELEMETRY_MAX_RECORDS * TELEMETRY_RECORD_SIZE;
+
+enum {
+    TELEMETRY_FLAG_ACTIVE   = 1 << 0,   // malha da planta ativa (a que vai pro grafico)
+    TELEMETRY_FLAG_DUAL     = 1 << 1,   // gerado no modo de duas malhas
+    TELEMETRY_FLAG_AUTOTUNE = 1 << 2,   // rele da sintonia automatica no lugar do PID
+    TELEMETRY_FLAG_PROFILE  = 1 << 3,   // setpoint vindo do perfil (setpoint.h)
+};
+
+typedef struct {
+    uint32_t cycle;
+    uint32_t time_ms;
+    float sp_v;
+    float y_v;
+    float u;
+    float iTerm;
+    uint8_t plant;
+    uint8_t combination;
+    uint8_t flags;
+    uint8_t reserved;
+} TelemetryRecord_t;
+
+typedef struct {
+    uint32_t seq;
+    uint16_t count;
+    uint16_t dropped;
+} TelemetryFrameHeader_t;
+
+// Estado de uma consumidora: cursor no anel e numeracao dos seus quadros
+typedef struct {
+    RingCursor_t ring;
+    uint32_t overflows_reported;
+    uint32_t frame_seq;
+} TelemetryCursor_t;
+
+// Somente a tarefa de controle chama; nunca bloqueia
+void telemetry_push(const TelemetryRecord_t *record);
+
+// Registra uma consumidora a partir do registro mais recente. Cada tarefa
+// usa o seu cursor; cursores diferentes nao interferem entre si.
+void telemetry_attach(TelemetryCursor_t *cursor);
+
+// Copia ate max registros pendentes do cursor, em ordem de ciclo
+int telemetry_drain(TelemetryCursor_t *cursor, TelemetryRecord_t *out, int max);
+
+// Registros que o cursor perdeu por ficar mais de TELEMETRY_RING_SIZE atras
+uint32_t telemetry_overflows(const TelemetryCursor_t *cursor);
+
+// Total de registros produzidos desde o boot
+uint32_t telemetry_produced();
+
+// O anel visto como pool do relatorio de memoria (memory_budget.h): blocos
+// sao os slots; em uso e pico, o atraso (registros pendentes) de uma
+// consumidora na ultima leitura e o maior ja visto; entregues, os
+// registros produzidos; faltas, os registros que alguma consumidora perdeu
+void telemetry_pool_stats(BufferPoolStats_t *out);
+
+// Esvazia ate TELEMETRY_MAX_RECORDS registros do cursor em um quadro pronto
+// para envio. Retorna o tamanho em bytes, ou 0 se nao havia registros (nesse
+// caso nenhum numero de sequencia e consumido).
+size_t telemetry_build_frame(TelemetryCursor_t *cursor, uint8_t *out, size_t capacity);
+
+// Codificacao/decodificacao do formato acima, independentes do anel.
+// encode retorna 0 se nao couber; decode retorna o numero de registros
+// (ate max_records) ou -1 se o quadro for invalido.
+size_t telemetry_encode_frame(uint8_t *out, size_t capacity, const TelemetryFrameHeader_t *header,
+                              const TelemetryRecord_t *records);
+int telemetry_decode_frame(const uint8_t *frame, size_t length, TelemetryFrameHeader_t *header,
+                           TelemetryRecord_t *records, int max_records);
+
+#endif // TELEMETRY_H
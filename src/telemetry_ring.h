@@ -0,0 +1,120 @@
+// src/telemetry_ring.h
+//
+// Anel de capacidade fixa com uma produtora e varias consumidoras
+// independentes, sem lock. A produtora (tarefa de controle) nunca espera:
+// cada push grava o proximo slot e avanca o indice global. Cada consumidora
+// tem o proprio cursor e esvazia o anel em lotes; quem fica mais de N
+// registros para tras perde os mais antigos, e a perda e somada ao contador
+// de overflow do cursor (nunca e silenciosa).
+//
+// Cada slot guarda o indice do registro que contem (2*indice, impar durante a
+// escrita), entao uma leitura que cruza com a produtora sobrescrevendo o
+// mesmo slot e detectada e contada como perda, sem espera. Como no
+// seqlock.h, o conteudo fica em palavras de 32 bits atomicas (relaxed).
+// Memoria: N * (sizeof(T) + 4) + 4 bytes, fixa.
+
+#ifndef TELEMETRY_RING_H
+#define TELEMETRY_RING_H
+
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+
+typedef struct {
+    uint32_t next;          // proximo indice a ler
+    uint32_t overflows;     // registros perdidos por ficar para tras
+} RingCursor_t;
+
+template <typename T, int N>
+class TelemetryRing {
+public:
+    TelemetryRing() : head_(0) {
+        for (int i = 0; i < N; i++) {
+            slots_[i].seq.store(1, std::memory_order_relaxed);
+            for (int w = 0; w < WORDS; w++) slots_[i].words[w].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // Somente uma produtora
+    void push(const T &value) {
+        uint32_t words[WORDS];
+        memcpy(words, &value, sizeof(T));
+
+        uint32_t index = head_.load(std::memory_order_relaxed);
+        Slot &slot = slots_[index & MASK];
+
+        slot.seq.store(2 * index + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (int w = 0; w < WORDS; w++) {
+            slot.words[w].store(words[w], std::memory_order_relaxed);
+        }
+        slot.seq.store(2 * index, std::memory_order_release);
+
+        head_.store(index + 1, std::memory_order_release);
+    }
+
+    // Posiciona o cursor no fim do anel: a consumidora recebe so o que for
+    // produzido daqui em diante
+    void attach(RingCursor_t *cursor) const {
+        cursor->next = head_.load(std::memory_order_acquire);
+        cursor->overflows = 0;
+    }
+
+    // Copia ate max registros a partir do cursor; retorna quantos copiou
+    int drain(RingCursor_t *cursor, T *out, int max) const {
+        int count = 0;
+
+        while (count < max) {
+            uint32_t head = head_.load(std::memory_order_acquire);
+            if (cursor->next == head) break;
+
+            // Ficou mais de N para tras: pula para o registro mais antigo
+            // que ainda esta no anel
+            if (head - cursor->next > (uint32_t)N) {
+                cursor->overflows += head - cursor->next - N;
+                cursor->next = head - N;
+            }
+
+            const Slot &slot = slots_[cursor->next & MASK];
+            const uint32_t expected = 2 * cursor->next;
+            uint32_t words[WORDS];
+
+            uint32_t before = slot.seq.load(std::memory_order_acquire);
+            for (int w = 0; w < WORDS; w++) {
+                words[w] = slot.words[w].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            uint32_t after = slot.seq.load(std::memory_order_relaxed);
+
+            cursor->next++;
+            if (before != expected || after != expected) {
+                // A produtora deu a volta e esta sobrescrevendo este slot
+                cursor->overflows++;
+                continue;
+            }
+            memcpy(&out[count++], words, sizeof(T));
+        }
+        return count;
+    }
+
+    // Total de registros produzidos (indice do proximo push)
+    uint32_t produced() const {
+        return head_.load(std::memory_order_acquire);
+    }
+
+private:
+    static const int WORDS = sizeof(T) / sizeof(uint32_t);
+    static const uint32_t MASK = N - 1;
+    static_assert((N & (N - 1)) == 0, "capacidade do anel deve ser potencia de 2");
+    static_assert(sizeof(T) % sizeof(uint32_t) == 0, "tipo do anel deve ter tamanho multiplo de 32 bits");
+
+    struct Slot {
+        std::atomic<uint32_t> seq;
+        std::atomic<uint32_t> words[WORDS];
+    };
+
+    std::atomic<uint32_t> head_;
+    Slot slots_[N];
+};
+
+#endif // TELEMETRY_RING_H
@@ -0,0 +1,21 @@
+// src/text_buffer.h
+//
+// Texto montado aos pedacos em um buffer de tamanho fixo, para as linhas do
+// /metrics (formato de exposicao do Prometheus). Cada modulo escreve o seu
+// trecho com text_append; o que nao couber e cortado, sem estourar o
+// buffer, e o texto fica sempre terminado em '\0'. Nada e alocado.
+
+#ifndef TEXT_BUFFER_H
+#define TEXT_BUFFER_H
+
+#include <stddef.h>
+
+typedef struct {
+    char *out;
+    size_t capacity;
+    size_t length;
+} TextBuffer_t;
+
+void text_append(TextBuffer_t *t, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+#endif // TEXT_BUFFER_H
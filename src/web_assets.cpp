@@ -0,0 +1,57 @@
+// src/web_assets.cpp
+
+#include "web_assets.h"
+
+#include <string.h>
+
+#if !defined(WEB_ASSETS_FROM_SPIFFS) && __has_include("web_assets_data.h")
+#include "web_assets_data.h"
+#define WEB_ASSETS_EMBEDDED 1
+#endif
+
+#ifdef WEB_ASSETS_EMBEDDED
+static const int WEB_ASSET_COUNT = sizeof(WEB_ASSETS) / sizeof(WEB_ASSETS[0]);
+#else
+static const WebAsset_t *const WEB_ASSETS = nullptr;
+static const int WEB_ASSET_COUNT = 0;
+#endif
+
+int web_assets_count() {
+    return WEB_ASSET_COUNT;
+}
+
+const WebAsset_t *web_assets_get(int index) {
+    if (index < 0 || index >= WEB_ASSET_COUNT) return nullptr;
+    return &WEB_ASSETS[index];
+}
+
+const WebAsset_t *web_assets_find(const char *path) {
+    if (strcmp(path, "/") == 0) path = "/index.html";
+    for (int i = 0; i < WEB_ASSET_COUNT; i++) {
+        if (strcmp(WEB_ASSETS[i].path, path) == 0) return &WEB_ASSETS[i];
+    }
+    return nullptr;
+}
+
+bool web_assets_etag_matches(const WebAsset_t *asset, const char *if_none_match) {
+    if (!if_none_match) return false;
+    if (strcmp(if_none_match, "*") == 0) return true;
+    return strstr(if_none_match, asset->etag) != nullptr;
+}
+
+bool web_assets_accepts_gzip(const char *accept_encoding) {
+    if (!accept_encoding) return false;
+    const char *p = strstr(accept_encoding, "gzip");
+    if (!p) return false;
+    p += 4;
+    while (*p == ' ') p++;
+    if (*p != ';') return true;
+    p++;
+    while (*p == ' ') p++;
+    if (strncmp(p, "q=0", 3) != 0) return true;
+    // q=0, q=0.0, q=0.000 recusam; q=0.5 aceita
+    p += 3;
+    if (*p == '.') p++;
+    while (*p == '0') p++;
+    return *p >= '1' && *p <= '9';
+}
@@ -0,0 +1,45 @@
+// src/web_assets.h
+//
+// Paginas do painel (data/) gravadas no firmware. tools/embed_assets.py
+// minifica e comprime com gzip cada arquivo na hora do build e gera
+// include/web_assets_data.h com os bytes prontos para enviar, o tipo e um
+// ETag forte (hash do conteudo). O servidor manda os bytes direto da flash
+// com Content-Encoding: gzip, sem abrir o SPIFFS nem alocar; um navegador
+// que ja tem a versao recebe 304. O index.html e revalidado a cada visita
+// (no-cache) e pede os outros arquivos com ?v=<hash>, por isso estes podem
+// ficar em cache por um ano (immutable).
+//
+// Sem o cabecalho gerado (build nativo, ou antes do primeiro build) ou com
+// -DWEB_ASSETS_FROM_SPIFFS, a tabela fica vazia e tudo vem do SPIFFS como
+// antes: util para mexer nas paginas e so fazer uploadfs, sem regravar o
+// firmware.
+
+#ifndef WEB_ASSETS_H
+#define WEB_ASSETS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct {
+    const char *path;           // "/script.js"
+    const char *content_type;
+    const uint8_t *data;        // conteudo em gzip
+    size_t size;
+    const char *etag;           // com aspas: "\"a14c7d78f7803bb6\""
+    const char *cache_control;
+} WebAsset_t;
+
+int web_assets_count();
+const WebAsset_t *web_assets_get(int index);
+
+// Arquivo pelo caminho da URL (sem a query), ou nullptr. "/" e o index.html.
+const WebAsset_t *web_assets_find(const char *path);
+
+// O cabecalho If-None-Match do pedido cita o ETag do arquivo (a lista pode
+// ter varios, e W/ nao muda a comparacao de um GET)
+bool web_assets_etag_matches(const WebAsset_t *asset, const char *if_none_match);
+
+// Accept-Encoding aceita gzip (sem "gzip;q=0")
+bool web_assets_accepts_gzip(const char *accept_encoding);
+
+#endif // WEB_ASSETS_H
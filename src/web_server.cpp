@@ -2,65 +2,470 @@
 
 #include "web_server.h"
 #include "config.h"
-#include "controller.h"
+#include "control_loop.h"
 #include "mux.h"
+#include "adc_acquisition.h"
+#include "adc_calibration.h"
+#include "run_recorder.h"
+#include "autotune.h"
+#include "gain_schedule.h"
+#include "setpoint.h"
+#include "loop_metrics.h"
+#include "boot.h"
+#include "identification.h"
+#include "step_response.h"
+#include "controller_engine.h"
+#include "control_command.h"
+#include "web_assets.h"
+#include "command_queue.h"
+#include "memory_budget.h"
+
+#include <memory>
+#include <string.h>
 
 // instancia dos objetos do servidor
 AsyncWebServer server(80);
 AsyncWebSocket ws("/ws");
 
+// Consultas ao historico, respondidas pela tarefa do WebSocket
+static CommandQueue<HistoryRequest_t, 8> history_requests;
+
+bool web_server_next_history_request(HistoryRequest_t *request) {
+    return history_requests.pop(request);
+}
+
+static void web_server_request_history(uint32_t client, uint16_t id, uint32_t window_s, uint32_t resolution_ms) {
+    HistoryRequest_t request;
+    request.client = client;
+    request.query.id = id;
+    request.query.window_s = window_s;
+    request.query.resolution_ms = resolution_ms;
+    if (!history_requests.push(&request, 1)) Serial.println("Fila de consultas ao historico cheia");
+}
+
+// Assinaturas dos clientes (subscriptions.h), aplicadas pela tarefa do
+// WebSocket
+static CommandQueue<SubscriptionRequest_t, 16> subscription_requests;
+
+bool web_server_next_subscription_request(SubscriptionRequest_t *request) {
+    return subscription_requests.pop(request);
+}
+
+static void web_server_request_subscription(uint32_t client, uint8_t op, uint8_t channels, uint8_t decimation) {
+    SubscriptionRequest_t request;
+    request.client = client;
+    request.op = op;
+    request.channels = channels;
+    request.decimation = decimation;
+    if (!subscription_requests.push(&request, 1)) Serial.println("Fila de assinaturas cheia");
+}
+
+// Confirmacao de um lote de comandos (control_command.h), no formato em que
+// o lote chegou: {"ack": {"id", "estado", "ciclo"}} ou o quadro binario
+static void web_server_format_ack(const ControlAck_t *ack, char *out, size_t size) {
+    StaticJsonDocument<128> doc;
+    JsonObject result = doc.createNestedObject("ack");
+    result["id"] = ack->id;
+    result["estado"] = control_ack_status_name(ack->status);
+    if (ack->status == CONTROL_ACK_APPLIED) result["ciclo"] = ack->cycle;
+    if (ack->status == CONTROL_ACK_REJECTED) result["comando"] = ack->type;
+    serializeJson(doc, out, size);
+}
+
+// Recusa imediata, na tarefa do AsyncTCP (nada foi enfileirado)
+static void web_server_reply_ack(AsyncWebSocketClient *client, const ControlAck_t *ack) {
+    if (ack->binary) {
+        uint8_t frame[CONTROL_ACK_SIZE];
+        size_t length = control_ack_encode(frame, sizeof(frame), ack);
+        client->binary(frame, length);
+    } else {
+        char json_buffer[96];
+        web_server_format_ack(ack, json_buffer, sizeof(json_buffer));
+        client->text(json_buffer);
+    }
+}
+
+void web_server_send_acks() {
+    ControlAck_t acks[8];
+    int count;
+    while ((count = control_loop_drain_acks(acks, 8)) > 0) {
+        for (int i = 0; i < count; i++) {
+            const ControlAck_t *ack = &acks[i];
+            if (ack->binary) {
+                uint8_t frame[CONTROL_ACK_SIZE];
+                size_t length = control_ack_encode(frame, sizeof(frame), ack);
+                ws.binary(ack->client, frame, length);
+            } else {
+                char json_buffer[96];
+                web_server_format_ack(ack, json_buffer, sizeof(json_buffer));
+                ws.text(ack->client, json_buffer);
+            }
+        }
+    }
+}
+
+// Lote de comandos em binario: decodificado e validado aqui, aplicado pela
+// tarefa de controle no proximo ciclo
+static void web_server_handle_binary(AsyncWebSocketClient *client, uint8_t *data, size_t len) {
+    ControlCommand_t batch[CONTROL_COMMAND_MAX_BATCH];
+    ControlAck_t ack;
+    memset(&ack, 0, sizeof(ack));
+    ack.client = client->id();
+    ack.binary = 1;
+
+    int count = control_command_decode(data, len, &ack.id, batch, CONTROL_COMMAND_MAX_BATCH);
+    if (count < 0) {
+        ack.status = CONTROL_ACK_INVALID;
+        web_server_reply_ack(client, &ack);
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        batch[i].flags = CONTROL_CMD_FLAG_BINARY;
+        batch[i].id = ack.id;
+        batch[i].client = ack.client;
+    }
+    if (!control_loop_submit(batch, count)) {
+        ack.status = CONTROL_ACK_QUEUE_FULL;
+        web_server_reply_ack(client, &ack);
+    }
+}
+
+// Documento dos comandos JSON: as chaves do topo, os objetos
+// "identificacao", "historico", "assinar" e "calibracao_adc" e o texto do
+// perfil, que e a parte grande (ate SETPOINT_MAX_TEXT caracteres, setpoint.h)
+static const size_t WS_COMMAND_JSON_CAPACITY = JSON_OBJECT_SIZE(24) + 4 * JSON_OBJECT_SIZE(3) + JSON_ARRAY_SIZE(8) +
+                                               JSON_ARRAY_SIZE(ADC_CAL_POINTS) + SETPOINT_MAX_TEXT + 256;
+
+static void web_server_handle_json(AsyncWebSocketClient *client, uint8_t *data, size_t len) {
+    // Estatico: grande demais para a pilha, e todos os eventos do WebSocket
+    // rodam na mesma tarefa
+    static StaticJsonDocument<WS_COMMAND_JSON_CAPACITY> doc;
+    DeserializationError error = deserializeJson(doc, (char*)data, len);
+
+    if (error) {
+        Serial.print("Falha ao interpretar JSON: ");
+        Serial.println(error.c_str());
+        return;
+    }
+
+    // Os comandos para o laco viram um lote, montado e validado aqui, fora
+    // da tarefa de controle, e aplicado inteiro no proximo ciclo. A ordem do
+    // lote e a ordem de aplicacao: modo e planta antes dos ganhos, para que
+    // os ganhos enviados vao para a rede escolhida.
+    ControlCommand_t batch[CONTROL_COMMAND_MAX_BATCH];
+    int count = 0;
+    memset(batch, 0, sizeof(batch));
+
+    if (doc.containsKey("duas_malhas")) {
+        batch[count].type = CONTROL_CMD_DUAL;
+        batch[count++].dual = doc["duas_malhas"];
+    }
+
+    if (doc.containsKey("planta") && doc.containsKey("combinacao")) {
+        batch[count].type = CONTROL_CMD_PLANT;
+        batch[count].plant.plant_id = doc["planta"];
+        batch[count++].plant.combination = doc["combinacao"];
+    }
+
+    if (doc.containsKey("kp") && doc.containsKey("ki") && doc.containsKey("kd")) {
+        batch[count].type = CONTROL_CMD_TUNINGS;
+        batch[count].tunings.kp = doc["kp"];
+        batch[count].tunings.ki = doc["ki"];
+        batch[count++].tunings.kd = doc["kd"];
+    }
+
+    // valor usado para o calculo nunca e maior que VCC ou menor que 0
+    if (doc.containsKey("setpoint_v")) {
+        batch[count].type = CONTROL_CMD_SETPOINT;
+        batch[count++].sp = control_command_setpoint_counts(doc["setpoint_v"]);
+    }
+
+    // Perfil de setpoint em texto (formato em setpoint.h); "parar" ou vazio
+    // volta ao setpoint manual. Todos os eventos do WebSocket rodam na mesma
+    // tarefa, que e a unica a escrever no buffer de perfil.
+    SetpointProfile_t *profile = NULL;
+    char profile_error[48] = "";
+    if (doc.containsKey("perfil")) {
+        const char *text = doc["perfil"];
+        batch[count].type = CONTROL_CMD_PROFILE;
+        if (text == NULL || text[0] == '\0' || strcmp(text, "parar") == 0) {
+            batch[count++].profile_start = false;
+        } else if (setpoint_profile_parse(text, control_loop_profile_buffer(), profile_error, sizeof(profile_error))) {
+            profile = control_loop_profile_buffer();
+            batch[count++].profile_start = true;
+        }
+    }
+
+    // Sintonia automatica: "autotune": "zn" | "tl" | "simc" | "cancelar",
+    // com "autotune_amplitude" opcional (contagens do DAC)
+    if (doc.containsKey("autotune")) {
+        const char *rule_name = doc["autotune"];
+        int rule = -1;
+        if (rule_name != NULL) {
+            if (strcmp(rule_name, "zn") == 0) rule = AUTOTUNE_RULE_ZN;
+            else if (strcmp(rule_name, "tl") == 0) rule = AUTOTUNE_RULE_TL;
+            else if (strcmp(rule_name, "simc") == 0) rule = AUTOTUNE_RULE_SIMC;
+        }
+        batch[count].type = CONTROL_CMD_AUTOTUNE;
+        batch[count].autotune.rule = rule;
+        batch[count++].autotune.amplitude = doc.containsKey("autotune_amplitude") ? (double)doc["autotune_amplitude"]
+                                                                                  : AUTOTUNE_DEFAULT_AMPLITUDE;
+    }
+
+    // Identificacao em linha: "identificacao": {"excitacao" (contagens do
+    // DAC, 0 desliga), "referencia": true (modelo atual da rede ativa vira a
+    // referencia da deriva), "reiniciar": true (recomeca o modelo dela)}
+    if (doc.containsKey("identificacao")) {
+        JsonVariant ident = doc["identificacao"];
+        batch[count].type = CONTROL_CMD_IDENT;
+        batch[count].ident.excitation = ident["excitacao"].isNull() ? -1.0 : ident["excitacao"].as<double>();
+        batch[count++].ident.action = ident["reiniciar"].as<bool>()    ? IDENT_ACTION_RESET
+                                      : ident["referencia"].as<bool>() ? IDENT_ACTION_REFERENCE
+                                                                       : IDENT_ACTION_NONE;
+    }
+
+    // Algoritmo da malha simples: "controlador": "pid" | "mpc", com
+    // "mpc_peso" opcional (peso dos incrementos de u). O MPC precisa do
+    // modelo identificado da rede ativa.
+    if (doc.containsKey("controlador")) {
+        const char *name = doc["controlador"];
+        batch[count].type = CONTROL_CMD_CONTROLLER;
+        batch[count].controller.kind = (name != NULL && strcmp(name, "mpc") == 0) ? CONTROLLER_MPC
+                                     : (name != NULL && strcmp(name, "pid") == 0) ? CONTROLLER_PID : -1;
+        batch[count++].controller.weight = doc.containsKey("mpc_peso") ? (double)doc["mpc_peso"] : -1.0;
+    }
+
+    // "id" opcional: com ele, a tarefa de controle confirma o lote
+    ControlAck_t ack;
+    memset(&ack, 0, sizeof(ack));
+    ack.client = client->id();
+    ack.id = doc.containsKey("id") ? doc["id"].as<uint16_t>() : 0;
+    ack.status = CONTROL_ACK_APPLIED;
+    for (int i = 0; i < count; i++) {
+        batch[i].id = ack.id;
+        batch[i].client = ack.client;
+        if (ack.status == CONTROL_ACK_APPLIED && !control_command_valid(&batch[i])) {
+            ack.status = CONTROL_ACK_INVALID;
+            ack.type = batch[i].type;
+        }
+    }
+    if (count > 0 && ack.status == CONTROL_ACK_APPLIED) {
+        if (profile != NULL) control_loop_deliver_profile();
+        if (!control_loop_submit(batch, count)) ack.status = CONTROL_ACK_QUEUE_FULL;
+    }
+    if (ack.status != CONTROL_ACK_APPLIED) {
+        web_server_reply_ack(client, &ack);
+    } else {
+        for (int i = 0; i < count; i++) {
+            const ControlCommand_t *c = &batch[i];
+            if (c->type == CONTROL_CMD_TUNINGS) {
+                Serial.printf("Ganhos PID pedidos: Kp=%.3f, Ki=%.3f, Kd=%.3f\n", c->tunings.kp, c->tunings.ki, c->tunings.kd);
+            } else if (c->type == CONTROL_CMD_PLANT) {
+                Serial.printf("Planta %d, combinacao %d pedida\n", (int)c->plant.plant_id, (int)c->plant.combination);
+            } else if (c->type == CONTROL_CMD_DUAL) {
+                Serial.printf("Modo de duas malhas: %s\n", c->dual ? "ligado" : "desligado");
+            } else if (c->type == CONTROL_CMD_SETPOINT) {
+                Serial.printf("Setpoint recebido: %.4f V -> Convertido para: %.0f\n", (double)doc["setpoint_v"], c->sp);
+            } else if (c->type == CONTROL_CMD_AUTOTUNE) {
+                if (c->autotune.rule >= 0) Serial.printf("Sintonia automatica pedida: regra %d, d=%.0f\n", (int)c->autotune.rule, c->autotune.amplitude);
+                else Serial.println("Sintonia automatica cancelada");
+            } else if (c->type == CONTROL_CMD_CONTROLLER) {
+                Serial.printf("Controlador pedido: %s\n", controller_kind_name(c->controller.kind));
+            } else if (c->type == CONTROL_CMD_IDENT) {
+                Serial.printf("Identificacao: excitacao %.0f, acao %d\n", c->ident.excitation, (int)c->ident.action);
+            }
+        }
+    }
+
+    // Resultado do perfil so para quem enviou:
+    // {"perfil": {"estado", "segmentos", "duracao_s"}} ou o erro
+    if (doc.containsKey("perfil")) {
+        StaticJsonDocument<192> reply;
+        JsonObject result = reply.createNestedObject("perfil");
+        if (profile_error[0] != '\0') {
+            result["estado"] = "erro";
+            result["erro"] = profile_error;
+            Serial.printf("Perfil de setpoint rejeitado: %s\n", profile_error);
+        } else if (ack.status != CONTROL_ACK_APPLIED) {
+            result["estado"] = "erro";
+            result["erro"] = control_ack_status_name(ack.status);
+        } else if (profile == NULL) {
+            result["estado"] = "parado";
+        } else {
+            result["estado"] = "rodando";
+            result["segmentos"] = profile->count;
+            result["repetir"] = profile->repeat;
+            result["duracao_s"] = profile->total_samples * SAMPLE_TIME_S;
+            Serial.printf("Perfil de setpoint: %u segmentos, %.1f s\n", profile->count,
+                          profile->total_samples * SAMPLE_TIME_S);
+        }
+
+        char json_buffer[192];
+        serializeJson(reply, json_buffer, sizeof(json_buffer));
+        client->text(json_buffer);
+    }
+
+    // Comandos que nao passam pelo laco de controle
+
+    if (doc.containsKey("filtro_adc")) {
+        int mode = doc["filtro_adc"];
+        if (mode >= ADC_DECIMATE_MEAN && mode <= ADC_DECIMATE_BOXCAR) {
+            adc_acquisition_set_mode((AdcDecimation_t)mode);
+            Serial.printf("Filtro do ADC: %d\n", mode);
+        }
+    }
+
+    // Calibracao do ADC de um canal (adc_calibration.h): {"calibracao_adc":
+    // {"planta": 1, "tabela": [ADC_CAL_POINTS valores corrigidos, em
+    // contagens]}}; sem "tabela", o canal volta a identidade. A tarefa de
+    // controle adota a tabela na proxima leitura e a
+    // combination_selector_task a grava.
+    if (doc.containsKey("calibracao_adc")) {
+        JsonVariant request = doc["calibracao_adc"];
+        int plant_id = request["planta"].as<int>();
+        JsonVariant values = request["tabela"];
+        AdcCalibration_t calibration;
+        AdcCalibration_t identity;
+        adc_calibration_get(&calibration);
+        adc_calibration_identity(&identity);
+        float table[ADC_CAL_POINTS];
+        bool valid = (plant_id == 1 || plant_id == 2) && (values.isNull() || values.size() == ADC_CAL_POINTS);
+        for (int i = 0; valid && i < ADC_CAL_POINTS; i++) {
+            table[i] = values.isNull() ? identity.corrected[plant_id - 1][i] : values[i].as<float>();
+        }
+        if (valid && adc_calibration_table_valid(table)) {
+            memcpy(calibration.corrected[plant_id - 1], table, sizeof(table));
+            calibration.revision++;
+            adc_calibration_set(&calibration);
+            Serial.printf("Calibracao do ADC da planta %d trocada\n", plant_id);
+        } else {
+            Serial.println("Calibracao do ADC recusada: planta ou tabela invalida");
+        }
+    }
+
+    // Varredura programada pelas redes da tabela de ganhos, com
+    // "varredura_s" opcional (permanencia em cada rede, em segundos)
+    if (doc.containsKey("varredura")) {
+        bool sweep = doc["varredura"];
+        uint32_t dwell_ms = doc.containsKey("varredura_s") ? (uint32_t)((double)doc["varredura_s"] * 1000.0) : 0;
+        gain_schedule_request_sweep(sweep, dwell_ms);
+        Serial.printf("Varredura das redes: %s\n", sweep ? "ligada" : "desligada");
+    }
+
+    // Historico em varias resolucoes (history.h): "janela_s" (0: tudo),
+    // "resolucao_ms" opcional (0: automatica) e "id" devolvido no quadro
+    if (doc.containsKey("historico")) {
+        uint32_t window_s = doc["historico"]["janela_s"].isNull() ? HISTORY_DEFAULT_WINDOW_S : doc["historico"]["janela_s"].as<uint32_t>();
+        uint32_t resolution_ms = doc["historico"]["resolucao_ms"].as<uint32_t>();
+        uint16_t id = doc["historico"]["id"].as<uint16_t>();
+        web_server_request_history(client->id(), id, window_s, resolution_ms);
+    }
+
+    // Canais e decimacao da telemetria deste cliente (subscriptions.h):
+    // {"assinar": {"canais": ["sp", "y", ...], "decimacao": N}}
+    if (doc.containsKey("assinar")) {
+        uint8_t channels = 0;
+        JsonVariant names = doc["assinar"]["canais"];
+        for (size_t i = 0; i < names.size(); i++) {
+            uint8_t channel = subscriptions_channel_from_name(names[(int)i].as<const char*>());
+            if (channel == 0) Serial.printf("Canal desconhecido: %s\n", names[(int)i].as<const char*>());
+            channels |= channel;
+        }
+        uint32_t decimation = doc["assinar"]["decimacao"].isNull() ? 1 : doc["assinar"]["decimacao"].as<uint32_t>();
+        if (decimation < 1) decimation = 1;
+        if (decimation > 255) decimation = 255;
+        web_server_request_subscription(client->id(), SUBSCRIPTION_SET, channels, (uint8_t)decimation);
+    }
+
+    // Quadro de metricas do laco pelo WebSocket (loop_metrics.h), so para
+    // este cliente
+    if (doc.containsKey("metricas")) {
+        bool metrics = doc["metricas"];
+        web_server_request_subscription(client->id(), metrics ? SUBSCRIPTION_ADD : SUBSCRIPTION_REMOVE,
+                                        SUBSCRIPTION_CHANNEL_METRICS, 0);
+    }
+
+    if (doc.containsKey("gravar")) {
+        bool record = doc["gravar"];
+        if (record) run_recorder_request_start();
+        else run_recorder_request_stop();
+        Serial.printf("Gravacao da execucao: %s\n", record ? "ligada" : "desligada");
+    }
+}
+
+// Roda na tarefa do AsyncTCP: nada aqui segura o estado do controlador nem
+// espera pela tarefa de controle
 void on_web_socket_event(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len) {
     if (type == WS_EVT_CONNECT) {
         Serial.printf("Cliente WebSocket conectado: #%u\n", client->id());
+        web_server_request_subscription(client->id(), SUBSCRIPTION_SET, SUBSCRIPTION_CHANNELS_DEFAULT, 1);
+        // O grafico de quem chega comeca com o passado recente
+        web_server_request_history(client->id(), 0, HISTORY_DEFAULT_WINDOW_S, 0);
     } else if (type == WS_EVT_DISCONNECT) {
         Serial.printf("Cliente WebSocket desconectado: #%u\n", client->id());
+        web_server_request_subscription(client->id(), SUBSCRIPTION_DISCONNECT, 0, 0);
     } else if (type == WS_EVT_DATA) {
         AwsFrameInfo *info = (AwsFrameInfo*)arg;
-        if (info->final && info->index == 0 && info->len == len && info->opcode == WS_TEXT) {
-            
-            StaticJsonDocument<256> doc;
-            DeserializationError error = deserializeJson(doc, (char*)data, len);
-
-            if (error) {
-                Serial.print("Falha ao interpretar JSON: ");
-                Serial.println(error.c_str());
-                return;
-            }
+        if (!info->final || info->index != 0 || info->len != len) return;
+        if (info->opcode == WS_TEXT) web_server_handle_json(client, data, len);
+        else if (info->opcode == WS_BINARY) web_server_handle_binary(client, data, len);
+    }
+}
 
-            if (xSemaphoreTake(xStateMutex, portMAX_DELAY) == pdTRUE) {
-                // Atualizacao das variaveis do sistema a partir do JSON recebido
-                if (doc.containsKey("kp") && doc.containsKey("ki") && doc.containsKey("kd")) {
-                    controller_set_tunings(doc["kp"], doc["ki"], doc["kd"]);
-                    Serial.printf("Ganhos PID atualizados: Kp=%.3f, Ki=%.3f, Kd=%.3f\n", (double)doc["kp"], (double)doc["ki"], (double)doc["kd"]);
-                }
-
-                if (doc.containsKey("planta") && doc.containsKey("combinacao")) {
-                    g_systemState.active_plant = doc["planta"];
-                    g_systemState.mux_combination = doc["combinacao"];
-                    mux_report_selection(g_systemState.active_plant, g_systemState.mux_combination);
-                }
-
-                if (doc.containsKey("setpoint_v")) {
-                    double received_sp_voltage = doc["setpoint_v"];
-
-                    // valor usado para o calculo nunca seja maior que VCC ou menor que 0
-                    if (received_sp_voltage > VCC) {
-                        received_sp_voltage = VCC;
-                    } else if (received_sp_voltage < 0.0) {
-                        received_sp_voltage = 0.0;
-                    }
-
-                    //Conversao e atualizacaoo com o valor já validado e 
-                    g_systemState.sp = (received_sp_voltage / VCC) * ADC_RESOLUTION;
-                    
-                    Serial.printf("Setpoint recebido: %.4f V -> Valor usado: %.4f V -> Convertido para: %.0f\n", 
-                                  (double)doc["setpoint_v"], received_sp_voltage, g_systemState.sp);
-                }
-                
-                xSemaphoreGive(xStateMutex);
-            }
-        }
+// Arquivo gravado no firmware: 304 se o navegador ja tem esta versao, senao
+// os bytes em gzip direto da flash. Um cliente sem gzip recebe a copia do
+// SPIFFS, se houver.
+static void web_server_send_asset(AsyncWebServerRequest *request, const WebAsset_t *asset) {
+    const char *if_none_match = request->hasHeader("If-None-Match") ? request->getHeader("If-None-Match")->value().c_str() : nullptr;
+    if (web_assets_etag_matches(asset, if_none_match)) {
+        AsyncWebServerResponse *response = request->beginResponse(304, asset->content_type, String());
+        response->addHeader("ETag", asset->etag);
+        response->addHeader("Cache-Control", asset->cache_control);
+        request->send(response);
+        return;
     }
+
+    const char *accept_encoding = request->hasHeader("Accept-Encoding") ? request->getHeader("Accept-Encoding")->value().c_str() : nullptr;
+    if (!web_assets_accepts_gzip(accept_encoding) && SPIFFS.exists(asset->path)) {
+        request->send(SPIFFS, asset->path, asset->content_type);
+        return;
+    }
+
+    AsyncWebServerResponse *response = request->beginResponse_P(200, asset->content_type, asset->data, asset->size);
+    response->addHeader("Content-Encoding", "gzip");
+    response->addHeader("ETag", asset->etag);
+    response->addHeader("Cache-Control", asset->cache_control);
+    response->addHeader("Vary", "Accept-Encoding");
+    request->send(response);
+}
+
+// Envia length bytes de um bloco sem passar por uma String no heap: a
+// resposta copia o bloco em pedacos direto para o envio do AsyncTCP e o
+// segura ate ser destruida (enviada ou com a conexao caida); o deleter do
+// shared_ptr libera o bloco.
+static void web_server_send_block(AsyncWebServerRequest *request, const char *type,
+                                  std::shared_ptr<char> block, size_t length) {
+    AwsResponseFiller filler = [block, length](uint8_t *buffer, size_t max_len, size_t index) -> size_t {
+        if (index >= length) return 0;
+        size_t n = (length - index < max_len) ? length - index : max_len;
+        memcpy(buffer, block.get() + index, n);
+        return n;
+    };
+    request->send(request->beginResponse(type, length, filler));
+}
+
+// Responde com o documento serializado em um buffer do pool de JSON
+// (memory_budget.h), que volta ao pool quando a resposta termina. Sem
+// buffer livre, 503.
+static void web_server_send_json(AsyncWebServerRequest *request, const JsonDocument &doc) {
+    char *json = g_jsonBuffers.acquire();
+    if (json == nullptr) {
+        request->send(503, "text/plain", "sem buffer de JSON livre");
+        return;
+    }
+    size_t length = serializeJson(doc, json, JSON_BUFFER_SIZE);
+    std::shared_ptr<char> block(json, [](char *p) { g_jsonBuffers.release(p); });
+    web_server_send_block(request, "application/json", block, length);
 }
 
 void setup_web_server() {
@@ -70,6 +475,211 @@ void setup_web_server() {
 
      // --- Configuração das rotas do Web Service ---
 
+    // Lista das execucoes gravadas (run_recorder.h)
+    server.on("/runs", HTTP_GET, [](AsyncWebServerRequest *request) {
+        RunFileInfo_t files[RUN_MAX_FILES];
+        int count = run_storage_list(files, RUN_MAX_FILES);
+
+        StaticJsonDocument<768> doc;
+        doc["gravando"] = run_recorder_is_recording();
+        JsonArray runs = doc.createNestedArray("execucoes");
+        for (int i = 0; i < count; i++) {
+            JsonObject run = runs.createNestedObject();
+            run["nome"] = files[i].name;
+            run["bytes"] = files[i].size;
+        }
+
+        web_server_send_json(request, doc);
+    });
+
+    // Download de uma execucao: /run?nome=run_0001.bin
+    server.on("/run", HTTP_GET, [](AsyncWebServerRequest *request) {
+        if (!request->hasParam("nome")) {
+            request->send(400, "text/plain", "parametro 'nome' ausente");
+            return;
+        }
+        String name = request->getParam("nome")->value();
+        if (name.indexOf('/') >= 0 || !name.endsWith(".bin")) {
+            request->send(400, "text/plain", "nome invalido");
+            return;
+        }
+        String path = String("/runs/") + name;
+        if (!SPIFFS.exists(path)) {
+            request->send(404, "text/plain", "execucao nao encontrada");
+            return;
+        }
+        request->send(SPIFFS, path, "application/octet-stream", true);
+    });
+
+    // Modelos identificados em linha (identification.h), por rede. Relatorio
+    // e documento estaticos, como o buffer do /metrics.
+    server.on("/identificacao", HTTP_GET, [](AsyncWebServerRequest *request) {
+        static IdentReport_t report;
+        ident_report_read(&report);
+
+        static StaticJsonDocument<3072> doc;
+        doc.clear();
+        doc["ciclo"] = report.cycle;
+        doc["excitacao"] = report.excitation;
+        JsonArray models = doc.createNestedArray("modelos");
+        for (int i = 0; i < GAIN_SCHEDULE_ENTRIES; i++) {
+            const IdentModel_t *m = &report.models[i];
+            if (m->updates == 0) continue;
+            JsonObject model = models.createNestedObject();
+            model["planta"] = i / GAIN_SCHEDULE_COMBINATIONS + 1;
+            model["combinacao"] = i % GAIN_SCHEDULE_COMBINATIONS;
+            model["ordem"] = m->order;
+            model["amostras"] = m->updates;
+            model["valido"] = (m->flags & IDENT_MODEL_VALID) != 0;
+            model["ganho"] = m->gain;
+            model["tau_s"] = m->tau_s;
+            model["atraso_s"] = m->theta_s;
+            model["tau1_s"] = m->tau1_s;
+            model["tau2_s"] = m->tau2_s;
+            model["offset_v"] = m->offset_v;
+            model["erro_v"] = m->rms_error_v;
+            JsonArray a = model.createNestedArray("a");
+            JsonArray b = model.createNestedArray("b");
+            for (uint32_t k = 0; k < m->order; k++) a.add(m->a[k]);
+            for (int k = 0; k < IDENT_INPUT_TERMS; k++) b.add(m->b[k]);
+            model["c"] = m->c;
+            if (m->flags & IDENT_MODEL_REFERENCE) {
+                model["ganho_ref"] = m->gain_ref;
+                model["tau_ref_s"] = m->tau_ref_s;
+                model["deriva"] = m->drift;
+                model["derivando"] = (m->flags & IDENT_MODEL_DRIFT) != 0;
+            }
+        }
+
+        web_server_send_json(request, doc);
+    });
+
+    // Ultimos degraus analisados de cada rede (step_response.h)
+    server.on("/degraus", HTTP_GET, [](AsyncWebServerRequest *request) {
+        static StepReport_t report;
+        step_response_report_read(&report);
+
+        static StaticJsonDocument<4096> doc;
+        doc.clear();
+        doc["seq"] = report.seq;
+        JsonArray networks = doc.createNestedArray("redes");
+        for (int i = 0; i < GAIN_SCHEDULE_ENTRIES; i++) {
+            const StepHistory_t *history = &report.networks[i];
+            if (history->count == 0) continue;
+            JsonObject network = networks.createNestedObject();
+            network["planta"] = i / GAIN_SCHEDULE_COMBINATIONS + 1;
+            network["combinacao"] = i % GAIN_SCHEDULE_COMBINATIONS;
+            network["total"] = history->count;
+            JsonArray steps = network.createNestedArray("degraus");
+            uint32_t kept = history->count < (uint32_t)STEP_HISTORY ? history->count : STEP_HISTORY;
+            for (uint32_t k = history->count - kept; k < history->count; k++) {
+                const StepResult_t *step = &history->steps[k % STEP_HISTORY];
+                JsonObject entry = steps.createNestedObject();
+                entry["seq"] = step->seq;
+                entry["ciclo"] = step->cycle;
+                entry["estado"] = step_response_state_name(step->flags);
+                entry["de_v"] = step->from_v;
+                entry["para_v"] = step->to_v;
+                entry["subida_s"] = step->rise_s;
+                entry["sobressinal_pct"] = step->overshoot_pct;
+                entry["acomodacao_s"] = step->settling_s;
+                entry["erro_regime_v"] = step->steady_error_v;
+                entry["iae"] = step->iae;
+                entry["duracao_s"] = step->duration_s;
+            }
+        }
+
+        web_server_send_json(request, doc);
+    });
+
+    // Orcamento de memoria (memory_budget.h): heap, pilhas das tarefas e
+    // uso dos pools
+    server.on("/memoria", HTTP_GET, [](AsyncWebServerRequest *request) {
+        static MemoryBudget_t budget;
+        memory_budget_read(&budget);
+
+        static StaticJsonDocument<2048> doc;
+        doc.clear();
+        doc["partida_concluida"] = budget.sealed;
+        if (budget.heap.total > 0) {
+            JsonObject heap = doc.createNestedObject("heap");
+            heap["total"] = budget.heap.total;
+            heap["livre"] = budget.heap.free;
+            heap["minimo_livre"] = budget.heap.min_free;
+            heap["maior_bloco"] = budget.heap.largest_block;
+            if (budget.sealed) heap["livre_na_partida"] = budget.heap_free_at_seal;
+        }
+        if (budget.tracking) {
+            JsonObject allocations = doc.createNestedObject("alocacoes");
+            allocations["partida"] = budget.allocations_boot;
+            allocations["outras_tarefas"] = budget.allocations_other;
+            allocations["violacoes"] = budget.violations;
+        }
+        doc["pilhas_estaticas"] = budget.static_stack_bytes;
+        JsonArray tasks = doc.createNestedArray("tarefas");
+        for (int i = 0; i < LOOP_TASK_COUNT; i++) {
+            const MemoryTaskBudget_t *task = &budget.tasks[i];
+            if (!task->registered) continue;
+            JsonObject entry = tasks.createNestedObject();
+            entry["nome"] = loop_metrics_task_name((LoopTask_t)i);
+            entry["pilha"] = task->stack_bytes;
+            entry["pilha_livre_min"] = task->stack_free_min;
+            entry["estatica"] = task->static_stack;
+            entry["sem_heap"] = task->no_heap;
+            if (budget.tracking) entry["alocacoes"] = task->allocations;
+        }
+        JsonArray pools = doc.createNestedArray("pools");
+        for (int i = 0; i < MEMORY_POOL_COUNT; i++) {
+            const BufferPoolStats_t *pool = &budget.pools[i];
+            JsonObject entry = pools.createNestedObject();
+            entry["nome"] = memory_budget_pool_name((MemoryPool_t)i);
+            entry["blocos"] = pool->blocks;
+            entry["bytes_bloco"] = pool->block_size;
+            entry["em_uso"] = pool->in_use;
+            entry["pico"] = pool->peak;
+            entry["entregues"] = pool->acquired;
+            entry["faltas"] = pool->exhausted;
+        }
+        web_server_send_json(request, doc);
+    });
+
+    // Metricas de tempo do laco de controle (loop_metrics.h), da partida
+    // (boot.h), dos modelos identificados (identification.h), dos degraus
+    // (step_response.h) e da memoria (memory_budget.h) em texto. O buffer e
+    // estatico (as rotas e o envio rodam todos na tarefa do AsyncTCP) e a
+    // resposta o segura ate terminar de ser enviada; outro pedido nesse
+    // meio tempo recebe 503.
+    server.on("/metrics", HTTP_GET, [](AsyncWebServerRequest *request) {
+        static char text[LOOP_METRICS_TEXT_SIZE];
+        static bool sending = false;
+        if (sending) {
+            request->send(503, "text/plain", "metricas ainda sendo enviadas");
+            return;
+        }
+        size_t length = loop_metrics_format_text(text, sizeof(text));
+        length += boot_format_text(text + length, sizeof(text) - length);
+        length += ident_format_text(text + length, sizeof(text) - length);
+        length += step_response_format_text(text + length, sizeof(text) - length);
+        length += memory_budget_format_text(text + length, sizeof(text) - length);
+        sending = true;
+        std::shared_ptr<char> block(text, [](char *) { sending = false; });
+        web_server_send_block(request, "text/plain; version=0.0.4", block, length);
+    });
+
+    // Paginas do painel gravadas no firmware (web_assets.h); o que nao
+    // estiver la (ou tudo, com -DWEB_ASSETS_FROM_SPIFFS) vem do SPIFFS
+    for (int i = 0; i < web_assets_count(); i++) {
+        const WebAsset_t *asset = web_assets_get(i);
+        server.on(asset->path, HTTP_GET, [asset](AsyncWebServerRequest *request) {
+            web_server_send_asset(request, asset);
+        });
+    }
+    if (const WebAsset_t *index = web_assets_find("/")) {
+        server.on("/", HTTP_GET, [index](AsyncWebServerRequest *request) {
+            web_server_send_asset(request, index);
+        });
+    }
+
     server.serveStatic("/", SPIFFS, "/").setDefaultFile("index.html");
     Serial.println("Servidor Web e WebSocket iniciados.");
 }
\ No newline at end of file
@@ -4,6 +4,8 @@
 #define WEB_SERVER_H
 
 #include <ESPAsyncWebServer.h> 
+#include "history.h"
+#include "subscriptions.h"
 //#include <config.h>
 //#include <AsyncTCP.h>
 
@@ -12,4 +14,24 @@ extern AsyncWebSocket ws;
 void on_web_socket_event(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len);
 void setup_web_server();
 
+// Envia aos clientes as confirmacoes dos lotes de comandos que a tarefa de
+// controle aplicou (control_loop_drain_acks). Chamado pela tarefa que envia a
+// telemetria; e a unica consumidora das confirmacoes.
+void web_server_send_acks();
+
+// Consulta ao historico (history.h) de um cliente: a pagina pede com
+// {"historico": {"janela_s", "resolucao_ms", "id"}}, e todo cliente novo
+// recebe as ultimas HISTORY_DEFAULT_WINDOW_S sem pedir
+typedef struct {
+    uint32_t client;
+    HistoryQuery_t query;
+} HistoryRequest_t;
+
+// Proxima consulta pendente; so a tarefa que mantem o historico chama
+bool web_server_next_history_request(HistoryRequest_t *request);
+
+// Proximo pedido de assinatura pendente (conexao, {"assinar"},
+// {"metricas"}, desconexao); so a tarefa que envia a telemetria chama
+bool web_server_next_subscription_request(SubscriptionRequest_t *request);
+
 #endif // WEB_SERVER_H
\ No newline at end of file
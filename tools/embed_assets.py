@@ -0,0 +1,210 @@
+# tools/embed_assets.py
+#
+# Gera include/web_assets_data.h a partir de data/: cada pagina e minificada
+# (sem mudar o que o navegador executa), comprimida com gzip e gravada como
+# um vetor constexpr no firmware, com um ETag forte (hash do conteudo
+# servido). O index.html passa a pedir os outros arquivos com ?v=<hash>,
+# entao eles podem ficar em cache por um ano: qualquer mudanca troca a URL.
+#
+# Roda sozinho a cada build do ESP32 (extra_scripts em platformio.ini) e
+# tambem direto:
+#     python3 tools/embed_assets.py [--data data] [--out include/web_assets_data.h] [--no-minify]
+#
+# A saida e deterministica (gzip sem data), entao o arquivo so muda quando
+# data/ muda e o build nao recompila a toa.
+
+import gzip
+import hashlib
+import os
+import re
+import sys
+
+CONTENT_TYPES = {
+    ".html": "text/html",
+    ".css": "text/css",
+    ".js": "application/javascript",
+    ".json": "application/json",
+    ".svg": "image/svg+xml",
+    ".ico": "image/x-icon",
+    ".png": "image/png",
+}
+
+CACHE_IMMUTABLE = "public, max-age=31536000, immutable"
+CACHE_REVALIDATE = "no-cache"
+
+
+def minify_css(text):
+    text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+    text = re.sub(r"\s+", " ", text)
+    text = re.sub(r"\s*([{};:,>])\s*", r"\1", text)
+    return text.replace(";}", "}").strip()
+
+
+# Tira comentarios e a indentacao; o conteudo de <textarea> e <pre> fica
+# como esta (ali os espacos fazem parte do valor)
+def minify_html(text):
+    text = re.sub(r"<!--.*?-->", "", text, flags=re.S)
+    out = []
+    keep = False
+    for line in text.split("\n"):
+        if keep:
+            out.append(line)
+        elif line.strip():
+            out.append(line.strip())
+        opened = len(re.findall(r"<(textarea|pre)\b", line))
+        closed = len(re.findall(r"</(textarea|pre)>", line))
+        if opened > closed:
+            keep = True
+        elif closed > opened:
+            keep = False
+    return "\n".join(out) + "\n"
+
+
+# So o que e seguro sem um parser: indentacao, linhas vazias e linhas que sao
+# so comentario. Arquivos ja minificados (chart.js) passam sem mudanca; se
+# houver template string de varias linhas, o arquivo fica como esta.
+def minify_js(text):
+    lines = text.split("\n")
+    if any(line.count("`") % 2 for line in lines):
+        return text
+    out = []
+    for line in lines:
+        stripped = line.strip()
+        if not stripped or stripped.startswith("//"):
+            continue
+        out.append(stripped)
+    return "\n".join(out) + "\n"
+
+
+MINIFIERS = {".css": minify_css, ".html": minify_html, ".js": minify_js}
+
+
+def load_assets(data_dir, minify):
+    assets = []
+    for name in sorted(os.listdir(data_dir)):
+        ext = os.path.splitext(name)[1].lower()
+        if ext not in CONTENT_TYPES:
+            continue
+        with open(os.path.join(data_dir, name), "rb") as f:
+            raw = f.read()
+        body = raw
+        if minify and ext in MINIFIERS:
+            body = MINIFIERS[ext](raw.decode("utf-8")).encode("utf-8")
+        assets.append({"name": name, "ext": ext, "raw_size": len(raw), "body": body})
+    return assets
+
+
+def compress(body):
+    return gzip.compress(body, compresslevel=9, mtime=0)
+
+
+def finish(asset):
+    asset["gzip"] = compress(asset["body"])
+    asset["hash"] = hashlib.sha256(asset["gzip"]).hexdigest()[:16]
+
+
+# Os arquivos citados pelo index.html ganham ?v=<hash> (o hash deles e
+# calculado antes do index)
+def version_references(index, others):
+    text = index["body"].decode("utf-8")
+    for asset in others:
+        pattern = r'((?:src|href)=")' + re.escape(asset["name"]) + r'(")'
+        text = re.sub(pattern, r"\g<1>" + asset["name"] + "?v=" + asset["hash"] + r"\g<2>", text)
+    index["body"] = text.encode("utf-8")
+
+
+def c_identifier(name):
+    return "WEB_ASSET_" + re.sub(r"[^A-Za-z0-9]", "_", name).upper()
+
+
+def render(assets):
+    lines = [
+        "// include/web_assets_data.h",
+        "//",
+        "// Gerado por tools/embed_assets.py a partir de data/ -- nao editar.",
+        "// Incluido apenas por src/web_assets.cpp.",
+        "",
+        "#ifndef WEB_ASSETS_DATA_H",
+        "#define WEB_ASSETS_DATA_H",
+        "",
+    ]
+    for asset in assets:
+        data = asset["gzip"]
+        lines.append("// %s: %d bytes, %d minificado, %d com gzip" % (
+            asset["name"], asset["raw_size"], len(asset["body"]), len(data)))
+        lines.append("alignas(4) constexpr uint8_t %s[%d] = {" % (c_identifier(asset["name"]), len(data)))
+        for i in range(0, len(data), 20):
+            lines.append("    " + ",".join("0x%02x" % b for b in data[i:i + 20]) + ",")
+        lines.append("};")
+        lines.append("")
+
+    lines.append("constexpr WebAsset_t WEB_ASSETS[] = {")
+    for asset in assets:
+        cache = CACHE_REVALIDATE if asset["name"] == "index.html" else CACHE_IMMUTABLE
+        lines.append('    {"/%s", "%s", %s, sizeof(%s), "\\"%s\\"", "%s"},' % (
+            asset["name"], CONTENT_TYPES[asset["ext"]], c_identifier(asset["name"]),
+            c_identifier(asset["name"]), asset["hash"], cache))
+    lines.append("};")
+    lines.append("")
+    lines.append("#endif // WEB_ASSETS_DATA_H")
+    return "\n".join(lines) + "\n"
+
+
+def generate(data_dir, out_path, minify=True, quiet=False):
+    assets = load_assets(data_dir, minify)
+    index = next((a for a in assets if a["name"] == "index.html"), None)
+    others = [a for a in assets if a is not index]
+    for asset in others:
+        finish(asset)
+    if index is not None:
+        version_references(index, others)
+        finish(index)
+
+    text = render(assets)
+    previous = None
+    if os.path.exists(out_path):
+        with open(out_path) as f:
+            previous = f.read()
+    if previous != text:
+        os.makedirs(os.path.dirname(out_path), exist_ok=True)
+        with open(out_path, "w") as f:
+            f.write(text)
+
+    if not quiet:
+        raw = sum(a["raw_size"] for a in assets)
+        packed = sum(len(a["gzip"]) for a in assets)
+        print("embed_assets: %d arquivos, %d -> %d bytes (%s)" % (
+            len(assets), raw, packed, "atualizado" if previous != text else "sem mudanca"))
+        for a in assets:
+            print("  %-12s %7d -> %7d  %s" % (a["name"], a["raw_size"], len(a["gzip"]), a["hash"]))
+    return assets
+
+
+def main(argv):
+    root = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    data_dir = os.path.join(root, "data")
+    out_path = os.path.join(root, "include", "web_assets_data.h")
+    minify = True
+    i = 0
+    while i < len(argv):
+        if argv[i] == "--data":
+            data_dir = argv[i + 1]
+            i += 1
+        elif argv[i] == "--out":
+            out_path = argv[i + 1]
+            i += 1
+        elif argv[i] == "--no-minify":
+            minify = False
+        i += 1
+    generate(data_dir, out_path, minify)
+
+
+# PlatformIO executa o script com SCons (Import existe); direto, e um
+# script comum
+try:
+    Import("env")  # noqa: F821
+    generate(os.path.join(env.subst("$PROJECT_DIR"), "data"),  # noqa: F821
+             os.path.join(env.subst("$PROJECT_INCLUDE_DIR"), "web_assets_data.h"))  # noqa: F821
+except NameError:
+    if __name__ == "__main__":
+        main(sys.argv[1:])